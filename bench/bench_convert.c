@@ -0,0 +1,115 @@
+/*
+ * bench_convert.c - Pixel Conversion Micro-Benchmark
+ *
+ * Copyright (c) 2024 mikedx
+ * GitHub: https://github.com/mikedx/libretro_raylib
+ *
+ * This file is part of libretro_raylib.
+ *
+ * libretro_raylib is free software: you can redistribute it and/or modify
+ * it under the terms of the MIT License.
+ *
+ * Measures row conversion throughput (source GB/s) for every pixel format
+ * and every converter implementation available on this CPU, and checks each
+ * SIMD implementation against the scalar reference.
+ *
+ * Usage: bench_convert [width] [height] [iterations]
+ */
+
+#include "libretro_convert.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static const char* format_name(unsigned format) {
+    switch (format) {
+        case RETRO_PIXEL_FORMAT_0RGB1555: return "0RGB1555";
+        case RETRO_PIXEL_FORMAT_XRGB8888: return "XRGB8888";
+        case RETRO_PIXEL_FORMAT_RGB565: return "RGB565";
+        default: return "UNKNOWN";
+    }
+}
+
+int main(int argc, char* argv[]) {
+    unsigned width = (argc > 1) ? (unsigned)atoi(argv[1]) : 1920;
+    unsigned height = (argc > 2) ? (unsigned)atoi(argv[2]) : 1080;
+    unsigned iterations = (argc > 3) ? (unsigned)atoi(argv[3]) : 200;
+    if (width == 0 || height == 0 || iterations == 0) {
+        fprintf(stderr, "Usage: %s [width] [height] [iterations]\n", argv[0]);
+        return 1;
+    }
+
+    libretro_convert_init();
+
+    size_t pixels = (size_t)width * height;
+    uint8_t* src = (uint8_t*)malloc(pixels * 4);
+    uint32_t* dst = (uint32_t*)malloc(pixels * 4);
+    uint32_t* ref = (uint32_t*)malloc(pixels * 4);
+    if (!src || !dst || !ref) {
+        fprintf(stderr, "Failed to allocate benchmark buffers\n");
+        return 1;
+    }
+
+    // Deterministic pseudo-random source pixels
+    uint32_t seed = 0x12345678u;
+    for (size_t i = 0; i < pixels * 4; i++) {
+        seed = seed * 1664525u + 1013904223u;
+        src[i] = (uint8_t)(seed >> 24);
+    }
+
+    printf("%-10s %-8s %10s %10s %s\n", "format", "impl", "GB/s", "Mpix/s", "check");
+
+    int failures = 0;
+    static const unsigned formats[] = {
+        RETRO_PIXEL_FORMAT_XRGB8888, RETRO_PIXEL_FORMAT_RGB565, RETRO_PIXEL_FORMAT_0RGB1555
+    };
+
+    for (size_t f = 0; f < sizeof(formats) / sizeof(formats[0]); f++) {
+        unsigned format = formats[f];
+        size_t bpp = (format == RETRO_PIXEL_FORMAT_XRGB8888) ? 4 : 2;
+        size_t pitch = width * bpp;
+
+        libretro_convert_row_t reference = libretro_convert_get_row_impl(LIBRETRO_CONVERT_SCALAR, format);
+        for (unsigned y = 0; y < height; y++) {
+            reference(ref + (size_t)y * width, src + y * pitch, width);
+        }
+
+        for (int impl = 0; impl < LIBRETRO_CONVERT_IMPL_COUNT; impl++) {
+            libretro_convert_row_t convert = libretro_convert_get_row_impl((libretro_convert_impl_t)impl, format);
+            if (!convert) continue;
+
+            memset(dst, 0, pixels * 4);
+            for (unsigned y = 0; y < height; y++) {
+                convert(dst + (size_t)y * width, src + y * pitch, width);
+            }
+            bool match = memcmp(dst, ref, pixels * 4) == 0;
+            if (!match) failures++;
+
+            double start = now_seconds();
+            for (unsigned i = 0; i < iterations; i++) {
+                for (unsigned y = 0; y < height; y++) {
+                    convert(dst + (size_t)y * width, src + y * pitch, width);
+                }
+            }
+            double elapsed = now_seconds() - start;
+
+            double bytes = (double)pixels * bpp * iterations;
+            printf("%-10s %-8s %10.2f %10.1f %s\n",
+                   format_name(format), libretro_convert_impl_name((libretro_convert_impl_t)impl),
+                   bytes / elapsed / 1e9, (double)pixels * iterations / elapsed / 1e6,
+                   match ? "ok" : "MISMATCH");
+        }
+    }
+
+    free(src);
+    free(dst);
+    free(ref);
+    return failures ? 1 : 0;
+}
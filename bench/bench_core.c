@@ -0,0 +1,163 @@
+/*
+ * bench_core.c - Synthetic Core for the Frontend Benchmark
+ *
+ * Copyright (c) 2024 mikedx
+ * GitHub: https://github.com/mikedx/libretro_raylib
+ *
+ * This file is part of libretro_raylib.
+ *
+ * libretro_raylib is free software: you can redistribute it and/or modify
+ * it under the terms of the MIT License.
+ *
+ * A minimal libretro core that does just enough work to drive the frontend
+ * the way a real one does, and as little as possible of its own: every
+ * retro_run polls input, reads the joypad, redraws a band of rows of an
+ * XRGB8888 frame and sends one frame of 44.1 kHz stereo audio in a batch.
+ * Runs without content. Built as a shared library and loaded by
+ * bench_frontend like any other core.
+ */
+
+#include "libretro.h"
+#include <stdint.h>
+#include <string.h>
+
+#define BENCH_CORE_WIDTH 320
+#define BENCH_CORE_HEIGHT 240
+#define BENCH_CORE_FPS 60.0
+#define BENCH_CORE_SAMPLE_RATE 44100.0
+#define BENCH_CORE_AUDIO_FRAMES 735     // 44100 / 60
+#define BENCH_CORE_BAND_ROWS 30         // Rows redrawn per frame (1/8 of the frame)
+
+static retro_environment_t environ_cb;
+static retro_video_refresh_t video_cb;
+static retro_audio_sample_t audio_cb;
+static retro_audio_sample_batch_t audio_batch_cb;
+static retro_input_poll_t input_poll_cb;
+static retro_input_state_t input_state_cb;
+
+static uint32_t frame[BENCH_CORE_WIDTH * BENCH_CORE_HEIGHT];
+static int16_t audio[BENCH_CORE_AUDIO_FRAMES * 2];
+static unsigned frame_count;
+static int16_t phase;
+
+RETRO_API void retro_set_environment(retro_environment_t cb) {
+    environ_cb = cb;
+    bool no_game = true;
+    environ_cb(RETRO_ENVIRONMENT_SET_SUPPORT_NO_GAME, &no_game);
+}
+
+RETRO_API void retro_set_video_refresh(retro_video_refresh_t cb) { video_cb = cb; }
+RETRO_API void retro_set_audio_sample(retro_audio_sample_t cb) { audio_cb = cb; }
+RETRO_API void retro_set_audio_sample_batch(retro_audio_sample_batch_t cb) { audio_batch_cb = cb; }
+RETRO_API void retro_set_input_poll(retro_input_poll_t cb) { input_poll_cb = cb; }
+RETRO_API void retro_set_input_state(retro_input_state_t cb) { input_state_cb = cb; }
+
+RETRO_API unsigned retro_api_version(void) { return RETRO_API_VERSION; }
+
+RETRO_API void retro_init(void) {
+    frame_count = 0;
+    phase = 0;
+    memset(frame, 0, sizeof(frame));
+}
+
+RETRO_API void retro_deinit(void) {}
+
+RETRO_API void retro_get_system_info(struct retro_system_info* info) {
+    memset(info, 0, sizeof(*info));
+    info->library_name = "bench_core";
+    info->library_version = "1";
+    info->valid_extensions = "";
+    info->need_fullpath = false;
+}
+
+RETRO_API void retro_get_system_av_info(struct retro_system_av_info* info) {
+    memset(info, 0, sizeof(*info));
+    info->geometry.base_width = BENCH_CORE_WIDTH;
+    info->geometry.base_height = BENCH_CORE_HEIGHT;
+    info->geometry.max_width = BENCH_CORE_WIDTH;
+    info->geometry.max_height = BENCH_CORE_HEIGHT;
+    info->geometry.aspect_ratio = 4.0f / 3.0f;
+    info->timing.fps = BENCH_CORE_FPS;
+    info->timing.sample_rate = BENCH_CORE_SAMPLE_RATE;
+}
+
+RETRO_API void retro_set_controller_port_device(unsigned port, unsigned device) {
+    (void)port;
+    (void)device;
+}
+
+RETRO_API void retro_reset(void) {
+    frame_count = 0;
+}
+
+RETRO_API void retro_run(void) {
+    input_poll_cb();
+    int16_t buttons = input_state_cb(0, RETRO_DEVICE_JOYPAD, 0, RETRO_DEVICE_ID_JOYPAD_MASK);
+
+    // A band of rows changes each frame, so row hashing has something to skip
+    unsigned first = (frame_count * BENCH_CORE_BAND_ROWS) % BENCH_CORE_HEIGHT;
+    uint32_t color = 0xff000000u | (frame_count * 0x010203u) | (uint32_t)(uint16_t)buttons;
+    for (unsigned y = first; y < first + BENCH_CORE_BAND_ROWS && y < BENCH_CORE_HEIGHT; y++) {
+        uint32_t* row = frame + (size_t)y * BENCH_CORE_WIDTH;
+        for (unsigned x = 0; x < BENCH_CORE_WIDTH; x++) row[x] = color + x;
+    }
+    video_cb(frame, BENCH_CORE_WIDTH, BENCH_CORE_HEIGHT, BENCH_CORE_WIDTH * sizeof(uint32_t));
+
+    // Sawtooth, so the resampler isn't fed silence
+    for (unsigned i = 0; i < BENCH_CORE_AUDIO_FRAMES; i++) {
+        phase += 300;
+        audio[i * 2] = phase;
+        audio[i * 2 + 1] = (int16_t)-phase;
+    }
+    audio_batch_cb(audio, BENCH_CORE_AUDIO_FRAMES);
+    frame_count++;
+}
+
+RETRO_API size_t retro_serialize_size(void) { return sizeof(frame_count); }
+
+RETRO_API bool retro_serialize(void* data, size_t size) {
+    if (size < sizeof(frame_count)) return false;
+    memcpy(data, &frame_count, sizeof(frame_count));
+    return true;
+}
+
+RETRO_API bool retro_unserialize(const void* data, size_t size) {
+    if (size < sizeof(frame_count)) return false;
+    memcpy(&frame_count, data, sizeof(frame_count));
+    return true;
+}
+
+RETRO_API void retro_cheat_reset(void) {}
+
+RETRO_API void retro_cheat_set(unsigned index, bool enabled, const char* code) {
+    (void)index;
+    (void)enabled;
+    (void)code;
+}
+
+RETRO_API bool retro_load_game(const struct retro_game_info* game) {
+    (void)game;
+    enum retro_pixel_format format = RETRO_PIXEL_FORMAT_XRGB8888;
+    return environ_cb(RETRO_ENVIRONMENT_SET_PIXEL_FORMAT, &format);
+}
+
+RETRO_API bool retro_load_game_special(unsigned type, const struct retro_game_info* info, size_t num) {
+    (void)type;
+    (void)info;
+    (void)num;
+    return false;
+}
+
+RETRO_API void retro_unload_game(void) {}
+
+RETRO_API unsigned retro_get_region(void) { return RETRO_REGION_NTSC; }
+
+RETRO_API void* retro_get_memory_data(unsigned id) {
+    (void)id;
+    return NULL;
+}
+
+RETRO_API size_t retro_get_memory_size(unsigned id) {
+    (void)id;
+    return 0;
+}
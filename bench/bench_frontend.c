@@ -0,0 +1,485 @@
+/*
+ * bench_frontend.c - Frontend Hot Path Micro-Benchmarks
+ *
+ * Copyright (c) 2024 mikedx
+ * GitHub: https://github.com/mikedx/libretro_raylib
+ *
+ * This file is part of libretro_raylib.
+ *
+ * libretro_raylib is free software: you can redistribute it and/or modify
+ * it under the terms of the MIT License.
+ *
+ * Times the per-frame paths that don't need a real core or raylib:
+ *
+ * - Frame conversion for each pixel format at a tight, an odd and a wide
+ *   (1024 pixel) pitch
+ * - retro_audio_sample_batch at several batch sizes, the single-sample
+ *   path, and libretro_frontend_get_audio_samples at several device
+ *   period sizes
+ * - Input state lookups
+ * - The whole libretro_frontend_run_display_frame loop, driven by the
+ *   synthetic core in bench_core.c, with and without row hashing
+ *
+ * Each case is calibrated to run for about one block, then timed over a few
+ * blocks and the best is kept. Results go to stdout as a table and, with
+ * --dump, to a .csv or .json file for comparing runs release over release.
+ *
+ * Usage: bench_frontend [--core PATH] [--block-ms N] [--dump FILE]
+ */
+
+#include "libretro_frontend.h"
+#include "libretro_audio.h"
+#include "libretro_input.h"
+#include "libretro_video.h"
+#include "libretro_convert.h"
+#include "libretro_perf.h"
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __APPLE__
+#define BENCH_CORE_NAME "bench_core.dylib"
+#else
+#define BENCH_CORE_NAME "bench_core.so"
+#endif
+
+#define BENCH_BLOCKS 5                  // Timed blocks per case; the fastest counts
+#define BENCH_DEFAULT_BLOCK_MS 20
+#define BENCH_MAX_RESULTS 64
+#define BENCH_AUDIO_RATE 44100          // Core rate, resampled to the 48 kHz output
+#define BENCH_AUDIO_OUTPUT_RATE 48000
+#define BENCH_AUDIO_RING_MS 20000       // Big enough that a block never fills it
+#define BENCH_FRAME_SAMPLES 735         // Single-sample calls per frame at 44.1 kHz / 60
+#define BENCH_DRAIN_FRAMES 4096
+
+//=============================================================================
+// Harness
+//=============================================================================
+
+typedef struct {
+    char benchmark[24];
+    char variant[40];
+    double ns_per_op;
+    double bytes_per_op;            // 0 = not a throughput benchmark
+} bench_result_t;
+
+/**
+ * One case: run() does reps operations back to back; reset() runs untimed
+ * before each block (drain or refill the audio ring, ...)
+ */
+typedef struct {
+    void (*reset)(void* ctx, unsigned reps);
+    void (*run)(void* ctx, unsigned reps);
+    void* ctx;
+    unsigned max_reps;              // Most operations per block (0 = no limit)
+} bench_case_t;
+
+static bench_result_t g_results[BENCH_MAX_RESULTS];
+static unsigned g_result_count = 0;
+static uint64_t g_block_ns = BENCH_DEFAULT_BLOCK_MS * 1000000ull;
+
+static uint64_t bench_block(const bench_case_t* c, unsigned reps) {
+    if (c->reset) c->reset(c->ctx, reps);
+    uint64_t start = libretro_perf_now_ns();
+    c->run(c->ctx, reps);
+    return libretro_perf_now_ns() - start;
+}
+
+/**
+ * Time a case and record it
+ * @param bytes_per_op Bytes each operation processes, for MB/s (0 = none)
+ */
+static void bench_run(const char* benchmark, const char* variant, const bench_case_t* c, double bytes_per_op) {
+    // Double the block until it takes a good part of the target, then
+    // scale it to the target
+    unsigned reps = 1;
+    uint64_t elapsed = bench_block(c, reps);
+    while (elapsed < g_block_ns / 4 && (!c->max_reps || reps < c->max_reps) && reps < UINT_MAX / 2) {
+        reps *= 2;
+        if (c->max_reps && reps > c->max_reps) reps = c->max_reps;
+        elapsed = bench_block(c, reps);
+    }
+    if (elapsed > 0 && elapsed < g_block_ns) {
+        double scaled = (double)reps * g_block_ns / elapsed;
+        if (c->max_reps && scaled > c->max_reps) scaled = c->max_reps;
+        if (scaled < UINT_MAX / 2) reps = (unsigned)scaled;
+    }
+
+    double best = 0.0;
+    for (int b = 0; b < BENCH_BLOCKS; b++) {
+        double ns = (double)bench_block(c, reps) / reps;
+        if (b == 0 || ns < best) best = ns;
+    }
+
+    if (g_result_count == BENCH_MAX_RESULTS) return;
+    bench_result_t* result = &g_results[g_result_count++];
+    snprintf(result->benchmark, sizeof(result->benchmark), "%s", benchmark);
+    snprintf(result->variant, sizeof(result->variant), "%s", variant);
+    result->ns_per_op = best;
+    result->bytes_per_op = bytes_per_op;
+
+    printf("%-14s %-28s %12.1f %12.3f", benchmark, variant, best, 1e3 / best);
+    if (bytes_per_op > 0.0) printf(" %10.1f", bytes_per_op / best * 1e3);
+    printf("\n");
+    fflush(stdout);
+}
+
+/**
+ * Write the results as CSV, or JSON for a .json path
+ */
+static bool bench_dump(const char* path) {
+    FILE* file = fopen(path, "w");
+    if (!file) {
+        fprintf(stderr, "Failed to open benchmark dump file: %s\n", path);
+        return false;
+    }
+    size_t length = strlen(path);
+    bool json = length >= 5 && strcmp(path + length - 5, ".json") == 0;
+
+    if (json) {
+        fprintf(file, "{\n  \"unit\": \"ns\",\n  \"convert_impl\": \"%s\",\n  \"results\": [",
+                libretro_convert_impl_name(libretro_convert_get_impl()));
+        for (unsigned i = 0; i < g_result_count; i++) {
+            const bench_result_t* r = &g_results[i];
+            fprintf(file, "%s\n    {\"benchmark\": \"%s\", \"case\": \"%s\", \"ns_per_op\": %.3f, "
+                    "\"ops_per_sec\": %.1f, \"mb_per_sec\": %.3f}", i ? "," : "", r->benchmark, r->variant,
+                    r->ns_per_op, 1e9 / r->ns_per_op, r->bytes_per_op / r->ns_per_op * 1e3);
+        }
+        fprintf(file, "\n  ]\n}\n");
+    } else {
+        fprintf(file, "benchmark,case,ns_per_op,ops_per_sec,mb_per_sec\n");
+        for (unsigned i = 0; i < g_result_count; i++) {
+            const bench_result_t* r = &g_results[i];
+            fprintf(file, "%s,%s,%.3f,%.1f,%.3f\n", r->benchmark, r->variant, r->ns_per_op,
+                    1e9 / r->ns_per_op, r->bytes_per_op / r->ns_per_op * 1e3);
+        }
+    }
+
+    bool ok = !ferror(file);
+    if (fclose(file) != 0) ok = false;
+    return ok;
+}
+
+//=============================================================================
+// Pixel Conversion
+//=============================================================================
+
+typedef struct {
+    const uint8_t* src;
+    uint32_t* dst;
+    unsigned width;
+    unsigned height;
+    size_t pitch;
+    unsigned format;
+} convert_ctx_t;
+
+static void convert_run(void* arg, unsigned reps) {
+    convert_ctx_t* ctx = (convert_ctx_t*)arg;
+    for (unsigned i = 0; i < reps; i++) {
+        libretro_video_convert_frame(ctx->dst, ctx->src, ctx->width, ctx->height, ctx->pitch, ctx->format);
+    }
+}
+
+static const char* format_name(unsigned format) {
+    switch (format) {
+        case RETRO_PIXEL_FORMAT_0RGB1555: return "0RGB1555";
+        case RETRO_PIXEL_FORMAT_XRGB8888: return "XRGB8888";
+        case RETRO_PIXEL_FORMAT_RGB565: return "RGB565";
+        default: return "UNKNOWN";
+    }
+}
+
+static bool bench_conversion(void) {
+    const unsigned width = 320, height = 240;
+    const size_t max_pitch = 1024 * 4;
+    uint8_t* src = (uint8_t*)malloc(max_pitch * height);
+    uint32_t* dst = (uint32_t*)malloc((size_t)width * height * 4);
+    if (!src || !dst) {
+        fprintf(stderr, "Failed to allocate conversion buffers\n");
+        free(src);
+        free(dst);
+        return false;
+    }
+    uint32_t seed = 0x12345678u;
+    for (size_t i = 0; i < max_pitch * height; i++) {
+        seed = seed * 1664525u + 1013904223u;
+        src[i] = (uint8_t)(seed >> 24);
+    }
+
+    static const unsigned formats[] = {
+        RETRO_PIXEL_FORMAT_XRGB8888, RETRO_PIXEL_FORMAT_RGB565, RETRO_PIXEL_FORMAT_0RGB1555
+    };
+    bool ok = true;
+    for (size_t f = 0; f < sizeof(formats) / sizeof(formats[0]); f++) {
+        size_t bpp = (formats[f] == RETRO_PIXEL_FORMAT_XRGB8888) ? 4 : 2;
+        // Tight rows, rows that don't start on a vector boundary, and a core
+        // that draws into a 1024 pixel wide buffer
+        const struct { const char* name; size_t pitch; } pitches[] = {
+            { "tight", width * bpp },
+            { "odd", (width + 3) * bpp },
+            { "stride1024", 1024 * bpp }
+        };
+        for (size_t p = 0; p < sizeof(pitches) / sizeof(pitches[0]); p++) {
+            convert_ctx_t ctx = { src, dst, width, height, pitches[p].pitch, formats[f] };
+            if (!libretro_video_convert_frame(dst, src, width, height, ctx.pitch, ctx.format)) {
+                fprintf(stderr, "Conversion failed for %s\n", format_name(formats[f]));
+                ok = false;
+                continue;
+            }
+            char variant[40];
+            snprintf(variant, sizeof(variant), "%s %ux%u %s", format_name(formats[f]), width, height,
+                     pitches[p].name);
+            bench_case_t c = { NULL, convert_run, &ctx, 0 };
+            bench_run("convert_frame", variant, &c, (double)width * height * bpp);
+        }
+    }
+    free(src);
+    free(dst);
+    return ok;
+}
+
+//=============================================================================
+// Audio
+//=============================================================================
+
+typedef struct {
+    libretro_frontend_t* frontend;
+    const int16_t* samples;
+    float* buffer;
+    size_t frames;                  // Per call
+} audio_ctx_t;
+
+static void audio_drain(void* arg, unsigned reps) {
+    audio_ctx_t* ctx = (audio_ctx_t*)arg;
+    (void)reps;
+    while (libretro_audio_ring_read(&ctx->frontend->audio_ring, ctx->buffer, BENCH_DRAIN_FRAMES) > 0) {
+    }
+}
+
+static void audio_fill(void* arg, unsigned reps) {
+    audio_ctx_t* ctx = (audio_ctx_t*)arg;
+    audio_drain(arg, reps);
+    memset(ctx->buffer, 0, BENCH_DRAIN_FRAMES * 2 * sizeof(float));
+    for (size_t left = (size_t)reps * ctx->frames; left > 0; ) {
+        size_t chunk = left < BENCH_DRAIN_FRAMES ? left : BENCH_DRAIN_FRAMES;
+        if (libretro_audio_ring_write(&ctx->frontend->audio_ring, ctx->buffer, chunk) == 0) break;
+        left -= chunk;
+    }
+}
+
+static void audio_batch_run(void* arg, unsigned reps) {
+    audio_ctx_t* ctx = (audio_ctx_t*)arg;
+    for (unsigned i = 0; i < reps; i++) {
+        retro_audio_sample_batch_callback(ctx->samples, ctx->frames);
+    }
+}
+
+static void audio_sample_run(void* arg, unsigned reps) {
+    audio_ctx_t* ctx = (audio_ctx_t*)arg;
+    // Flushed once per frame's worth, as run_frame does after retro_run
+    unsigned pending = 0;
+    for (unsigned i = 0; i < reps; i++) {
+        retro_audio_sample_callback(ctx->samples[(i % ctx->frames) * 2], ctx->samples[(i % ctx->frames) * 2 + 1]);
+        if (++pending == BENCH_FRAME_SAMPLES) {
+            libretro_audio_flush_buffer(ctx->frontend);
+            pending = 0;
+        }
+    }
+    libretro_audio_flush_buffer(ctx->frontend);
+}
+
+static void audio_read_run(void* arg, unsigned reps) {
+    audio_ctx_t* ctx = (audio_ctx_t*)arg;
+    for (unsigned i = 0; i < reps; i++) {
+        libretro_frontend_get_audio_samples(ctx->frontend, ctx->buffer, ctx->frames);
+    }
+}
+
+static bool bench_audio(libretro_frontend_t* frontend) {
+    static const size_t sizes[] = { 64, 256, 735, 2048 };
+    const size_t max_frames = 2048;
+    int16_t* samples = (int16_t*)malloc(max_frames * 2 * sizeof(int16_t));
+    float* buffer = (float*)malloc(BENCH_DRAIN_FRAMES * 2 * sizeof(float));
+    if (!samples || !buffer) {
+        fprintf(stderr, "Failed to allocate audio buffers\n");
+        free(samples);
+        free(buffer);
+        return false;
+    }
+    int16_t phase = 0;
+    for (size_t i = 0; i < max_frames; i++) {
+        phase += 300;
+        samples[i * 2] = phase;
+        samples[i * 2 + 1] = (int16_t)-phase;
+    }
+    libretro_audio_set_timing(frontend, BENCH_AUDIO_RATE, 60.0);
+
+    // Keep every block's output within half the ring, so nothing is dropped
+    // and rate control stays near 1:1
+    size_t room = frontend->audio_ring.capacity / 2;
+    double out_per_in = (double)BENCH_AUDIO_OUTPUT_RATE / BENCH_AUDIO_RATE * 1.01;
+    char variant[40];
+
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        audio_ctx_t ctx = { frontend, samples, buffer, sizes[s] };
+        bench_case_t c = { audio_drain, audio_batch_run, &ctx, (unsigned)(room / (sizes[s] * out_per_in + 2)) };
+        snprintf(variant, sizeof(variant), "%zu frames", sizes[s]);
+        bench_run("audio_batch", variant, &c, (double)sizes[s] * 2 * sizeof(int16_t));
+    }
+
+    audio_ctx_t sample_ctx = { frontend, samples, buffer, max_frames };
+    bench_case_t sample_case = { audio_drain, audio_sample_run, &sample_ctx, (unsigned)(room / out_per_in) };
+    bench_run("audio_sample", "per sample", &sample_case, 2 * sizeof(int16_t));
+
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        if (sizes[s] > BENCH_DRAIN_FRAMES) continue;
+        audio_ctx_t ctx = { frontend, samples, buffer, sizes[s] };
+        bench_case_t c = { audio_fill, audio_read_run, &ctx, (unsigned)(room / sizes[s]) };
+        snprintf(variant, sizeof(variant), "%zu frames", sizes[s]);
+        bench_run("audio_read", variant, &c, (double)sizes[s] * 2 * sizeof(float));
+    }
+    audio_drain(&sample_ctx, 0);
+
+    free(samples);
+    free(buffer);
+    return true;
+}
+
+//=============================================================================
+// Input
+//=============================================================================
+
+static volatile int32_t g_input_sink;
+
+typedef struct {
+    unsigned device;
+    unsigned id;                    // Fixed id, or RETRO_DEVICE_ID_JOYPAD_MASK
+    unsigned id_count;              // Cycle through this many ids instead (0 = fixed)
+} input_ctx_t;
+
+static void input_run(void* arg, unsigned reps) {
+    input_ctx_t* ctx = (input_ctx_t*)arg;
+    int32_t sum = 0;
+    for (unsigned i = 0; i < reps; i++) {
+        unsigned id = ctx->id_count ? ctx->id + i % ctx->id_count : ctx->id;
+        sum += retro_input_state_callback(0, ctx->device, 0, id);
+    }
+    g_input_sink = sum;
+}
+
+static void bench_input(libretro_frontend_t* frontend) {
+    libretro_frontend_set_joypad_mask(frontend, 0, 0x5a5a);
+    libretro_frontend_set_keyboard_key(frontend, RETROK_SPACE, true);
+
+    input_ctx_t button = { RETRO_DEVICE_JOYPAD, 0, 16 };
+    bench_case_t c = { NULL, input_run, &button, 0 };
+    bench_run("input_state", "joypad button", &c, 0.0);
+
+    input_ctx_t mask = { RETRO_DEVICE_JOYPAD, RETRO_DEVICE_ID_JOYPAD_MASK, 0 };
+    c.ctx = &mask;
+    bench_run("input_state", "joypad bitmask", &c, 0.0);
+
+    input_ctx_t keyboard = { RETRO_DEVICE_KEYBOARD, RETROK_a, 26 };
+    c.ctx = &keyboard;
+    bench_run("input_state", "keyboard key", &c, 0.0);
+
+    libretro_frontend_set_joypad_mask(frontend, 0, 0);
+    libretro_frontend_set_keyboard_key(frontend, RETROK_SPACE, false);
+}
+
+//=============================================================================
+// Frame Loop
+//=============================================================================
+
+static void frame_run(void* arg, unsigned reps) {
+    audio_ctx_t* ctx = (audio_ctx_t*)arg;
+    for (unsigned i = 0; i < reps; ) {
+        i += libretro_frontend_run_display_frame(ctx->frontend);
+        libretro_frontend_clear_frame_dirty(ctx->frontend);
+    }
+}
+
+static bool bench_frame_loop(libretro_frontend_t* frontend, const char* core_path) {
+    uint64_t start = libretro_perf_now_ns();
+    if (!libretro_frontend_load_core(frontend, core_path) || !libretro_frontend_init_core(frontend) ||
+        !libretro_frontend_load_rom(frontend, NULL)) {
+        fprintf(stderr, "Failed to start the synthetic core %s\n", core_path);
+        return false;
+    }
+    double load_ns = (double)(libretro_perf_now_ns() - start);
+
+    float* buffer = (float*)malloc(BENCH_DRAIN_FRAMES * 2 * sizeof(float));
+    if (!buffer) return false;
+    audio_ctx_t ctx = { frontend, NULL, buffer, 0 };
+    double out_per_frame = (double)BENCH_AUDIO_OUTPUT_RATE / 60.0 * 1.01 + 2;
+    unsigned max_reps = (unsigned)(frontend->audio_ring.capacity / 2 / out_per_frame);
+    bench_case_t c = { audio_drain, frame_run, &ctx, max_reps };
+    double frame_bytes = (double)frontend->width * frontend->height * 4;
+
+    frontend->video_row_hash = false;
+    bench_run("run_frame", "320x240 XRGB8888", &c, frame_bytes);
+    frontend->video_row_hash = true;
+    bench_run("run_frame", "320x240 XRGB8888 row hash", &c, frame_bytes);
+    frontend->video_row_hash = false;
+    audio_drain(&ctx, 0);
+
+    printf("%-14s %-28s %12.1f\n", "core_load", "synthetic core", load_ns);
+    if (g_result_count < BENCH_MAX_RESULTS) {
+        bench_result_t* result = &g_results[g_result_count++];
+        snprintf(result->benchmark, sizeof(result->benchmark), "core_load");
+        snprintf(result->variant, sizeof(result->variant), "synthetic core");
+        result->ns_per_op = load_ns;
+        result->bytes_per_op = 0.0;
+    }
+    free(buffer);
+    return true;
+}
+
+//=============================================================================
+// Main
+//=============================================================================
+
+int main(int argc, char* argv[]) {
+    const char* core_path = NULL;
+    const char* dump_path = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--core") == 0 && i + 1 < argc) {
+            core_path = argv[++i];
+        } else if (strcmp(argv[i], "--block-ms") == 0 && i + 1 < argc) {
+            int ms = atoi(argv[++i]);
+            if (ms > 0) g_block_ns = (uint64_t)ms * 1000000ull;
+        } else if (strcmp(argv[i], "--dump") == 0 && i + 1 < argc) {
+            dump_path = argv[++i];
+        } else {
+            fprintf(stderr, "Usage: %s [--core PATH] [--block-ms N] [--dump FILE.csv|FILE.json]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    // The synthetic core is built next to this binary
+    char default_core[PATH_MAX];
+    if (!core_path) {
+        const char* slash = strrchr(argv[0], '/');
+        snprintf(default_core, sizeof(default_core), "%.*s%s", slash ? (int)(slash - argv[0] + 1) : 0, argv[0],
+                 BENCH_CORE_NAME);
+        core_path = default_core;
+    }
+
+    libretro_frontend_t frontend;
+    if (!libretro_frontend_init(&frontend) ||
+        !libretro_frontend_set_audio_output(&frontend, BENCH_AUDIO_OUTPUT_RATE, BENCH_AUDIO_RING_MS)) {
+        fprintf(stderr, "Failed to initialize frontend\n");
+        return 1;
+    }
+
+    printf("%-14s %-28s %12s %12s %10s\n", "benchmark", "case", "ns/op", "Mops/s", "MB/s");
+    bool ok = bench_conversion();
+    ok = bench_audio(&frontend) && ok;
+    bench_input(&frontend);
+    ok = bench_frame_loop(&frontend, core_path) && ok;
+
+    if (dump_path && !bench_dump(dump_path)) ok = false;
+    libretro_frontend_deinit(&frontend);
+    return ok ? 0 : 1;
+}
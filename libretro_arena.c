@@ -0,0 +1,104 @@
+/*
+ * libretro_arena.c - Session Memory Arena Implementation
+ *
+ * Copyright (c) 2024 mikedx
+ * GitHub: https://github.com/mikedx/libretro_raylib
+ *
+ * This file is part of libretro_raylib.
+ *
+ * libretro_raylib is free software: you can redistribute it and/or modify
+ * it under the terms of the MIT License.
+ */
+
+#include "libretro_arena.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void arena_lock(libretro_arena_t* arena) {
+    while (__atomic_exchange_n(&arena->lock, 1, __ATOMIC_ACQUIRE)) {
+    }
+}
+
+static void arena_unlock(libretro_arena_t* arena) {
+    __atomic_store_n(&arena->lock, 0, __ATOMIC_RELEASE);
+}
+
+size_t libretro_arena_aligned_size(size_t size) {
+    return (size + LIBRETRO_ARENA_ALIGNMENT - 1) & ~(size_t)(LIBRETRO_ARENA_ALIGNMENT - 1);
+}
+
+/**
+ * Add a block with room for at least size bytes (lock held)
+ */
+static libretro_arena_block_t* arena_add_block(libretro_arena_t* arena, size_t size) {
+    if (size < LIBRETRO_ARENA_MIN_BLOCK) size = LIBRETRO_ARENA_MIN_BLOCK;
+    size = libretro_arena_aligned_size(size);
+
+    // Header and data in one allocation; data starts at the first aligned byte
+    size_t total = sizeof(libretro_arena_block_t) + LIBRETRO_ARENA_ALIGNMENT + size;
+    libretro_arena_block_t* block = (libretro_arena_block_t*)malloc(total);
+    if (!block) {
+        fprintf(stderr, "Failed to allocate %zu byte session arena block\n", size);
+        return NULL;
+    }
+    uintptr_t start = (uintptr_t)(block + 1);
+    start = (start + LIBRETRO_ARENA_ALIGNMENT - 1) & ~(uintptr_t)(LIBRETRO_ARENA_ALIGNMENT - 1);
+    block->data = (uint8_t*)start;
+    block->size = size;
+    block->used = 0;
+    block->next = arena->blocks;
+    arena->blocks = block;
+    arena->reserved += total;
+    arena->block_count++;
+    return block;
+}
+
+bool libretro_arena_reserve(libretro_arena_t* arena, size_t size) {
+    arena_lock(arena);
+    libretro_arena_block_t* block = arena->blocks;
+    bool ok = (block && block->size - block->used >= size) || arena_add_block(arena, size);
+    arena_unlock(arena);
+    return ok;
+}
+
+void* libretro_arena_alloc(libretro_arena_t* arena, size_t size) {
+    size = libretro_arena_aligned_size(size ? size : 1);
+    arena_lock(arena);
+    libretro_arena_block_t* block = arena->blocks;
+    if (!block || block->size - block->used < size) {
+        block = arena_add_block(arena, size);
+    }
+    void* memory = NULL;
+    if (block) {
+        memory = block->data + block->used;
+        block->used += size;
+        arena->used += size;
+    }
+    arena_unlock(arena);
+    return memory;
+}
+
+void* libretro_arena_grow(libretro_arena_t* arena, void* buffer, size_t* capacity, size_t needed) {
+    if (buffer && needed <= *capacity) return buffer;
+    void* bigger = libretro_arena_alloc(arena, needed);
+    if (!bigger) return NULL;
+    if (buffer) {
+        arena_lock(arena);
+        arena->regrowths++;
+        arena->abandoned += *capacity;
+        arena_unlock(arena);
+    }
+    *capacity = needed;
+    return bigger;
+}
+
+void libretro_arena_free(libretro_arena_t* arena) {
+    libretro_arena_block_t* block = arena->blocks;
+    while (block) {
+        libretro_arena_block_t* next = block->next;
+        free(block);
+        block = next;
+    }
+    memset(arena, 0, sizeof(*arena));
+}
@@ -0,0 +1,107 @@
+/*
+ * libretro_arena.h - Session Memory Arena
+ *
+ * Copyright (c) 2024 mikedx
+ * GitHub: https://github.com/mikedx/libretro_raylib
+ *
+ * This file is part of libretro_raylib.
+ *
+ * libretro_raylib is free software: you can redistribute it and/or modify
+ * it under the terms of the MIT License.
+ *
+ * Bump allocator for buffers that live as long as the loaded content: the
+ * framebuffers, row hashes, audio accumulator and pipeline slots. They are
+ * carved out at load time at the sizes the core's max geometry and the
+ * largest sample rate need (libretro_frontend_reserve_session), so geometry
+ * and rate changes mid-session reuse memory instead of freeing, allocating
+ * and zeroing it again.
+ *
+ * Nothing is freed individually. A buffer that has to outgrow its region
+ * (a core that sends frames beyond its own max geometry) gets a new one and
+ * the old space is abandoned until the session ends; such growth is counted
+ * so it shows up in the session's memory report.
+ */
+
+#ifndef LIBRETRO_ARENA_H
+#define LIBRETRO_ARENA_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+//=============================================================================
+// Arena Structures
+//=============================================================================
+
+#define LIBRETRO_ARENA_ALIGNMENT 64             // Cache line (and SIMD/upload friendly)
+#define LIBRETRO_ARENA_MIN_BLOCK (256 * 1024)   // Smallest block added on demand
+
+typedef struct libretro_arena_block {
+    struct libretro_arena_block* next;
+    size_t size;                    // Usable bytes in data
+    size_t used;
+    uint8_t* data;                  // Aligned start, inside this allocation
+} libretro_arena_block_t;
+
+/**
+ * Session arena; a zeroed struct is an empty arena
+ * Allocation takes a spin lock: after load it only happens when a buffer
+ * outgrows its reservation, which is rare, but may come from the emulation
+ * and render threads at once.
+ */
+typedef struct libretro_arena {
+    libretro_arena_block_t* blocks; // Newest first
+    int lock;                       // Spin lock (atomic)
+
+    // Statistics
+    size_t reserved;                // Bytes allocated from the system
+    size_t used;                    // Bytes handed out
+    unsigned block_count;
+    unsigned regrowths;             // Buffers that outgrew their region after the reservation
+    size_t abandoned;               // Bytes left behind by those
+} libretro_arena_t;
+
+//=============================================================================
+// Public API Functions
+//=============================================================================
+
+/**
+ * Make sure the next allocations of up to size bytes in total come from a
+ * single block (one system allocation for the whole session)
+ * @param arena Arena
+ * @param size Bytes about to be allocated (alignment padding included)
+ * @return false on allocation failure
+ */
+bool libretro_arena_reserve(libretro_arena_t* arena, size_t size);
+
+/**
+ * Allocate LIBRETRO_ARENA_ALIGNMENT aligned bytes; contents are undefined
+ * @param arena Arena
+ * @param size Bytes
+ * @return NULL on allocation failure
+ */
+void* libretro_arena_alloc(libretro_arena_t* arena, size_t size);
+
+/**
+ * Make a buffer hold at least needed bytes; a larger one is carved from the
+ * arena and the old one abandoned (contents are not kept)
+ * @param arena Arena
+ * @param buffer Current buffer (NULL = none)
+ * @param capacity Current capacity in bytes, updated
+ * @param needed Bytes required
+ * @return The buffer to use, or NULL on allocation failure (the old one is kept)
+ */
+void* libretro_arena_grow(libretro_arena_t* arena, void* buffer, size_t* capacity, size_t needed);
+
+/**
+ * Bytes needed to allocate size bytes, alignment padding included (for reserve)
+ */
+size_t libretro_arena_aligned_size(size_t size);
+
+/**
+ * Release every block; buffers carved from the arena are invalid afterwards
+ * @param arena Arena
+ */
+void libretro_arena_free(libretro_arena_t* arena);
+
+#endif // LIBRETRO_ARENA_H
@@ -12,73 +12,53 @@
 
 #include "libretro_audio.h"
 #include "libretro_frontend.h"
+#include "libretro_capture.h"
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
-// Global frontend instance for callbacks
-static libretro_frontend_t* g_frontend = NULL;
-
-void libretro_audio_set_frontend(libretro_frontend_t* frontend) {
-    g_frontend = frontend;
-}
-
-// Single-sample audio accumulator for cores that use retro_audio_sample_callback
-#define SINGLE_SAMPLE_BUFFER_SIZE 512
-#define SINGLE_SAMPLE_FLUSH_THRESHOLD 1
-static int16_t single_sample_buffer[SINGLE_SAMPLE_BUFFER_SIZE * 2]; // Stereo
-static size_t single_sample_count = 0;
+// Fewest frames the single-sample accumulator holds, whatever the timing
+#define SINGLE_SAMPLE_MIN_FRAMES 512
 
 /**
  * Audio sample callback implementation
  */
 void retro_audio_sample_callback(int16_t left, int16_t right) {
-    if (!g_frontend) return;
+    libretro_frontend_t* frontend = libretro_frontend_current();
+    if (!frontend || !frontend->audio_sample_accum) return;
+    if (!(libretro_frontend_av_enable(frontend) & LIBRETRO_AV_ENABLE_AUDIO)) return;
     
-    // Accumulate samples in buffer
-    if (single_sample_count < SINGLE_SAMPLE_BUFFER_SIZE) {
-        single_sample_buffer[single_sample_count * 2] = left;
-        single_sample_buffer[single_sample_count * 2 + 1] = right;
-        single_sample_count++;
-    } else {
-        // Buffer is full - flush it before adding more samples
-        retro_audio_sample_batch_callback(single_sample_buffer, single_sample_count);
-        single_sample_count = 0;
-        single_sample_buffer[0] = left;
-        single_sample_buffer[1] = right;
-        single_sample_count = 1;
+    // Normally flushed once per retro_run; only flush here if the core
+    // produces more than a frame's worth of samples
+    if (frontend->audio_sample_accum_count == frontend->audio_sample_accum_frames) {
+        libretro_audio_flush_buffer(frontend);
     }
     
-    // Flush when buffer reaches threshold
-    if (single_sample_count >= SINGLE_SAMPLE_FLUSH_THRESHOLD) {
-        size_t processed = retro_audio_sample_batch_callback(single_sample_buffer, single_sample_count);
-        if (processed != single_sample_count) {
-            static int drop_count = 0;
-            if (drop_count++ < 3) {
-                fprintf(stderr, "WARNING: Only processed %zu/%zu samples (buffer full?)\n", 
-                        processed, single_sample_count);
-            }
-        }
-        single_sample_count = 0;
-    }
+    int16_t* slot = frontend->audio_sample_accum + frontend->audio_sample_accum_count * 2;
+    slot[0] = left;
+    slot[1] = right;
+    frontend->audio_sample_accum_count++;
 }
 
 /**
  * Flush any remaining samples in the single-sample buffer
  */
-void libretro_audio_flush_buffer(void) {
-    if (single_sample_count > 0 && g_frontend) {
-        retro_audio_sample_batch_callback(single_sample_buffer, single_sample_count);
-        single_sample_count = 0;
-    }
+void libretro_audio_flush_buffer(libretro_frontend_t* frontend) {
+    if (!frontend || frontend->audio_sample_accum_count == 0) return;
+    retro_audio_sample_batch_callback(frontend->audio_sample_accum, frontend->audio_sample_accum_count);
+    frontend->audio_sample_accum_count = 0;
 }
 
+// Input frames resampled per step; bounds the stack scratch buffers
+#define RESAMPLE_CHUNK_FRAMES 256
+#define RESAMPLE_MAX_RATIO 8
+
 /**
- * Audio sample batch callback implementation (preferred method)
+ * Resample a batch into the ring (body of the batch callback)
  */
-size_t retro_audio_sample_batch_callback(const int16_t* data, size_t frames) {
-    if (!g_frontend || !data || frames == 0) return 0;
-    
-    if (!g_frontend->audio_ring_buffer || g_frontend->audio_ring_buffer_size == 0) {
+static size_t audio_sample_batch(libretro_frontend_t* frontend, const int16_t* data, size_t frames) {
+    libretro_audio_ring_t* ring = &frontend->audio_ring;
+    if (!ring->buffer) {
         static int error_count = 0;
         if (error_count++ < 3) {
             fprintf(stderr, "ERROR: Audio ring buffer not initialized!\n");
@@ -86,32 +66,105 @@ size_t retro_audio_sample_batch_callback(const int16_t* data, size_t frames) {
         return 0;
     }
     
-    // Convert int16_t samples to float and add to ring buffer
-    // Proper ring buffer handling: drop samples if buffer is full (prevent overflow)
-    size_t available_space = g_frontend->audio_ring_buffer_size - g_frontend->audio_ring_available;
-    size_t frames_to_write = (frames < available_space) ? frames : available_space;
+    // Dynamic rate control: pick the ratio once per batch from the ring fill level
+    double ratio = libretro_resampler_drc_ratio(&frontend->resampler,
+                                                libretro_audio_ring_space(ring), ring->capacity);
+    // Fast-forward produces audio faster than real time; resample it down by
+    // the measured speed so it still fits (the pitch rises with the speed)
+    if (frontend->fastforward_speed > 1.0) ratio /= frontend->fastforward_speed;
+    // Likewise for the small speed change frame pacing makes to match the display
+    double speed;
+    __atomic_load(&frontend->speed, &speed, __ATOMIC_RELAXED);
+    if (speed > 0.0) ratio /= speed;
+    if (ratio > RESAMPLE_MAX_RATIO) ratio = RESAMPLE_MAX_RATIO;
+    
+    float input[RESAMPLE_CHUNK_FRAMES * 2];
+    float output[(RESAMPLE_CHUNK_FRAMES * RESAMPLE_MAX_RATIO + 2) * 2];
+    size_t dropped = 0;
+    
+    // Convert int16_t samples to float, resample to the device rate and add to
+    // the ring buffer; if the ring is still full, drop (prevents overflow)
+    for (size_t done = 0; done < frames; ) {
+        size_t chunk = frames - done;
+        if (chunk > RESAMPLE_CHUNK_FRAMES) chunk = RESAMPLE_CHUNK_FRAMES;
+        
+        libretro_resampler_s16_to_float(input, data + done * 2, chunk * 2);
+        size_t out_frames = libretro_resampler_process(&frontend->resampler, input, chunk, output, ratio);
+        size_t written = libretro_audio_ring_write(ring, output, out_frames);
+        if (frontend->capture) libretro_capture_audio(frontend->capture, output, out_frames);
+        dropped += out_frames - written;
+        done += chunk;
+    }
     
-    if (frames_to_write == 0) {
-        // Buffer full - drop samples to prevent overflow
+    if (dropped > 0) {
+        frontend->audio_dropped_frames += dropped;
         static int drop_warn_count = 0;
         if (drop_warn_count++ < 3) {
-            fprintf(stderr, "Audio buffer full, dropping %zu frames\n", frames);
+            fprintf(stderr, "Audio buffer full, dropping %zu frames\n", dropped);
         }
-        return 0;
     }
     
-    // Write to ring buffer
-    for (size_t i = 0; i < frames_to_write; i++) {
-        size_t write_idx = (g_frontend->audio_ring_write_pos + i) % g_frontend->audio_ring_buffer_size;
-        float* buffer = g_frontend->audio_ring_buffer + write_idx * 2;
-        
-        buffer[0] = (float)data[i * 2] / 32768.0f;
-        buffer[1] = (float)data[i * 2 + 1] / 32768.0f;
-    }
+    // All input was consumed (resampled), even if some output had to be dropped
+    return frames;
+}
+
+/**
+ * Audio sample batch callback implementation (preferred method)
+ */
+size_t retro_audio_sample_batch_callback(const int16_t* data, size_t frames) {
+    libretro_frontend_t* frontend = libretro_frontend_current();
+    if (!frontend || !data || frames == 0) return 0;
+    
+    // Hidden run-ahead frames (the real frame's audio is already queued) and
+    // muted fast-forward
+    if (!(libretro_frontend_av_enable(frontend) & LIBRETRO_AV_ENABLE_AUDIO)) return frames;
     
-    g_frontend->audio_ring_write_pos = (g_frontend->audio_ring_write_pos + frames_to_write) % g_frontend->audio_ring_buffer_size;
-    g_frontend->audio_ring_available += frames_to_write;
+    if (frontend->audio_checksum_enabled) {
+        const uint8_t* bytes = (const uint8_t*)data;
+        uint64_t h = frontend->audio_checksum;
+        for (size_t i = 0; i < frames * 2 * sizeof(int16_t); i++) {
+            h = (h ^ bytes[i]) * 0x100000001B3ull;
+        }
+        frontend->audio_checksum = h;
+    }
     
-    return frames_to_write;
+    if (!frontend->perf) return audio_sample_batch(frontend, data, frames);
+    uint64_t start = libretro_perf_now_ns();
+    size_t processed = audio_sample_batch(frontend, data, frames);
+    libretro_perf_add(frontend->perf, LIBRETRO_PERF_AUDIO, libretro_perf_now_ns() - start);
+    return processed;
 }
 
+/**
+ * Apply new core audio timing
+ */
+size_t libretro_audio_accum_frames(unsigned sample_rate, double fps) {
+    // One retro_run worth of frames plus 25% headroom for cores whose
+    // per-frame sample count jitters
+    if (fps <= 0.0) fps = 60.0;
+    size_t frames = (size_t)((double)sample_rate / fps) + 1;
+    frames += frames / 4;
+    if (frames < SINGLE_SAMPLE_MIN_FRAMES) frames = SINGLE_SAMPLE_MIN_FRAMES;
+    return frames;
+}
+
+void libretro_audio_set_timing(libretro_frontend_t* frontend, unsigned sample_rate, double fps) {
+    if (!frontend || sample_rate == 0) return;
+    libretro_resampler_set_input_rate(&frontend->resampler, (double)sample_rate);
+    
+    size_t frames = libretro_audio_accum_frames(sample_rate, fps);
+    if (frames <= frontend->audio_sample_accum_frames) return;
+    
+    // Pending samples were produced at the old timing; send them on first.
+    // Normally the session reservation already covers this rate.
+    libretro_audio_flush_buffer(frontend);
+    size_t capacity = frontend->audio_sample_accum_frames * 2 * sizeof(int16_t);
+    int16_t* accum = (int16_t*)libretro_arena_grow(&frontend->arena, frontend->audio_sample_accum, &capacity,
+                                                   frames * 2 * sizeof(int16_t));
+    if (!accum) {
+        fprintf(stderr, "Failed to allocate single-sample audio buffer\n");
+        return;
+    }
+    frontend->audio_sample_accum = accum;
+    frontend->audio_sample_accum_frames = capacity / (2 * sizeof(int16_t));
+}
@@ -16,6 +16,10 @@
 #include "libretro.h"
 #include "libretro_frontend.h"
 
+// Default output device rate and ring buffer latency
+#define LIBRETRO_AUDIO_DEFAULT_OUTPUT_RATE 48000
+#define LIBRETRO_AUDIO_DEFAULT_LATENCY_MS 64
+
 /**
  * Audio sample callback - receives single audio samples (less efficient)
  * @param left Left channel sample
@@ -33,14 +37,27 @@ size_t retro_audio_sample_batch_callback(const int16_t* data, size_t frames);
 
 /**
  * Flush any remaining samples in the single-sample audio buffer
+ * Called once after every retro_run
+ * @param frontend Frontend instance
+ */
+void libretro_audio_flush_buffer(libretro_frontend_t* frontend);
+
+/**
+ * Apply new core audio timing: retargets the resampler and grows the
+ * single-sample accumulator to hold one frame of audio
+ * The ring buffer is sized from the output rate, so it is left alone
+ * @param frontend Frontend instance
+ * @param sample_rate Core sample rate in Hz
+ * @param fps Core frame rate
  */
-void libretro_audio_flush_buffer(void);
+void libretro_audio_set_timing(libretro_frontend_t* frontend, unsigned sample_rate, double fps);
 
 /**
- * Set the frontend instance for callbacks
- * @param frontend Frontend instance (can be NULL)
+ * Single-sample accumulator size for a core rate (frames)
+ * @param sample_rate Core sample rate
+ * @param fps Core frame rate
  */
-void libretro_audio_set_frontend(libretro_frontend_t* frontend);
+size_t libretro_audio_accum_frames(unsigned sample_rate, double fps);
 
 #endif // LIBRETRO_AUDIO_H
 
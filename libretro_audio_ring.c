@@ -0,0 +1,107 @@
+/*
+ * libretro_audio_ring.c - Lock-Free Audio Ring Buffer Implementation
+ *
+ * Copyright (c) 2024 mikedx
+ * GitHub: https://github.com/mikedx/libretro_raylib
+ *
+ * This file is part of libretro_raylib.
+ *
+ * libretro_raylib is free software: you can redistribute it and/or modify
+ * it under the terms of the MIT License.
+ */
+
+#include "libretro_audio_ring.h"
+#include <stdlib.h>
+#include <string.h>
+
+// GCC/Clang atomic builtins (the tree is C99, so no <stdatomic.h>)
+#define RING_LOAD_ACQUIRE(p) __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define RING_LOAD_RELAXED(p) __atomic_load_n((p), __ATOMIC_RELAXED)
+#define RING_STORE_RELEASE(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+
+size_t libretro_audio_ring_capacity_for(size_t min_frames) {
+    size_t capacity = 1;
+    while (capacity < min_frames) {
+        capacity <<= 1;
+    }
+    return capacity;
+}
+
+bool libretro_audio_ring_init(libretro_audio_ring_t* ring, size_t min_frames) {
+    if (!ring) return false;
+
+    memset(ring, 0, sizeof(*ring));
+    size_t capacity = libretro_audio_ring_capacity_for(min_frames ? min_frames : 1);
+    ring->buffer = (float*)calloc(capacity * 2, sizeof(float));
+    if (!ring->buffer) return false;
+
+    ring->capacity = capacity;
+    ring->mask = capacity - 1;
+    return true;
+}
+
+void libretro_audio_ring_free(libretro_audio_ring_t* ring) {
+    if (!ring) return;
+    free(ring->buffer);
+    memset(ring, 0, sizeof(*ring));
+}
+
+size_t libretro_audio_ring_available(const libretro_audio_ring_t* ring) {
+    if (!ring || !ring->buffer) return 0;
+    size_t write_pos = RING_LOAD_ACQUIRE(&ring->write_pos);
+    size_t read_pos = RING_LOAD_ACQUIRE(&ring->read_pos);
+    return write_pos - read_pos;
+}
+
+size_t libretro_audio_ring_space(const libretro_audio_ring_t* ring) {
+    if (!ring || !ring->buffer) return 0;
+    return ring->capacity - libretro_audio_ring_available(ring);
+}
+
+size_t libretro_audio_ring_write(libretro_audio_ring_t* ring, const float* data, size_t frames) {
+    if (!ring || !ring->buffer || !data || frames == 0) return 0;
+
+    // Only the producer modifies write_pos, so a relaxed load of our own position is enough
+    size_t write_pos = RING_LOAD_RELAXED(&ring->write_pos);
+    size_t read_pos = RING_LOAD_ACQUIRE(&ring->read_pos);
+    size_t space = ring->capacity - (write_pos - read_pos);
+    size_t to_write = (frames < space) ? frames : space;
+
+    // Fill up to two contiguous regions (before and after the wrap)
+    size_t done = 0;
+    while (done < to_write) {
+        size_t index = (write_pos + done) & ring->mask;
+        size_t run = ring->capacity - index;
+        if (run > to_write - done) run = to_write - done;
+
+        memcpy(ring->buffer + index * 2, data + done * 2, run * 2 * sizeof(float));
+        done += run;
+    }
+
+    // Publish the samples before the position that makes them visible
+    RING_STORE_RELEASE(&ring->write_pos, write_pos + to_write);
+    return to_write;
+}
+
+size_t libretro_audio_ring_read(libretro_audio_ring_t* ring, float* out, size_t max_frames) {
+    if (!ring || !ring->buffer || !out || max_frames == 0) return 0;
+
+    size_t read_pos = RING_LOAD_RELAXED(&ring->read_pos);
+    size_t write_pos = RING_LOAD_ACQUIRE(&ring->write_pos);
+    size_t available = write_pos - read_pos;
+    size_t to_read = (max_frames < available) ? max_frames : available;
+
+    size_t done = 0;
+    while (done < to_read) {
+        size_t index = (read_pos + done) & ring->mask;
+        size_t run = ring->capacity - index;
+        if (run > to_read - done) run = to_read - done;
+
+        memcpy(out + done * 2, ring->buffer + index * 2, run * 2 * sizeof(float));
+        done += run;
+    }
+
+    // Release the slots back to the producer only after copying them out
+    RING_STORE_RELEASE(&ring->read_pos, read_pos + to_read);
+    return to_read;
+}
@@ -0,0 +1,108 @@
+/*
+ * libretro_audio_ring.h - Lock-Free Audio Ring Buffer
+ *
+ * Copyright (c) 2024 mikedx
+ * GitHub: https://github.com/mikedx/libretro_raylib
+ *
+ * This file is part of libretro_raylib.
+ *
+ * libretro_raylib is free software: you can redistribute it and/or modify
+ * it under the terms of the MIT License.
+ *
+ * Single-producer/single-consumer ring of interleaved stereo float frames.
+ * The emulation thread writes (audio callbacks from the core) and the audio
+ * device thread reads, without locks: each side owns one position and
+ * publishes it with release/acquire ordering. Capacity is a power of two so
+ * positions wrap with a mask instead of a modulo.
+ */
+
+#ifndef LIBRETRO_AUDIO_RING_H
+#define LIBRETRO_AUDIO_RING_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+//=============================================================================
+// Ring Structure
+//=============================================================================
+
+#define LIBRETRO_AUDIO_RING_CACHE_LINE 64
+
+/**
+ * Audio ring buffer
+ * Positions count frames and only ever increase; index = pos & mask
+ */
+typedef struct {
+    float* buffer;          // Interleaved stereo frames (capacity * 2 floats)
+    size_t capacity;        // Capacity in frames (power of two)
+    size_t mask;            // capacity - 1
+
+    // Producer and consumer positions live on separate cache lines so the two
+    // threads don't bounce the same line on every update
+    char pad0[LIBRETRO_AUDIO_RING_CACHE_LINE];
+    size_t write_pos;       // Written by the producer only
+    char pad1[LIBRETRO_AUDIO_RING_CACHE_LINE];
+    size_t read_pos;        // Written by the consumer only
+    char pad2[LIBRETRO_AUDIO_RING_CACHE_LINE];
+} libretro_audio_ring_t;
+
+//=============================================================================
+// Public API Functions
+//=============================================================================
+
+/**
+ * Allocate the ring
+ * @param ring Ring to initialize
+ * @param min_frames Minimum capacity in frames (rounded up to a power of two)
+ * @return true on success, false on allocation failure
+ */
+bool libretro_audio_ring_init(libretro_audio_ring_t* ring, size_t min_frames);
+
+/**
+ * Free the ring's storage
+ * Neither side may be using the ring while it is freed
+ * @param ring Ring to free
+ */
+void libretro_audio_ring_free(libretro_audio_ring_t* ring);
+
+/**
+ * Round a frame count up to the capacity the ring would use
+ * @param min_frames Minimum capacity in frames
+ * @return Power-of-two capacity
+ */
+size_t libretro_audio_ring_capacity_for(size_t min_frames);
+
+/**
+ * Number of frames ready to read (safe from either thread)
+ * @param ring Ring
+ * @return Readable frames
+ */
+size_t libretro_audio_ring_available(const libretro_audio_ring_t* ring);
+
+/**
+ * Number of frames that can be written (safe from either thread)
+ * @param ring Ring
+ * @return Writable frames
+ */
+size_t libretro_audio_ring_space(const libretro_audio_ring_t* ring);
+
+/**
+ * Producer: append frames to the ring
+ * @param ring Ring
+ * @param data Interleaved stereo float samples
+ * @param frames Number of frames
+ * @return Number of frames written (less than frames if the ring is full)
+ */
+size_t libretro_audio_ring_write(libretro_audio_ring_t* ring, const float* data, size_t frames);
+
+/**
+ * Consumer: read frames from the ring
+ * @param ring Ring
+ * @param out Output interleaved stereo float buffer
+ * @param max_frames Maximum number of frames to read
+ * @return Number of frames read
+ */
+size_t libretro_audio_ring_read(libretro_audio_ring_t* ring, float* out, size_t max_frames);
+
+#endif // LIBRETRO_AUDIO_RING_H
@@ -0,0 +1,992 @@
+/*
+ * libretro_batch.c - Parallel Batch Runner Implementation
+ *
+ * Copyright (c) 2024 mikedx
+ * GitHub: https://github.com/mikedx/libretro_raylib
+ *
+ * This file is part of libretro_raylib.
+ *
+ * libretro_raylib is free software: you can redistribute it and/or modify
+ * it under the terms of the MIT License.
+ */
+
+#include "libretro_batch.h"
+#include "libretro_convert.h"
+#include "libretro_core.h"
+#include "libretro_instance.h"
+#include "libretro_movie.h"
+#include "libretro_perf.h"
+#include <limits.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define FNV_OFFSET 0xCBF29CE484222325ull
+#define FNV_PRIME  0x100000001B3ull
+
+//=============================================================================
+// JSON
+//=============================================================================
+
+typedef enum {
+    JSON_NULL,
+    JSON_BOOL,
+    JSON_NUMBER,
+    JSON_STRING,
+    JSON_ARRAY,
+    JSON_OBJECT
+} json_type_t;
+
+/**
+ * Parsed JSON value; arrays and objects own their items
+ */
+typedef struct json_value {
+    json_type_t type;
+    bool boolean;
+    double number;
+    char* string;
+    struct json_value* items;       // Array elements or object values
+    char** keys;                    // Object keys
+    unsigned count;
+} json_value_t;
+
+typedef struct {
+    const char* p;
+    const char* end;
+    unsigned line;
+    const char* error;
+} json_parser_t;
+
+static void json_free(json_value_t* value) {
+    if (!value) return;
+    for (unsigned i = 0; i < value->count; i++) {
+        json_free(&value->items[i]);
+        if (value->keys) free(value->keys[i]);
+    }
+    free(value->items);
+    free(value->keys);
+    free(value->string);
+    memset(value, 0, sizeof(*value));
+}
+
+/**
+ * Skip whitespace and // comments (allowed so manifests can be annotated)
+ */
+static void json_skip(json_parser_t* parser) {
+    while (parser->p < parser->end) {
+        char c = *parser->p;
+        if (c == '\n') {
+            parser->line++;
+            parser->p++;
+        } else if (c == ' ' || c == '\t' || c == '\r') {
+            parser->p++;
+        } else if (c == '/' && parser->p + 1 < parser->end && parser->p[1] == '/') {
+            while (parser->p < parser->end && *parser->p != '\n') parser->p++;
+        } else {
+            break;
+        }
+    }
+}
+
+static void json_put_utf8(char* out, size_t* length, unsigned code) {
+    if (code < 0x80) {
+        out[(*length)++] = (char)code;
+    } else if (code < 0x800) {
+        out[(*length)++] = (char)(0xC0 | (code >> 6));
+        out[(*length)++] = (char)(0x80 | (code & 0x3F));
+    } else if (code < 0x10000) {
+        out[(*length)++] = (char)(0xE0 | (code >> 12));
+        out[(*length)++] = (char)(0x80 | ((code >> 6) & 0x3F));
+        out[(*length)++] = (char)(0x80 | (code & 0x3F));
+    } else {
+        out[(*length)++] = (char)(0xF0 | (code >> 18));
+        out[(*length)++] = (char)(0x80 | ((code >> 12) & 0x3F));
+        out[(*length)++] = (char)(0x80 | ((code >> 6) & 0x3F));
+        out[(*length)++] = (char)(0x80 | (code & 0x3F));
+    }
+}
+
+static bool json_hex4(const char* p, unsigned* code) {
+    *code = 0;
+    for (int i = 0; i < 4; i++) {
+        char c = p[i];
+        unsigned digit;
+        if (c >= '0' && c <= '9') digit = (unsigned)(c - '0');
+        else if (c >= 'a' && c <= 'f') digit = (unsigned)(c - 'a' + 10);
+        else if (c >= 'A' && c <= 'F') digit = (unsigned)(c - 'A' + 10);
+        else return false;
+        *code = (*code << 4) | digit;
+    }
+    return true;
+}
+
+/**
+ * Parse a string (the opening quote is at parser->p)
+ * Decoded output is never longer than the escaped input
+ */
+static char* json_parse_string(json_parser_t* parser) {
+    const char* start = ++parser->p;
+    const char* close = start;
+    while (close < parser->end && *close != '"') {
+        if (*close == '\\') close++;
+        close++;
+    }
+    if (close >= parser->end) {
+        parser->error = "unterminated string";
+        return NULL;
+    }
+
+    char* out = (char*)malloc((size_t)(close - start) + 1);
+    if (!out) {
+        parser->error = "out of memory";
+        return NULL;
+    }
+    size_t length = 0;
+    for (const char* p = start; p < close; p++) {
+        if (*p != '\\') {
+            out[length++] = *p;
+            continue;
+        }
+        p++;
+        switch (*p) {
+            case '"': out[length++] = '"'; break;
+            case '\\': out[length++] = '\\'; break;
+            case '/': out[length++] = '/'; break;
+            case 'b': out[length++] = '\b'; break;
+            case 'f': out[length++] = '\f'; break;
+            case 'n': out[length++] = '\n'; break;
+            case 'r': out[length++] = '\r'; break;
+            case 't': out[length++] = '\t'; break;
+            case 'u': {
+                unsigned code, low;
+                if (close - p < 5 || !json_hex4(p + 1, &code)) {
+                    parser->error = "bad \\u escape";
+                    free(out);
+                    return NULL;
+                }
+                p += 4;
+                // Surrogate pair: the six escaped bytes cover the four UTF-8 ones
+                if (code >= 0xD800 && code < 0xDC00 && close - p >= 7 && p[1] == '\\' && p[2] == 'u' &&
+                    json_hex4(p + 3, &low) && low >= 0xDC00 && low < 0xE000) {
+                    code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                    p += 6;
+                }
+                json_put_utf8(out, &length, code);
+                break;
+            }
+            default:
+                parser->error = "bad escape";
+                free(out);
+                return NULL;
+        }
+    }
+    out[length] = '\0';
+    parser->p = close + 1;
+    return out;
+}
+
+static bool json_parse_value(json_parser_t* parser, json_value_t* value, unsigned depth);
+
+static bool json_append(json_parser_t* parser, json_value_t* container, unsigned* capacity) {
+    if (container->count < *capacity) return true;
+    unsigned grown = *capacity ? *capacity * 2 : 8;
+    json_value_t* items = (json_value_t*)realloc(container->items, grown * sizeof(json_value_t));
+    if (!items) {
+        parser->error = "out of memory";
+        return false;
+    }
+    container->items = items;
+    if (container->type == JSON_OBJECT) {
+        char** keys = (char**)realloc(container->keys, grown * sizeof(char*));
+        if (!keys) {
+            parser->error = "out of memory";
+            return false;
+        }
+        container->keys = keys;
+    }
+    *capacity = grown;
+    return true;
+}
+
+/**
+ * Parse an array or object body (the opening bracket is at parser->p)
+ */
+static bool json_parse_container(json_parser_t* parser, json_value_t* value, unsigned depth) {
+    bool object = *parser->p == '{';
+    char close = object ? '}' : ']';
+    value->type = object ? JSON_OBJECT : JSON_ARRAY;
+    parser->p++;
+    unsigned capacity = 0;
+
+    json_skip(parser);
+    if (parser->p < parser->end && *parser->p == close) {
+        parser->p++;
+        return true;
+    }
+    for (;;) {
+        if (!json_append(parser, value, &capacity)) return false;
+        json_value_t* item = &value->items[value->count];
+        memset(item, 0, sizeof(*item));
+
+        char* key = NULL;
+        if (object) {
+            json_skip(parser);
+            if (parser->p >= parser->end || *parser->p != '"') {
+                parser->error = "expected a key";
+                return false;
+            }
+            if (!(key = json_parse_string(parser))) return false;
+            json_skip(parser);
+            if (parser->p >= parser->end || *parser->p != ':') {
+                parser->error = "expected ':'";
+                free(key);
+                return false;
+            }
+            parser->p++;
+        }
+        if (!json_parse_value(parser, item, depth + 1)) {
+            free(key);
+            json_free(item);
+            return false;
+        }
+        if (object) value->keys[value->count] = key;
+        value->count++;
+
+        json_skip(parser);
+        if (parser->p < parser->end && *parser->p == ',') {
+            parser->p++;
+            continue;
+        }
+        if (parser->p < parser->end && *parser->p == close) {
+            parser->p++;
+            return true;
+        }
+        parser->error = object ? "expected ',' or '}'" : "expected ',' or ']'";
+        return false;
+    }
+}
+
+static bool json_parse_value(json_parser_t* parser, json_value_t* value, unsigned depth) {
+    memset(value, 0, sizeof(*value));
+    if (depth > 64) {
+        parser->error = "nested too deeply";
+        return false;
+    }
+    json_skip(parser);
+    if (parser->p >= parser->end) {
+        parser->error = "unexpected end of file";
+        return false;
+    }
+
+    char c = *parser->p;
+    size_t left = (size_t)(parser->end - parser->p);
+    if (c == '{' || c == '[') return json_parse_container(parser, value, depth);
+    if (c == '"') {
+        value->type = JSON_STRING;
+        return (value->string = json_parse_string(parser)) != NULL;
+    }
+    if (left >= 4 && strncmp(parser->p, "true", 4) == 0) {
+        value->type = JSON_BOOL;
+        value->boolean = true;
+        parser->p += 4;
+        return true;
+    }
+    if (left >= 5 && strncmp(parser->p, "false", 5) == 0) {
+        value->type = JSON_BOOL;
+        parser->p += 5;
+        return true;
+    }
+    if (left >= 4 && strncmp(parser->p, "null", 4) == 0) {
+        value->type = JSON_NULL;
+        parser->p += 4;
+        return true;
+    }
+
+    // The buffer is NUL terminated, so strtod stops in bounds
+    char* number_end = NULL;
+    value->number = strtod(parser->p, &number_end);
+    if (number_end == parser->p) {
+        parser->error = "unexpected character";
+        return false;
+    }
+    value->type = JSON_NUMBER;
+    parser->p = number_end;
+    return true;
+}
+
+static const json_value_t* json_get(const json_value_t* object, const char* key) {
+    if (!object || object->type != JSON_OBJECT) return NULL;
+    for (unsigned i = 0; i < object->count; i++) {
+        if (strcmp(object->keys[i], key) == 0) return &object->items[i];
+    }
+    return NULL;
+}
+
+static const char* json_get_string(const json_value_t* object, const char* key) {
+    const json_value_t* value = json_get(object, key);
+    return (value && value->type == JSON_STRING) ? value->string : NULL;
+}
+
+static bool json_get_bool(const json_value_t* object, const char* key, bool* out) {
+    const json_value_t* value = json_get(object, key);
+    if (!value || value->type != JSON_BOOL) return false;
+    *out = value->boolean;
+    return true;
+}
+
+static bool json_get_unsigned(const json_value_t* object, const char* key, unsigned* out) {
+    const json_value_t* value = json_get(object, key);
+    if (!value || value->type != JSON_NUMBER || value->number < 0.0 || value->number > (double)UINT32_MAX) {
+        return false;
+    }
+    *out = (unsigned)value->number;
+    return true;
+}
+
+/**
+ * Write a string with JSON escaping
+ */
+static void json_write_string(FILE* file, const char* s) {
+    fputc('"', file);
+    for (; *s; s++) {
+        unsigned char c = (unsigned char)*s;
+        if (c == '"' || c == '\\') {
+            fprintf(file, "\\%c", c);
+        } else if (c < 0x20) {
+            fprintf(file, "\\u%04x", c);
+        } else {
+            fputc(c, file);
+        }
+    }
+    fputc('"', file);
+}
+
+//=============================================================================
+// Jobs
+//=============================================================================
+
+/**
+ * Hashes to take (and maybe compare) after a number of frames
+ */
+typedef struct {
+    unsigned frame;
+    bool has_expected_video;
+    bool has_expected_audio;
+    uint64_t expected_video;
+    uint64_t expected_audio;
+    bool captured;
+    uint64_t video;
+    uint64_t audio;
+} batch_checkpoint_t;
+
+/**
+ * Joypad state from a frame on, until the port's next entry
+ */
+typedef struct {
+    unsigned frame;
+    unsigned port;
+    uint16_t mask;
+} batch_input_t;
+
+typedef struct {
+    char name[128];
+    char core[PATH_MAX];
+    char rom[PATH_MAX];             // Empty = no game
+    char movie_path[PATH_MAX];      // Input movie to replay (empty = none)
+    bool frames_set;                // Otherwise a movie's length decides
+    bool reload_core;               // Open a fresh copy instead of the worker's
+    bool core_reused;               // Ran on an image an earlier job initialized
+    struct batch_worker* worker;    // Worker running it
+    char** overrides;               // "key=value"
+    unsigned override_count;
+
+    batch_checkpoint_t* checkpoints; // Sorted by frame
+    unsigned checkpoint_count;
+    unsigned next_checkpoint;
+    batch_input_t* inputs;          // Sorted by frame
+    unsigned input_count;
+    unsigned next_input;
+
+    libretro_instance_t instance;
+    libretro_movie_t movie;
+    unsigned mismatches;
+    char error[128];                // Manifest problem, if any
+} batch_job_t;
+
+typedef struct {
+    batch_job_t* jobs;
+    unsigned count;
+    unsigned next_job;              // Claimed with an atomic add
+} batch_t;
+
+// Joypad button names for "buttons" (RETRO_DEVICE_ID_JOYPAD_* order)
+static const char* const batch_button_names[16] = {
+    "b", "y", "select", "start", "up", "down", "left", "right",
+    "a", "x", "l", "r", "l2", "r2", "l3", "r3"
+};
+
+/**
+ * Resolve a manifest path relative to the manifest's directory; made absolute
+ * when it exists, so a report still resolves wherever it is written
+ * @param out Buffer of PATH_MAX bytes
+ */
+static void batch_resolve_path(char* out, const char* base_dir, const char* path) {
+    char joined[PATH_MAX];
+    if (path[0] == '/' || !base_dir[0]) {
+        snprintf(joined, sizeof(joined), "%s", path);
+    } else {
+        snprintf(joined, sizeof(joined), "%s/%s", base_dir, path);
+    }
+    if (!realpath(joined, out)) snprintf(out, PATH_MAX, "%s", joined);
+}
+
+static bool batch_parse_hash(const char* text, uint64_t* hash) {
+    if (!text || strlen(text) != 16) return false;
+    char* end = NULL;
+    *hash = strtoull(text, &end, 16);
+    return end && *end == '\0';
+}
+
+static int batch_compare_checkpoints(const void* a, const void* b) {
+    unsigned fa = ((const batch_checkpoint_t*)a)->frame;
+    unsigned fb = ((const batch_checkpoint_t*)b)->frame;
+    return (fa > fb) - (fa < fb);
+}
+
+static int batch_compare_inputs(const void* a, const void* b) {
+    unsigned fa = ((const batch_input_t*)a)->frame;
+    unsigned fb = ((const batch_input_t*)b)->frame;
+    return (fa > fb) - (fa < fb);
+}
+
+static bool batch_add_overrides(batch_job_t* job, const json_value_t* options) {
+    if (!options) return true;
+    if (options->type != JSON_OBJECT) return false;
+    char** overrides = (char**)realloc(job->overrides, (job->override_count + options->count) * sizeof(char*));
+    if (!overrides) return false;
+    job->overrides = overrides;
+    for (unsigned i = 0; i < options->count; i++) {
+        if (options->items[i].type != JSON_STRING) return false;
+        size_t length = strlen(options->keys[i]) + strlen(options->items[i].string) + 2;
+        char* assignment = (char*)malloc(length);
+        if (!assignment) return false;
+        snprintf(assignment, length, "%s=%s", options->keys[i], options->items[i].string);
+        job->overrides[job->override_count++] = assignment;
+    }
+    return true;
+}
+
+static bool batch_parse_input(batch_job_t* job, const json_value_t* input) {
+    if (!input) return true;
+    if (input->type != JSON_ARRAY) return false;
+    job->inputs = (batch_input_t*)calloc(input->count ? input->count : 1, sizeof(batch_input_t));
+    if (!job->inputs) return false;
+
+    for (unsigned i = 0; i < input->count; i++) {
+        const json_value_t* entry = &input->items[i];
+        batch_input_t* out = &job->inputs[job->input_count];
+        if (!json_get_unsigned(entry, "frame", &out->frame)) return false;
+        if (!json_get_unsigned(entry, "port", &out->port)) out->port = 0;
+        if (out->port >= LIBRETRO_INPUT_MAX_PORTS) return false;
+
+        const json_value_t* buttons = json_get(entry, "buttons");
+        if (buttons && buttons->type == JSON_NUMBER) {
+            out->mask = (uint16_t)buttons->number;
+        } else if (buttons && buttons->type == JSON_ARRAY) {
+            for (unsigned b = 0; b < buttons->count; b++) {
+                if (buttons->items[b].type != JSON_STRING) return false;
+                unsigned id = 0;
+                while (id < 16 && strcmp(buttons->items[b].string, batch_button_names[id]) != 0) id++;
+                if (id == 16) return false;
+                out->mask |= (uint16_t)(1u << id);
+            }
+        } else {
+            return false;
+        }
+        job->input_count++;
+    }
+    qsort(job->inputs, job->input_count, sizeof(batch_input_t), batch_compare_inputs);
+    return true;
+}
+
+static bool batch_parse_checkpoints(batch_job_t* job, const json_value_t* checkpoints) {
+    if (!checkpoints) return true;
+    if (checkpoints->type != JSON_ARRAY) return false;
+    job->checkpoints = (batch_checkpoint_t*)calloc(checkpoints->count ? checkpoints->count : 1,
+                                                   sizeof(batch_checkpoint_t));
+    if (!job->checkpoints) return false;
+
+    for (unsigned i = 0; i < checkpoints->count; i++) {
+        const json_value_t* entry = &checkpoints->items[i];
+        batch_checkpoint_t* out = &job->checkpoints[job->checkpoint_count];
+        if (entry->type == JSON_NUMBER) {
+            if (entry->number < 1.0) return false;
+            out->frame = (unsigned)entry->number;
+        } else {
+            if (!json_get_unsigned(entry, "frame", &out->frame) || out->frame == 0) return false;
+            const char* video = json_get_string(entry, "video");
+            const char* audio = json_get_string(entry, "audio");
+            if (video && !(out->has_expected_video = batch_parse_hash(video, &out->expected_video))) return false;
+            if (audio && !(out->has_expected_audio = batch_parse_hash(audio, &out->expected_audio))) return false;
+        }
+        job->checkpoint_count++;
+    }
+    qsort(job->checkpoints, job->checkpoint_count, sizeof(batch_checkpoint_t), batch_compare_checkpoints);
+    return true;
+}
+
+/**
+ * Fill in a job from its manifest entry and the manifest's defaults
+ */
+static bool batch_parse_job(batch_job_t* job, unsigned index, const json_value_t* entry,
+                            const json_value_t* manifest, const char* base_dir, unsigned default_frames) {
+    const char* core = json_get_string(entry, "core");
+    if (!core) core = json_get_string(manifest, "core");
+    const char* rom = json_get_string(entry, "rom");
+    const char* name = json_get_string(entry, "name");
+
+    if (name) {
+        snprintf(job->name, sizeof(job->name), "%s", name);
+    } else if (rom) {
+        const char* slash = strrchr(rom, '/');
+        snprintf(job->name, sizeof(job->name), "%s", slash ? slash + 1 : rom);
+    } else {
+        snprintf(job->name, sizeof(job->name), "job %u", index);
+    }
+    if (entry->type != JSON_OBJECT || !core) {
+        snprintf(job->error, sizeof(job->error), "no core");
+        return false;
+    }
+    batch_resolve_path(job->core, base_dir, core);
+    if (rom) batch_resolve_path(job->rom, base_dir, rom);
+
+    unsigned frames = default_frames;
+    job->frames_set = json_get_unsigned(entry, "frames", &frames) || json_get_unsigned(manifest, "frames", &frames);
+    if (!json_get_bool(entry, "reload_core", &job->reload_core)) {
+        json_get_bool(manifest, "reload_core", &job->reload_core);
+    }
+
+    const char* movie = json_get_string(entry, "movie");
+    if (movie && json_get(entry, "input")) {
+        snprintf(job->error, sizeof(job->error), "\"movie\" and \"input\" can't be combined");
+        return false;
+    }
+    if (movie) batch_resolve_path(job->movie_path, base_dir, movie);
+
+    if (!batch_add_overrides(job, json_get(manifest, "options")) ||
+        !batch_add_overrides(job, json_get(entry, "options"))) {
+        snprintf(job->error, sizeof(job->error), "bad \"options\" (string values only)");
+        return false;
+    }
+    if (!batch_parse_input(job, json_get(entry, "input"))) {
+        snprintf(job->error, sizeof(job->error), "bad \"input\" entry");
+        return false;
+    }
+    if (!batch_parse_checkpoints(job, json_get(entry, "checkpoints"))) {
+        snprintf(job->error, sizeof(job->error), "bad \"checkpoints\" entry");
+        return false;
+    }
+
+    // Run at least up to the last checkpoint
+    if (job->checkpoint_count && job->checkpoints[job->checkpoint_count - 1].frame > frames) {
+        frames = job->checkpoints[job->checkpoint_count - 1].frame;
+    }
+
+    libretro_instance_config_t* config = &job->instance.config;
+    config->core_path = job->core;
+    config->rom_path = job->rom[0] ? job->rom : NULL;
+    config->frames = frames;
+    config->option_overrides = (const char* const*)job->overrides;
+    config->option_override_count = job->override_count;
+    return true;
+}
+
+static void batch_free_job(batch_job_t* job) {
+    for (unsigned i = 0; i < job->override_count; i++) free(job->overrides[i]);
+    free(job->overrides);
+    free(job->checkpoints);
+    free(job->inputs);
+}
+
+//=============================================================================
+// Running
+//=============================================================================
+
+typedef struct batch_worker {
+    batch_t* batch;
+    int cpu;
+    pthread_t thread;
+    bool started;
+
+    // Private copy of the core the last job ran, kept for the next job with
+    // the same core, content and options: copying and dlopening the core
+    // dominates short jobs
+    void* core_image;
+    const batch_job_t* image_job;   // Job that opened it
+    uint8_t* state;                 // Core state right after that job loaded
+    size_t state_size;
+} batch_worker_t;
+
+static void batch_worker_drop_core(batch_worker_t* worker) {
+    libretro_core_close_image(worker->core_image);
+    worker->core_image = NULL;
+    worker->image_job = NULL;
+    worker->state_size = 0;
+}
+
+/**
+ * Whether two jobs load the same core and content with the same options
+ */
+static bool batch_same_setup(const batch_job_t* a, const batch_job_t* b) {
+    if (strcmp(a->core, b->core) != 0 || strcmp(a->rom, b->rom) != 0 ||
+        a->override_count != b->override_count) {
+        return false;
+    }
+    for (unsigned i = 0; i < a->override_count; i++) {
+        if (strcmp(a->overrides[i], b->overrides[i]) != 0) return false;
+    }
+    return true;
+}
+
+/**
+ * Right after loading: keep the state of a fresh image, and put a reused
+ * one back into it, so a core that retro_init doesn't fully reset still
+ * starts the job where a fresh load would
+ */
+static bool batch_post_load_state(batch_job_t* job, libretro_frontend_t* frontend) {
+    batch_worker_t* worker = job->worker;
+    struct retro_core_t* core = frontend->core;
+    if (!worker || !worker->core_image) return true;
+
+    if (job->core_reused) {
+        if (!core->retro_unserialize || !core->retro_unserialize(worker->state, worker->state_size)) {
+            snprintf(job->error, sizeof(job->error), "failed to restore the post-load state");
+            return false;
+        }
+        return true;
+    }
+
+    // A core that can't serialize isn't reused
+    size_t size = core->retro_serialize_size ? core->retro_serialize_size() : 0;
+    uint8_t* state = size ? (uint8_t*)realloc(worker->state, size) : NULL;
+    if (state) worker->state = state;
+    worker->state_size = (state && core->retro_serialize && core->retro_serialize(state, size)) ? size : 0;
+    return true;
+}
+
+static uint64_t batch_hash_frame(const libretro_frontend_t* frontend) {
+    uint64_t h = FNV_OFFSET;
+    uint32_t size[2] = { frontend->frame_width, frontend->frame_height };
+    const uint8_t* bytes = (const uint8_t*)size;
+    for (size_t i = 0; i < sizeof(size); i++) h = (h ^ bytes[i]) * FNV_PRIME;
+
+    // Frames are converted at their own size (nothing is uploaded natively here)
+    size_t length = (size_t)frontend->frame_width * frontend->frame_height * 4;
+    if (!frontend->framebuffer || length > frontend->framebuffer_size) return h;
+    bytes = (const uint8_t*)frontend->framebuffer;
+    for (size_t i = 0; i < length; i++) h = (h ^ bytes[i]) * FNV_PRIME;
+    return h;
+}
+
+static bool batch_before_frame(libretro_instance_t* instance, unsigned frame) {
+    batch_job_t* job = (batch_job_t*)instance->userdata;
+    if (frame == 0) {
+        if (!batch_post_load_state(job, &instance->frontend)) return false;
+        instance->frontend.audio_checksum_enabled = true;
+        instance->frontend.audio_checksum = FNV_OFFSET;
+
+        // Replayed from the state right after loading, like it was recorded
+        if (job->movie_path[0]) {
+            if (!libretro_movie_play(&job->movie, &instance->frontend, job->movie_path)) {
+                snprintf(job->error, sizeof(job->error), "failed to play movie");
+                return false;
+            }
+            unsigned* frames = &instance->config.frames;
+            // An explicit frame count wins over the movie's length, as with --frames
+            if (!job->frames_set) *frames = job->movie.frame_count;
+            if (job->checkpoint_count && job->checkpoints[job->checkpoint_count - 1].frame > *frames) {
+                *frames = job->checkpoints[job->checkpoint_count - 1].frame;
+            }
+        }
+    }
+    while (job->next_input < job->input_count && job->inputs[job->next_input].frame <= frame) {
+        const batch_input_t* input = &job->inputs[job->next_input++];
+        libretro_frontend_set_joypad_mask(&instance->frontend, input->port, input->mask);
+    }
+    return true;
+}
+
+static bool batch_after_frame(libretro_instance_t* instance, unsigned frames) {
+    batch_job_t* job = (batch_job_t*)instance->userdata;
+    while (job->next_checkpoint < job->checkpoint_count && job->checkpoints[job->next_checkpoint].frame <= frames) {
+        batch_checkpoint_t* checkpoint = &job->checkpoints[job->next_checkpoint++];
+        checkpoint->captured = true;
+        checkpoint->video = batch_hash_frame(&instance->frontend);
+        checkpoint->audio = instance->frontend.audio_checksum;
+        if ((checkpoint->has_expected_video && checkpoint->video != checkpoint->expected_video) ||
+            (checkpoint->has_expected_audio && checkpoint->audio != checkpoint->expected_audio)) {
+            job->mismatches++;
+        }
+    }
+    return true;
+}
+
+static void* batch_worker_thread(void* arg) {
+    batch_worker_t* worker = (batch_worker_t*)arg;
+    batch_t* batch = worker->batch;
+    for (;;) {
+        unsigned index = __atomic_fetch_add(&batch->next_job, 1, __ATOMIC_RELAXED);
+        if (index >= batch->count) break;
+        batch_job_t* job = &batch->jobs[index];
+        if (job->error[0]) continue;
+
+        // The core goes through retro_deinit and retro_init again between
+        // jobs instead of being reloaded
+        job->core_reused = worker->core_image && worker->state_size && !job->reload_core &&
+                           batch_same_setup(worker->image_job, job);
+        if (!job->core_reused) batch_worker_drop_core(worker);
+        double open_seconds = 0.0;
+        if (!worker->core_image && !job->reload_core) {
+            uint64_t start = libretro_perf_now_ns();
+            worker->core_image = libretro_core_open_image(job->core, true);
+            worker->image_job = job;
+            open_seconds = (double)(libretro_perf_now_ns() - start) / 1e9;
+        }
+
+        job->worker = worker;
+        job->instance.cpu = worker->cpu;
+        job->instance.index = index;
+        job->instance.userdata = job;
+        job->instance.before_frame = batch_before_frame;
+        job->instance.after_frame = batch_after_frame;
+        job->instance.core_image = worker->core_image;
+        libretro_instance_run(&job->instance);
+        job->instance.load_seconds += open_seconds;
+        libretro_movie_stop(&job->movie);
+
+        // A job that failed may have left the core in any state
+        if (!job->instance.ok) batch_worker_drop_core(worker);
+    }
+    batch_worker_drop_core(worker);
+    free(worker->state);
+    return NULL;
+}
+
+static void batch_write_report(const batch_t* batch, const char* path, unsigned workers, double elapsed) {
+    FILE* file = fopen(path, "w");
+    if (!file) {
+        fprintf(stderr, "Failed to write batch report: %s\n", path);
+        return;
+    }
+    fprintf(file, "{\n  \"workers\": %u,\n  \"seconds\": %.3f,\n  \"jobs\": [\n", workers, elapsed);
+    for (unsigned i = 0; i < batch->count; i++) {
+        const batch_job_t* job = &batch->jobs[i];
+        const libretro_instance_t* instance = &job->instance;
+        fprintf(file, "    {\n      \"name\": ");
+        json_write_string(file, job->name);
+        fprintf(file, ",\n      \"core\": ");
+        json_write_string(file, job->core);
+        if (job->rom[0]) {
+            fprintf(file, ",\n      \"rom\": ");
+            json_write_string(file, job->rom);
+        }
+        if (job->movie_path[0]) {
+            fprintf(file, ",\n      \"movie\": ");
+            json_write_string(file, job->movie_path);
+        }
+        fprintf(file, ",\n      \"frames\": %u,\n      \"status\": \"%s\"", instance->config.frames,
+                !instance->ok ? "failed" : job->mismatches ? "mismatch" : "ok");
+        fprintf(file, ",\n      \"load_seconds\": %.3f,\n      \"run_seconds\": %.3f",
+                instance->load_seconds, instance->run_seconds);
+        if (job->core_reused) fprintf(file, ",\n      \"core_reused\": true");
+        if (job->override_count) {
+            fprintf(file, ",\n      \"options\": {");
+            for (unsigned o = 0; o < job->override_count; o++) {
+                const char* equals = strchr(job->overrides[o], '=');
+                char key[256];
+                snprintf(key, sizeof(key), "%.*s", (int)(equals - job->overrides[o]), job->overrides[o]);
+                fprintf(file, "%s ", o ? "," : "");
+                json_write_string(file, key);
+                fprintf(file, ": ");
+                json_write_string(file, equals + 1);
+            }
+            fprintf(file, " }");
+        }
+        if (job->input_count) {
+            fprintf(file, ",\n      \"input\": [");
+            for (unsigned n = 0; n < job->input_count; n++) {
+                const batch_input_t* input = &job->inputs[n];
+                fprintf(file, "%s\n        { \"frame\": %u, \"port\": %u, \"buttons\": %u }",
+                        n ? "," : "", input->frame, input->port, input->mask);
+            }
+            fprintf(file, "\n      ]");
+        }
+        fprintf(file, ",\n      \"checkpoints\": [");
+        for (unsigned c = 0; c < job->checkpoint_count; c++) {
+            const batch_checkpoint_t* checkpoint = &job->checkpoints[c];
+            fprintf(file, "%s\n        { \"frame\": %u", c ? "," : "", checkpoint->frame);
+            if (checkpoint->captured) {
+                fprintf(file, ", \"video\": \"%016llx\", \"audio\": \"%016llx\"",
+                        (unsigned long long)checkpoint->video, (unsigned long long)checkpoint->audio);
+            }
+            fprintf(file, " }");
+        }
+        fprintf(file, "%s]\n    }%s\n", job->checkpoint_count ? "\n      " : "", i + 1 < batch->count ? "," : "");
+    }
+    fprintf(file, "  ]\n}\n");
+    fclose(file);
+}
+
+/**
+ * Read a whole file, NUL terminated
+ */
+static char* batch_read_file(const char* path, size_t* size) {
+    FILE* file = fopen(path, "rb");
+    if (!file) return NULL;
+    fseek(file, 0, SEEK_END);
+    long length = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    char* data = length >= 0 ? (char*)malloc((size_t)length + 1) : NULL;
+    if (data && fread(data, 1, (size_t)length, file) != (size_t)length) {
+        free(data);
+        data = NULL;
+    }
+    fclose(file);
+    if (!data) return NULL;
+    data[length] = '\0';
+    *size = (size_t)length;
+    return data;
+}
+
+bool libretro_batch_run(const char* manifest_path, const char* report_path, unsigned workers,
+                        unsigned default_frames, bool pin) {
+    if (!manifest_path) return false;
+
+    size_t size = 0;
+    char* text = batch_read_file(manifest_path, &size);
+    if (!text) {
+        fprintf(stderr, "Failed to read batch manifest: %s\n", manifest_path);
+        return false;
+    }
+    json_parser_t parser = { text, text + size, 1, NULL };
+    json_value_t manifest;
+    bool parsed = json_parse_value(&parser, &manifest, 0);
+    if (parsed) {
+        json_skip(&parser);
+        if (parser.p != parser.end) {
+            parser.error = "trailing characters";
+            parsed = false;
+        }
+    }
+    free(text);
+    if (!parsed) {
+        // Whatever was parsed before the error is still owned by the tree
+        json_free(&manifest);
+        fprintf(stderr, "%s:%u: %s\n", manifest_path, parser.line, parser.error);
+        return false;
+    }
+
+    const json_value_t* jobs = json_get(&manifest, "jobs");
+    if (!jobs || jobs->type != JSON_ARRAY || jobs->count == 0) {
+        fprintf(stderr, "%s: no \"jobs\" array\n", manifest_path);
+        json_free(&manifest);
+        return false;
+    }
+
+    char base_dir[PATH_MAX];
+    snprintf(base_dir, sizeof(base_dir), "%s", manifest_path);
+    char* slash = strrchr(base_dir, '/');
+    if (slash) *slash = '\0'; else base_dir[0] = '\0';
+
+    batch_t batch = { 0 };
+    batch.count = jobs->count;
+    batch.jobs = (batch_job_t*)calloc(batch.count, sizeof(batch_job_t));
+    if (!batch.jobs) {
+        fprintf(stderr, "Failed to allocate %u batch jobs\n", batch.count);
+        json_free(&manifest);
+        return false;
+    }
+    for (unsigned i = 0; i < batch.count; i++) {
+        if (!batch_parse_job(&batch.jobs[i], i, &jobs->items[i], &manifest, base_dir, default_frames)) {
+            fprintf(stderr, "Batch job '%s': %s\n", batch.jobs[i].name, batch.jobs[i].error);
+        }
+    }
+    if (workers == 0) json_get_unsigned(&manifest, "workers", &workers);
+    json_free(&manifest);
+
+    unsigned cpus = libretro_instance_cpu_count();
+    if (workers == 0) workers = cpus;
+    if (workers > batch.count) workers = batch.count;
+
+    batch_worker_t* pool = (batch_worker_t*)calloc(workers, sizeof(batch_worker_t));
+    if (!pool) {
+        fprintf(stderr, "Failed to allocate %u batch workers\n", workers);
+        workers = 0;
+    }
+
+    // Process-wide setup the workers would otherwise race on
+    libretro_convert_init();
+
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr, LIBRETRO_INSTANCE_STACK_SIZE);
+    uint64_t start = libretro_perf_now_ns();
+    for (unsigned w = 0; w < workers; w++) {
+        pool[w].batch = &batch;
+        pool[w].cpu = pin ? (int)(w % cpus) : -1;
+        pool[w].started = pthread_create(&pool[w].thread, &attr, batch_worker_thread, &pool[w]) == 0;
+    }
+    bool any_started = false;
+    for (unsigned w = 0; w < workers; w++) {
+        if (pool[w].started) {
+            pthread_join(pool[w].thread, NULL);
+            any_started = true;
+        }
+    }
+    pthread_attr_destroy(&attr);
+    double elapsed = (double)(libretro_perf_now_ns() - start) / 1e9;
+    free(pool);
+    if (!any_started) {
+        fprintf(stderr, "Failed to start batch workers\n");
+    }
+
+    // Summary
+    unsigned ok = 0, mismatched = 0, failed = 0;
+    unsigned long long frames = 0;
+    for (unsigned i = 0; i < batch.count; i++) {
+        const batch_job_t* job = &batch.jobs[i];
+        const libretro_instance_t* instance = &job->instance;
+        if (!instance->ok) {
+            failed++;
+            printf("[FAILED]   %s%s%s\n", job->name, job->error[0] ? ": " : "", job->error);
+            continue;
+        }
+        frames += instance->frames_run;
+        double fps = instance->run_seconds > 0.0 ? instance->frames_run / instance->run_seconds : 0.0;
+        printf("[%s] %s: %u frames in %.3f s (%.1f fps), loaded in %.3f s%s\n",
+               job->mismatches ? "MISMATCH" : "ok      ", job->name, instance->frames_run,
+               instance->run_seconds, fps, instance->load_seconds, job->core_reused ? " (core reused)" : "");
+        for (unsigned c = 0; c < job->checkpoint_count; c++) {
+            const batch_checkpoint_t* checkpoint = &job->checkpoints[c];
+            if (!checkpoint->captured) continue;
+            bool video_bad = checkpoint->has_expected_video && checkpoint->video != checkpoint->expected_video;
+            bool audio_bad = checkpoint->has_expected_audio && checkpoint->audio != checkpoint->expected_audio;
+            printf("           frame %u: video %016llx%s, audio %016llx%s\n", checkpoint->frame,
+                   (unsigned long long)checkpoint->video, video_bad ? " (MISMATCH)" : "",
+                   (unsigned long long)checkpoint->audio, audio_bad ? " (MISMATCH)" : "");
+        }
+        if (job->mismatches) mismatched++; else ok++;
+    }
+    printf("Batch: %u jobs (%u ok, %u mismatched, %u failed) on %u workers in %.3f s: "
+           "%llu frames, %.1f frames/s\n",
+           batch.count, ok, mismatched, failed, workers, elapsed, frames,
+           elapsed > 0.0 ? frames / elapsed : 0.0);
+
+    if (report_path) batch_write_report(&batch, report_path, workers, elapsed);
+
+    for (unsigned i = 0; i < batch.count; i++) batch_free_job(&batch.jobs[i]);
+    free(batch.jobs);
+    return ok == batch.count;
+}
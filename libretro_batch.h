@@ -0,0 +1,74 @@
+/*
+ * libretro_batch.h - Parallel Batch Runner
+ *
+ * Copyright (c) 2024 mikedx
+ * GitHub: https://github.com/mikedx/libretro_raylib
+ *
+ * This file is part of libretro_raylib.
+ *
+ * libretro_raylib is free software: you can redistribute it and/or modify
+ * it under the terms of the MIT License.
+ *
+ * Runs the jobs in a JSON manifest across a pool of worker threads, each job
+ * a headless core instance in this process (libretro_instance), and checks
+ * frame hashes and audio checksums at chosen frames:
+ *
+ *   {
+ *     "workers": 4,                        // Optional, default one per CPU
+ *     "core": "cores/snes9x_libretro.dylib", // Defaults for every job
+ *     "frames": 600,
+ *     "reload_core": false,                // Optional, see below
+ *     "jobs": [
+ *       {
+ *         "name": "smw-title",
+ *         "rom": "roms/smw.sfc",
+ *         "checkpoints": [
+ *           300,                           // Capture only
+ *           { "frame": 600, "video": "9f3a0c...", "audio": "51be..." }
+ *         ],
+ *         "input": [                       // Held until the port's next entry
+ *           { "frame": 120, "port": 0, "buttons": ["start"] },
+ *           { "frame": 126, "buttons": [] }
+ *         ],
+ *         "options": { "snes9x_region": "NTSC" }
+ *       },
+ *       {
+ *         "rom": "roms/smw.sfc",
+ *         "movie": "movies/smw-1-1.lrm",   // Instead of "input"; runs the
+ *         "checkpoints": [3600]            // whole movie unless "frames" is set
+ *       }
+ *     ]
+ *   }
+ *
+ * Relative paths are relative to the manifest. A checkpoint at frame N is
+ * taken after N frames have run: "video" is a 64-bit FNV-1a hash of the
+ * converted RGBA8888 frame and its size, "audio" one of every int16_t sample
+ * the core produced so far. The report written with --batch-report has the
+ * same layout with every hash filled in, so it can serve as the next run's
+ * expected results.
+ *
+ * Copying and dlopening the core is most of a short job's cost, so a worker
+ * keeps the private copy it loaded and runs its next job on the same core
+ * in it, through retro_deinit and retro_init again. Jobs (or manifests)
+ * with "reload_core": true get a fresh copy, for cores that don't reset all
+ * of their state in retro_init. A job that fails closes the copy.
+ */
+
+#ifndef LIBRETRO_BATCH_H
+#define LIBRETRO_BATCH_H
+
+#include <stdbool.h>
+
+/**
+ * Run every job in a manifest and print a summary to stdout
+ * @param manifest_path JSON manifest
+ * @param report_path Where to write results as JSON (NULL = don't)
+ * @param workers Worker threads (0 = the manifest's, or one per CPU)
+ * @param default_frames Frames for jobs that set none
+ * @param pin Pin worker threads to CPUs round-robin
+ * @return true if every job ran and matched its expected hashes
+ */
+bool libretro_batch_run(const char* manifest_path, const char* report_path, unsigned workers,
+                        unsigned default_frames, bool pin);
+
+#endif // LIBRETRO_BATCH_H
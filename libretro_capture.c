@@ -0,0 +1,563 @@
+/*
+ * libretro_capture.c - Video and Audio Capture Implementation
+ *
+ * Copyright (c) 2024 mikedx
+ * GitHub: https://github.com/mikedx/libretro_raylib
+ *
+ * This file is part of libretro_raylib.
+ *
+ * libretro_raylib is free software: you can redistribute it and/or modify
+ * it under the terms of the MIT License.
+ */
+
+#include "libretro_capture.h"
+#include "libretro_perf.h"
+#include "libretro_video.h"
+#include <ctype.h>
+#include <math.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Audio is converted to 16-bit and written in chunks of this many frames
+#define CAPTURE_AUDIO_CHUNK 4096
+
+#define CAPTURE_WAV_HEADER_SIZE 44
+
+// Wake the encoder for audio once the ring is this fraction full
+#define CAPTURE_AUDIO_WAKE_DIVISOR 4
+
+#ifdef __APPLE__
+#define CAPTURE_DEFAULT_CODEC "h264_videotoolbox"
+#else
+#define CAPTURE_DEFAULT_CODEC "libx264"
+#endif
+
+static size_t capture_bytes_per_pixel(unsigned format) {
+    return (format == RETRO_PIXEL_FORMAT_XRGB8888) ? 4 : 2;
+}
+
+static unsigned capture_gcd(unsigned a, unsigned b) {
+    while (b) {
+        unsigned t = a % b;
+        a = b;
+        b = t;
+    }
+    return a ? a : 1;
+}
+
+static bool capture_has_extension(const char* path, const char* ext) {
+    size_t len = strlen(path), ext_len = strlen(ext);
+    if (len < ext_len) return false;
+    for (size_t i = 0; i < ext_len; i++) {
+        if (tolower((unsigned char)path[len - ext_len + i]) != ext[i]) return false;
+    }
+    return true;
+}
+
+/**
+ * The video path with its extension replaced by .wav
+ */
+static bool capture_audio_path(const char* path, char* out, size_t size) {
+    const char* slash = strrchr(path, '/');
+    const char* dot = strrchr(path, '.');
+    size_t stem = (dot && (!slash || dot > slash)) ? (size_t)(dot - path) : strlen(path);
+    int len = snprintf(out, size, "%.*s.wav", (int)stem, path);
+    return len > 0 && (size_t)len < size;
+}
+
+//=============================================================================
+// WAV Output
+//=============================================================================
+
+static void capture_put_le32(uint8_t* p, uint32_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+static void capture_put_le16(uint8_t* p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+/**
+ * 16-bit stereo PCM header; sizes are filled in when the file is closed
+ */
+static bool capture_write_wav_header(FILE* file, unsigned rate, uint64_t frames) {
+    uint64_t data = frames * 4;
+    if (data > UINT32_MAX - 36) data = UINT32_MAX - 36;
+    uint8_t h[CAPTURE_WAV_HEADER_SIZE];
+    memcpy(h, "RIFF", 4);
+    capture_put_le32(h + 4, (uint32_t)(36 + data));
+    memcpy(h + 8, "WAVEfmt ", 8);
+    capture_put_le32(h + 16, 16);
+    capture_put_le16(h + 20, 1);                // PCM
+    capture_put_le16(h + 22, 2);                // Stereo
+    capture_put_le32(h + 24, rate);
+    capture_put_le32(h + 28, rate * 4);         // Bytes per second
+    capture_put_le16(h + 32, 4);                // Bytes per frame
+    capture_put_le16(h + 34, 16);
+    memcpy(h + 36, "data", 4);
+    capture_put_le32(h + 40, (uint32_t)data);
+    return fwrite(h, 1, sizeof(h), file) == sizeof(h);
+}
+
+/**
+ * Encoder thread: move teed audio from the ring into the WAV
+ */
+static void capture_drain_audio(libretro_capture_t* capture) {
+    float samples[CAPTURE_AUDIO_CHUNK * 2];
+    int16_t pcm[CAPTURE_AUDIO_CHUNK * 2];
+    size_t frames;
+    while ((frames = libretro_audio_ring_read(&capture->audio, samples, CAPTURE_AUDIO_CHUNK)) > 0) {
+        for (size_t i = 0; i < frames * 2; i++) {
+            float s = samples[i] * 32767.0f;
+            if (s > 32767.0f) s = 32767.0f;
+            if (s < -32768.0f) s = -32768.0f;
+            pcm[i] = (int16_t)lrintf(s);
+        }
+        if (capture->wav && fwrite(pcm, 4, frames, capture->wav) != frames) {
+            fprintf(stderr, "Capture: failed to write %s\n", capture->audio_path);
+            fclose(capture->wav);
+            capture->wav = NULL;
+        }
+        capture->audio_frames_written += frames;
+    }
+}
+
+//=============================================================================
+// Video Output
+//=============================================================================
+
+/**
+ * Full range BT.601 4:2:0 (Y4M's C420jpeg), chroma from each 2x2 block
+ */
+static void capture_rgba_to_yuv420(const uint32_t* rgba, unsigned width, unsigned height, uint8_t* yuv) {
+    unsigned cw = (width + 1) / 2, ch = (height + 1) / 2;
+    uint8_t* y_plane = yuv;
+    uint8_t* u_plane = yuv + (size_t)width * height;
+    uint8_t* v_plane = u_plane + (size_t)cw * ch;
+
+    for (unsigned y = 0; y < height; y++) {
+        const uint32_t* row = rgba + (size_t)y * width;
+        for (unsigned x = 0; x < width; x++) {
+            uint32_t p = row[x];
+            unsigned r = p & 0xFF, g = (p >> 8) & 0xFF, b = (p >> 16) & 0xFF;
+            y_plane[(size_t)y * width + x] = (uint8_t)((77 * r + 150 * g + 29 * b + 128) >> 8);
+        }
+    }
+
+    for (unsigned cy = 0; cy < ch; cy++) {
+        unsigned y0 = cy * 2, y1 = (y0 + 1 < height) ? y0 + 1 : y0;
+        for (unsigned cx = 0; cx < cw; cx++) {
+            unsigned x0 = cx * 2, x1 = (x0 + 1 < width) ? x0 + 1 : x0;
+            uint32_t q[4] = {
+                rgba[(size_t)y0 * width + x0], rgba[(size_t)y0 * width + x1],
+                rgba[(size_t)y1 * width + x0], rgba[(size_t)y1 * width + x1]
+            };
+            int r = 0, g = 0, b = 0;
+            for (int i = 0; i < 4; i++) {
+                r += q[i] & 0xFF;
+                g += (q[i] >> 8) & 0xFF;
+                b += (q[i] >> 16) & 0xFF;
+            }
+            r = (r + 2) / 4;
+            g = (g + 2) / 4;
+            b = (b + 2) / 4;
+            // Offset by 128.5 * 256 before shifting so the sums stay positive
+            int u = (-43 * r - 85 * g + 128 * b + 32896) >> 8;
+            int v = (128 * r - 107 * g - 21 * b + 32896) >> 8;
+            u_plane[(size_t)cy * cw + cx] = (uint8_t)(u > 255 ? 255 : u);
+            v_plane[(size_t)cy * cw + cx] = (uint8_t)(v > 255 ? 255 : v);
+        }
+    }
+}
+
+/**
+ * Nearest-neighbour scale to the output size (frames that changed size)
+ */
+static void capture_scale(const uint32_t* src, unsigned src_width, unsigned src_height,
+                          uint32_t* dst, unsigned dst_width, unsigned dst_height) {
+    for (unsigned y = 0; y < dst_height; y++) {
+        const uint32_t* row = src + (size_t)(y * src_height / dst_height) * src_width;
+        for (unsigned x = 0; x < dst_width; x++) {
+            dst[(size_t)y * dst_width + x] = row[x * src_width / dst_width];
+        }
+    }
+}
+
+/**
+ * Copy a path into a single-quoted shell word
+ */
+static bool capture_shell_quote(const char* s, char* out, size_t size) {
+    size_t n = 0;
+    if (size < 3) return false;
+    out[n++] = '\'';
+    for (; *s; s++) {
+        const char* piece = (*s == '\'') ? "'\\''" : NULL;
+        size_t len = piece ? 4 : 1;
+        if (n + len + 2 > size) return false;
+        if (piece) {
+            memcpy(out + n, piece, len);
+        } else {
+            out[n] = *s;
+        }
+        n += len;
+    }
+    out[n++] = '\'';
+    out[n] = '\0';
+    return true;
+}
+
+/**
+ * Encoder thread, first frame: fix the output size and start the stream
+ */
+static bool capture_open_video(libretro_capture_t* capture, unsigned width, unsigned height) {
+    capture->out_width = width;
+    capture->out_height = height;
+    // Y4M frames are exactly the planes at the output size, which is usually
+    // smaller than the max geometry the buffer was allocated for
+    capture->yuv_size = (size_t)width * height + 2 * (size_t)((width + 1) / 2) * ((height + 1) / 2);
+
+    unsigned rate_num = (unsigned)lround(capture->fps * 1000.0), rate_den = 1000;
+    unsigned g = capture_gcd(rate_num, rate_den);
+    rate_num /= g;
+    rate_den /= g;
+
+    if (capture->format == LIBRETRO_CAPTURE_Y4M) {
+        // Pixel aspect ratio, so players show the core's display aspect
+        unsigned par_num = 1000, par_den = 1000;
+        if (capture->aspect_ratio > 0.0f) {
+            par_num = (unsigned)lround(capture->aspect_ratio * height / width * 1000.0);
+        }
+        g = capture_gcd(par_num, par_den);
+        return fprintf(capture->video, "YUV4MPEG2 W%u H%u F%u:%u Ip A%u:%u C420jpeg\n",
+                       width, height, rate_num, rate_den, par_num / g, par_den / g) > 0;
+    }
+
+    char quoted[PATH_MAX * 4 + 3];
+    char command[sizeof(quoted) + 256];
+    if (!capture_shell_quote(capture->video_path, quoted, sizeof(quoted))) return false;
+    snprintf(command, sizeof(command),
+             "ffmpeg -hide_banner -loglevel error -y -f rawvideo -pix_fmt rgba -s %ux%u -r %u/%u -i - "
+             "-c:v %s -pix_fmt yuv420p %s",
+             width, height, rate_num, rate_den, capture->codec, quoted);
+    // A failed or exited ffmpeg must show up as a write error, not kill us
+    signal(SIGPIPE, SIG_IGN);
+    capture->video = popen(command, "w");
+    if (!capture->video) {
+        fprintf(stderr, "Capture: failed to start ffmpeg\n");
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Encoder thread: write one output frame (or the last one again)
+ */
+static void capture_write_frame(libretro_capture_t* capture, const uint32_t* rgba) {
+    if (capture->video_failed || !capture->video) return;
+    bool rgba_given = rgba != NULL;
+    bool ok;
+    if (capture->format == LIBRETRO_CAPTURE_Y4M) {
+        if (rgba) capture_rgba_to_yuv420(rgba, capture->out_width, capture->out_height, capture->yuv);
+        ok = fputs("FRAME\n", capture->video) >= 0 &&
+             fwrite(capture->yuv, 1, capture->yuv_size, capture->video) == capture->yuv_size;
+    } else {
+        // The frame to repeat is still in the buffer it was written from
+        if (!rgba) rgba = capture->last_frame;
+        size_t pixels = (size_t)capture->out_width * capture->out_height;
+        ok = rgba && fwrite(rgba, 4, pixels, capture->video) == pixels;
+    }
+    if (!ok) {
+        fprintf(stderr, "Capture: failed to write video to %s\n", capture->video_path);
+        capture->video_failed = true;
+        return;
+    }
+    capture->frames_written++;
+    if (!rgba_given) capture->frames_repeated++;
+}
+
+static void capture_encode(libretro_capture_t* capture, const libretro_capture_frame_t* frame) {
+    // Duplicates from before the first frame have nothing to repeat yet; they
+    // become copies of that frame so the video keeps the audio's length
+    unsigned leading = 0;
+    if (capture->out_width == 0) {
+        if (!capture_open_video(capture, frame->width, frame->height)) {
+            fprintf(stderr, "Capture: failed to start video output %s\n", capture->video_path);
+            capture->video_failed = true;
+        }
+        leading = frame->repeats;
+    } else {
+        for (unsigned i = 0; i < frame->repeats; i++) {
+            capture_write_frame(capture, NULL);
+        }
+    }
+    if (capture->video_failed) return;
+
+    libretro_video_convert_frame(capture->rgba, frame->data, frame->width, frame->height,
+                                 frame->width * capture_bytes_per_pixel(frame->format), frame->format);
+    const uint32_t* out = capture->rgba;
+    if (frame->width != capture->out_width || frame->height != capture->out_height) {
+        capture_scale(capture->rgba, frame->width, frame->height,
+                      capture->scaled, capture->out_width, capture->out_height);
+        out = capture->scaled;
+    }
+    capture->last_frame = out;
+    capture_write_frame(capture, out);
+    for (; leading > 0; leading--) {
+        capture_write_frame(capture, NULL);
+    }
+}
+
+static bool capture_queue_empty(libretro_capture_t* capture) {
+    return __atomic_load_n(&capture->head, __ATOMIC_SEQ_CST) == capture->tail;
+}
+
+/**
+ * Teed audio the encoder should be woken for even without a new frame
+ * (duplicate frames, hardware rendering), well before the ring is full
+ */
+static bool capture_audio_due(libretro_capture_t* capture) {
+    return libretro_audio_ring_available(&capture->audio) >= capture->audio.capacity / CAPTURE_AUDIO_WAKE_DIVISOR;
+}
+
+static bool capture_idle(libretro_capture_t* capture) {
+    return capture_queue_empty(capture) && !capture_audio_due(capture);
+}
+
+/**
+ * Producer side: wake the encoder if it is asleep
+ * The encoder only holds the lock while deciding to sleep
+ */
+static void capture_wake(libretro_capture_t* capture) {
+    if (__atomic_load_n(&capture->waiting, __ATOMIC_SEQ_CST)) {
+        pthread_mutex_lock(&capture->mutex);
+        pthread_cond_signal(&capture->cond);
+        pthread_mutex_unlock(&capture->mutex);
+    }
+}
+
+/**
+ * Encoder thread: encode queued frames and write audio until told to quit
+ * with the queue empty
+ */
+static void* capture_thread(void* arg) {
+    libretro_capture_t* capture = (libretro_capture_t*)arg;
+    for (;;) {
+        pthread_mutex_lock(&capture->mutex);
+        while (capture_idle(capture) && !capture->quit) {
+            // Set before rechecking, so a frame or audio queued meanwhile sees it and signals
+            __atomic_store_n(&capture->waiting, true, __ATOMIC_SEQ_CST);
+            if (!capture_idle(capture)) break;
+            pthread_cond_wait(&capture->cond, &capture->mutex);
+        }
+        __atomic_store_n(&capture->waiting, false, __ATOMIC_SEQ_CST);
+        bool quit = capture->quit;
+        pthread_mutex_unlock(&capture->mutex);
+
+        uint64_t start = libretro_perf_now_ns();
+        uint64_t head = __atomic_load_n(&capture->head, __ATOMIC_ACQUIRE);
+        while (capture->tail != head) {
+            capture_encode(capture, &capture->frames[capture->tail % LIBRETRO_CAPTURE_QUEUE]);
+            __atomic_store_n(&capture->tail, capture->tail + 1, __ATOMIC_RELEASE);
+        }
+        capture_drain_audio(capture);
+        capture->encode_ns += libretro_perf_now_ns() - start;
+
+        if (quit && capture_queue_empty(capture)) break;
+    }
+    return NULL;
+}
+
+//=============================================================================
+// Public API
+//=============================================================================
+
+static void capture_release(libretro_capture_t* capture) {
+    for (unsigned i = 0; i < LIBRETRO_CAPTURE_QUEUE; i++) {
+        free(capture->frames[i].data);
+        capture->frames[i].data = NULL;
+    }
+    free(capture->rgba);
+    free(capture->scaled);
+    free(capture->yuv);
+    capture->rgba = NULL;
+    capture->scaled = NULL;
+    capture->yuv = NULL;
+    libretro_audio_ring_free(&capture->audio);
+}
+
+bool libretro_capture_start(libretro_capture_t* capture, libretro_frontend_t* frontend,
+                            const char* path, const char* codec) {
+    memset(capture, 0, sizeof(*capture));
+    if (!frontend || !path) return false;
+
+    capture->format = capture_has_extension(path, ".y4m") ? LIBRETRO_CAPTURE_Y4M : LIBRETRO_CAPTURE_FFMPEG;
+    snprintf(capture->codec, sizeof(capture->codec), "%s", codec ? codec : CAPTURE_DEFAULT_CODEC);
+    if (snprintf(capture->video_path, sizeof(capture->video_path), "%s", path) >= (int)sizeof(capture->video_path) ||
+        !capture_audio_path(path, capture->audio_path, sizeof(capture->audio_path))) {
+        fprintf(stderr, "Capture: path too long: %s\n", path);
+        return false;
+    }
+    capture->fps = (frontend->fps > 0.0) ? frontend->fps : 60.0;
+    capture->aspect_ratio = frontend->aspect_ratio;
+    capture->audio_rate = frontend->audio_output_rate;
+
+    // Everything is allocated here, sized for the largest frame the core
+    // may send, so capturing allocates nothing per frame
+    unsigned max_width = frontend->max_width ? frontend->max_width : frontend->width;
+    unsigned max_height = frontend->max_height ? frontend->max_height : frontend->height;
+    size_t max_pixels = (size_t)max_width * max_height;
+    capture->frame_capacity = max_pixels * 4;
+    bool allocated = max_pixels > 0;
+    for (unsigned i = 0; allocated && i < LIBRETRO_CAPTURE_QUEUE; i++) {
+        capture->frames[i].data = (uint8_t*)malloc(capture->frame_capacity);
+        allocated = capture->frames[i].data != NULL;
+    }
+    capture->rgba = allocated ? (uint32_t*)malloc(max_pixels * sizeof(uint32_t)) : NULL;
+    capture->scaled = allocated ? (uint32_t*)malloc(max_pixels * sizeof(uint32_t)) : NULL;
+    // Any frame of up to max_pixels has at most max_pixels + 1 chroma bytes
+    // ((w + 1) * (h + 1) / 2), whatever its shape
+    capture->yuv = allocated ? (uint8_t*)malloc(max_pixels * 2 + 1) : NULL;
+    if (!capture->rgba || !capture->scaled || !capture->yuv ||
+        !libretro_audio_ring_init(&capture->audio, (size_t)capture->audio_rate * LIBRETRO_CAPTURE_AUDIO_SECONDS)) {
+        fprintf(stderr, "Capture: failed to allocate buffers for %ux%u frames\n", max_width, max_height);
+        capture_release(capture);
+        return false;
+    }
+
+    // Y4M is opened now so a bad path fails before running; ffmpeg is started
+    // with the first frame, once the size is known
+    if (capture->format == LIBRETRO_CAPTURE_Y4M) {
+        capture->video = fopen(capture->video_path, "wb");
+        if (!capture->video) {
+            fprintf(stderr, "Capture: failed to create %s\n", capture->video_path);
+            capture_release(capture);
+            return false;
+        }
+    }
+    capture->wav = fopen(capture->audio_path, "wb");
+    if (!capture->wav || !capture_write_wav_header(capture->wav, capture->audio_rate, 0)) {
+        fprintf(stderr, "Capture: failed to create %s\n", capture->audio_path);
+        if (capture->wav) fclose(capture->wav);
+        if (capture->video) fclose(capture->video);
+        capture_release(capture);
+        return false;
+    }
+
+    pthread_mutex_init(&capture->mutex, NULL);
+    pthread_cond_init(&capture->cond, NULL);
+    if (pthread_create(&capture->thread, NULL, capture_thread, capture) != 0) {
+        fprintf(stderr, "Capture: failed to start encoder thread\n");
+        pthread_cond_destroy(&capture->cond);
+        pthread_mutex_destroy(&capture->mutex);
+        fclose(capture->wav);
+        if (capture->video) fclose(capture->video);
+        capture_release(capture);
+        return false;
+    }
+    capture->thread_started = true;
+    capture->frontend = frontend;
+    frontend->capture = capture;
+    fprintf(stderr, "Capturing to %s (%s) and %s\n", capture->video_path,
+            capture->format == LIBRETRO_CAPTURE_Y4M ? "y4m" : capture->codec, capture->audio_path);
+    return true;
+}
+
+void libretro_capture_video(libretro_capture_t* capture, const void* data, unsigned width, unsigned height,
+                            size_t pitch, unsigned format) {
+    // Duplicates, and frames that can't be queued, become repeats of the
+    // previous frame so the output keeps its frame rate
+    if (!data) {
+        capture->pending_repeats++;
+        return;
+    }
+    size_t row_bytes = (size_t)width * capture_bytes_per_pixel(format);
+    if ((size_t)width * height > capture->frame_capacity / 4) {
+        capture->frames_oversized++;
+        capture->pending_repeats++;
+        return;
+    }
+    uint64_t head = capture->head;
+    if (head - __atomic_load_n(&capture->tail, __ATOMIC_ACQUIRE) >= LIBRETRO_CAPTURE_QUEUE) {
+        capture->frames_dropped++;
+        capture->pending_repeats++;
+        return;
+    }
+
+    libretro_capture_frame_t* frame = &capture->frames[head % LIBRETRO_CAPTURE_QUEUE];
+    for (unsigned y = 0; y < height; y++) {
+        memcpy(frame->data + y * row_bytes, (const uint8_t*)data + y * pitch, row_bytes);
+    }
+    frame->width = width;
+    frame->height = height;
+    frame->format = format;
+    frame->repeats = capture->pending_repeats;
+    capture->pending_repeats = 0;
+    capture->frames_queued++;
+    __atomic_store_n(&capture->head, head + 1, __ATOMIC_SEQ_CST);
+    capture_wake(capture);
+}
+
+void libretro_capture_audio(libretro_capture_t* capture, const float* samples, size_t frames) {
+    size_t written = libretro_audio_ring_write(&capture->audio, samples, frames);
+    capture->audio_frames_dropped += frames - written;
+    if (capture_audio_due(capture)) capture_wake(capture);
+}
+
+bool libretro_capture_stop(libretro_capture_t* capture) {
+    if (!capture || !capture->frontend) return true;
+    if (capture->frontend->capture == capture) capture->frontend->capture = NULL;
+    capture->frontend = NULL;
+
+    pthread_mutex_lock(&capture->mutex);
+    capture->quit = true;
+    pthread_cond_signal(&capture->cond);
+    pthread_mutex_unlock(&capture->mutex);
+    pthread_join(capture->thread, NULL);
+    capture->thread_started = false;
+    pthread_cond_destroy(&capture->cond);
+    pthread_mutex_destroy(&capture->mutex);
+
+    // Duplicates after the last queued frame
+    for (; capture->pending_repeats > 0 && capture->out_width > 0; capture->pending_repeats--) {
+        capture_write_frame(capture, NULL);
+    }
+
+    bool ok = !capture->video_failed;
+    if (capture->video) {
+        if (capture->format == LIBRETRO_CAPTURE_FFMPEG) {
+            if (pclose(capture->video) != 0) {
+                fprintf(stderr, "Capture: ffmpeg failed encoding %s\n", capture->video_path);
+                ok = false;
+            }
+        } else if (fclose(capture->video) != 0) {
+            ok = false;
+        }
+        capture->video = NULL;
+    }
+    if (capture->wav) {
+        if (fseek(capture->wav, 0, SEEK_SET) != 0 ||
+            !capture_write_wav_header(capture->wav, capture->audio_rate, capture->audio_frames_written)) {
+            ok = false;
+        }
+        if (fclose(capture->wav) != 0) ok = false;
+        capture->wav = NULL;
+    } else {
+        ok = false;
+    }
+
+    fprintf(stderr, "Capture: %llu frames written (%llu repeated), %llu dropped by a busy encoder, "
+            "%llu oversized; %.1f s audio, %llu audio frames dropped; %.2f ms encode per frame\n",
+            (unsigned long long)capture->frames_written, (unsigned long long)capture->frames_repeated,
+            (unsigned long long)capture->frames_dropped, (unsigned long long)capture->frames_oversized,
+            capture->audio_rate ? (double)capture->audio_frames_written / capture->audio_rate : 0.0,
+            (unsigned long long)capture->audio_frames_dropped,
+            capture->frames_queued ? capture->encode_ns / 1e6 / capture->frames_queued : 0.0);
+
+    capture_release(capture);
+    return ok;
+}
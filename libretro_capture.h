@@ -0,0 +1,166 @@
+/*
+ * libretro_capture.h - Video and Audio Capture
+ *
+ * Copyright (c) 2024 mikedx
+ * GitHub: https://github.com/mikedx/libretro_raylib
+ *
+ * This file is part of libretro_raylib.
+ *
+ * libretro_raylib is free software: you can redistribute it and/or modify
+ * it under the terms of the MIT License.
+ *
+ * Records what the core shows and plays, without slowing it down:
+ *
+ * - The core's thread copies each shown frame, raw and repacked, into one
+ *   of a few buffers allocated up front from the core's max geometry, and
+ *   hands it over through a bounded queue; audio is teed as it goes into
+ *   the output ring, into a second ring of its own
+ * - An encoder thread converts, encodes and writes: Y4M (YUV 4:2:0) for
+ *   .y4m paths, otherwise the frames are piped to ffmpeg (hardware H.264 by
+ *   default on macOS); audio always goes to a 16-bit WAV alongside
+ * - When the encoder can't keep up, the frame is dropped instead of waiting
+ *   and counted; the previous frame is written again in its place, as for
+ *   duplicate frames, so the video keeps its constant frame rate and stays
+ *   in sync with the audio
+ *
+ * The output size and rate are fixed by the first frame; frames of another
+ * size are scaled to it. Hardware rendered frames are not captured.
+ */
+
+#ifndef LIBRETRO_CAPTURE_H
+#define LIBRETRO_CAPTURE_H
+
+#include "libretro_frontend.h"
+#include "libretro_audio_ring.h"
+#include <limits.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+//=============================================================================
+// Capture Structures
+//=============================================================================
+
+#define LIBRETRO_CAPTURE_QUEUE 8            // Frames in flight (power of two)
+#define LIBRETRO_CAPTURE_AUDIO_SECONDS 2    // Audio buffered for the encoder
+
+typedef enum {
+    LIBRETRO_CAPTURE_Y4M,
+    LIBRETRO_CAPTURE_FFMPEG
+} libretro_capture_format_t;
+
+/**
+ * One raw frame handed to the encoder (rows repacked to width * bpp)
+ */
+typedef struct {
+    uint8_t* data;
+    unsigned width;
+    unsigned height;
+    unsigned format;                // RETRO_PIXEL_FORMAT_*
+    unsigned repeats;               // Write the previous frame this many times first
+} libretro_capture_frame_t;
+
+/**
+ * Capture state
+ * The queue is single-producer (the core's thread) single-consumer (the
+ * encoder thread): head and tail are only advanced by their own side
+ */
+typedef struct libretro_capture {
+    libretro_frontend_t* frontend;
+    libretro_capture_format_t format;
+    char video_path[PATH_MAX];
+    char audio_path[PATH_MAX];
+    char codec[32];                 // ffmpeg video encoder
+    double fps;
+    float aspect_ratio;
+
+    // Frame pool and queue
+    libretro_capture_frame_t frames[LIBRETRO_CAPTURE_QUEUE];
+    size_t frame_capacity;          // Bytes per pooled frame
+    uint64_t head;                  // Frames queued (atomic)
+    uint64_t tail;                  // Frames taken by the encoder (atomic)
+    unsigned pending_repeats;       // Producer: repeats for the next queued frame
+
+    libretro_audio_ring_t audio;    // Teed output audio
+    unsigned audio_rate;
+
+    // Encoder thread
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    bool thread_started;
+    bool waiting;                   // Encoder is asleep on cond
+    bool quit;
+
+    // Encoder side
+    FILE* video;
+    FILE* wav;
+    bool video_failed;
+    unsigned out_width;             // Fixed by the first frame
+    unsigned out_height;
+    uint32_t* rgba;                 // Converted frame
+    uint32_t* scaled;               // At the output size
+    uint8_t* yuv;                   // Y4M planes of the last frame written
+    const uint32_t* last_frame;     // ffmpeg: RGBA of the last frame written
+    size_t yuv_size;
+    uint64_t audio_frames_written;
+
+    // Statistics
+    uint64_t frames_queued;
+    uint64_t frames_dropped;        // Queue full
+    uint64_t frames_oversized;      // Larger than the core's max geometry
+    uint64_t frames_repeated;       // Duplicates and drops written as the previous frame
+    uint64_t frames_written;
+    uint64_t audio_frames_dropped;  // Audio ring full
+    uint64_t encode_ns;             // Encoder thread busy time
+} libretro_capture_t;
+
+//=============================================================================
+// Public API Functions
+//=============================================================================
+
+/**
+ * Start capturing and attach to the frontend
+ * Call after content is loaded, before the core runs on another thread
+ * @param capture Capture state
+ * @param frontend Frontend with content loaded
+ * @param path Output video (.y4m, or anything ffmpeg can write); the audio
+ *             goes to the same path with a .wav extension
+ * @param codec ffmpeg video encoder (NULL = h264_videotoolbox on macOS, libx264 elsewhere)
+ * @return false if the buffers, files or encoder thread couldn't be set up
+ */
+bool libretro_capture_start(libretro_capture_t* capture, libretro_frontend_t* frontend,
+                            const char* path, const char* codec);
+
+/**
+ * Queue a shown frame (retro_video_refresh calls this; never blocks)
+ * @param capture Capture state
+ * @param data Raw pixels, or NULL for a duplicate of the previous frame
+ * @param width Frame width
+ * @param height Frame height
+ * @param pitch Bytes per row in data
+ * @param format RETRO_PIXEL_FORMAT_*
+ */
+void libretro_capture_video(libretro_capture_t* capture, const void* data, unsigned width, unsigned height,
+                            size_t pitch, unsigned format);
+
+/**
+ * Tee output audio (the audio path calls this; never blocks)
+ * @param capture Capture state
+ * @param samples Interleaved stereo float frames at the output rate
+ * @param frames Frame count
+ */
+void libretro_capture_audio(libretro_capture_t* capture, const float* samples, size_t frames);
+
+/**
+ * Detach, let the encoder finish the queue, close the files and free
+ * buffers; prints what was captured and dropped. Safe on a zeroed state.
+ * Call once the core no longer runs on another thread.
+ * @param capture Capture state
+ * @return false if writing failed
+ */
+bool libretro_capture_stop(libretro_capture_t* capture);
+
+#endif // LIBRETRO_CAPTURE_H
@@ -0,0 +1,724 @@
+/*
+ * libretro_content.c - Content Loading Implementation
+ *
+ * Copyright (c) 2024 mikedx
+ * GitHub: https://github.com/mikedx/libretro_raylib
+ *
+ * This file is part of libretro_raylib.
+ *
+ * libretro_raylib is free software: you can redistribute it and/or modify
+ * it under the terms of the MIT License.
+ */
+
+#include "libretro_content.h"
+#include "libretro_file.h"
+#include "libretro_perf.h"
+#include "libretro_vfs.h"
+#include <dirent.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <utime.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <zlib.h>
+
+// Mapped files up to this size are prefetched in the background; bigger ones
+// (disc images) are paged in as the core touches them
+#define CONTENT_PREFETCH_MAX_BYTES ((size_t)64 << 20)
+
+// Zip record signatures and fixed sizes
+#define ZIP_LOCAL_SIG 0x04034b50u
+#define ZIP_CENTRAL_SIG 0x02014b50u
+#define ZIP_END_SIG 0x06054b50u
+#define ZIP_LOCAL_SIZE 30
+#define ZIP_CENTRAL_SIZE 46
+#define ZIP_END_SIZE 22
+#define ZIP_METHOD_STORED 0
+#define ZIP_METHOD_DEFLATE 8
+
+typedef enum {
+    CONTENT_NONE,
+    CONTENT_ZIP,
+    CONTENT_GZIP
+} content_kind_t;
+
+/**
+ * Member picked out of an archive
+ */
+typedef struct {
+    char name[PATH_MAX];
+    uint16_t method;
+    uint32_t crc;                   // zip only
+    const uint8_t* data;            // Compressed bytes inside the archive mapping
+    size_t compressed_size;
+    size_t size;                    // Uncompressed size (gzip: modulo 2^32)
+} content_member_t;
+
+/**
+ * Cache configuration
+ */
+typedef struct {
+    char dir[PATH_MAX];             // Empty until resolved
+    size_t max_bytes;
+} content_cache_t;
+
+static content_cache_t g_cache = { "", (size_t)LIBRETRO_CONTENT_CACHE_DEFAULT_MB << 20 };
+
+//=============================================================================
+// Helpers
+//=============================================================================
+
+static uint16_t read_le16(const uint8_t* p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t read_le32(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static int lower_ascii(int c) {
+    return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+}
+
+/**
+ * Check whether a file name's extension is in a "ext1|ext2" list
+ */
+static bool extension_listed(const char* name, const char* extensions) {
+    if (!name || !extensions) return false;
+    const char* dot = strrchr(name, '.');
+    if (!dot || strchr(dot, '/')) return false;
+    const char* ext = dot + 1;
+    size_t ext_len = strlen(ext);
+    if (ext_len == 0) return false;
+
+    const char* p = extensions;
+    while (*p) {
+        const char* end = strchr(p, '|');
+        size_t len = end ? (size_t)(end - p) : strlen(p);
+        if (len == ext_len) {
+            size_t i = 0;
+            while (i < len && lower_ascii((unsigned char)p[i]) == lower_ascii((unsigned char)ext[i])) i++;
+            if (i == len) return true;
+        }
+        if (!end) break;
+        p = end + 1;
+    }
+    return false;
+}
+
+static const char* path_basename(const char* path) {
+    const char* slash = strrchr(path, '/');
+    return slash ? slash + 1 : path;
+}
+
+/**
+ * Split "archive.zip#member" into its parts
+ * A '#' that is part of an existing file's name is left alone
+ * @param path Content path
+ * @param archive Output archive path (PATH_MAX bytes)
+ * @return Member name inside path, or NULL if none was given
+ */
+static const char* split_member(const char* path, char* archive) {
+    snprintf(archive, PATH_MAX, "%s", path);
+    struct stat st;
+    if (stat(path, &st) == 0) return NULL;
+
+    char* hash = strrchr(archive, '#');
+    if (!hash) return NULL;
+    *hash = '\0';
+    if (stat(archive, &st) != 0 || !S_ISREG(st.st_mode)) {
+        *hash = '#';
+        return NULL;
+    }
+    return path + (hash - archive) + 1;
+}
+
+/**
+ * Identify an archive by magic, falling back to its extension
+ */
+static content_kind_t content_kind(const char* archive) {
+    uint8_t magic[4] = {0};
+    FILE* file = fopen(archive, "rb");
+    if (file) {
+        size_t got = fread(magic, 1, sizeof(magic), file);
+        fclose(file);
+        if (got == 4 && read_le32(magic) == ZIP_LOCAL_SIG) return CONTENT_ZIP;
+        if (got >= 2 && magic[0] == 0x1f && magic[1] == 0x8b) return CONTENT_GZIP;
+        if (got == 4) return CONTENT_NONE;
+    }
+    if (extension_listed(archive, "zip")) return CONTENT_ZIP;
+    if (extension_listed(archive, "gz")) return CONTENT_GZIP;
+    return CONTENT_NONE;
+}
+
+/**
+ * Compute a CRC-32 over a buffer of any size (zlib takes 32-bit lengths)
+ */
+static uint32_t crc32_buffer(const uint8_t* data, size_t size) {
+    uLong crc = crc32(0L, Z_NULL, 0);
+    while (size > 0) {
+        uInt chunk = size > UINT_MAX ? UINT_MAX : (uInt)size;
+        crc = crc32(crc, data, chunk);
+        data += chunk;
+        size -= chunk;
+    }
+    return (uint32_t)crc;
+}
+
+//=============================================================================
+// Archive Parsing
+//=============================================================================
+
+/**
+ * Pick a zip member: the named one, else the first with a core extension,
+ * else the largest
+ */
+static bool zip_find_member(const uint8_t* zip, size_t zip_size, const char* wanted,
+                            const char* extensions, content_member_t* member) {
+    if (zip_size < ZIP_END_SIZE) return false;
+
+    // The end record sits before a comment of up to 64 KB
+    size_t end = 0;
+    bool found_end = false;
+    size_t lowest = zip_size > ZIP_END_SIZE + 0xFFFF ? zip_size - ZIP_END_SIZE - 0xFFFF : 0;
+    for (size_t pos = zip_size - ZIP_END_SIZE + 1; pos-- > lowest; ) {
+        if (read_le32(zip + pos) == ZIP_END_SIG) {
+            end = pos;
+            found_end = true;
+            break;
+        }
+    }
+    if (!found_end) {
+        fprintf(stderr, "Zip: no central directory (not a zip, or zip64)\n");
+        return false;
+    }
+
+    unsigned count = read_le16(zip + end + 10);
+    size_t pos = read_le32(zip + end + 16);
+    const uint8_t* best = NULL;
+    bool best_listed = false;
+
+    for (unsigned i = 0; i < count; i++) {
+        if (pos + ZIP_CENTRAL_SIZE > zip_size || read_le32(zip + pos) != ZIP_CENTRAL_SIG) {
+            fprintf(stderr, "Zip: corrupt central directory\n");
+            return false;
+        }
+        const uint8_t* entry = zip + pos;
+        size_t name_len = read_le16(entry + 28);
+        size_t next = pos + ZIP_CENTRAL_SIZE + name_len + read_le16(entry + 30) + read_le16(entry + 32);
+        if (next > zip_size) {
+            fprintf(stderr, "Zip: corrupt central directory\n");
+            return false;
+        }
+        pos = next;
+
+        char name[PATH_MAX];
+        if (name_len == 0 || name_len >= sizeof(name)) continue;
+        memcpy(name, entry + ZIP_CENTRAL_SIZE, name_len);
+        name[name_len] = '\0';
+        if (name[name_len - 1] == '/') continue; // Directory
+
+        if (wanted) {
+            if (strcmp(name, wanted) == 0) {
+                best = entry;
+                break;
+            }
+            continue;
+        }
+        bool listed = extension_listed(name, extensions);
+        if (listed && !best_listed) {
+            best = entry;
+            best_listed = true;
+        } else if (!best_listed && (!best || read_le32(entry + 24) > read_le32(best + 24))) {
+            best = entry;
+        }
+    }
+
+    if (!best) {
+        if (wanted) fprintf(stderr, "Zip: no member named %s\n", wanted);
+        else fprintf(stderr, "Zip: archive has no files\n");
+        return false;
+    }
+
+    size_t name_len = read_le16(best + 28);
+    memcpy(member->name, best + ZIP_CENTRAL_SIZE, name_len);
+    member->name[name_len] = '\0';
+    member->method = read_le16(best + 10);
+    member->crc = read_le32(best + 16);
+    member->compressed_size = read_le32(best + 20);
+    member->size = read_le32(best + 24);
+
+    if (read_le16(best + 8) & 0x1) {
+        fprintf(stderr, "Zip: %s is encrypted\n", member->name);
+        return false;
+    }
+    if (member->method != ZIP_METHOD_STORED && member->method != ZIP_METHOD_DEFLATE) {
+        fprintf(stderr, "Zip: %s uses unsupported compression method %u\n", member->name, member->method);
+        return false;
+    }
+    // Stored data is used as is, so its size must be the one bounds-checked below
+    if (member->method == ZIP_METHOD_STORED && member->size != member->compressed_size) {
+        fprintf(stderr, "Zip: corrupt sizes for stored %s\n", member->name);
+        return false;
+    }
+
+    // Data follows the local header, whose extra field can differ from the
+    // central directory's
+    size_t local = read_le32(best + 42);
+    if (local + ZIP_LOCAL_SIZE > zip_size || read_le32(zip + local) != ZIP_LOCAL_SIG) {
+        fprintf(stderr, "Zip: corrupt local header for %s\n", member->name);
+        return false;
+    }
+    size_t data = local + ZIP_LOCAL_SIZE + read_le16(zip + local + 26) + read_le16(zip + local + 28);
+    if (data > zip_size || member->compressed_size > zip_size - data) {
+        fprintf(stderr, "Zip: %s is truncated\n", member->name);
+        return false;
+    }
+    member->data = zip + data;
+    return true;
+}
+
+/**
+ * Describe the single member of a gzip file
+ */
+static bool gzip_find_member(const uint8_t* gz, size_t gz_size, const char* archive,
+                             content_member_t* member) {
+    if (gz_size < 18) {
+        fprintf(stderr, "Gzip: file is truncated\n");
+        return false;
+    }
+
+    // Named after the archive minus ".gz"
+    snprintf(member->name, sizeof(member->name), "%s", path_basename(archive));
+    size_t len = strlen(member->name);
+    if (len > 3 && extension_listed(member->name, "gz")) member->name[len - 3] = '\0';
+
+    member->method = ZIP_METHOD_DEFLATE;
+    member->crc = 0;
+    member->data = gz;
+    member->compressed_size = gz_size;
+    member->size = read_le32(gz + gz_size - 4); // ISIZE: length modulo 2^32
+    return true;
+}
+
+/**
+ * Inflate into a buffer sized for the whole output
+ * @param window_bits -MAX_WBITS for raw deflate (zip), 16 + MAX_WBITS for gzip
+ * @param size_hint Expected output size (grown if the data turns out larger)
+ * @return Buffer to free(), or NULL on error (already reported)
+ */
+static void* inflate_content(const uint8_t* src, size_t src_size, size_t size_hint,
+                             int window_bits, size_t* out_size) {
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    if (inflateInit2(&stream, window_bits) != Z_OK) {
+        fprintf(stderr, "Failed to initialize inflate\n");
+        return NULL;
+    }
+
+    size_t capacity = size_hint ? size_hint : src_size * 2 + 1;
+    uint8_t* out = (uint8_t*)malloc(capacity);
+    if (!out) fprintf(stderr, "Failed to allocate %zu bytes for content\n", capacity);
+    size_t in_pos = 0;
+    size_t out_pos = 0;
+
+    while (out) {
+        if (out_pos == capacity) {
+            uint8_t* grown = (uint8_t*)realloc(out, capacity * 2);
+            if (!grown) {
+                fprintf(stderr, "Failed to allocate %zu bytes for content\n", capacity * 2);
+                free(out);
+                out = NULL;
+                break;
+            }
+            out = grown;
+            capacity *= 2;
+        }
+
+        size_t in_left = src_size - in_pos;
+        size_t out_left = capacity - out_pos;
+        stream.next_in = (Bytef*)(src + in_pos);
+        stream.avail_in = in_left > UINT_MAX ? UINT_MAX : (uInt)in_left;
+        stream.next_out = out + out_pos;
+        stream.avail_out = out_left > UINT_MAX ? UINT_MAX : (uInt)out_left;
+        uInt in_avail = stream.avail_in;
+        uInt out_avail = stream.avail_out;
+
+        int ret = inflate(&stream, Z_NO_FLUSH);
+        in_pos += in_avail - stream.avail_in;
+        out_pos += out_avail - stream.avail_out;
+
+        if (ret == Z_STREAM_END) {
+            inflateEnd(&stream);
+            *out_size = out_pos;
+            return out;
+        }
+        if (ret == Z_OK || (ret == Z_BUF_ERROR && out_pos == capacity)) continue;
+
+        fprintf(stderr, "Inflate failed: %s\n", ret == Z_BUF_ERROR ? "data is truncated" :
+                (stream.msg ? stream.msg : "corrupt data"));
+        free(out);
+        out = NULL;
+    }
+
+    inflateEnd(&stream);
+    return NULL;
+}
+
+//=============================================================================
+// Cache
+//=============================================================================
+
+/**
+ * Resolve the cache directory, creating it
+ * @return Directory, or NULL if there is nowhere to put it
+ */
+static const char* cache_dir(void) {
+    if (!g_cache.dir[0] && !libretro_file_cache_dir("content", g_cache.dir, sizeof(g_cache.dir))) {
+        return NULL;
+    }
+    if (!libretro_file_make_dirs(g_cache.dir)) {
+        fprintf(stderr, "Content cache: can't create %s\n", g_cache.dir);
+        return NULL;
+    }
+    return g_cache.dir;
+}
+
+/**
+ * Build the cache path for an archive member
+ * Content is cached as <dir>/<key>/<member name>, so cores that name saves
+ * after the content path still see the original file name
+ * @return false if there is no cache directory
+ */
+static bool cache_path(char* path, const char* archive, const struct stat* st, const char* member) {
+    const char* dir = cache_dir();
+    if (!dir) return false;
+
+    // FNV-1a over everything that identifies this version of the member
+    // (names with their terminators, so "ab"+"c" and "a"+"bc" differ)
+    uint64_t key = libretro_file_hash(LIBRETRO_FILE_HASH_INIT, archive, strlen(archive) + 1);
+    key = libretro_file_hash(key, member, strlen(member) + 1);
+    uint64_t stamp[2] = { (uint64_t)st->st_size, (uint64_t)st->st_mtime };
+    key = libretro_file_hash(key, stamp, sizeof(stamp));
+
+    int len = snprintf(path, PATH_MAX, "%s/%016llx/%s", dir, (unsigned long long)key, path_basename(member));
+    return len > 0 && len < PATH_MAX;
+}
+
+/**
+ * Check for a cached copy and mark it recently used
+ * @param expected_size Uncompressed size (compared modulo 2^32, as gzip stores it)
+ */
+static bool cache_lookup(const char* path, size_t expected_size) {
+    struct stat st;
+    if (stat(path, &st) != 0 || !S_ISREG(st.st_mode)) return false;
+    if ((uint32_t)st.st_size != (uint32_t)expected_size) return false;
+    utime(path, NULL);
+    return true;
+}
+
+/**
+ * Write decompressed content to the cache (atomically: temp file + rename)
+ */
+static bool cache_store(const char* path, const void* data, size_t size) {
+    return libretro_file_make_parent_dirs(path) && libretro_file_write(path, data, size);
+}
+
+/**
+ * One cached file considered for eviction
+ */
+typedef struct {
+    char path[PATH_MAX];
+    size_t size;
+    time_t used;
+} cache_file_t;
+
+static int cache_file_compare(const void* a, const void* b) {
+    time_t ta = ((const cache_file_t*)a)->used;
+    time_t tb = ((const cache_file_t*)b)->used;
+    return (ta > tb) - (ta < tb);
+}
+
+/**
+ * Delete least recently used files until the cache fits its cap
+ * @param keep File just stored or opened (never evicted)
+ */
+static void cache_evict(const char* keep) {
+    const char* dir = cache_dir();
+    if (!dir) return;
+    DIR* root = opendir(dir);
+    if (!root) return;
+
+    cache_file_t* files = NULL;
+    size_t count = 0;
+    size_t capacity = 0;
+    size_t total = 0;
+
+    struct dirent* key_entry;
+    while ((key_entry = readdir(root)) != NULL) {
+        if (key_entry->d_name[0] == '.') continue;
+        char key_dir[PATH_MAX];
+        snprintf(key_dir, sizeof(key_dir), "%s/%s", dir, key_entry->d_name);
+        DIR* sub = opendir(key_dir);
+        if (!sub) continue;
+
+        struct dirent* file_entry;
+        while ((file_entry = readdir(sub)) != NULL) {
+            if (file_entry->d_name[0] == '.' && (file_entry->d_name[1] == '\0' ||
+                (file_entry->d_name[1] == '.' && file_entry->d_name[2] == '\0'))) continue;
+            if (count == capacity) {
+                size_t new_capacity = capacity ? capacity * 2 : 64;
+                cache_file_t* grown = (cache_file_t*)realloc(files, new_capacity * sizeof(*files));
+                if (!grown) break;
+                files = grown;
+                capacity = new_capacity;
+            }
+            cache_file_t* file = &files[count];
+            int len = snprintf(file->path, sizeof(file->path), "%s/%s", key_dir, file_entry->d_name);
+            if (len < 0 || (size_t)len >= sizeof(file->path)) continue;
+            struct stat st;
+            if (stat(file->path, &st) != 0 || !S_ISREG(st.st_mode)) continue;
+            file->size = (size_t)st.st_size;
+            file->used = st.st_mtime;
+            total += file->size;
+            count++;
+        }
+        closedir(sub);
+    }
+    closedir(root);
+
+    if (total > g_cache.max_bytes) {
+        qsort(files, count, sizeof(*files), cache_file_compare);
+        unsigned evicted = 0;
+        size_t evicted_bytes = 0;
+        for (size_t i = 0; i < count && total > g_cache.max_bytes; i++) {
+            if (keep && strcmp(files[i].path, keep) == 0) continue;
+            if (unlink(files[i].path) != 0) continue;
+            char* slash = strrchr(files[i].path, '/');
+            if (slash) {
+                *slash = '\0';
+                rmdir(files[i].path); // Only succeeds once the key directory is empty
+            }
+            total -= files[i].size;
+            evicted_bytes += files[i].size;
+            evicted++;
+        }
+        if (evicted) {
+            fprintf(stderr, "Content cache: evicted %u files (%.2f MB)\n", evicted, evicted_bytes / (1024.0 * 1024.0));
+        }
+    }
+    free(files);
+}
+
+//=============================================================================
+// Public API
+//=============================================================================
+
+void libretro_content_set_cache(const char* dir, unsigned max_mb) {
+    g_cache.dir[0] = '\0';
+    if (dir) snprintf(g_cache.dir, sizeof(g_cache.dir), "%s", dir);
+    g_cache.max_bytes = (size_t)max_mb << 20;
+}
+
+bool libretro_content_is_archive(const char* path, const char* extensions) {
+    if (!path) return false;
+    char archive[PATH_MAX];
+    split_member(path, archive);
+
+    content_kind_t kind = content_kind(archive);
+    if (kind == CONTENT_NONE) return false;
+    // Cores listing the archive type (arcade romsets, DOS) open it themselves
+    if (kind == CONTENT_ZIP && extension_listed("x.zip", extensions)) return false;
+    if (kind == CONTENT_GZIP && extension_listed("x.gz", extensions)) return false;
+    return true;
+}
+
+void* libretro_content_map_file(const char* path, size_t* size) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return NULL;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size <= 0) {
+        close(fd);
+        return NULL;
+    }
+
+    // Pages are shared with the page cache, so nothing is read up front and
+    // the data isn't duplicated; the mapping is private, so a core that
+    // writes to its (const) game data only copies the pages it touches
+    void* data = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd); // The mapping keeps the file open
+    if (data == MAP_FAILED) return NULL;
+
+    if ((size_t)st.st_size <= CONTENT_PREFETCH_MAX_BYTES) {
+        madvise(data, (size_t)st.st_size, MADV_WILLNEED);
+    }
+    *size = (size_t)st.st_size;
+    return data;
+}
+
+bool libretro_content_open(libretro_content_t* content, const char* path,
+                           const char* extensions, bool need_fullpath, bool vfs) {
+    if (!content || !path) return false;
+    memset(content, 0, sizeof(*content));
+    uint64_t start = libretro_perf_now_ns();
+
+    char archive_arg[PATH_MAX];
+    const char* wanted = split_member(path, archive_arg);
+    char archive[PATH_MAX];
+    struct stat st;
+    if (!realpath(archive_arg, archive) || stat(archive, &st) != 0) {
+        fprintf(stderr, "Failed to open archive: %s\n", archive_arg);
+        return false;
+    }
+    content_kind_t kind = content_kind(archive);
+
+    size_t map_size = 0;
+    uint8_t* map = (uint8_t*)libretro_content_map_file(archive, &map_size);
+    if (!map) {
+        fprintf(stderr, "Failed to map archive: %s\n", archive);
+        return false;
+    }
+
+    content_member_t member;
+    bool found = (kind == CONTENT_ZIP) ? zip_find_member(map, map_size, wanted, extensions, &member)
+                                       : gzip_find_member(map, map_size, archive, &member);
+    if (!found) {
+        munmap(map, map_size);
+        return false;
+    }
+
+    bool caching = g_cache.max_bytes > 0;
+    // need_fullpath cores that can't be served from memory get a real file
+    bool extract = need_fullpath && !vfs;
+    char cached[PATH_MAX];
+    bool have_cache_path = cache_path(cached, archive, &st, member.name);
+    const char* how = NULL;
+    bool by_name = extract;         // The core gets the cached file's path
+
+    // 1. Cached from an earlier launch: map it (or just name it)
+    if (have_cache_path && cache_lookup(cached, member.size)) {
+        if (need_fullpath) {
+            by_name = true;
+            how = "cached";
+        } else if ((content->map = libretro_content_map_file(cached, &content->map_size)) != NULL) {
+            content->data = content->map;
+            content->size = content->map_size;
+            how = "cached";
+        }
+    }
+
+    // Stored data gets the CRC check inflated data does
+    if (!how && member.method == ZIP_METHOD_STORED && crc32_buffer(member.data, member.size) != member.crc) {
+        fprintf(stderr, "Zip: %s failed its CRC check\n", member.name);
+        munmap(map, map_size);
+        return false;
+    }
+
+    // 2. Stored member: use it in place from the archive mapping
+    if (!how && member.method == ZIP_METHOD_STORED && !extract) {
+        content->map = map;
+        content->map_size = map_size;
+        content->data = (void*)member.data;
+        content->size = member.size;
+        map = NULL;
+        how = "stored";
+    }
+
+    // 3. Decompress straight into the buffer retro_load_game will get
+    if (!how) {
+        void* data = NULL;
+        size_t size = 0;
+        if (member.method == ZIP_METHOD_STORED) {
+            data = (void*)member.data;
+            size = member.size;
+        } else {
+            data = inflate_content(member.data, member.compressed_size, member.size,
+                                   kind == CONTENT_ZIP ? -MAX_WBITS : 16 + MAX_WBITS, &size);
+            if (!data) {
+                munmap(map, map_size);
+                return false;
+            }
+            if (kind == CONTENT_ZIP && (size != member.size || crc32_buffer((const uint8_t*)data, size) != member.crc)) {
+                fprintf(stderr, "Zip: %s failed its CRC check\n", member.name);
+                free(data);
+                munmap(map, map_size);
+                return false;
+            }
+            content->heap = data;
+        }
+
+        // need_fullpath cores outside the VFS must have a file; without a
+        // cache it is removed again when the content is closed
+        bool stored = have_cache_path && (caching || extract) && cache_store(cached, data, size);
+        if (extract && !stored) {
+            fprintf(stderr, "Failed to extract %s for a core that loads by path\n", member.name);
+            free(content->heap);
+            content->heap = NULL;
+            munmap(map, map_size);
+            return false;
+        }
+        content->remove_on_close = extract && !caching;
+
+        if (extract) {
+            free(content->heap);
+            content->heap = NULL;
+        } else {
+            content->data = content->heap;
+            content->size = size;
+        }
+        how = member.method == ZIP_METHOD_STORED ? "extracted" : "inflated";
+    }
+
+    if (map) munmap(map, map_size);
+    if (caching && have_cache_path) cache_evict(cached);
+
+    // RetroArch's convention: "archive#member" for content held in memory
+    if (by_name) {
+        content->path = strdup(cached);
+    } else {
+        size_t len = strlen(archive) + 1 + strlen(member.name) + 1;
+        content->path = (char*)malloc(len);
+        if (content->path) snprintf(content->path, len, "%s#%s", archive, member.name);
+    }
+    if (!content->path) {
+        fprintf(stderr, "Failed to allocate content path\n");
+        libretro_content_close(content);
+        return false;
+    }
+    if (need_fullpath && !by_name) {
+        content->vfs_file = libretro_vfs_add_memory_file(content->path, content->data, content->size);
+        if (!content->vfs_file) {
+            fprintf(stderr, "Failed to serve %s through the VFS\n", member.name);
+            libretro_content_close(content);
+            return false;
+        }
+    }
+
+    double mb = (need_fullpath ? member.size : content->size) / (1024.0 * 1024.0);
+    fprintf(stderr, "Content: %s from %s (%.2f MB) %s%s in %.2f ms\n", member.name, path_basename(archive),
+            mb, how, content->vfs_file ? ", served through the VFS" : "", (libretro_perf_now_ns() - start) / 1e6);
+    return true;
+}
+
+void libretro_content_close(libretro_content_t* content) {
+    if (!content) return;
+    if (content->remove_on_close && content->path) {
+        unlink(content->path);
+        char* slash = strrchr(content->path, '/');
+        if (slash) {
+            *slash = '\0';
+            rmdir(content->path);
+        }
+    }
+    if (content->vfs_file) libretro_vfs_remove_memory_file(content->path);
+    if (content->map) munmap(content->map, content->map_size);
+    free(content->heap);
+    free(content->path);
+    memset(content, 0, sizeof(*content));
+}
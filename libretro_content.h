@@ -0,0 +1,97 @@
+/*
+ * libretro_content.h - Content Loading (plain and compressed)
+ *
+ * Copyright (c) 2024 mikedx
+ * GitHub: https://github.com/mikedx/libretro_raylib
+ *
+ * This file is part of libretro_raylib.
+ *
+ * libretro_raylib is free software: you can redistribute it and/or modify
+ * it under the terms of the MIT License.
+ *
+ * Opens zip and gzip content without extracting it first:
+ *
+ * - A zip member is picked by "archive.zip#member", else the first member
+ *   with one of the core's extensions, else the largest member
+ * - Deflated data is inflated straight into the buffer handed to
+ *   retro_load_game; stored members are used in place from the mapping
+ * - Decompressed content is kept in a size-capped cache directory, keyed by
+ *   archive path, size, mtime and member, so the next launch maps the cached
+ *   file instead of inflating again (least recently used files are evicted)
+ * - need_fullpath cores that read files through the VFS get the member
+ *   served from memory under its "archive#member" path
+ *   (libretro_vfs_add_memory_file), so nothing is written to disk
+ * - Other need_fullpath cores open the path with their own stdio, which can
+ *   only reach a real file: they get the cached file, or, with the cache
+ *   disabled, a temporary extraction removed again on close
+ */
+
+#ifndef LIBRETRO_CONTENT_H
+#define LIBRETRO_CONTENT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Default size cap for the decompressed content cache
+#define LIBRETRO_CONTENT_CACHE_DEFAULT_MB 1024
+
+/**
+ * Content opened from an archive
+ */
+typedef struct libretro_content {
+    void* data;                     // Decompressed content (NULL when need_fullpath gets a file)
+    size_t size;
+    char* path;                     // Path for retro_game_info (cached file or archive#member)
+    bool vfs_file;                  // path is served from data by the VFS
+
+    // Backing storage, released by libretro_content_close
+    void* map;                      // Mapping of the archive or cached file
+    size_t map_size;
+    void* heap;                     // Inflated buffer when there is no mapping
+    bool remove_on_close;           // path is a temporary extraction (cache disabled)
+} libretro_content_t;
+
+/**
+ * Set the decompressed content cache location and size cap
+ * @param dir Cache directory (NULL = $XDG_CACHE_HOME or ~/.cache, under libretro_raylib/content)
+ * @param max_mb Size cap in megabytes (0 = don't cache)
+ */
+void libretro_content_set_cache(const char* dir, unsigned max_mb);
+
+/**
+ * Check whether a path names compressed content this module should open
+ * (by extension or magic); accepts the "archive.zip#member" form
+ * @param path Content path
+ * @param extensions Core's valid extensions; if the archive's own extension
+ *                   is listed, the core loads archives itself (arcade romsets)
+ */
+bool libretro_content_is_archive(const char* path, const char* extensions);
+
+/**
+ * Open compressed content
+ * @param content Output content
+ * @param path Archive path, optionally with "#member"
+ * @param extensions Core's valid extensions ("sfc|smc"), may be NULL
+ * @param need_fullpath Core loads by path: produce a path instead of a buffer
+ * @param vfs The core opens files through the VFS, so the path can be virtual
+ * @return false on error (already reported)
+ */
+bool libretro_content_open(libretro_content_t* content, const char* path,
+                           const char* extensions, bool need_fullpath, bool vfs);
+
+/**
+ * Release content opened by libretro_content_open
+ * @param content Content
+ */
+void libretro_content_close(libretro_content_t* content);
+
+/**
+ * Map a whole file privately (writes stay in memory)
+ * Small files are prefetched in the background; big ones page in on demand
+ * @param path File path
+ * @param size Output file size
+ * @return Mapping to munmap(), or NULL if the file can't be mapped
+ */
+void* libretro_content_map_file(const char* path, size_t* size);
+
+#endif // LIBRETRO_CONTENT_H
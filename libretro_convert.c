@@ -0,0 +1,380 @@
+/*
+ * libretro_convert.c - Pixel Format Row Converters Implementation
+ *
+ * Copyright (c) 2024 mikedx
+ * GitHub: https://github.com/mikedx/libretro_raylib
+ *
+ * This file is part of libretro_raylib.
+ *
+ * libretro_raylib is free software: you can redistribute it and/or modify
+ * it under the terms of the MIT License.
+ *
+ * All converters write RGBA8888 in memory order (R, G, B, A), i.e. the
+ * little-endian uint32_t 0xAABBGGRR, which is what raylib's
+ * PIXELFORMAT_UNCOMPRESSED_R8G8B8A8 expects. Low bits of 5/6-bit channels
+ * are zero-filled (plain shift), matching the original per-pixel loops.
+ */
+
+#include "libretro_convert.h"
+#include <stdio.h>
+#include <stddef.h>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__)
+#define LIBRETRO_CONVERT_HAVE_X86 1
+#include <emmintrin.h>
+#include <immintrin.h>
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define LIBRETRO_CONVERT_HAVE_NEON 1
+#include <arm_neon.h>
+#endif
+
+//=============================================================================
+// Scalar Reference Converters
+//=============================================================================
+
+static void convert_xrgb8888_scalar(uint32_t* dst, const void* src, unsigned width) {
+    const uint32_t* src_pixels = (const uint32_t*)src;
+    for (unsigned x = 0; x < width; x++) {
+        uint32_t pixel = src_pixels[x];
+        uint8_t r = (pixel >> 16) & 0xFF;
+        uint8_t g = (pixel >> 8) & 0xFF;
+        uint8_t b = pixel & 0xFF;
+        dst[x] = (0xFFu << 24) | ((uint32_t)b << 16) | ((uint32_t)g << 8) | r;
+    }
+}
+
+static void convert_rgb565_scalar(uint32_t* dst, const void* src, unsigned width) {
+    const uint16_t* src_pixels = (const uint16_t*)src;
+    for (unsigned x = 0; x < width; x++) {
+        uint16_t pixel = src_pixels[x];
+        uint8_t r = ((pixel >> 11) & 0x1F) << 3;
+        uint8_t g = ((pixel >> 5) & 0x3F) << 2;
+        uint8_t b = (pixel & 0x1F) << 3;
+        dst[x] = (0xFFu << 24) | ((uint32_t)b << 16) | ((uint32_t)g << 8) | r;
+    }
+}
+
+static void convert_0rgb1555_scalar(uint32_t* dst, const void* src, unsigned width) {
+    const uint16_t* src_pixels = (const uint16_t*)src;
+    for (unsigned x = 0; x < width; x++) {
+        uint16_t pixel = src_pixels[x];
+        uint8_t r = ((pixel >> 10) & 0x1F) << 3;
+        uint8_t g = ((pixel >> 5) & 0x1F) << 3;
+        uint8_t b = (pixel & 0x1F) << 3;
+        dst[x] = (0xFFu << 24) | ((uint32_t)b << 16) | ((uint32_t)g << 8) | r;
+    }
+}
+
+//=============================================================================
+// SSE2 Converters (x86 baseline)
+//=============================================================================
+
+#ifdef LIBRETRO_CONVERT_HAVE_X86
+
+static void convert_xrgb8888_sse2(uint32_t* dst, const void* src, unsigned width) {
+    const uint32_t* src_pixels = (const uint32_t*)src;
+    const __m128i mask_lo = _mm_set1_epi32(0x000000FF);
+    const __m128i mask_g = _mm_set1_epi32(0x0000FF00);
+    const __m128i mask_b = _mm_set1_epi32(0x00FF0000);
+    const __m128i alpha = _mm_set1_epi32((int)0xFF000000);
+    unsigned x = 0;
+
+    for (; x + 4 <= width; x += 4) {
+        __m128i p = _mm_loadu_si128((const __m128i*)(src_pixels + x));
+        __m128i r = _mm_and_si128(_mm_srli_epi32(p, 16), mask_lo);
+        __m128i g = _mm_and_si128(p, mask_g);
+        __m128i b = _mm_and_si128(_mm_slli_epi32(p, 16), mask_b);
+        __m128i out = _mm_or_si128(_mm_or_si128(r, g), _mm_or_si128(b, alpha));
+        _mm_storeu_si128((__m128i*)(dst + x), out);
+    }
+
+    convert_xrgb8888_scalar(dst + x, src_pixels + x, width - x);
+}
+
+/**
+ * Expand four zero-extended RGB565 pixels (one per 32-bit lane) to RGBA8888
+ */
+static inline __m128i expand_rgb565_sse2(__m128i p) {
+    __m128i r = _mm_and_si128(_mm_srli_epi32(p, 8), _mm_set1_epi32(0x000000F8));
+    __m128i g = _mm_and_si128(_mm_slli_epi32(p, 5), _mm_set1_epi32(0x0000FC00));
+    __m128i b = _mm_and_si128(_mm_slli_epi32(p, 19), _mm_set1_epi32(0x00F80000));
+    return _mm_or_si128(_mm_or_si128(r, g), _mm_or_si128(b, _mm_set1_epi32((int)0xFF000000)));
+}
+
+/**
+ * Expand four zero-extended 0RGB1555 pixels (one per 32-bit lane) to RGBA8888
+ */
+static inline __m128i expand_0rgb1555_sse2(__m128i p) {
+    __m128i r = _mm_and_si128(_mm_srli_epi32(p, 7), _mm_set1_epi32(0x000000F8));
+    __m128i g = _mm_and_si128(_mm_slli_epi32(p, 6), _mm_set1_epi32(0x0000F800));
+    __m128i b = _mm_and_si128(_mm_slli_epi32(p, 19), _mm_set1_epi32(0x00F80000));
+    return _mm_or_si128(_mm_or_si128(r, g), _mm_or_si128(b, _mm_set1_epi32((int)0xFF000000)));
+}
+
+static void convert_rgb565_sse2(uint32_t* dst, const void* src, unsigned width) {
+    const uint16_t* src_pixels = (const uint16_t*)src;
+    const __m128i zero = _mm_setzero_si128();
+    unsigned x = 0;
+
+    for (; x + 8 <= width; x += 8) {
+        __m128i p = _mm_loadu_si128((const __m128i*)(src_pixels + x));
+        _mm_storeu_si128((__m128i*)(dst + x), expand_rgb565_sse2(_mm_unpacklo_epi16(p, zero)));
+        _mm_storeu_si128((__m128i*)(dst + x + 4), expand_rgb565_sse2(_mm_unpackhi_epi16(p, zero)));
+    }
+
+    convert_rgb565_scalar(dst + x, src_pixels + x, width - x);
+}
+
+static void convert_0rgb1555_sse2(uint32_t* dst, const void* src, unsigned width) {
+    const uint16_t* src_pixels = (const uint16_t*)src;
+    const __m128i zero = _mm_setzero_si128();
+    unsigned x = 0;
+
+    for (; x + 8 <= width; x += 8) {
+        __m128i p = _mm_loadu_si128((const __m128i*)(src_pixels + x));
+        _mm_storeu_si128((__m128i*)(dst + x), expand_0rgb1555_sse2(_mm_unpacklo_epi16(p, zero)));
+        _mm_storeu_si128((__m128i*)(dst + x + 4), expand_0rgb1555_sse2(_mm_unpackhi_epi16(p, zero)));
+    }
+
+    convert_0rgb1555_scalar(dst + x, src_pixels + x, width - x);
+}
+
+//=============================================================================
+// AVX2 Converters (x86, runtime-detected)
+//=============================================================================
+
+// Compiled with a per-function target so the rest of the file stays at the
+// SSE2 baseline; only called once libretro_convert_init() has seen AVX2.
+#define LIBRETRO_AVX2 __attribute__((target("avx2")))
+
+LIBRETRO_AVX2 static void convert_xrgb8888_avx2(uint32_t* dst, const void* src, unsigned width) {
+    const uint32_t* src_pixels = (const uint32_t*)src;
+    const __m256i mask_lo = _mm256_set1_epi32(0x000000FF);
+    const __m256i mask_g = _mm256_set1_epi32(0x0000FF00);
+    const __m256i mask_b = _mm256_set1_epi32(0x00FF0000);
+    const __m256i alpha = _mm256_set1_epi32((int)0xFF000000);
+    unsigned x = 0;
+
+    for (; x + 8 <= width; x += 8) {
+        __m256i p = _mm256_loadu_si256((const __m256i*)(src_pixels + x));
+        __m256i r = _mm256_and_si256(_mm256_srli_epi32(p, 16), mask_lo);
+        __m256i g = _mm256_and_si256(p, mask_g);
+        __m256i b = _mm256_and_si256(_mm256_slli_epi32(p, 16), mask_b);
+        __m256i out = _mm256_or_si256(_mm256_or_si256(r, g), _mm256_or_si256(b, alpha));
+        _mm256_storeu_si256((__m256i*)(dst + x), out);
+    }
+
+    convert_xrgb8888_scalar(dst + x, src_pixels + x, width - x);
+}
+
+LIBRETRO_AVX2 static void convert_rgb565_avx2(uint32_t* dst, const void* src, unsigned width) {
+    const uint16_t* src_pixels = (const uint16_t*)src;
+    const __m256i mask_r = _mm256_set1_epi32(0x000000F8);
+    const __m256i mask_g = _mm256_set1_epi32(0x0000FC00);
+    const __m256i mask_b = _mm256_set1_epi32(0x00F80000);
+    const __m256i alpha = _mm256_set1_epi32((int)0xFF000000);
+    unsigned x = 0;
+
+    for (; x + 8 <= width; x += 8) {
+        __m256i p = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)(src_pixels + x)));
+        __m256i r = _mm256_and_si256(_mm256_srli_epi32(p, 8), mask_r);
+        __m256i g = _mm256_and_si256(_mm256_slli_epi32(p, 5), mask_g);
+        __m256i b = _mm256_and_si256(_mm256_slli_epi32(p, 19), mask_b);
+        __m256i out = _mm256_or_si256(_mm256_or_si256(r, g), _mm256_or_si256(b, alpha));
+        _mm256_storeu_si256((__m256i*)(dst + x), out);
+    }
+
+    convert_rgb565_scalar(dst + x, src_pixels + x, width - x);
+}
+
+LIBRETRO_AVX2 static void convert_0rgb1555_avx2(uint32_t* dst, const void* src, unsigned width) {
+    const uint16_t* src_pixels = (const uint16_t*)src;
+    const __m256i mask_r = _mm256_set1_epi32(0x000000F8);
+    const __m256i mask_g = _mm256_set1_epi32(0x0000F800);
+    const __m256i mask_b = _mm256_set1_epi32(0x00F80000);
+    const __m256i alpha = _mm256_set1_epi32((int)0xFF000000);
+    unsigned x = 0;
+
+    for (; x + 8 <= width; x += 8) {
+        __m256i p = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)(src_pixels + x)));
+        __m256i r = _mm256_and_si256(_mm256_srli_epi32(p, 7), mask_r);
+        __m256i g = _mm256_and_si256(_mm256_slli_epi32(p, 6), mask_g);
+        __m256i b = _mm256_and_si256(_mm256_slli_epi32(p, 19), mask_b);
+        __m256i out = _mm256_or_si256(_mm256_or_si256(r, g), _mm256_or_si256(b, alpha));
+        _mm256_storeu_si256((__m256i*)(dst + x), out);
+    }
+
+    convert_0rgb1555_scalar(dst + x, src_pixels + x, width - x);
+}
+
+#endif // LIBRETRO_CONVERT_HAVE_X86
+
+//=============================================================================
+// NEON Converters (ARM)
+//=============================================================================
+
+#ifdef LIBRETRO_CONVERT_HAVE_NEON
+
+static void convert_xrgb8888_neon(uint32_t* dst, const void* src, unsigned width) {
+    const uint32_t* src_pixels = (const uint32_t*)src;
+    unsigned x = 0;
+
+    for (; x + 16 <= width; x += 16) {
+        // Little-endian XRGB8888 is B, G, R, X in memory
+        uint8x16x4_t in = vld4q_u8((const uint8_t*)(src_pixels + x));
+        uint8x16x4_t out;
+        out.val[0] = in.val[2];
+        out.val[1] = in.val[1];
+        out.val[2] = in.val[0];
+        out.val[3] = vdupq_n_u8(0xFF);
+        vst4q_u8((uint8_t*)(dst + x), out);
+    }
+
+    convert_xrgb8888_scalar(dst + x, src_pixels + x, width - x);
+}
+
+static void convert_rgb565_neon(uint32_t* dst, const void* src, unsigned width) {
+    const uint16_t* src_pixels = (const uint16_t*)src;
+    const uint8x8_t mask_rb = vdup_n_u8(0xF8);
+    const uint8x8_t mask_g = vdup_n_u8(0xFC);
+    unsigned x = 0;
+
+    for (; x + 8 <= width; x += 8) {
+        uint16x8_t p = vld1q_u16(src_pixels + x);
+        uint8x8x4_t out;
+        out.val[0] = vand_u8(vshrn_n_u16(p, 8), mask_rb);
+        out.val[1] = vand_u8(vshrn_n_u16(p, 3), mask_g);
+        out.val[2] = vand_u8(vmovn_u16(vshlq_n_u16(p, 3)), mask_rb);
+        out.val[3] = vdup_n_u8(0xFF);
+        vst4_u8((uint8_t*)(dst + x), out);
+    }
+
+    convert_rgb565_scalar(dst + x, src_pixels + x, width - x);
+}
+
+static void convert_0rgb1555_neon(uint32_t* dst, const void* src, unsigned width) {
+    const uint16_t* src_pixels = (const uint16_t*)src;
+    const uint8x8_t mask = vdup_n_u8(0xF8);
+    unsigned x = 0;
+
+    for (; x + 8 <= width; x += 8) {
+        uint16x8_t p = vld1q_u16(src_pixels + x);
+        uint8x8x4_t out;
+        out.val[0] = vand_u8(vshrn_n_u16(p, 7), mask);
+        out.val[1] = vand_u8(vshrn_n_u16(p, 2), mask);
+        out.val[2] = vand_u8(vmovn_u16(vshlq_n_u16(p, 3)), mask);
+        out.val[3] = vdup_n_u8(0xFF);
+        vst4_u8((uint8_t*)(dst + x), out);
+    }
+
+    convert_0rgb1555_scalar(dst + x, src_pixels + x, width - x);
+}
+
+#endif // LIBRETRO_CONVERT_HAVE_NEON
+
+//=============================================================================
+// Dispatch
+//=============================================================================
+
+/**
+ * Converter table, indexed by implementation then pixel format
+ * (RETRO_PIXEL_FORMAT_0RGB1555 = 0, XRGB8888 = 1, RGB565 = 2)
+ */
+static const libretro_convert_row_t converter_table[LIBRETRO_CONVERT_IMPL_COUNT][3] = {
+    [LIBRETRO_CONVERT_SCALAR] = {
+        convert_0rgb1555_scalar, convert_xrgb8888_scalar, convert_rgb565_scalar
+    },
+#ifdef LIBRETRO_CONVERT_HAVE_X86
+    [LIBRETRO_CONVERT_SSE2] = {
+        convert_0rgb1555_sse2, convert_xrgb8888_sse2, convert_rgb565_sse2
+    },
+    [LIBRETRO_CONVERT_AVX2] = {
+        convert_0rgb1555_avx2, convert_xrgb8888_avx2, convert_rgb565_avx2
+    },
+#endif
+#ifdef LIBRETRO_CONVERT_HAVE_NEON
+    [LIBRETRO_CONVERT_NEON] = {
+        convert_0rgb1555_neon, convert_xrgb8888_neon, convert_rgb565_neon
+    },
+#endif
+};
+
+static libretro_convert_impl_t active_impl = LIBRETRO_CONVERT_SCALAR;
+static bool convert_initialized = false;
+
+bool libretro_convert_impl_available(libretro_convert_impl_t impl) {
+    switch (impl) {
+        case LIBRETRO_CONVERT_SCALAR:
+            return true;
+#ifdef LIBRETRO_CONVERT_HAVE_X86
+        case LIBRETRO_CONVERT_SSE2:
+            return __builtin_cpu_supports("sse2");
+        case LIBRETRO_CONVERT_AVX2:
+            return __builtin_cpu_supports("avx2");
+#endif
+#ifdef LIBRETRO_CONVERT_HAVE_NEON
+        case LIBRETRO_CONVERT_NEON:
+            return true;
+#endif
+        default:
+            return false;
+    }
+}
+
+void libretro_convert_init(void) {
+    if (convert_initialized) return;
+
+#ifdef LIBRETRO_CONVERT_HAVE_X86
+    __builtin_cpu_init();
+#endif
+
+    // Pick the most preferred available implementation
+    active_impl = LIBRETRO_CONVERT_SCALAR;
+    for (int impl = LIBRETRO_CONVERT_IMPL_COUNT - 1; impl > LIBRETRO_CONVERT_SCALAR; impl--) {
+        if (libretro_convert_impl_available((libretro_convert_impl_t)impl)) {
+            active_impl = (libretro_convert_impl_t)impl;
+            break;
+        }
+    }
+
+    convert_initialized = true;
+    fprintf(stderr, "Pixel conversion: %s\n", libretro_convert_impl_name(active_impl));
+}
+
+libretro_convert_row_t libretro_convert_get_row_impl(libretro_convert_impl_t impl, unsigned pixel_format) {
+    if (impl >= LIBRETRO_CONVERT_IMPL_COUNT || pixel_format > RETRO_PIXEL_FORMAT_RGB565) return NULL;
+    if (!libretro_convert_impl_available(impl)) return NULL;
+    return converter_table[impl][pixel_format];
+}
+
+libretro_convert_row_t libretro_convert_get_row(unsigned pixel_format) {
+    if (!convert_initialized) {
+        libretro_convert_init();
+    }
+    return libretro_convert_get_row_impl(active_impl, pixel_format);
+}
+
+bool libretro_convert_set_impl(libretro_convert_impl_t impl) {
+    if (!convert_initialized) {
+        libretro_convert_init();
+    }
+    if (!libretro_convert_impl_available(impl)) return false;
+    active_impl = impl;
+    return true;
+}
+
+libretro_convert_impl_t libretro_convert_get_impl(void) {
+    return active_impl;
+}
+
+const char* libretro_convert_impl_name(libretro_convert_impl_t impl) {
+    switch (impl) {
+        case LIBRETRO_CONVERT_SCALAR: return "scalar";
+        case LIBRETRO_CONVERT_SSE2: return "sse2";
+        case LIBRETRO_CONVERT_AVX2: return "avx2";
+        case LIBRETRO_CONVERT_NEON: return "neon";
+        default: return "unknown";
+    }
+}
@@ -0,0 +1,101 @@
+/*
+ * libretro_convert.h - Pixel Format Row Converters
+ *
+ * Copyright (c) 2024 mikedx
+ * GitHub: https://github.com/mikedx/libretro_raylib
+ *
+ * This file is part of libretro_raylib.
+ *
+ * libretro_raylib is free software: you can redistribute it and/or modify
+ * it under the terms of the MIT License.
+ *
+ * Row converters from the libretro pixel formats (XRGB8888, RGB565, 0RGB1555)
+ * to RGBA8888. A scalar reference implementation is always available; SIMD
+ * implementations (SSE2/AVX2 on x86, NEON on ARM) are selected at startup
+ * based on CPU features and must produce bit-identical output.
+ */
+
+#ifndef LIBRETRO_CONVERT_H
+#define LIBRETRO_CONVERT_H
+
+#include "libretro.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+//=============================================================================
+// Converter Types
+//=============================================================================
+
+/**
+ * Converter implementations, in increasing order of preference
+ */
+typedef enum {
+    LIBRETRO_CONVERT_SCALAR = 0,
+    LIBRETRO_CONVERT_SSE2,
+    LIBRETRO_CONVERT_AVX2,
+    LIBRETRO_CONVERT_NEON,
+    LIBRETRO_CONVERT_IMPL_COUNT
+} libretro_convert_impl_t;
+
+/**
+ * Row converter - converts one row of source pixels to RGBA8888
+ * @param dst Destination row (width RGBA8888 pixels)
+ * @param src Source row in the converter's pixel format
+ * @param width Number of pixels to convert
+ */
+typedef void (*libretro_convert_row_t)(uint32_t* dst, const void* src, unsigned width);
+
+//=============================================================================
+// Public API Functions
+//=============================================================================
+
+/**
+ * Select the best converter implementation supported by the running CPU
+ * Safe to call more than once; later calls are no-ops
+ */
+void libretro_convert_init(void);
+
+/**
+ * Get the row converter for a pixel format using the active implementation
+ * @param pixel_format RETRO_PIXEL_FORMAT_*
+ * @return Row converter, or NULL if the format is not supported
+ */
+libretro_convert_row_t libretro_convert_get_row(unsigned pixel_format);
+
+/**
+ * Get the row converter for a pixel format from a specific implementation
+ * @param impl Converter implementation
+ * @param pixel_format RETRO_PIXEL_FORMAT_*
+ * @return Row converter, or NULL if the implementation is not available
+ *         on this CPU/build or the format is not supported
+ */
+libretro_convert_row_t libretro_convert_get_row_impl(libretro_convert_impl_t impl, unsigned pixel_format);
+
+/**
+ * Check whether an implementation is compiled in and supported by the CPU
+ * @param impl Converter implementation
+ * @return true if available
+ */
+bool libretro_convert_impl_available(libretro_convert_impl_t impl);
+
+/**
+ * Force a specific implementation (e.g. for benchmarking or debugging)
+ * @param impl Converter implementation
+ * @return true on success, false if the implementation is not available
+ */
+bool libretro_convert_set_impl(libretro_convert_impl_t impl);
+
+/**
+ * Get the active implementation
+ * @return Active converter implementation
+ */
+libretro_convert_impl_t libretro_convert_get_impl(void);
+
+/**
+ * Get a human-readable implementation name
+ * @param impl Converter implementation
+ * @return Static name string ("scalar", "sse2", "avx2", "neon")
+ */
+const char* libretro_convert_impl_name(libretro_convert_impl_t impl);
+
+#endif // LIBRETRO_CONVERT_H
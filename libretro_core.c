@@ -10,17 +10,83 @@
  * it under the terms of the MIT License.
  */
 
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE // dladdr
+#endif
+
 #include "libretro_core.h"
 #include "libretro_frontend.h"
 #include "libretro_environment.h"
 #include "libretro_video.h"
 #include "libretro_audio.h"
 #include "libretro_input.h"
+#include "libretro_content.h"
 #include <dlfcn.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <limits.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+// Private core copies made so far (names them uniquely)
+static unsigned g_core_copies = 0;
+
+/**
+ * Read a whole ROM file into a heap buffer (fallback when mapping fails)
+ * @param path File path
+ * @param size Output file size
+ * @return Buffer to free(), or NULL on error (already reported)
+ */
+static void* rom_read_file(const char* path, size_t* size) {
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        fprintf(stderr, "Failed to open ROM file: %s\n", path);
+        return NULL;
+    }
+    
+    fseek(file, 0, SEEK_END);
+    long file_size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    
+    if (file_size <= 0) {
+        fprintf(stderr, "Invalid ROM file size\n");
+        fclose(file);
+        return NULL;
+    }
+    
+    void* rom_data = malloc(file_size);
+    if (!rom_data) {
+        fprintf(stderr, "Failed to allocate memory for ROM\n");
+        fclose(file);
+        return NULL;
+    }
+    
+    size_t bytes_read = fread(rom_data, 1, file_size, file);
+    fclose(file);
+    
+    if (bytes_read != (size_t)file_size) {
+        fprintf(stderr, "Failed to read ROM file completely\n");
+        free(rom_data);
+        return NULL;
+    }
+    
+    *size = (size_t)file_size;
+    return rom_data;
+}
+
+/**
+ * Release ROM data from libretro_content_map_file or rom_read_file
+ */
+static void rom_release(void* data, size_t size, bool mapped) {
+    if (!data) return;
+    if (mapped) {
+        munmap(data, size);
+    } else {
+        free(data);
+    }
+}
 
 /**
  * Set up callbacks after loading a game
@@ -57,23 +123,104 @@ static void setup_callbacks_after_load(libretro_frontend_t* frontend) {
     }
 }
 
+/**
+ * Copy a file (private core copies)
+ * @return false on error (already reported)
+ */
+static bool core_copy_file(const char* from, const char* to) {
+    int in = open(from, O_RDONLY);
+    if (in < 0) {
+        fprintf(stderr, "Failed to open core: %s\n", from);
+        return false;
+    }
+    int out = open(to, O_WRONLY | O_CREAT | O_EXCL, 0700);
+    if (out < 0) {
+        fprintf(stderr, "Failed to create core copy: %s\n", to);
+        close(in);
+        return false;
+    }
+    
+    char buffer[65536];
+    bool ok = true;
+    ssize_t got;
+    while (ok && (got = read(in, buffer, sizeof(buffer))) > 0) {
+        ok = write(out, buffer, (size_t)got) == got;
+    }
+    ok = ok && got == 0;
+    close(in);
+    if (close(out) != 0) ok = false;
+    if (!ok) {
+        fprintf(stderr, "Failed to copy core to %s\n", to);
+        unlink(to);
+    }
+    return ok;
+}
+
+/**
+ * dlopen a core
+ * dlopen hands back the already loaded image for a file that is loaded, so
+ * instances sharing a process would share the core's globals. A private
+ * copy under its own name is a separate image with its own; it is unlinked
+ * as soon as it is loaded.
+ */
+static void* core_open(const char* core_path, bool private_copy) {
+    if (!private_copy) return dlopen(core_path, RTLD_LAZY | RTLD_LOCAL);
+    
+    const char* tmp = getenv("TMPDIR");
+    if (!tmp || !tmp[0]) tmp = "/tmp";
+    const char* slash = strrchr(core_path, '/');
+    const char* name = slash ? slash + 1 : core_path;
+    unsigned copy = __atomic_add_fetch(&g_core_copies, 1, __ATOMIC_RELAXED);
+    
+    char path[PATH_MAX];
+    int len = snprintf(path, sizeof(path), "%s/libretro_raylib-%d-%u-%s", tmp, (int)getpid(), copy, name);
+    if (len < 0 || (size_t)len >= sizeof(path)) {
+        fprintf(stderr, "Core copy path too long\n");
+        return NULL;
+    }
+    if (!core_copy_file(core_path, path)) return NULL;
+    
+    void* handle = dlopen(path, RTLD_LAZY | RTLD_LOCAL);
+    unlink(path);
+    return handle;
+}
+
+void* libretro_core_open_image(const char* core_path, bool private_copy) {
+    if (!core_path) return NULL;
+    void* handle = core_open(core_path, private_copy);
+    if (!handle) {
+        const char* error = dlerror();
+        fprintf(stderr, "Failed to load core: %s\n", error ? error : core_path);
+    }
+    return handle;
+}
+
+void libretro_core_close_image(void* image) {
+    if (image) dlclose(image);
+}
+
+/**
+ * Close the frontend's core image unless it was lent to it (core_image)
+ */
+static void core_close(libretro_frontend_t* frontend, void* handle) {
+    if (handle != frontend->core_image) dlclose(handle);
+}
+
 /**
  * Load a libretro core from a dynamic library
  */
 bool libretro_core_load(libretro_frontend_t* frontend, const char* core_path) {
     if (!frontend || !core_path) return false;
     
-    void* handle = dlopen(core_path, RTLD_LAZY);
-    if (!handle) {
-        fprintf(stderr, "Failed to load core: %s\n", dlerror());
-        return false;
-    }
+    void* handle = frontend->core_image ? frontend->core_image
+                                        : libretro_core_open_image(core_path, frontend->core_private_copy);
+    if (!handle) return false;
     
     frontend->core_handle = handle;
     
     frontend->core = (struct retro_core_t*)calloc(1, sizeof(struct retro_core_t));
     if (!frontend->core) {
-        dlclose(handle);
+        core_close(frontend, handle);
         frontend->core_handle = NULL;
         return false;
     }
@@ -87,13 +234,17 @@ bool libretro_core_load(libretro_frontend_t* frontend, const char* core_path) {
         fprintf(stderr, "Failed to load required symbols from core\n");
         free(frontend->core);
         frontend->core = NULL;
-        dlclose(handle);
+        core_close(frontend, handle);
         frontend->core_handle = NULL;
         return false;
     }
     
+    // Calls from threads the core starts itself are routed by its image
+    Dl_info image;
+    frontend->core_base = dladdr((void*)set_env, &image) ? image.dli_fbase : NULL;
+    
     // Set environment callback early
-    libretro_environment_set_frontend(frontend);
+    libretro_frontend_bind_thread(frontend);
     fprintf(stderr, "Setting environment callback (matching RetroArch sequence)...\n");
     set_env(retro_environment_callback);
     frontend->has_set_environment = true;
@@ -122,7 +273,7 @@ bool libretro_core_load(libretro_frontend_t* frontend, const char* core_path) {
         fprintf(stderr, "Failed to load core functions\n");
         free(frontend->core);
         frontend->core = NULL;
-        dlclose(handle);
+        core_close(frontend, handle);
         frontend->core_handle = NULL;
         return false;
     }
@@ -140,6 +291,7 @@ bool libretro_core_init(libretro_frontend_t* frontend) {
     if (frontend->core->retro_get_system_info) {
         frontend->core->retro_get_system_info(&info);
         frontend->need_fullpath = info.need_fullpath;
+        frontend->valid_extensions = info.valid_extensions;
         fprintf(stderr, "Core: %s %s\n", info.library_name, info.library_version);
     }
     
@@ -170,6 +322,8 @@ void libretro_core_update_av_info(libretro_frontend_t* frontend) {
         frontend->core->retro_get_system_av_info(&av_info);
         frontend->width = av_info.geometry.base_width;
         frontend->height = av_info.geometry.base_height;
+        frontend->max_width = av_info.geometry.max_width;
+        frontend->max_height = av_info.geometry.max_height;
         frontend->aspect_ratio = av_info.geometry.aspect_ratio;
         
         unsigned new_sample_rate = (unsigned)av_info.timing.sample_rate;
@@ -180,25 +334,12 @@ void libretro_core_update_av_info(libretro_frontend_t* frontend) {
         fprintf(stderr, "Video: %ux%u (aspect: %.2f, fps: %.2f)\n", 
                 frontend->width, frontend->height, frontend->aspect_ratio, frontend->fps);
         fprintf(stderr, "Audio: %u Hz\n", new_sample_rate);
-        if (new_sample_rate != frontend->audio_sample_rate) {
-            if (frontend->audio_ring_buffer) {
-                free(frontend->audio_ring_buffer);
-            }
-            frontend->audio_sample_rate = new_sample_rate;
-            frontend->audio_ring_buffer_size = frontend->audio_sample_rate / 4;
-            if (frontend->audio_ring_buffer_size == 0) {
-                frontend->audio_ring_buffer_size = 11025;
-            }
-            frontend->audio_ring_buffer = (float*)calloc(frontend->audio_ring_buffer_size * 2, sizeof(float));
-            frontend->audio_ring_read_pos = 0;
-            frontend->audio_ring_write_pos = 0;
-            frontend->audio_ring_available = 0;
-        }
-        
+        frontend->audio_sample_rate = new_sample_rate;
         frontend->fps = av_info.timing.fps;
         
-        // Don't allocate framebuffer here - let video callback handle it
-        // Framebuffer allocation should happen in video callback based on actual frame dimensions
+        // The first AV info sizes the session's buffers for its max geometry
+        libretro_frontend_reserve_session(frontend);
+        libretro_audio_set_timing(frontend, new_sample_rate, frontend->fps);
     }
 }
 
@@ -226,76 +367,84 @@ bool libretro_core_load_rom(libretro_frontend_t* frontend, const char* rom_path)
         return false;
     }
     
-    char* abs_path = realpath(rom_path, NULL);
-    if (!abs_path) {
-        fprintf(stderr, "Failed to get absolute path for ROM: %s\n", rom_path);
-        return false;
-    }
-    
     struct retro_game_info game_info = {0};
     void* rom_data = NULL;
-    
-    if (frontend->need_fullpath) {
-        game_info.path = abs_path;
-        game_info.data = NULL;
-        game_info.size = 0;
-        game_info.meta = NULL;
-    } else {
-        FILE* file = fopen(abs_path, "rb");
-        if (!file) {
-            fprintf(stderr, "Failed to open ROM file: %s\n", abs_path);
-            free(abs_path);
+    size_t rom_size = 0;
+    bool mapped = false;
+    char* abs_path = NULL;
+    uint64_t start = libretro_perf_now_ns();
+    
+    if (libretro_content_is_archive(rom_path, frontend->valid_extensions)) {
+        // Compressed content: the loader owns the data and the path
+        libretro_content_t* content = (libretro_content_t*)malloc(sizeof(*content));
+        if (!content || !libretro_content_open(content, rom_path, frontend->valid_extensions,
+                                               frontend->need_fullpath, frontend->core_uses_vfs)) {
+            free(content);
             return false;
         }
-        
-        fseek(file, 0, SEEK_END);
-        long file_size = ftell(file);
-        fseek(file, 0, SEEK_SET);
-        
-        if (file_size <= 0) {
-            fprintf(stderr, "Invalid ROM file size\n");
-            fclose(file);
-            free(abs_path);
+        frontend->content = content;
+        game_info.path = content->path;
+        game_info.data = content->data;
+        game_info.size = content->size;
+        abs_path = strdup(content->path);
+        if (!abs_path) {
+            libretro_content_close(content);
+            free(content);
+            frontend->content = NULL;
             return false;
         }
-        
-        rom_data = malloc(file_size);
-        if (!rom_data) {
-            fprintf(stderr, "Failed to allocate memory for ROM\n");
-            fclose(file);
-            free(abs_path);
+    } else {
+        abs_path = realpath(rom_path, NULL);
+        if (!abs_path) {
+            fprintf(stderr, "Failed to get absolute path for ROM: %s\n", rom_path);
             return false;
         }
+        game_info.path = abs_path;
         
-        size_t bytes_read = fread(rom_data, 1, file_size, file);
-        fclose(file);
-        
-        if (bytes_read != (size_t)file_size) {
-            fprintf(stderr, "Failed to read ROM file completely\n");
-            free(rom_data);
-            free(abs_path);
-            return false;
+        if (!frontend->need_fullpath) {
+            rom_data = libretro_content_map_file(abs_path, &rom_size);
+            mapped = rom_data != NULL;
+            if (!rom_data) {
+                rom_data = rom_read_file(abs_path, &rom_size);
+            }
+            if (!rom_data) {
+                free(abs_path);
+                return false;
+            }
+            game_info.data = rom_data;
+            game_info.size = rom_size;
         }
-        
-        game_info.path = abs_path;
-        game_info.data = rom_data;
-        game_info.size = (size_t)file_size;
-        game_info.meta = NULL;
     }
     
+    uint64_t loaded = libretro_perf_now_ns();
     bool success = frontend->core->retro_load_game(&game_info);
+    uint64_t done = libretro_perf_now_ns();
     
     if (!success) {
         fprintf(stderr, "Failed to load ROM - core returned false\n");
-        if (rom_data) {
-            free(rom_data);
-        }
+        rom_release(rom_data, rom_size, mapped);
         free(abs_path);
+        if (frontend->content) {
+            libretro_content_close(frontend->content);
+            free(frontend->content);
+            frontend->content = NULL;
+        }
         return false;
     }
     
+    if (rom_data) {
+        fprintf(stderr, "ROM: %.2f MB %s in %.2f ms, retro_load_game %.2f ms\n",
+                rom_size / (1024.0 * 1024.0), mapped ? "mapped" : "read",
+                (loaded - start) / 1e6, (done - loaded) / 1e6);
+    } else if (frontend->content) {
+        fprintf(stderr, "ROM: retro_load_game %.2f ms\n", (done - loaded) / 1e6);
+    } else {
+        fprintf(stderr, "ROM: passed by path, retro_load_game %.2f ms\n", (done - loaded) / 1e6);
+    }
+    
     frontend->rom_data = rom_data;
     frontend->rom_data_size = frontend->need_fullpath ? 0 : game_info.size;
+    frontend->rom_data_mapped = mapped;
     frontend->rom_path = abs_path;
     
     // Match RetroArch's exact sequence:
@@ -331,8 +480,14 @@ void libretro_core_unload(libretro_frontend_t* frontend) {
     }
     
     if (frontend->rom_data) {
-        free(frontend->rom_data);
+        rom_release(frontend->rom_data, frontend->rom_data_size, frontend->rom_data_mapped);
         frontend->rom_data = NULL;
+        frontend->rom_data_mapped = false;
+    }
+    if (frontend->content) {
+        libretro_content_close(frontend->content);
+        free(frontend->content);
+        frontend->content = NULL;
     }
     if (frontend->rom_path) {
         free(frontend->rom_path);
@@ -344,8 +499,9 @@ void libretro_core_unload(libretro_frontend_t* frontend) {
     }
     
     if (frontend->core_handle) {
-        dlclose(frontend->core_handle);
+        core_close(frontend, frontend->core_handle);
         frontend->core_handle = NULL;
+        frontend->core_base = NULL;
     }
     
     if (frontend->core) {
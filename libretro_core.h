@@ -26,6 +26,22 @@
  */
 bool libretro_core_load(libretro_frontend_t* frontend, const char* core_path);
 
+/**
+ * Open a core file without loading it into a frontend, so several frontends
+ * can load it one after another (libretro_frontend_t.core_image); each one
+ * runs retro_init/retro_deinit on the same image
+ * @param core_path Path to the core file
+ * @param private_copy Open a private copy (see core_private_copy)
+ * @return dlopen handle, or NULL (already reported)
+ */
+void* libretro_core_open_image(const char* core_path, bool private_copy);
+
+/**
+ * Close an image opened with libretro_core_open_image
+ * @param image dlopen handle (NULL is ignored)
+ */
+void libretro_core_close_image(void* image);
+
 /**
  * Initialize the loaded libretro core
  * @param frontend Frontend instance with loaded core
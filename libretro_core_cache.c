@@ -0,0 +1,188 @@
+/*
+ * libretro_core_cache.c - Core Metadata Cache Implementation
+ *
+ * Copyright (c) 2024 mikedx
+ * GitHub: https://github.com/mikedx/libretro_raylib
+ *
+ * This file is part of libretro_raylib.
+ *
+ * libretro_raylib is free software: you can redistribute it and/or modify
+ * it under the terms of the MIT License.
+ */
+
+#include "libretro_core_cache.h"
+#include "libretro_core_types.h"
+#include "libretro_file.h"
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Bumped whenever the entry format changes; other versions are misses
+#define CORE_CACHE_VERSION 1
+
+/**
+ * Entry path for a core: <cache>/libretro_raylib/cores/<FNV-1a of the path>.info
+ * @param create Create the directory
+ * @return false if there is no cache directory
+ */
+static bool core_cache_path(const char* core_path, char* path, size_t size, bool create) {
+    char dir[PATH_MAX];
+    if (!libretro_file_cache_dir("cores", dir, sizeof(dir))) return false;
+    if (create && !libretro_file_make_dirs(dir)) return false;
+
+    uint64_t key = libretro_file_hash(LIBRETRO_FILE_HASH_INIT, core_path, strlen(core_path));
+    int len = snprintf(path, size, "%s/%016llx.info", dir, (unsigned long long)key);
+    return len > 0 && (size_t)len < size;
+}
+
+/**
+ * Copy a string into a fixed field, truncating
+ */
+static void core_cache_copy(char* field, size_t size, const char* value) {
+    snprintf(field, size, "%s", value ? value : "");
+}
+
+//=============================================================================
+// Public API
+//=============================================================================
+
+bool libretro_core_cache_load(const char* core_path, libretro_core_meta_t* meta) {
+    memset(meta, 0, sizeof(*meta));
+    struct stat st;
+    char path[PATH_MAX];
+    if (!core_path || stat(core_path, &st) != 0 || !core_cache_path(core_path, path, sizeof(path), false)) {
+        return false;
+    }
+    FILE* file = fopen(path, "r");
+    if (!file) return false;
+
+    // Every identifying line has to match this version of the core file
+    unsigned matched = 0;
+    bool valid = true;
+    char line[PATH_MAX + 64];
+    while (valid && fgets(line, sizeof(line), file)) {
+        line[strcspn(line, "\r\n")] = '\0';
+        char* value = strchr(line, '=');
+        if (!value) continue;
+        *value++ = '\0';
+
+        if (strcmp(line, "version") == 0) {
+            valid = atoi(value) == CORE_CACHE_VERSION;
+            matched++;
+        } else if (strcmp(line, "path") == 0) {
+            valid = strcmp(value, core_path) == 0;
+            matched++;
+        } else if (strcmp(line, "size") == 0) {
+            valid = strtoull(value, NULL, 10) == (unsigned long long)st.st_size;
+            matched++;
+        } else if (strcmp(line, "mtime") == 0) {
+            valid = strtoll(value, NULL, 10) == (long long)st.st_mtime;
+            matched++;
+        } else if (strcmp(line, "library_name") == 0) {
+            core_cache_copy(meta->library_name, sizeof(meta->library_name), value);
+        } else if (strcmp(line, "library_version") == 0) {
+            core_cache_copy(meta->library_version, sizeof(meta->library_version), value);
+        } else if (strcmp(line, "valid_extensions") == 0) {
+            core_cache_copy(meta->valid_extensions, sizeof(meta->valid_extensions), value);
+        } else if (strcmp(line, "need_fullpath") == 0) {
+            meta->need_fullpath = atoi(value) != 0;
+        } else if (strcmp(line, "block_extract") == 0) {
+            meta->block_extract = atoi(value) != 0;
+        } else if (strcmp(line, "hw_render") == 0) {
+            meta->hw_render = atoi(value) != 0;
+        } else if (strcmp(line, "av") == 0) {
+            meta->have_av = sscanf(value, "%u %u %u %u %f %lf %u", &meta->base_width, &meta->base_height,
+                                   &meta->max_width, &meta->max_height, &meta->aspect_ratio,
+                                   &meta->fps, &meta->sample_rate) == 7 &&
+                            meta->base_width > 0 && meta->base_height > 0;
+        }
+    }
+    fclose(file);
+
+    if (!valid || matched != 4) {
+        memset(meta, 0, sizeof(*meta));
+        return false;
+    }
+    return true;
+}
+
+void libretro_core_cache_collect(libretro_frontend_t* frontend, libretro_core_meta_t* meta) {
+    memset(meta, 0, sizeof(*meta));
+    if (!frontend || !frontend->core) return;
+
+    if (frontend->core->retro_get_system_info) {
+        struct retro_system_info info;
+        memset(&info, 0, sizeof(info));
+        frontend->core->retro_get_system_info(&info);
+        core_cache_copy(meta->library_name, sizeof(meta->library_name), info.library_name);
+        core_cache_copy(meta->library_version, sizeof(meta->library_version), info.library_version);
+        core_cache_copy(meta->valid_extensions, sizeof(meta->valid_extensions), info.valid_extensions);
+        meta->need_fullpath = info.need_fullpath;
+        meta->block_extract = info.block_extract;
+    }
+
+    meta->have_av = frontend->width > 0 && frontend->height > 0;
+    meta->base_width = frontend->width;
+    meta->base_height = frontend->height;
+    meta->max_width = frontend->max_width;
+    meta->max_height = frontend->max_height;
+    meta->aspect_ratio = frontend->aspect_ratio;
+    meta->fps = frontend->fps;
+    meta->sample_rate = frontend->audio_sample_rate;
+    meta->hw_render = frontend->hw.requested;
+}
+
+bool libretro_core_cache_store(const char* core_path, const libretro_core_meta_t* meta) {
+    struct stat st;
+    char path[PATH_MAX];
+    if (!core_path || stat(core_path, &st) != 0 || !core_cache_path(core_path, path, sizeof(path), true)) {
+        return false;
+    }
+    libretro_file_write_t writer;
+    if (!libretro_file_begin_write(&writer, path)) return false;
+    FILE* file = fdopen(writer.fd, "w");
+    if (!file) {
+        close(writer.fd);
+        return libretro_file_end_write(&writer, false);
+    }
+
+    fprintf(file, "version=%d\n", CORE_CACHE_VERSION);
+    fprintf(file, "path=%s\n", core_path);
+    fprintf(file, "size=%llu\n", (unsigned long long)st.st_size);
+    fprintf(file, "mtime=%lld\n", (long long)st.st_mtime);
+    fprintf(file, "library_name=%s\n", meta->library_name);
+    fprintf(file, "library_version=%s\n", meta->library_version);
+    fprintf(file, "valid_extensions=%s\n", meta->valid_extensions);
+    fprintf(file, "need_fullpath=%d\n", meta->need_fullpath ? 1 : 0);
+    fprintf(file, "block_extract=%d\n", meta->block_extract ? 1 : 0);
+    fprintf(file, "hw_render=%d\n", meta->hw_render ? 1 : 0);
+    if (meta->have_av) {
+        fprintf(file, "av=%u %u %u %u %.9g %.17g %u\n", meta->base_width, meta->base_height,
+                meta->max_width, meta->max_height, meta->aspect_ratio, meta->fps, meta->sample_rate);
+    }
+
+    bool ok = !ferror(file);
+    if (fclose(file) != 0) ok = false;
+    return libretro_file_end_write(&writer, ok);
+}
+
+bool libretro_core_cache_changed(const libretro_core_meta_t* a, const libretro_core_meta_t* b) {
+    return strcmp(a->library_name, b->library_name) != 0 ||
+           strcmp(a->library_version, b->library_version) != 0 ||
+           strcmp(a->valid_extensions, b->valid_extensions) != 0 ||
+           a->need_fullpath != b->need_fullpath ||
+           a->block_extract != b->block_extract ||
+           a->have_av != b->have_av ||
+           a->base_width != b->base_width ||
+           a->base_height != b->base_height ||
+           a->max_width != b->max_width ||
+           a->max_height != b->max_height ||
+           a->aspect_ratio != b->aspect_ratio ||
+           a->fps != b->fps ||
+           a->sample_rate != b->sample_rate ||
+           a->hw_render != b->hw_render;
+}
@@ -0,0 +1,87 @@
+/*
+ * libretro_core_cache.h - Core Metadata Cache
+ *
+ * Copyright (c) 2024 mikedx
+ * GitHub: https://github.com/mikedx/libretro_raylib
+ *
+ * This file is part of libretro_raylib.
+ *
+ * libretro_raylib is free software: you can redistribute it and/or modify
+ * it under the terms of the MIT License.
+ *
+ * What a core reported the last time it ran: its system info and the AV
+ * info of the content it loaded. It is kept per core file, keyed by path,
+ * size and mtime (a rebuilt core is a miss), in
+ * $XDG_CACHE_HOME/libretro_raylib/cores (or ~/.cache).
+ *
+ * Startup uses it to size the window before the core has been opened, so
+ * the window, audio device and shaders are set up while the core loads and
+ * initializes and its content loads, instead of after.
+ */
+
+#ifndef LIBRETRO_CORE_CACHE_H
+#define LIBRETRO_CORE_CACHE_H
+
+#include "libretro_frontend.h"
+#include <stdbool.h>
+
+//=============================================================================
+// Cache Structures
+//=============================================================================
+
+/**
+ * Metadata recorded for a core
+ */
+typedef struct {
+    // retro_get_system_info
+    char library_name[64];
+    char library_version[64];
+    char valid_extensions[256];
+    bool need_fullpath;
+    bool block_extract;
+
+    // Last AV info, as it stood once content was loaded
+    bool have_av;
+    unsigned base_width;
+    unsigned base_height;
+    unsigned max_width;
+    unsigned max_height;
+    float aspect_ratio;
+    double fps;
+    unsigned sample_rate;
+    bool hw_render;                 // Asked for SET_HW_RENDER
+} libretro_core_meta_t;
+
+//=============================================================================
+// Public API Functions
+//=============================================================================
+
+/**
+ * Look up a core's metadata
+ * @param core_path Core file
+ * @param meta Output metadata (zeroed on a miss)
+ * @return false if there is no entry for this version of the core file
+ */
+bool libretro_core_cache_load(const char* core_path, libretro_core_meta_t* meta);
+
+/**
+ * Collect metadata from a frontend whose content is loaded
+ * @param frontend Frontend
+ * @param meta Output metadata
+ */
+void libretro_core_cache_collect(libretro_frontend_t* frontend, libretro_core_meta_t* meta);
+
+/**
+ * Write a core's metadata (through a temporary file and a rename)
+ * @param core_path Core file
+ * @param meta Metadata
+ * @return false if it couldn't be written
+ */
+bool libretro_core_cache_store(const char* core_path, const libretro_core_meta_t* meta);
+
+/**
+ * Whether two entries differ in anything the cache records
+ */
+bool libretro_core_cache_changed(const libretro_core_meta_t* a, const libretro_core_meta_t* b);
+
+#endif // LIBRETRO_CORE_CACHE_H
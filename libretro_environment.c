@@ -12,18 +12,14 @@
 
 #include "libretro_environment.h"
 #include "libretro_frontend.h"
+#include "libretro_video.h"
+#include "libretro_audio.h"
+#include "libretro_vfs.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdarg.h>
 #include <limits.h>
 
-// Global frontend instance for callbacks
-static libretro_frontend_t* g_frontend = NULL;
-
-void libretro_environment_set_frontend(libretro_frontend_t* frontend) {
-    g_frontend = frontend;
-}
-
 // Log callback implementation
 static void RETRO_CALLCONV retro_log_callback(enum retro_log_level level, const char* fmt, ...) {
     (void)level; // We'll log everything to stderr regardless of level
@@ -38,11 +34,12 @@ static void RETRO_CALLCONV retro_log_callback(enum retro_log_level level, const
  * Handles requests from the core for system information and configuration
  */
 bool retro_environment_callback(unsigned cmd, void* data) {
-    if (!g_frontend) {
+    libretro_frontend_t* frontend = libretro_frontend_current();
+    if (!frontend) {
         if (cmd == RETRO_ENVIRONMENT_SET_PIXEL_FORMAT) {
-            fprintf(stderr, "ERROR: SET_PIXEL_FORMAT called but g_frontend is NULL! cmd=%u\n", cmd);
+            fprintf(stderr, "ERROR: SET_PIXEL_FORMAT called but frontend is NULL! cmd=%u\n", cmd);
         }
-        fprintf(stderr, "WARNING: Environment callback called with cmd=%u but g_frontend is NULL\n", cmd);
+        fprintf(stderr, "WARNING: Environment callback called with cmd=%u but frontend is NULL\n", cmd);
         return false;
     }
     
@@ -52,31 +49,37 @@ bool retro_environment_callback(unsigned cmd, void* data) {
     switch (cmd) {
         case RETRO_ENVIRONMENT_SET_PIXEL_FORMAT: {
             unsigned* format = (unsigned*)data;
-            if (!g_frontend) return false;
+            if (!frontend) return false;
             switch (*format) {
                 case RETRO_PIXEL_FORMAT_0RGB1555: 
-                    g_frontend->pixel_format = RETRO_PIXEL_FORMAT_0RGB1555;
-                    g_frontend->pixel_format_raw = *format;
+                    frontend->pixel_format = RETRO_PIXEL_FORMAT_0RGB1555;
+                    frontend->pixel_format_raw = *format;
                     break;
                 case RETRO_PIXEL_FORMAT_XRGB8888: 
-                    g_frontend->pixel_format = RETRO_PIXEL_FORMAT_XRGB8888;
-                    g_frontend->pixel_format_raw = *format;
+                    frontend->pixel_format = RETRO_PIXEL_FORMAT_XRGB8888;
+                    frontend->pixel_format_raw = *format;
                     break;
                 case RETRO_PIXEL_FORMAT_RGB565: 
-                    g_frontend->pixel_format = RETRO_PIXEL_FORMAT_RGB565;
-                    g_frontend->pixel_format_raw = *format;
+                    frontend->pixel_format = RETRO_PIXEL_FORMAT_RGB565;
+                    frontend->pixel_format_raw = *format;
                     break;
                 case 12: // Format 12: snes9x uses this but reports it as RGB565
-                    g_frontend->pixel_format = RETRO_PIXEL_FORMAT_RGB565;
-                    g_frontend->pixel_format_raw = 12;
+                    frontend->pixel_format = RETRO_PIXEL_FORMAT_RGB565;
+                    frontend->pixel_format_raw = 12;
                     break;
                 default:
-                    g_frontend->pixel_format = RETRO_PIXEL_FORMAT_RGB565;
-                    g_frontend->pixel_format_raw = *format;
+                    frontend->pixel_format = RETRO_PIXEL_FORMAT_RGB565;
+                    frontend->pixel_format_raw = *format;
                     break;
             }
             return true;
         }
+        case RETRO_ENVIRONMENT_GET_CAN_DUPE: {
+            if (!data) return false;
+            // NULL frames are handled by the video callback as "keep showing the last one"
+            *(bool*)data = true;
+            return true;
+        }
         case RETRO_ENVIRONMENT_GET_SYSTEM_DIRECTORY: {
             if (!data) return false;
             const char** dir = (const char**)data;
@@ -109,18 +112,96 @@ bool retro_environment_callback(unsigned cmd, void* data) {
             return true;
         }
         case RETRO_ENVIRONMENT_SET_VARIABLES: {
+            if (!data) return false;
+            return libretro_options_declare_variables(&frontend->options, (const struct retro_variable*)data);
+        }
+        case RETRO_ENVIRONMENT_GET_VARIABLE: {
+            if (!data) return false;
+            // Hands out the interned value: no allocation or copy per call
+            struct retro_variable* var = (struct retro_variable*)data;
+            var->value = libretro_options_get(&frontend->options, var->key);
+            return var->value != NULL;
+        }
+        case RETRO_ENVIRONMENT_GET_VARIABLE_UPDATE: {
+            if (!data) return false;
+            *(bool*)data = libretro_options_check_update(&frontend->options);
+            return true;
+        }
+        case RETRO_ENVIRONMENT_SET_VARIABLE: {
+            // NULL data queries support
+            if (!data) return true;
+            const struct retro_variable* var = (const struct retro_variable*)data;
+            if (!libretro_options_get(&frontend->options, var->key)) return false;
+            return libretro_options_set(&frontend->options, var->key, var->value);
+        }
+        case RETRO_ENVIRONMENT_GET_CORE_OPTIONS_VERSION: {
+            if (!data) return false;
+            *(unsigned*)data = LIBRETRO_OPTIONS_VERSION;
+            return true;
+        }
+        case RETRO_ENVIRONMENT_SET_CORE_OPTIONS: {
+            if (!data) return false;
+            return libretro_options_declare_v1(&frontend->options, (const struct retro_core_option_definition*)data);
+        }
+        case RETRO_ENVIRONMENT_SET_CORE_OPTIONS_INTL: {
+            if (!data) return false;
+            // No translations: only the US English definitions are used
+            const struct retro_core_options_intl* intl = (const struct retro_core_options_intl*)data;
+            return libretro_options_declare_v1(&frontend->options, intl->us);
+        }
+        case RETRO_ENVIRONMENT_SET_CORE_OPTIONS_V2: {
+            if (!data) return false;
+            // The result only says whether categories are supported (they aren't)
+            const struct retro_core_options_v2* v2 = (const struct retro_core_options_v2*)data;
+            libretro_options_declare_v2(&frontend->options, v2->definitions);
+            return false;
+        }
+        case RETRO_ENVIRONMENT_SET_CORE_OPTIONS_V2_INTL: {
+            if (!data) return false;
+            const struct retro_core_options_v2_intl* intl = (const struct retro_core_options_v2_intl*)data;
+            if (intl->us) libretro_options_declare_v2(&frontend->options, intl->us->definitions);
+            return false;
+        }
+        case RETRO_ENVIRONMENT_SET_CORE_OPTIONS_DISPLAY: {
+            if (!data) return false;
+            const struct retro_core_option_display* display = (const struct retro_core_option_display*)data;
+            libretro_options_set_visible(&frontend->options, display->key, display->visible);
             return true;
         }
         case RETRO_ENVIRONMENT_GET_AUDIO_VIDEO_ENABLE: {
             if (!data) return false;
             unsigned* enable = (unsigned*)data;
-            *enable = 3; // Enable both audio and video
+            // Run-ahead and fast-forward clear bits around frames nobody sees
+            *enable = frontend ? libretro_frontend_av_enable(frontend)
+                                 : (LIBRETRO_AV_ENABLE_VIDEO | LIBRETRO_AV_ENABLE_AUDIO);
             return true;
         }
         case RETRO_ENVIRONMENT_SET_AUDIO_CALLBACK: {
             return true;
         }
         case RETRO_ENVIRONMENT_SET_FASTFORWARDING_OVERRIDE: {
+            // NULL data queries support; otherwise the core takes over
+            // fast-forward, optionally locking the user's toggle out
+            if (!data || !frontend) return true;
+            const struct retro_fastforwarding_override* ff = (const struct retro_fastforwarding_override*)data;
+            frontend->fastforward_ratio = ff->ratio;
+            __atomic_store_n(&frontend->fastforward_locked, ff->inhibit_toggle, __ATOMIC_RELAXED);
+            __atomic_store_n(&frontend->fastforward, ff->fastforward, __ATOMIC_RELAXED);
+            return true;
+        }
+        case RETRO_ENVIRONMENT_GET_VFS_INTERFACE: {
+            if (!data) return false;
+            struct retro_vfs_interface_info* info = (struct retro_vfs_interface_info*)data;
+            struct retro_vfs_interface* iface = libretro_vfs_get_interface(info->required_interface_version);
+            if (!iface) return false;
+            info->required_interface_version = LIBRETRO_VFS_VERSION;
+            info->iface = iface;
+            if (frontend) frontend->core_uses_vfs = true;
+            return true;
+        }
+        case RETRO_ENVIRONMENT_GET_FASTFORWARDING: {
+            if (!data) return false;
+            *(bool*)data = frontend && __atomic_load_n(&frontend->fastforward, __ATOMIC_RELAXED);
             return true;
         }
         case RETRO_ENVIRONMENT_SET_DISK_CONTROL_INTERFACE: {
@@ -129,26 +210,20 @@ bool retro_environment_callback(unsigned cmd, void* data) {
         case RETRO_ENVIRONMENT_SET_SYSTEM_AV_INFO: {
             if (!data) return false;
             const struct retro_system_av_info* av_info = (const struct retro_system_av_info*)data;
-            if (g_frontend && av_info) {
-                g_frontend->width = av_info->geometry.base_width;
-                g_frontend->height = av_info->geometry.base_height;
-                g_frontend->aspect_ratio = av_info->geometry.aspect_ratio;
-                g_frontend->fps = av_info->timing.fps;
+            // Run-ahead's second instance is frames ahead: the real core
+            // reports the change when it gets there
+            if (frontend && av_info && !frontend->runahead_secondary) {
+                frontend->width = av_info->geometry.base_width;
+                frontend->height = av_info->geometry.base_height;
+                frontend->max_width = av_info->geometry.max_width;
+                frontend->max_height = av_info->geometry.max_height;
+                frontend->aspect_ratio = av_info->geometry.aspect_ratio;
+                frontend->fps = av_info->timing.fps;
                 unsigned new_sample_rate = (unsigned)av_info->timing.sample_rate;
                 if (new_sample_rate > 0) {
-                    g_frontend->audio_sample_rate = new_sample_rate;
-                    // Reallocate audio ring buffer if sample rate changed
-                    if (g_frontend->audio_ring_buffer) {
-                        free(g_frontend->audio_ring_buffer);
-                    }
-                    g_frontend->audio_ring_buffer_size = new_sample_rate / 4; // ~0.25 seconds
-                    if (g_frontend->audio_ring_buffer_size == 0) {
-                        g_frontend->audio_ring_buffer_size = 11025;
-                    }
-                    g_frontend->audio_ring_buffer = (float*)calloc(g_frontend->audio_ring_buffer_size * 2, sizeof(float));
-                    g_frontend->audio_ring_read_pos = 0;
-                    g_frontend->audio_ring_write_pos = 0;
-                    g_frontend->audio_ring_available = 0;
+                    frontend->audio_sample_rate = new_sample_rate;
+                    // Retarget the resampler; the ring is sized from the output rate
+                    libretro_audio_set_timing(frontend, new_sample_rate, frontend->fps);
                 }
                 // Logged in video callback instead
             }
@@ -157,14 +232,36 @@ bool retro_environment_callback(unsigned cmd, void* data) {
         case RETRO_ENVIRONMENT_SET_GEOMETRY: {
             if (!data) return false;
             const struct retro_game_geometry* geom = (const struct retro_game_geometry*)data;
-            if (g_frontend && geom) {
-                g_frontend->width = geom->base_width;
-                g_frontend->height = geom->base_height;
-                g_frontend->aspect_ratio = geom->aspect_ratio;
+            if (frontend && geom && !frontend->runahead_secondary) {
+                frontend->width = geom->base_width;
+                frontend->height = geom->base_height;
+                frontend->aspect_ratio = geom->aspect_ratio;
                 // Logged in video callback instead
             }
             return true;
         }
+        case RETRO_ENVIRONMENT_SET_HW_RENDER: {
+            if (!data) return false;
+            return libretro_hw_set_render(&frontend->hw, (struct retro_hw_render_callback*)data);
+        }
+        case RETRO_ENVIRONMENT_GET_PREFERRED_HW_RENDER: {
+            if (!data) return false;
+            // raylib's context is an OpenGL 3.3 core profile
+            if (!frontend->hw.available) return false;
+            *(unsigned*)data = RETRO_HW_CONTEXT_OPENGL_CORE;
+            return true;
+        }
+        case RETRO_ENVIRONMENT_GET_CURRENT_SOFTWARE_FRAMEBUFFER: {
+            if (!data) return false;
+            // The framebuffer belongs to the real core; a second instance
+            // renders into its own
+            if (frontend->runahead_secondary) return false;
+            return libretro_video_get_software_framebuffer(frontend, (struct retro_framebuffer*)data);
+        }
+        case RETRO_ENVIRONMENT_GET_INPUT_BITMASKS: {
+            // retro_input_state_callback answers RETRO_DEVICE_ID_JOYPAD_MASK
+            return true;
+        }
         case RETRO_ENVIRONMENT_GET_LOG_INTERFACE: {
             if (!data) return false;
             struct retro_log_callback* log_cb = (struct retro_log_callback*)data;
@@ -174,7 +271,6 @@ bool retro_environment_callback(unsigned cmd, void* data) {
         case 33: // RETRO_ENVIRONMENT_SET_DISK_CONTROL_EXT_INTERFACE
         case 34: // RETRO_ENVIRONMENT_GET_DISK_CONTROL_INTERFACE_VERSION
         case 35: // RETRO_ENVIRONMENT_SET_CORE_OPTIONS_UPDATE_DISPLAY_CALLBACK
-        case 36: // RETRO_ENVIRONMENT_GET_INPUT_BITMASKS
         case 38: { // RETRO_ENVIRONMENT_SET_SUPPORT_ACHIEVEMENTS
             return true;
         }
@@ -24,11 +24,5 @@
  */
 bool retro_environment_callback(unsigned cmd, void* data);
 
-/**
- * Set the frontend instance for callbacks
- * @param frontend Frontend instance (can be NULL)
- */
-void libretro_environment_set_frontend(libretro_frontend_t* frontend);
-
 #endif // LIBRETRO_ENVIRONMENT_H
 
@@ -0,0 +1,96 @@
+/*
+ * libretro_file.c - File Helpers Implementation
+ *
+ * Copyright (c) 2024 mikedx
+ * GitHub: https://github.com/mikedx/libretro_raylib
+ *
+ * This file is part of libretro_raylib.
+ *
+ * libretro_raylib is free software: you can redistribute it and/or modify
+ * it under the terms of the MIT License.
+ */
+
+#include "libretro_file.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+//=============================================================================
+// Public API
+//=============================================================================
+
+bool libretro_file_make_dirs(const char* dir) {
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s", dir);
+    for (char* p = path + 1; ; p++) {
+        if (*p == '/' || *p == '\0') {
+            char saved = *p;
+            *p = '\0';
+            if (mkdir(path, 0755) != 0 && errno != EEXIST) return false;
+            *p = saved;
+            if (saved == '\0') break;
+        }
+    }
+    return true;
+}
+
+bool libretro_file_make_parent_dirs(const char* path) {
+    char dir[PATH_MAX];
+    snprintf(dir, sizeof(dir), "%s", path);
+    char* last = strrchr(dir, '/');
+    if (!last || last == dir) return true;
+    *last = '\0';
+    return libretro_file_make_dirs(dir);
+}
+
+bool libretro_file_cache_dir(const char* name, char* dir, size_t size) {
+    const char* xdg = getenv("XDG_CACHE_HOME");
+    const char* home = getenv("HOME");
+    int len;
+    if (xdg && xdg[0]) {
+        len = snprintf(dir, size, "%s/libretro_raylib/%s", xdg, name);
+    } else if (home && home[0]) {
+        len = snprintf(dir, size, "%s/.cache/libretro_raylib/%s", home, name);
+    } else {
+        return false;
+    }
+    return len > 0 && (size_t)len < size;
+}
+
+uint64_t libretro_file_hash(uint64_t hash, const void* data, size_t size) {
+    const uint8_t* bytes = (const uint8_t*)data;
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ bytes[i]) * 1099511628211ull;
+    }
+    return hash;
+}
+
+bool libretro_file_begin_write(libretro_file_write_t* writer, const char* path) {
+    writer->path = path;
+    snprintf(writer->temp, sizeof(writer->temp), "%s.XXXXXX", path);
+    writer->fd = mkstemp(writer->temp);
+    if (writer->fd < 0) return false;
+    fchmod(writer->fd, 0644);    // mkstemp creates it 0600
+    return true;
+}
+
+bool libretro_file_end_write(libretro_file_write_t* writer, bool ok) {
+    if (writer->fd < 0) return false;
+    writer->fd = -1;
+    if (ok && rename(writer->temp, writer->path) != 0) ok = false;
+    if (!ok) remove(writer->temp);
+    return ok;
+}
+
+bool libretro_file_write(const char* path, const void* data, size_t size) {
+    libretro_file_write_t writer;
+    if (!libretro_file_begin_write(&writer, path)) return false;
+    FILE* file = fdopen(writer.fd, "wb");
+    if (!file) close(writer.fd);
+    bool ok = file && fwrite(data, 1, size, file) == size;
+    if (file && fclose(file) != 0) ok = false;
+    return libretro_file_end_write(&writer, ok);
+}
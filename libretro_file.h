@@ -0,0 +1,108 @@
+/*
+ * libretro_file.h - File Helpers
+ *
+ * Copyright (c) 2024 mikedx
+ * GitHub: https://github.com/mikedx/libretro_raylib
+ *
+ * This file is part of libretro_raylib.
+ *
+ * libretro_raylib is free software: you can redistribute it and/or modify
+ * it under the terms of the MIT License.
+ *
+ * What the content cache, core metadata cache, save slots and options file
+ * all need to keep files on disk: directory creation, the cache directory,
+ * a key hash for cache entries and atomic writes.
+ *
+ * A write goes to a temporary file named uniquely per writer (mkstemp) next
+ * to the target and is renamed over it once complete, so neither a crash
+ * nor an instance or process writing the same file can leave it truncated
+ * or mixed.
+ */
+
+#ifndef LIBRETRO_FILE_H
+#define LIBRETRO_FILE_H
+
+#include <limits.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+//=============================================================================
+// File Structures
+//=============================================================================
+
+// Start value for libretro_file_hash
+#define LIBRETRO_FILE_HASH_INIT 1469598103934665603ull
+
+/**
+ * Atomic write in progress
+ */
+typedef struct {
+    const char* path;           // File replaced on success
+    char temp[PATH_MAX + 8];    // <path>.XXXXXX
+    int fd;                     // Open on the temporary file (-1 = none)
+} libretro_file_write_t;
+
+//=============================================================================
+// Public API Functions
+//=============================================================================
+
+/**
+ * Create a directory and its parents (mkdir -p)
+ * @param dir Directory
+ * @return false if one couldn't be created
+ */
+bool libretro_file_make_dirs(const char* dir);
+
+/**
+ * Create the directory holding a file, and its parents
+ * @param path File
+ * @return false if one couldn't be created
+ */
+bool libretro_file_make_parent_dirs(const char* path);
+
+/**
+ * Resolve a cache subdirectory: $XDG_CACHE_HOME/libretro_raylib/<name>,
+ * or ~/.cache/libretro_raylib/<name> (not created)
+ * @param name Subdirectory
+ * @param dir Output path
+ * @param size Size of dir
+ * @return false if there is neither variable or the path doesn't fit
+ */
+bool libretro_file_cache_dir(const char* name, char* dir, size_t size);
+
+/**
+ * FNV-1a over a buffer, continuing a hash
+ * @param hash LIBRETRO_FILE_HASH_INIT, or the hash so far
+ * @return Updated hash
+ */
+uint64_t libretro_file_hash(uint64_t hash, const void* data, size_t size);
+
+/**
+ * Open a temporary file to replace a file with (mode 0644)
+ * Write through writer->fd (fdopen/gzdopen take it over), then end the write.
+ * @param writer Write state
+ * @param path File to replace
+ * @return false if the temporary file couldn't be created
+ */
+bool libretro_file_begin_write(libretro_file_write_t* writer, const char* path);
+
+/**
+ * Finish a write: rename the temporary file over the target, or remove it
+ * The descriptor must be closed, or handed to a stream that was closed.
+ * @param writer Write state
+ * @param ok Everything was written and closed
+ * @return false if the write failed or the rename did
+ */
+bool libretro_file_end_write(libretro_file_write_t* writer, bool ok);
+
+/**
+ * Replace a file with a buffer
+ * @param path File
+ * @param data Contents
+ * @param size Size of data
+ * @return false if it couldn't be written
+ */
+bool libretro_file_write(const char* path, const void* data, size_t size);
+
+#endif // LIBRETRO_FILE_H
@@ -16,6 +16,10 @@
  * This file implements the frontend side of the libretro API.
  */
 
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE // dladdr
+#endif
+
 #include "libretro_frontend.h"
 #include "libretro.h"
 #include "libretro_environment.h"
@@ -23,19 +27,94 @@
 #include "libretro_audio.h"
 #include "libretro_input.h"
 #include "libretro_core.h"
+#include "libretro_convert.h"
+#include "libretro_runahead.h"
+#include "libretro_rewind.h"
+#include "libretro_movie.h"
+#include "libretro_save.h"
+#include "libretro_vfs.h"
 #include "libretro_environment.h"  // For retro_environment_callback
+#include <dlfcn.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#include <sys/resource.h>
+
+// Frontend the core callbacks on this thread dispatch to
+static __thread libretro_frontend_t* t_frontend = NULL;
+
+// Initialized frontends, for calls from threads nobody bound (cores' own
+// threads); process-wide services stop with the last one
+static pthread_mutex_t g_frontends_lock = PTHREAD_MUTEX_INITIALIZER;
+static libretro_frontend_t** g_frontends = NULL;
+static unsigned g_frontend_count = 0;
+static unsigned g_frontend_capacity = 0;
 
-// Global frontend instance for callbacks
-static libretro_frontend_t* g_frontend = NULL;
+static bool frontend_register(libretro_frontend_t* frontend) {
+    pthread_mutex_lock(&g_frontends_lock);
+    if (g_frontend_count == g_frontend_capacity) {
+        unsigned capacity = g_frontend_capacity ? g_frontend_capacity * 2 : 4;
+        libretro_frontend_t** grown = (libretro_frontend_t**)realloc(g_frontends, capacity * sizeof(*grown));
+        if (!grown) {
+            pthread_mutex_unlock(&g_frontends_lock);
+            return false;
+        }
+        g_frontends = grown;
+        g_frontend_capacity = capacity;
+    }
+    g_frontends[g_frontend_count++] = frontend;
+    pthread_mutex_unlock(&g_frontends_lock);
+    return true;
+}
+
+/**
+ * @return Frontends still registered
+ */
+static unsigned frontend_unregister(libretro_frontend_t* frontend) {
+    pthread_mutex_lock(&g_frontends_lock);
+    for (unsigned i = 0; i < g_frontend_count; i++) {
+        if (g_frontends[i] == frontend) {
+            g_frontends[i] = g_frontends[--g_frontend_count];
+            break;
+        }
+    }
+    unsigned remaining = g_frontend_count;
+    if (remaining == 0) {
+        free(g_frontends);
+        g_frontends = NULL;
+        g_frontend_capacity = 0;
+    }
+    pthread_mutex_unlock(&g_frontends_lock);
+    return remaining;
+}
+
+void libretro_frontend_bind_thread(libretro_frontend_t* frontend) {
+    t_frontend = frontend;
+}
+
+libretro_frontend_t* libretro_frontend_lookup(const void* caller) {
+    if (t_frontend) return t_frontend;
+    
+    // A thread the core started: find the image the call came from
+    Dl_info info;
+    const void* base = (caller && dladdr(caller, &info)) ? info.dli_fbase : NULL;
+    libretro_frontend_t* found = NULL;
+    pthread_mutex_lock(&g_frontends_lock);
+    for (unsigned i = 0; i < g_frontend_count && !found; i++) {
+        if (base && g_frontends[i]->core_base == base) found = g_frontends[i];
+    }
+    if (!found && g_frontend_count == 1) found = g_frontends[0];
+    pthread_mutex_unlock(&g_frontends_lock);
+    return found;
+}
 
 bool libretro_frontend_init(libretro_frontend_t* frontend) {
     if (!frontend) return false;
     
     memset(frontend, 0, sizeof(libretro_frontend_t));
+    if (!frontend_register(frontend)) return false;
     frontend->width = 320;
     frontend->height = 240;
     frontend->aspect_ratio = 4.0f / 3.0f;
@@ -44,24 +123,31 @@ bool libretro_frontend_init(libretro_frontend_t* frontend) {
     frontend->audio_buffer_size = 4096;
     frontend->audio_buffer = (float*)malloc(frontend->audio_buffer_size * sizeof(float) * 2);
     
-    // Initialize audio ring buffer
-    frontend->audio_ring_buffer_size = frontend->audio_sample_rate / 4;
-    frontend->audio_ring_buffer = (float*)calloc(frontend->audio_ring_buffer_size * 2, sizeof(float));
-    frontend->audio_ring_read_pos = 0;
-    frontend->audio_ring_write_pos = 0;
-    frontend->audio_ring_available = 0;
+    // Initialize audio output: resample to the device rate, ring sized by latency
+    frontend->audio_output_rate = LIBRETRO_AUDIO_DEFAULT_OUTPUT_RATE;
+    frontend->audio_latency_ms = LIBRETRO_AUDIO_DEFAULT_LATENCY_MS;
+    libretro_resampler_init(&frontend->resampler, frontend->audio_sample_rate, frontend->audio_output_rate);
+    libretro_frontend_set_audio_output(frontend, 0, 0);
     
     frontend->pixel_format = RETRO_PIXEL_FORMAT_XRGB8888;
     frontend->pixel_format_raw = RETRO_PIXEL_FORMAT_XRGB8888;
+    frontend->native_upload = true;
+    frontend->av_enable = LIBRETRO_AV_ENABLE_VIDEO | LIBRETRO_AV_ENABLE_AUDIO;
+    frontend->fastforward_skip = LIBRETRO_FASTFORWARD_DEFAULT_SKIP;
+    frontend->fastforward_speed = 1.0;
+    frontend->speed = 1.0;
+    libretro_options_init(&frontend->options);
     
     memset(frontend->keyboard_state, 0, sizeof(frontend->keyboard_state));
     
-    // Set global frontend for callbacks
-    g_frontend = frontend;
-    libretro_environment_set_frontend(frontend);
-    libretro_video_set_frontend(frontend);
-    libretro_audio_set_frontend(frontend);
-    libretro_input_set_frontend(frontend);
+    // Pick pixel converters for this CPU once, before the first frame arrives
+    libretro_convert_init();
+    
+    // Callbacks from this thread go to this frontend; threads that were
+    // never bound find it in the registry by its core image
+    libretro_frontend_bind_thread(frontend);
+    // The single-sample accumulator is carved from the session reservation
+    // once the core reports its timing (libretro_frontend_reserve_session)
     
     return true;
 }
@@ -69,9 +155,9 @@ bool libretro_frontend_init(libretro_frontend_t* frontend) {
 bool libretro_frontend_load_core(libretro_frontend_t* frontend, const char* core_path) {
     if (!frontend || !core_path) return false;
     
-    // Set frontend for callbacks before loading
-    g_frontend = frontend;
-    libretro_environment_set_frontend(frontend);
+    // The core calls the environment callback from inside dlopen'd code
+    // right away, on this thread
+    libretro_frontend_bind_thread(frontend);
     
     return libretro_core_load(frontend, core_path);
 }
@@ -86,6 +172,71 @@ bool libretro_frontend_load_rom(libretro_frontend_t* frontend, const char* rom_p
     return libretro_core_load_rom(frontend, rom_path);
 }
 
+void libretro_frontend_reserve_session(libretro_frontend_t* frontend) {
+    if (!frontend || frontend->session_reserved) return;
+    frontend->session_reserved = true;
+    
+    unsigned max_width = frontend->max_width > frontend->width ? frontend->max_width : frontend->width;
+    unsigned max_height = frontend->max_height > frontend->height ? frontend->max_height : frontend->height;
+    size_t pixels = (size_t)max_width * max_height;
+    
+    // Largest of each: a converted RGBA8888 frame, one hash per row, a
+    // software framebuffer at 4 bytes per pixel with cache-line pitch, and
+    // one frame of single-sample audio at the highest rate
+    size_t framebuffer = pixels * 4;
+    size_t hashes = (size_t)max_height * sizeof(uint64_t);
+    size_t sw_pitch = libretro_arena_aligned_size((size_t)max_width * 4);
+    size_t sw_framebuffer = frontend->native_upload ? sw_pitch * max_height : 0;
+    unsigned rate = frontend->audio_sample_rate > LIBRETRO_SESSION_MAX_SAMPLE_RATE
+                  ? frontend->audio_sample_rate : LIBRETRO_SESSION_MAX_SAMPLE_RATE;
+    size_t accum = libretro_audio_accum_frames(rate, frontend->fps) * 2 * sizeof(int16_t);
+    
+    size_t total = libretro_arena_aligned_size(framebuffer) + libretro_arena_aligned_size(hashes) +
+                   libretro_arena_aligned_size(sw_framebuffer) + libretro_arena_aligned_size(accum);
+    if (!libretro_arena_reserve(&frontend->arena, total)) return;
+    
+    if (framebuffer > 0) {
+        frontend->framebuffer = libretro_arena_grow(&frontend->arena, frontend->framebuffer,
+                                                    &frontend->framebuffer_size, framebuffer);
+        size_t capacity = frontend->row_hash_capacity * sizeof(uint64_t);
+        frontend->row_hashes = (uint64_t*)libretro_arena_grow(&frontend->arena, frontend->row_hashes,
+                                                              &capacity, hashes);
+        frontend->row_hash_capacity = capacity / sizeof(uint64_t);
+        frontend->row_hash_layout = 0;
+    }
+    if (sw_framebuffer > 0) {
+        frontend->sw_framebuffer = libretro_arena_grow(&frontend->arena, frontend->sw_framebuffer,
+                                                       &frontend->sw_framebuffer_capacity, sw_framebuffer);
+    }
+    if (accum > frontend->audio_sample_accum_frames * 2 * sizeof(int16_t)) {
+        libretro_audio_flush_buffer(frontend);
+        size_t capacity = frontend->audio_sample_accum_frames * 2 * sizeof(int16_t);
+        frontend->audio_sample_accum = (int16_t*)libretro_arena_grow(&frontend->arena, frontend->audio_sample_accum,
+                                                                     &capacity, accum);
+        frontend->audio_sample_accum_frames = capacity / (2 * sizeof(int16_t));
+    }
+}
+
+void libretro_frontend_print_memory(const libretro_frontend_t* frontend) {
+    if (!frontend) return;
+    const libretro_arena_t* arena = &frontend->arena;
+    
+    // ru_maxrss is in kilobytes on Linux and bytes on macOS
+    double rss_mb = 0.0;
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+#ifdef __APPLE__
+        rss_mb = usage.ru_maxrss / 1048576.0;
+#else
+        rss_mb = usage.ru_maxrss / 1024.0;
+#endif
+    }
+    fprintf(stderr, "Memory: session arena %.2f MB reserved in %u block(s), %.2f MB used, "
+            "%u regrowth(s) (%.2f MB abandoned); peak RSS %.1f MB\n",
+            arena->reserved / 1048576.0, arena->block_count, arena->used / 1048576.0,
+            arena->regrowths, arena->abandoned / 1048576.0, rss_mb);
+}
+
 void libretro_frontend_update_av_info(libretro_frontend_t* frontend) {
     if (!frontend || !frontend->core) return;
     libretro_core_update_av_info(frontend);
@@ -94,13 +245,34 @@ void libretro_frontend_update_av_info(libretro_frontend_t* frontend) {
 void libretro_frontend_run_frame(libretro_frontend_t* frontend) {
     if (!frontend || !frontend->core || !frontend->initialized) return;
     
-    // RetroArch polls input before retro_run
-    if (frontend->has_set_input_poll && g_frontend) {
-        retro_input_poll_callback();
+    if (frontend->rewind && libretro_rewind_run_frame(frontend->rewind)) return;
+    if (frontend->save) libretro_save_run_frame(frontend->save);
+    if (frontend->movie) libretro_movie_begin_frame(frontend->movie);
+    
+    if (frontend->runahead) {
+        libretro_runahead_run_frame(frontend->runahead);
+    } else {
+        libretro_frontend_run_core_frame(frontend);
     }
     
+    if (frontend->rewind) libretro_rewind_capture(frontend->rewind);
+}
+
+void libretro_frontend_run_core_frame(libretro_frontend_t* frontend) {
+    if (!frontend || !frontend->core || !frontend->initialized) return;
+    
+    // Input is polled when the core asks for it (retro_input_poll_callback),
+    // which is the latest point that still affects this frame
+    frontend->input_polled = false;
     if (frontend->core->retro_run) {
+        uint64_t run_start = frontend->perf ? libretro_perf_now_ns() : 0;
         frontend->core->retro_run();
+        if (frontend->perf) libretro_perf_add(frontend->perf, LIBRETRO_PERF_RUN, libretro_perf_now_ns() - run_start);
+    }
+    
+    // Cores that never call input_poll still get fresh input for the next frame
+    if (!frontend->input_polled) {
+        retro_input_poll_callback();
     }
     
     // For VICE and similar cores: Call SET_SYSTEM_AV_INFO after first frame
@@ -118,12 +290,61 @@ void libretro_frontend_run_frame(libretro_frontend_t* frontend) {
     }
     
     // Flush any accumulated single-sample audio after each frame
-    libretro_audio_flush_buffer();
+    libretro_audio_flush_buffer(frontend);
+}
+
+unsigned libretro_frontend_run_display_frame(libretro_frontend_t* frontend) {
+    if (!frontend) return 0;
+    
+    if (!__atomic_load_n(&frontend->fastforward, __ATOMIC_RELAXED)) {
+        frontend->fastforward_last_ns = 0;
+        frontend->fastforward_speed = 1.0;
+        libretro_frontend_run_frame(frontend);
+        return 1;
+    }
+    
+    // Measure how fast we are really going, so un-muted audio can be
+    // squeezed into real time instead of overflowing the ring
+    uint64_t now = libretro_perf_now_ns();
+    unsigned frames = frontend->fastforward_skip ? frontend->fastforward_skip : 1;
+    if (frontend->fastforward_last_ns && frontend->fps > 0.0) {
+        double elapsed = (double)(now - frontend->fastforward_last_ns) / 1e9;
+        double speed = (elapsed > 0.0) ? (frames / frontend->fps) / elapsed : frontend->fastforward_speed;
+        if (speed < 1.0) speed = 1.0;
+        frontend->fastforward_speed = 0.9 * frontend->fastforward_speed + 0.1 * speed;
+    }
+    frontend->fastforward_last_ns = now;
+    
+    unsigned muted = frontend->fastforward_mute ? LIBRETRO_AV_ENABLE_AUDIO : 0;
+    for (unsigned i = 0; i < frames; i++) {
+        frontend->av_suppress = muted | ((i + 1 < frames) ? LIBRETRO_AV_ENABLE_VIDEO : 0);
+        libretro_frontend_run_frame(frontend);
+    }
+    frontend->av_suppress = 0;
+    return frames;
+}
+
+bool libretro_frontend_set_fastforward(libretro_frontend_t* frontend, bool enable) {
+    if (!frontend || __atomic_load_n(&frontend->fastforward_locked, __ATOMIC_RELAXED)) return false;
+    __atomic_store_n(&frontend->fastforward, enable, __ATOMIC_RELAXED);
+    return true;
+}
+
+void libretro_frontend_set_speed(libretro_frontend_t* frontend, double speed) {
+    if (!frontend || speed <= 0.0) return;
+    __atomic_store(&frontend->speed, &speed, __ATOMIC_RELAXED);
+}
+
+unsigned libretro_frontend_av_enable(const libretro_frontend_t* frontend) {
+    return frontend->av_enable & ~frontend->av_suppress;
 }
 
 void libretro_frontend_reset(libretro_frontend_t* frontend) {
     if (!frontend || !frontend->core || !frontend->initialized) return;
     
+    // A movie being played owns resets; one being recorded logs them
+    if (frontend->movie && !libretro_movie_reset(frontend->movie)) return;
+    
     if (frontend->core->retro_reset) {
         frontend->core->retro_reset();
     }
@@ -134,54 +355,80 @@ void* libretro_frontend_get_framebuffer(libretro_frontend_t* frontend) {
     return frontend->framebuffer;
 }
 
+const void* libretro_frontend_get_native_frame(libretro_frontend_t* frontend, size_t* pitch) {
+    if (!frontend || !frontend->frame_is_native) return NULL;
+    if (pitch) *pitch = frontend->native_pitch;
+    return frontend->native_frame;
+}
+
+bool libretro_frontend_frame_dirty(libretro_frontend_t* frontend, unsigned* first_row, unsigned* end_row) {
+    if (!frontend || !frontend->frame_dirty) return false;
+    if (first_row) *first_row = frontend->dirty_row_begin;
+    if (end_row) *end_row = frontend->dirty_row_end;
+    return true;
+}
+
+void libretro_frontend_clear_frame_dirty(libretro_frontend_t* frontend) {
+    if (!frontend) return;
+    frontend->frame_dirty = false;
+    frontend->dirty_row_begin = 0;
+    frontend->dirty_row_end = 0;
+}
+
 void libretro_frontend_get_video_size(libretro_frontend_t* frontend, unsigned* width, unsigned* height) {
     if (!frontend || !width || !height) return;
     *width = frontend->width;
     *height = frontend->height;
 }
 
+// Input words are only written by the main thread; relaxed atomics keep the
+// loads in the (possibly threaded) input state callback whole
 void libretro_frontend_set_input(libretro_frontend_t* frontend, unsigned port, unsigned button, bool pressed) {
-    if (!frontend || port >= 16 || button >= 16) return;
-    frontend->input_state[port][button] = pressed;
+    if (!frontend || port >= LIBRETRO_INPUT_MAX_PORTS || button >= 16) return;
+    uint16_t mask = __atomic_load_n(&frontend->input_state[port], __ATOMIC_RELAXED);
+    mask = pressed ? (uint16_t)(mask | (1u << button)) : (uint16_t)(mask & ~(1u << button));
+    __atomic_store_n(&frontend->input_state[port], mask, __ATOMIC_RELAXED);
+}
+
+void libretro_frontend_set_joypad_mask(libretro_frontend_t* frontend, unsigned port, uint16_t mask) {
+    if (!frontend || port >= LIBRETRO_INPUT_MAX_PORTS) return;
+    __atomic_store_n(&frontend->input_state[port], mask, __ATOMIC_RELAXED);
 }
 
 void libretro_frontend_set_keyboard_key(libretro_frontend_t* frontend, unsigned keycode, bool pressed) {
     if (!frontend || keycode >= RETROK_LAST) return;
-    frontend->keyboard_state[keycode] = pressed;
+    uint32_t* word = &frontend->keyboard_state[keycode / 32];
+    uint32_t bit = 1u << (keycode % 32);
+    uint32_t value = __atomic_load_n(word, __ATOMIC_RELAXED);
+    __atomic_store_n(word, pressed ? (value | bit) : (value & ~bit), __ATOMIC_RELAXED);
 }
 
-size_t libretro_frontend_get_audio_samples(libretro_frontend_t* frontend, float* buffer, size_t max_frames) {
-    if (!frontend || !buffer || max_frames == 0) return 0;
-    
-    if (!frontend->audio_ring_buffer || frontend->audio_ring_buffer_size == 0) {
-        return 0;
-    }
+bool libretro_frontend_set_audio_output(libretro_frontend_t* frontend, unsigned output_rate, unsigned latency_ms) {
+    if (!frontend) return false;
     
-    size_t frames_to_read = (max_frames < frontend->audio_ring_available) ? max_frames : frontend->audio_ring_available;
+    if (output_rate > 0) frontend->audio_output_rate = output_rate;
+    if (latency_ms > 0) frontend->audio_latency_ms = latency_ms;
+    frontend->resampler.output_rate = frontend->audio_output_rate;
     
-    if (frames_to_read == 0) {
-        // Underrun - fill with silence
-        memset(buffer, 0, max_frames * 2 * sizeof(float));
-        return max_frames;
+    size_t frames = (size_t)frontend->audio_output_rate * frontend->audio_latency_ms / 1000;
+    libretro_audio_ring_free(&frontend->audio_ring);
+    if (!libretro_audio_ring_init(&frontend->audio_ring, frames)) {
+        fprintf(stderr, "Failed to allocate audio ring buffer\n");
+        return false;
     }
+    return true;
+}
+
+size_t libretro_frontend_get_audio_samples(libretro_frontend_t* frontend, float* buffer, size_t max_frames) {
+    if (!frontend || !buffer || max_frames == 0) return 0;
     
-    // Read from ring buffer
-    for (size_t i = 0; i < frames_to_read; i++) {
-        size_t read_idx = (frontend->audio_ring_read_pos + i) % frontend->audio_ring_buffer_size;
-        float* src = frontend->audio_ring_buffer + read_idx * 2;
-        
-        buffer[i * 2] = src[0];
-        buffer[i * 2 + 1] = src[1];
-    }
+    size_t frames_read = libretro_audio_ring_read(&frontend->audio_ring, buffer, max_frames);
     
-    // Fill remaining with silence if we read less than requested
-    if (frames_to_read < max_frames) {
-        memset(buffer + frames_to_read * 2, 0, (max_frames - frames_to_read) * 2 * sizeof(float));
+    // Fill remaining with silence if we read less than requested (underrun)
+    if (frames_read < max_frames) {
+        memset(buffer + frames_read * 2, 0, (max_frames - frames_read) * 2 * sizeof(float));
     }
     
-    frontend->audio_ring_read_pos = (frontend->audio_ring_read_pos + frames_to_read) % frontend->audio_ring_buffer_size;
-    frontend->audio_ring_available -= frames_to_read;
-    
     return max_frames; // Always return requested frames (filled with silence if needed)
 }
 
@@ -190,33 +437,27 @@ void libretro_frontend_deinit(libretro_frontend_t* frontend) {
     
     // Unload core
     libretro_core_unload(frontend);
-    
-    // Free allocated memory
-    // Safety: Only free if framebuffer_size > 0 (indicates it was allocated)
-    if (frontend->framebuffer && frontend->framebuffer_size > 0) {
-        free(frontend->framebuffer);
-        frontend->framebuffer = NULL;
-        frontend->framebuffer_size = 0;
+    if (frontend_unregister(frontend) == 0) {
+        libretro_vfs_shutdown();
     }
+    libretro_options_save(&frontend->options);
+    libretro_options_free(&frontend->options);
+    
+    // Free allocated memory; the framebuffers, row hashes and audio
+    // accumulator all live in the session arena
+    libretro_arena_free(&frontend->arena);
     
     if (frontend->audio_buffer) {
         free(frontend->audio_buffer);
         frontend->audio_buffer = NULL;
     }
     
-    if (frontend->audio_ring_buffer) {
-        free(frontend->audio_ring_buffer);
-        frontend->audio_ring_buffer = NULL;
-    }
+    libretro_audio_ring_free(&frontend->audio_ring);
     
     memset(frontend, 0, sizeof(libretro_frontend_t));
     
-    // Clear global frontend
-    if (g_frontend == frontend) {
-        g_frontend = NULL;
-        libretro_environment_set_frontend(NULL);
-        libretro_video_set_frontend(NULL);
-        libretro_audio_set_frontend(NULL);
-        libretro_input_set_frontend(NULL);
+    // Stop dispatching to it
+    if (t_frontend == frontend) {
+        t_frontend = NULL;
     }
 }
@@ -19,6 +19,12 @@
 
 #include "libretro.h"
 #include "libretro_core_types.h"
+#include "libretro_audio_ring.h"
+#include "libretro_resampler.h"
+#include "libretro_perf.h"
+#include "libretro_options.h"
+#include "libretro_hw.h"
+#include "libretro_arena.h"
 #include <stdbool.h>
 #include <stdint.h>
 #include <stddef.h>
@@ -27,25 +33,120 @@
 // Frontend Structure
 //=============================================================================
 
+struct libretro_pipeline;
+struct libretro_runahead;
+struct libretro_rewind;
+struct libretro_movie;
+struct libretro_save;
+struct libretro_capture;
+struct libretro_content;
+
+#define LIBRETRO_INPUT_MAX_PORTS 16
+#define LIBRETRO_KEYBOARD_WORDS ((RETROK_LAST + 31) / 32)
+
+// RETRO_ENVIRONMENT_GET_AUDIO_VIDEO_ENABLE bits (documented in libretro.h,
+// which gives them no names)
+#define LIBRETRO_AV_ENABLE_VIDEO                0x1
+#define LIBRETRO_AV_ENABLE_AUDIO                0x2
+#define LIBRETRO_AV_ENABLE_FAST_SAVESTATES      0x4     // Savestate stays in this process
+#define LIBRETRO_AV_ENABLE_HARD_DISABLE_AUDIO   0x8     // Core may skip audio emulation
+
+// Frames run per presented frame while fast-forwarding
+#define LIBRETRO_FASTFORWARD_DEFAULT_SKIP 4
+
+// Largest core sample rate the session's audio buffers are reserved for
+#define LIBRETRO_SESSION_MAX_SAMPLE_RATE 192000
+
 /**
  * Main frontend structure containing all state for libretro core management
  */
 typedef struct {
     void* core_handle;
+    const void* core_base;   // Load address of the core image (routes calls from its own threads)
     struct retro_core_t* core;
+    bool core_private_copy;  // Load a private copy of the core file (set before load_core)
+    void* core_image;        // Already open image to load instead (kept open on unload; set before load_core)
     
     // Video
     unsigned width;          // Display width (from AV info base_width)
     unsigned height;         // Display height (from AV info base_height)
+    unsigned max_width;      // AV info max_width (sizes the HW render FBO)
+    unsigned max_height;
     float aspect_ratio;
-    void* framebuffer;
-    size_t framebuffer_size;
+    void* framebuffer;          // Converted RGBA8888 frame (session arena)
+    size_t framebuffer_size;    // Capacity in bytes
     unsigned pixel_format; // RETRO_PIXEL_FORMAT_*
     unsigned pixel_format_raw; // Original format value (for format 12 detection)
     
     // Frame cache dimensions (from video callback)
     unsigned frame_width;   // Actual frame buffer width from callback
     unsigned frame_height;  // Actual frame buffer height from callback
+    unsigned video_calls;       // Frames received by the video callback
+    bool video_logged_format;   // First frame's format/pitch was logged
+    bool video_warned_black;    // All-black output was reported
+    
+    // Native (zero-copy) upload: GPU-friendly frames skip conversion
+    bool native_upload;         // Allow passing XRGB8888/RGB565 frames through unconverted
+    bool frame_is_native;       // Last frame is in native_frame rather than framebuffer
+    const void* native_frame;   // Core-owned frame data (valid until the next retro_run)
+    size_t native_pitch;        // Pitch of native_frame in bytes
+    
+    // Frame change tracking (dirty rows accumulate until the renderer uploads)
+    bool frame_dirty;           // A changed frame is waiting to be uploaded
+    unsigned dirty_row_begin;   // First changed row
+    unsigned dirty_row_end;     // One past the last changed row
+    bool video_row_hash;        // Hash source rows to skip unchanged ones
+    uint64_t* row_hashes;       // Per-row hashes of the previous frame (session arena)
+    size_t row_hash_capacity;   // Number of rows row_hashes can hold
+    uint64_t row_hash_layout;   // Geometry/format the stored hashes belong to (0 = invalid)
+    
+    // Frontend-owned software framebuffer (GET_CURRENT_SOFTWARE_FRAMEBUFFER)
+    void* sw_framebuffer;           // Cache-line aligned (session arena), cores render straight into it
+    size_t sw_framebuffer_capacity; // Allocated size in bytes
+    
+    // Threaded mode: when set, the video callback hands raw frames to the
+    // pipeline's triple buffer instead of converting them (see libretro_pipeline.h)
+    struct libretro_pipeline* pipeline;
+    
+    // Run-ahead: when set, run_frame runs speculative frames around a
+    // savestate (see libretro_runahead.h)
+    struct libretro_runahead* runahead;
+    bool runahead_secondary;    // Its second instance is running: its AV info, geometry and framebuffer requests are ignored
+    unsigned av_enable;         // LIBRETRO_AV_ENABLE_* reported to the core
+    unsigned av_suppress;       // Bits forced off on top (skipped fast-forward frames)
+    
+    // Rewind: when set, run_frame captures a delta after each frame and steps
+    // back instead of running while rewinding (see libretro_rewind.h)
+    struct libretro_rewind* rewind;
+    
+    // Movie: when set, run_frame latches each frame's joypads through it so
+    // they can be recorded or replayed (see libretro_movie.h)
+    struct libretro_movie* movie;
+    
+    // Saves: when set, run_frame lets it take requested savestates, apply
+    // loaded ones and check SRAM before each frame (see libretro_save.h)
+    struct libretro_save* save;
+    
+    // Capture: when set, shown frames and output audio are teed to its
+    // encoder thread (see libretro_capture.h)
+    struct libretro_capture* capture;
+    
+    // Fast-forward: run unthrottled, converting and presenting one frame in
+    // fastforward_skip (see libretro_frontend_run_display_frame)
+    bool fastforward;               // Active: user toggle or core override (atomic)
+    bool fastforward_locked;        // Core override set inhibit_toggle
+    float fastforward_ratio;        // Speed cap from the core's override (< 1 = unlimited)
+    unsigned fastforward_skip;      // Frames run per presented frame
+    bool fastforward_mute;          // Mute audio instead of speeding it up
+    double fastforward_speed;       // Measured speed (1 = realtime); scales the resampler
+    uint64_t fastforward_last_ns;   // When the previous display frame started
+    
+    // Game speed chosen by frame pacing to match the display (1 = the core's
+    // rate; atomic); audio is resampled by the same factor (see libretro_pacing.h)
+    double speed;
+    
+    // Optional timing recorder; stages are only timed while this is set
+    libretro_perf_t* perf;
     
     // Audio
     float* audio_buffer;
@@ -53,16 +154,45 @@ typedef struct {
     unsigned audio_sample_rate;
     double fps;  // Core's reported FPS
     
-    // Audio ring buffer for streaming
-    float* audio_ring_buffer;
-    size_t audio_ring_buffer_size;  // Total capacity in frames
-    size_t audio_ring_read_pos;     // Read position (frames)
-    size_t audio_ring_write_pos;    // Write position (frames)
-    size_t audio_ring_available;     // Available frames to read
+    // Audio output: the core's audio is resampled to the device rate with
+    // dynamic rate control, so the ring is sized from the output rate and
+    // latency and never needs reallocating when the core changes rate
+    unsigned audio_output_rate;     // Device sample rate (Hz)
+    unsigned audio_latency_ms;      // Ring buffer size target
+    libretro_resampler_t resampler;
+    size_t audio_dropped_frames;    // Output frames lost to a full ring
+    
+    // Checksum of the core's own samples as heard (batch runs and regression
+    // checks), independent of the output rate and rate control
+    bool audio_checksum_enabled;
+    uint64_t audio_checksum;        // FNV-1a over the int16_t samples
+    
+    // Audio ring buffer for streaming: lock-free SPSC, written from the
+    // emulation thread and drained from the audio device thread
+    libretro_audio_ring_t audio_ring;
+    
+    // Buffers that live as long as the content, sized up front from the max
+    // geometry and LIBRETRO_SESSION_MAX_SAMPLE_RATE (see libretro_arena.h)
+    libretro_arena_t arena;
+    bool session_reserved;
+    
+    // Accumulator for cores using the single-sample callback; sized to hold
+    // one retro_run worth of frames so it is normally flushed once per frame
+    int16_t* audio_sample_accum;        // Interleaved stereo (session arena)
+    size_t audio_sample_accum_frames;   // Capacity in frames
+    size_t audio_sample_accum_count;    // Frames pending
     
-    // Input
-    bool input_state[16][16]; // [port][button]
-    bool keyboard_state[RETROK_LAST]; // Keyboard key states (RETROK_LAST defined in libretro.h)
+    // Input, packed so a whole joypad is one load (RETRO_DEVICE_ID_JOYPAD_MASK)
+    // Written by the main thread, read by whichever thread runs the core
+    uint16_t input_state[LIBRETRO_INPUT_MAX_PORTS];         // [port] bit per RETRO_DEVICE_ID_JOYPAD_*
+    uint32_t keyboard_state[LIBRETRO_KEYBOARD_WORDS];       // Bit per RETROK_* key
+    const uint16_t* input_latch;    // When set, joypads are read from here instead (movies)
+    
+    // Late polling: when set, called from retro_input_poll_callback so input
+    // is sampled inside retro_run, as late as the core allows
+    void (*input_poll_handler)(void* userdata);
+    void* input_poll_userdata;
+    bool input_polled;          // The core called input_poll during this retro_run
     
     // Core state
     bool initialized;
@@ -74,12 +204,22 @@ typedef struct {
     bool has_set_input_state;
     bool av_info_sent_after_first_frame; // Track if SET_SYSTEM_AV_INFO was sent after first frame
     
+    // Hardware rendering (SET_HW_RENDER)
+    libretro_hw_t hw;
+    
+    // Core options (GET_VARIABLE and friends)
+    libretro_options_t options;
+    
     // System info (from retro_get_system_info)
     bool need_fullpath;
+    const char* valid_extensions;   // "ext1|ext2", owned by the core
+    bool core_uses_vfs;             // Took the VFS interface (GET_VFS_INTERFACE)
     
     // ROM data (must remain valid until retro_unload_game is called)
     void* rom_data;
     size_t rom_data_size;
+    bool rom_data_mapped;   // rom_data is an mmap of the file, not a heap copy
+    struct libretro_content* content; // Set when the ROM came out of an archive
     char* rom_path;  // Path string (must remain valid until retro_unload_game is called)
 } libretro_frontend_t;
 
@@ -89,11 +229,37 @@ typedef struct {
 
 /**
  * Initialize the libretro frontend
+ * Also binds it to the calling thread (libretro_frontend_bind_thread)
  * @param frontend Pointer to frontend structure to initialize
  * @return true on success, false on failure
  */
 bool libretro_frontend_init(libretro_frontend_t* frontend);
 
+/**
+ * Make a frontend the one core callbacks on the calling thread dispatch to
+ * Libretro callbacks carry no context pointer, so the callback modules look
+ * the instance up per call: the thread's binding, or else, for threads the
+ * core starts itself, the frontend whose core image the call came from
+ * (instances load private copies, so every core has its own image). Call on
+ * every thread that runs a core.
+ * @param frontend Frontend instance (NULL unbinds)
+ */
+void libretro_frontend_bind_thread(libretro_frontend_t* frontend);
+
+/**
+ * Frontend a core callback belongs to
+ * @param caller Return address of the callback (inside the calling core)
+ * @return Bound frontend, the one whose core image contains caller, the
+ *         only live frontend, or NULL
+ */
+libretro_frontend_t* libretro_frontend_lookup(const void* caller);
+
+/**
+ * Frontend the calling core callback belongs to
+ * Only valid directly in a function the core calls through a pointer.
+ */
+#define libretro_frontend_current() libretro_frontend_lookup(__builtin_return_address(0))
+
 /**
  * Load a libretro core from a dynamic library file
  * @param frontend Pointer to initialized frontend structure
@@ -124,14 +290,68 @@ bool libretro_frontend_load_rom(libretro_frontend_t* frontend, const char* rom_p
  */
 void libretro_frontend_update_av_info(libretro_frontend_t* frontend);
 
+/**
+ * Carve the session's buffers out of the arena at their largest sizes, so
+ * geometry and rate changes don't reallocate (called once AV info is known)
+ * @param frontend Pointer to frontend structure
+ */
+void libretro_frontend_reserve_session(libretro_frontend_t* frontend);
+
+/**
+ * Print the session's memory: arena reserved/used, regrowths and peak RSS
+ * @param frontend Pointer to frontend structure
+ */
+void libretro_frontend_print_memory(const libretro_frontend_t* frontend);
+
 /**
  * Run one frame of the core
+ * With run-ahead attached this runs the real frame plus the hidden ones;
+ * with rewind attached it captures the state afterwards, or steps back
+ * instead while rewinding; with a movie attached the frame's joypads are
+ * latched (recorded or replayed) first
  * @param frontend Pointer to frontend structure
  */
 void libretro_frontend_run_frame(libretro_frontend_t* frontend);
 
 /**
- * Reset the core
+ * Run the frames behind one presented frame: one normally, or while
+ * fast-forwarding fastforward_skip frames with video only for the last
+ * @param frontend Pointer to frontend structure
+ * @return Number of core frames run
+ */
+unsigned libretro_frontend_run_display_frame(libretro_frontend_t* frontend);
+
+/**
+ * Start or stop fast-forward at the user's request
+ * @param frontend Pointer to frontend structure
+ * @param enable true to fast-forward
+ * @return false if the core's override currently controls fast-forward
+ */
+bool libretro_frontend_set_fastforward(libretro_frontend_t* frontend, bool enable);
+
+/**
+ * Set the game speed frame pacing runs at, so audio stays in step
+ * @param frontend Pointer to frontend structure
+ * @param speed 1 = the core's rate (safe from any thread)
+ */
+void libretro_frontend_set_speed(libretro_frontend_t* frontend, double speed);
+
+/**
+ * Audio/video output currently enabled for the core
+ * @param frontend Pointer to frontend structure
+ * @return LIBRETRO_AV_ENABLE_* bits (av_enable without av_suppress)
+ */
+unsigned libretro_frontend_av_enable(const libretro_frontend_t* frontend);
+
+/**
+ * Run exactly one retro_run (no run-ahead)
+ * Output is gated by frontend->av_enable
+ * @param frontend Pointer to frontend structure
+ */
+void libretro_frontend_run_core_frame(libretro_frontend_t* frontend);
+
+/**
+ * Reset the core (ignored while a movie plays: it replays its own resets)
  * @param frontend Pointer to frontend structure
  */
 void libretro_frontend_reset(libretro_frontend_t* frontend);
@@ -143,6 +363,33 @@ void libretro_frontend_reset(libretro_frontend_t* frontend);
  */
 void* libretro_frontend_get_framebuffer(libretro_frontend_t* frontend);
 
+/**
+ * Get the last frame in the core's own pixel format, if it was passed through
+ * without conversion (native upload mode, XRGB8888 or RGB565 only)
+ * @param frontend Pointer to frontend structure
+ * @param pitch Output parameter for the row pitch in bytes (can be NULL)
+ * @return Pointer to the core's frame data, or NULL if the last frame was
+ *         converted into the RGBA8888 framebuffer instead
+ */
+const void* libretro_frontend_get_native_frame(libretro_frontend_t* frontend, size_t* pitch);
+
+/**
+ * Check whether a changed frame is waiting to be uploaded
+ * Duplicate frames (NULL data) and, with row hashing enabled, byte-identical
+ * frames leave the flag clear so conversion and upload can be skipped
+ * @param frontend Pointer to frontend structure
+ * @param first_row Output: first changed row (can be NULL)
+ * @param end_row Output: one past the last changed row (can be NULL)
+ * @return true if there is something to upload
+ */
+bool libretro_frontend_frame_dirty(libretro_frontend_t* frontend, unsigned* first_row, unsigned* end_row);
+
+/**
+ * Mark the current frame as uploaded
+ * @param frontend Pointer to frontend structure
+ */
+void libretro_frontend_clear_frame_dirty(libretro_frontend_t* frontend);
+
 /**
  * Get the current video dimensions
  * @param frontend Pointer to frontend structure
@@ -160,6 +407,14 @@ void libretro_frontend_get_video_size(libretro_frontend_t* frontend, unsigned* w
  */
 void libretro_frontend_set_input(libretro_frontend_t* frontend, unsigned port, unsigned button, bool pressed);
 
+/**
+ * Set all joypad buttons of a port at once
+ * @param frontend Pointer to frontend structure
+ * @param port Controller port (0-15)
+ * @param mask Bit per RETRO_DEVICE_ID_JOYPAD_* button
+ */
+void libretro_frontend_set_joypad_mask(libretro_frontend_t* frontend, unsigned port, uint16_t mask);
+
 /**
  * Set keyboard key state
  * @param frontend Pointer to frontend structure
@@ -168,8 +423,19 @@ void libretro_frontend_set_input(libretro_frontend_t* frontend, unsigned port, u
  */
 void libretro_frontend_set_keyboard_key(libretro_frontend_t* frontend, unsigned keycode, bool pressed);
 
+/**
+ * Configure the audio output (device rate and latency)
+ * Must be called before the audio thread starts consuming
+ * @param frontend Pointer to frontend structure
+ * @param output_rate Device sample rate in Hz (0 = keep current)
+ * @param latency_ms Ring buffer size in milliseconds (0 = keep current)
+ * @return true on success, false on allocation failure
+ */
+bool libretro_frontend_set_audio_output(libretro_frontend_t* frontend, unsigned output_rate, unsigned latency_ms);
+
 /**
  * Get audio samples from the ring buffer for playback
+ * Lock-free; safe to call from the audio device thread
  * @param frontend Pointer to frontend structure
  * @param buffer Output buffer for audio samples (interleaved stereo float)
  * @param max_frames Maximum number of frames to read
@@ -0,0 +1,249 @@
+/*
+ * libretro_hw.c - Hardware (OpenGL) Rendering Implementation
+ *
+ * Copyright (c) 2024 mikedx
+ * GitHub: https://github.com/mikedx/libretro_raylib
+ *
+ * This file is part of libretro_raylib.
+ *
+ * libretro_raylib is free software: you can redistribute it and/or modify
+ * it under the terms of the MIT License.
+ */
+
+#include "libretro_hw.h"
+#include "libretro_frontend.h"
+#include <dlfcn.h>
+#include <stdio.h>
+#include <string.h>
+
+// raylib's desktop context: OpenGL 3.3 core profile, which runs code
+// written for core 3.1 and up (3.0 and earlier still had the fixed pipeline)
+#define HW_GL_MIN_VERSION 31
+#define HW_GL_MAX_VERSION 33
+
+// The few GL enums used here
+#define GL_TEXTURE_2D                   0x0DE1
+#define GL_UNSIGNED_BYTE                0x1401
+#define GL_RGBA                         0x1908
+#define GL_RGBA8                        0x8058
+#define GL_NEAREST                      0x2600
+#define GL_TEXTURE_MAG_FILTER           0x2800
+#define GL_TEXTURE_MIN_FILTER           0x2801
+#define GL_TEXTURE_WRAP_S               0x2802
+#define GL_TEXTURE_WRAP_T               0x2803
+#define GL_CLAMP_TO_EDGE                0x812F
+#define GL_DEPTH_COMPONENT24            0x81A6
+#define GL_DEPTH_STENCIL_ATTACHMENT     0x821A
+#define GL_DEPTH24_STENCIL8             0x88F0
+#define GL_FRAMEBUFFER_COMPLETE         0x8CD5
+#define GL_COLOR_ATTACHMENT0            0x8CE0
+#define GL_DEPTH_ATTACHMENT             0x8D00
+#define GL_FRAMEBUFFER                  0x8D40
+#define GL_RENDERBUFFER                 0x8D41
+#define GL_COLOR_BUFFER_BIT             0x4000
+
+/**
+ * GL entry points, resolved once the context exists
+ */
+typedef struct {
+    void (*GenTextures)(int n, unsigned* textures);
+    void (*DeleteTextures)(int n, const unsigned* textures);
+    void (*BindTexture)(unsigned target, unsigned texture);
+    void (*TexImage2D)(unsigned target, int level, int internal_format, int width, int height,
+                       int border, unsigned format, unsigned type, const void* pixels);
+    void (*TexParameteri)(unsigned target, unsigned name, int param);
+    void (*GenFramebuffers)(int n, unsigned* framebuffers);
+    void (*DeleteFramebuffers)(int n, const unsigned* framebuffers);
+    void (*BindFramebuffer)(unsigned target, unsigned framebuffer);
+    void (*FramebufferTexture2D)(unsigned target, unsigned attachment, unsigned textarget,
+                                 unsigned texture, int level);
+    unsigned (*CheckFramebufferStatus)(unsigned target);
+    void (*GenRenderbuffers)(int n, unsigned* renderbuffers);
+    void (*DeleteRenderbuffers)(int n, const unsigned* renderbuffers);
+    void (*BindRenderbuffer)(unsigned target, unsigned renderbuffer);
+    void (*RenderbufferStorage)(unsigned target, unsigned format, int width, int height);
+    void (*FramebufferRenderbuffer)(unsigned target, unsigned attachment, unsigned renderbuffer_target,
+                                    unsigned renderbuffer);
+    void (*ClearColor)(float r, float g, float b, float a);
+    void (*Clear)(unsigned mask);
+} hw_gl_t;
+
+static hw_gl_t g_gl;
+static bool g_gl_loaded = false;
+
+/**
+ * Resolve a GL symbol from the process (raylib links the GL library)
+ */
+static retro_proc_address_t RETRO_CALLCONV hw_get_proc_address(const char* symbol) {
+    if (!symbol) return NULL;
+    return (retro_proc_address_t)dlsym(RTLD_DEFAULT, symbol);
+}
+
+/**
+ * The calling core's FBO: the callback carries no user pointer, so the
+ * frontend is found the way every other callback finds it
+ */
+static uintptr_t RETRO_CALLCONV hw_get_current_framebuffer(void) {
+    libretro_frontend_t* frontend = libretro_frontend_current();
+    return frontend ? (uintptr_t)frontend->hw.fbo : 0;
+}
+
+static bool hw_load_gl(void) {
+    if (g_gl_loaded) return true;
+
+#define HW_GL_LOAD(name) \
+    if (!(*(void**)&g_gl.name = dlsym(RTLD_DEFAULT, "gl" #name))) { \
+        fprintf(stderr, "HW render: missing gl" #name "\n"); \
+        return false; \
+    }
+    HW_GL_LOAD(GenTextures)
+    HW_GL_LOAD(DeleteTextures)
+    HW_GL_LOAD(BindTexture)
+    HW_GL_LOAD(TexImage2D)
+    HW_GL_LOAD(TexParameteri)
+    HW_GL_LOAD(GenFramebuffers)
+    HW_GL_LOAD(DeleteFramebuffers)
+    HW_GL_LOAD(BindFramebuffer)
+    HW_GL_LOAD(FramebufferTexture2D)
+    HW_GL_LOAD(CheckFramebufferStatus)
+    HW_GL_LOAD(GenRenderbuffers)
+    HW_GL_LOAD(DeleteRenderbuffers)
+    HW_GL_LOAD(BindRenderbuffer)
+    HW_GL_LOAD(RenderbufferStorage)
+    HW_GL_LOAD(FramebufferRenderbuffer)
+    HW_GL_LOAD(ClearColor)
+    HW_GL_LOAD(Clear)
+#undef HW_GL_LOAD
+
+    g_gl_loaded = true;
+    return true;
+}
+
+/**
+ * (Re)allocate the FBO attachments at the given size
+ */
+static bool hw_allocate(libretro_hw_t* hw, unsigned width, unsigned height) {
+    if (!hw->fbo) g_gl.GenFramebuffers(1, &hw->fbo);
+    if (!hw->color_texture) g_gl.GenTextures(1, &hw->color_texture);
+
+    g_gl.BindTexture(GL_TEXTURE_2D, hw->color_texture);
+    g_gl.TexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, (int)width, (int)height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    g_gl.TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    g_gl.TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    g_gl.TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    g_gl.TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    g_gl.BindTexture(GL_TEXTURE_2D, 0);
+
+    g_gl.BindFramebuffer(GL_FRAMEBUFFER, hw->fbo);
+    g_gl.FramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, hw->color_texture, 0);
+
+    // Depth and stencil together must be one packed 24/8 buffer
+    if (hw->callback.depth || hw->callback.stencil) {
+        if (!hw->depth_renderbuffer) g_gl.GenRenderbuffers(1, &hw->depth_renderbuffer);
+        bool packed = hw->callback.stencil;
+        g_gl.BindRenderbuffer(GL_RENDERBUFFER, hw->depth_renderbuffer);
+        g_gl.RenderbufferStorage(GL_RENDERBUFFER, packed ? GL_DEPTH24_STENCIL8 : GL_DEPTH_COMPONENT24,
+                                 (int)width, (int)height);
+        g_gl.BindRenderbuffer(GL_RENDERBUFFER, 0);
+        g_gl.FramebufferRenderbuffer(GL_FRAMEBUFFER, packed ? GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT,
+                                     GL_RENDERBUFFER, hw->depth_renderbuffer);
+    }
+
+    bool complete = g_gl.CheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    if (complete) {
+        g_gl.ClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+        g_gl.Clear(GL_COLOR_BUFFER_BIT);
+    }
+    g_gl.BindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    if (!complete) {
+        fprintf(stderr, "HW render: %ux%u framebuffer is incomplete\n", width, height);
+        return false;
+    }
+    hw->width = width;
+    hw->height = height;
+    return true;
+}
+
+bool libretro_hw_set_render(libretro_hw_t* hw, struct retro_hw_render_callback* callback) {
+    if (!hw || !callback) return false;
+    if (!hw->available) {
+        fprintf(stderr, "HW render: no GL context in headless mode\n");
+        return false;
+    }
+
+    // Everything runs in raylib's context, so only what it can stand in for
+    // is accepted; cores then try their next preferred context type
+    unsigned version = callback->version_major * 10 + callback->version_minor;
+    switch (callback->context_type) {
+        case RETRO_HW_CONTEXT_OPENGL_CORE:
+            if (version < HW_GL_MIN_VERSION || version > HW_GL_MAX_VERSION) {
+                fprintf(stderr, "HW render: OpenGL %u.%u core requested, only 3.1 to 3.3 are available\n",
+                        callback->version_major, callback->version_minor);
+                return false;
+            }
+            break;
+        case RETRO_HW_CONTEXT_OPENGL:
+            // The context is core profile on every platform: no legacy GL
+            fprintf(stderr, "HW render: legacy OpenGL is unavailable, core profile only\n");
+            return false;
+        default:
+            fprintf(stderr, "HW render: context type %d is not supported\n", (int)callback->context_type);
+            return false;
+    }
+
+    callback->get_current_framebuffer = hw_get_current_framebuffer;
+    callback->get_proc_address = hw_get_proc_address;
+    hw->callback = *callback;
+    hw->requested = true;
+    fprintf(stderr, "HW render: OpenGL core %u.%u%s%s\n",
+            callback->version_major, callback->version_minor,
+            callback->depth ? ", depth" : "", callback->stencil ? ", stencil" : "");
+    return true;
+}
+
+bool libretro_hw_context_reset(libretro_hw_t* hw, unsigned max_width, unsigned max_height) {
+    if (!hw || !hw->requested) return false;
+    if (!hw_load_gl()) return false;
+    if (max_width == 0 || max_height == 0) {
+        max_width = 640;
+        max_height = 480;
+    }
+    if (!hw_allocate(hw, max_width, max_height)) return false;
+
+    hw->context_ready = true;
+    if (hw->callback.context_reset) {
+        hw->callback.context_reset();
+    }
+    return true;
+}
+
+bool libretro_hw_ensure_size(libretro_hw_t* hw, unsigned max_width, unsigned max_height) {
+    if (!hw || !hw->context_ready) return false;
+    if (max_width <= hw->width && max_height <= hw->height) return true;
+    unsigned width = max_width > hw->width ? max_width : hw->width;
+    unsigned height = max_height > hw->height ? max_height : hw->height;
+    return hw_allocate(hw, width, height);
+}
+
+void libretro_hw_frame(libretro_hw_t* hw, unsigned width, unsigned height) {
+    if (!hw || !hw->context_ready) return;
+    hw->frame_width = width < hw->width ? width : hw->width;
+    hw->frame_height = height < hw->height ? height : hw->height;
+    hw->frame_valid = true;
+}
+
+void libretro_hw_context_destroy(libretro_hw_t* hw) {
+    if (!hw || !hw->context_ready) return;
+    if (hw->callback.context_destroy) {
+        hw->callback.context_destroy();
+    }
+    if (hw->depth_renderbuffer) g_gl.DeleteRenderbuffers(1, &hw->depth_renderbuffer);
+    if (hw->color_texture) g_gl.DeleteTextures(1, &hw->color_texture);
+    if (hw->fbo) g_gl.DeleteFramebuffers(1, &hw->fbo);
+    hw->depth_renderbuffer = 0;
+    hw->color_texture = 0;
+    hw->fbo = 0;
+    hw->context_ready = false;
+    hw->frame_valid = false;
+}
@@ -0,0 +1,98 @@
+/*
+ * libretro_hw.h - Hardware (OpenGL) Rendering
+ *
+ * Copyright (c) 2024 mikedx
+ * GitHub: https://github.com/mikedx/libretro_raylib
+ *
+ * This file is part of libretro_raylib.
+ *
+ * libretro_raylib is free software: you can redistribute it and/or modify
+ * it under the terms of the MIT License.
+ *
+ * Support for RETRO_ENVIRONMENT_SET_HW_RENDER: the core renders with GL into
+ * a frontend-owned framebuffer object in raylib's own context, and the
+ * FBO's color texture is drawn by raylib directly, with no readback.
+ * raylib's context is OpenGL 3.3 core profile, so only
+ * RETRO_HW_CONTEXT_OPENGL_CORE 3.1 to 3.3 is accepted.
+ *
+ * The core asks for the context while loading content, before the window
+ * exists, so the FBO is created (and the core's context_reset called) once
+ * the window is up. GL contexts are bound to one thread, so hardware
+ * rendered cores always run in serial mode.
+ *
+ * GL entry points are resolved at runtime (they are also what
+ * get_proc_address hands the core), so no GL headers are needed here.
+ */
+
+#ifndef LIBRETRO_HW_H
+#define LIBRETRO_HW_H
+
+#include "libretro.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * Hardware rendering state
+ */
+typedef struct libretro_hw {
+    bool available;                 // A GL context will exist (not headless)
+    bool requested;                 // Core's SET_HW_RENDER was accepted
+    bool context_ready;             // FBO created and context_reset called
+    struct retro_hw_render_callback callback; // Copy of the core's request
+
+    // Framebuffer object the core renders into (GL names)
+    unsigned fbo;
+    unsigned color_texture;
+    unsigned depth_renderbuffer;
+    unsigned width;                 // FBO size (the core's max geometry)
+    unsigned height;
+
+    // Last frame the core presented (RETRO_HW_FRAME_BUFFER_VALID)
+    unsigned frame_width;
+    unsigned frame_height;
+    bool frame_valid;
+} libretro_hw_t;
+
+/**
+ * Accept or reject a core's SET_HW_RENDER request
+ * Fills in get_current_framebuffer and get_proc_address on success
+ * @param hw Hardware rendering state
+ * @param callback Core's request
+ * @return false if the context type/version can't be provided
+ */
+bool libretro_hw_set_render(libretro_hw_t* hw, struct retro_hw_render_callback* callback);
+
+/**
+ * Create the FBO and tell the core its context is ready
+ * Call on the GL thread once the window exists
+ * @param hw Hardware rendering state
+ * @param max_width Core's max geometry width
+ * @param max_height Core's max geometry height
+ * @return false if the FBO couldn't be created
+ */
+bool libretro_hw_context_reset(libretro_hw_t* hw, unsigned max_width, unsigned max_height);
+
+/**
+ * Grow the FBO if the core's max geometry grew (the FBO name stays the same)
+ * @param hw Hardware rendering state
+ * @param max_width Core's max geometry width
+ * @param max_height Core's max geometry height
+ */
+bool libretro_hw_ensure_size(libretro_hw_t* hw, unsigned max_width, unsigned max_height);
+
+/**
+ * Record a frame the core rendered into the FBO (from the video callback)
+ * @param hw Hardware rendering state
+ * @param width Frame width in the FBO
+ * @param height Frame height in the FBO
+ */
+void libretro_hw_frame(libretro_hw_t* hw, unsigned width, unsigned height);
+
+/**
+ * Call the core's context_destroy and delete the FBO
+ * Call on the GL thread before the window closes
+ * @param hw Hardware rendering state
+ */
+void libretro_hw_context_destroy(libretro_hw_t* hw);
+
+#endif // LIBRETRO_HW_H
@@ -14,34 +14,43 @@
 #include "libretro_frontend.h"
 #include "libretro.h"
 
-// Global frontend instance for callbacks
-static libretro_frontend_t* g_frontend = NULL;
-
-void libretro_input_set_frontend(libretro_frontend_t* frontend) {
-    g_frontend = frontend;
-}
-
 /**
  * Input poll callback implementation
  */
 void retro_input_poll_callback(void) {
-    // Input polling is handled by raylib in main.c
-    // This is called before retro_input_state
+    libretro_frontend_t* frontend = libretro_frontend_current();
+    if (!frontend || frontend->input_polled) return; // Once per retro_run is enough
+    frontend->input_polled = true;
+    
+    // The handler (main.c) samples raylib/OS input right now; without one,
+    // input was already updated before retro_run
+    if (!frontend->input_poll_handler) return;
+    uint64_t start = frontend->perf ? libretro_perf_now_ns() : 0;
+    frontend->input_poll_handler(frontend->input_poll_userdata);
+    if (frontend->perf) libretro_perf_add(frontend->perf, LIBRETRO_PERF_INPUT, libretro_perf_now_ns() - start);
 }
 
 /**
  * Input state callback implementation
  */
 int16_t retro_input_state_callback(unsigned port, unsigned device, unsigned index, unsigned id) {
+    libretro_frontend_t* frontend = libretro_frontend_current();
     (void)index;
-    if (!g_frontend) return 0;
+    if (!frontend) return 0;
     
-    if (device == RETRO_DEVICE_JOYPAD && port < 16 && id < 16) {
-        return g_frontend->input_state[port][id] ? 1 : 0;
+    if (device == RETRO_DEVICE_JOYPAD && port < LIBRETRO_INPUT_MAX_PORTS) {
+        // Movies latch the joypads per frame (libretro_movie_begin_frame)
+        uint16_t mask = frontend->input_latch ? frontend->input_latch[port]
+                                              : __atomic_load_n(&frontend->input_state[port], __ATOMIC_RELAXED);
+        // GET_INPUT_BITMASKS: the whole pad in one call
+        if (id == RETRO_DEVICE_ID_JOYPAD_MASK) return (int16_t)mask;
+        if (id < 16) return (mask >> id) & 1;
+        return 0;
     }
     
-    if (device == RETRO_DEVICE_KEYBOARD && port < 16 && id < RETROK_LAST) {
-        return g_frontend->keyboard_state[id] ? 1 : 0;
+    if (device == RETRO_DEVICE_KEYBOARD && port < LIBRETRO_INPUT_MAX_PORTS && id < RETROK_LAST) {
+        uint32_t word = __atomic_load_n(&frontend->keyboard_state[id / 32], __ATOMIC_RELAXED);
+        return (word >> (id % 32)) & 1;
     }
     
     return 0;
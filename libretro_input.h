@@ -31,11 +31,5 @@ void retro_input_poll_callback(void);
  */
 int16_t retro_input_state_callback(unsigned port, unsigned device, unsigned index, unsigned id);
 
-/**
- * Set the frontend instance for callbacks
- * @param frontend Frontend instance (can be NULL)
- */
-void libretro_input_set_frontend(libretro_frontend_t* frontend);
-
 #endif // LIBRETRO_INPUT_H
 
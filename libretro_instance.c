@@ -0,0 +1,177 @@
+/*
+ * libretro_instance.c - Multiple Core Instances in One Process Implementation
+ *
+ * Copyright (c) 2024 mikedx
+ * GitHub: https://github.com/mikedx/libretro_raylib
+ *
+ * This file is part of libretro_raylib.
+ *
+ * libretro_raylib is free software: you can redistribute it and/or modify
+ * it under the terms of the MIT License.
+ */
+
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE // pthread_setaffinity_np
+#endif
+
+#include "libretro_instance.h"
+#include "libretro_audio_ring.h"
+#include "libretro_convert.h"
+#include "libretro_perf.h"
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#ifdef __APPLE__
+#include <mach/mach.h>
+#include <mach/thread_policy.h>
+#endif
+
+// Frames drained from each instance's audio ring per read
+#define INSTANCE_AUDIO_CHUNK 1024
+
+unsigned libretro_instance_cpu_count(void) {
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (unsigned)count : 1;
+}
+
+// macOS has no hard affinity; threads with the same affinity tag are only
+// kept together, so each CPU index gets its own tag instead
+bool libretro_instance_pin_thread(int cpu) {
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#elif defined(__APPLE__)
+    thread_affinity_policy_data_t policy = { cpu + 1 };
+    return thread_policy_set(pthread_mach_thread_np(pthread_self()), THREAD_AFFINITY_POLICY,
+                             (thread_policy_t)&policy, THREAD_AFFINITY_POLICY_COUNT) == KERN_SUCCESS;
+#else
+    (void)cpu;
+    return false;
+#endif
+}
+
+/**
+ * Load the instance's core and content into its frontend
+ */
+static bool instance_load(libretro_instance_t* instance) {
+    libretro_frontend_t* frontend = &instance->frontend;
+    const libretro_instance_config_t* config = &instance->config;
+
+    // Options are read but never written back: instances share the file
+    if (config->options_path) {
+        libretro_options_load(&frontend->options, config->options_path);
+        frontend->options.path[0] = '\0';
+    }
+    for (unsigned i = 0; i < config->option_override_count; i++) {
+        libretro_options_set_assignment(&frontend->options, config->option_overrides[i]);
+    }
+
+    if (!libretro_frontend_load_core(frontend, config->core_path)) {
+        fprintf(stderr, "Instance %u: failed to load core %s\n", instance->index, config->core_path);
+        return false;
+    }
+    if (!libretro_frontend_init_core(frontend)) {
+        fprintf(stderr, "Instance %u: failed to initialize core\n", instance->index);
+        return false;
+    }
+    if (!libretro_frontend_load_rom(frontend, config->rom_path)) {
+        fprintf(stderr, "Instance %u: failed to load %s\n", instance->index,
+                config->rom_path ? config->rom_path : "(no game)");
+        return false;
+    }
+    if (frontend->hw.requested) {
+        fprintf(stderr, "Instance %u: hardware rendered cores can't run as instances\n", instance->index);
+        return false;
+    }
+    return true;
+}
+
+bool libretro_instance_run(libretro_instance_t* instance) {
+    if (!instance) return false;
+    libretro_frontend_t* frontend = &instance->frontend;
+    instance->ok = false;
+    instance->frames_run = 0;
+
+    if (instance->cpu >= 0 && !libretro_instance_pin_thread(instance->cpu)) {
+        instance->cpu = -1;
+    }
+
+    // Binds this thread's callbacks to the instance's frontend
+    uint64_t start = libretro_perf_now_ns();
+    libretro_frontend_init(frontend);
+    frontend->native_upload = false;    // No GPU: frames are converted
+    frontend->core_private_copy = true;
+    frontend->core_image = instance->core_image;
+
+    float audio[INSTANCE_AUDIO_CHUNK * 2];
+    if (instance_load(instance)) {
+        uint64_t run_start = libretro_perf_now_ns();
+        instance->load_seconds = (double)(run_start - start) / 1e9;
+        instance->core_fps = frontend->fps;
+
+        bool stopped = false;
+        while (instance->frames_run < instance->config.frames) {
+            if (instance->before_frame && !instance->before_frame(instance, instance->frames_run)) {
+                stopped = true;
+                break;
+            }
+            instance->frames_run += libretro_frontend_run_display_frame(frontend);
+            libretro_frontend_clear_frame_dirty(frontend);
+            while (libretro_audio_ring_read(&frontend->audio_ring, audio, INSTANCE_AUDIO_CHUNK) ==
+                   INSTANCE_AUDIO_CHUNK) {
+            }
+            if (instance->after_frame && !instance->after_frame(instance, instance->frames_run)) {
+                stopped = true;
+                break;
+            }
+        }
+        instance->run_seconds = (double)(libretro_perf_now_ns() - run_start) / 1e9;
+        instance->ok = !stopped;
+    }
+
+    libretro_frontend_deinit(frontend);
+    libretro_frontend_bind_thread(NULL);
+    return instance->ok;
+}
+
+static void* instance_thread(void* arg) {
+    libretro_instance_run((libretro_instance_t*)arg);
+    return NULL;
+}
+
+bool libretro_instance_run_all(libretro_instance_t* instances, unsigned count, bool pin) {
+    if (!instances || count == 0) return false;
+
+    // Process-wide setup the instances would otherwise race on
+    libretro_convert_init();
+
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr, LIBRETRO_INSTANCE_STACK_SIZE);
+
+    unsigned cpus = libretro_instance_cpu_count();
+    for (unsigned i = 0; i < count; i++) {
+        libretro_instance_t* instance = &instances[i];
+        instance->index = i;
+        instance->cpu = pin ? (int)(i % cpus) : -1;
+        instance->ok = false;
+        instance->started = pthread_create(&instance->thread, &attr, instance_thread, instance) == 0;
+        if (!instance->started) {
+            fprintf(stderr, "Instance %u: failed to start thread\n", i);
+        }
+    }
+    pthread_attr_destroy(&attr);
+
+    bool ok = true;
+    for (unsigned i = 0; i < count; i++) {
+        if (instances[i].started) {
+            pthread_join(instances[i].thread, NULL);
+            instances[i].started = false;
+        }
+        ok = ok && instances[i].ok;
+    }
+    return ok;
+}
@@ -0,0 +1,118 @@
+/*
+ * libretro_instance.h - Multiple Core Instances in One Process
+ *
+ * Copyright (c) 2024 mikedx
+ * GitHub: https://github.com/mikedx/libretro_raylib
+ *
+ * This file is part of libretro_raylib.
+ *
+ * libretro_raylib is free software: you can redistribute it and/or modify
+ * it under the terms of the MIT License.
+ *
+ * Runs several headless frontends side by side, each on its own thread:
+ *
+ * - Core callbacks reach the right frontend through the per-thread binding
+ *   (libretro_frontend_bind_thread), since libretro callbacks carry no
+ *   context pointer; calls from threads a core starts itself are matched to
+ *   the instance by the core image they come from
+ * - Cores keep their state in globals, so every instance loads a private
+ *   copy of the core file (libretro_frontend_t.core_private_copy)
+ * - Instance threads are pinned round-robin to CPUs, so one process can
+ *   stand in for a process per session
+ *
+ * Hardware rendered cores are not supported here (there is no GL context).
+ */
+
+#ifndef LIBRETRO_INSTANCE_H
+#define LIBRETRO_INSTANCE_H
+
+#include "libretro_frontend.h"
+#include <pthread.h>
+#include <stdbool.h>
+
+//=============================================================================
+// Instance Structures
+//=============================================================================
+
+// Stack for instance threads: cores expect a main-thread sized one (macOS
+// gives other threads 512 KB)
+#define LIBRETRO_INSTANCE_STACK_SIZE (8u << 20)
+
+/**
+ * What one instance runs
+ */
+typedef struct {
+    const char* core_path;
+    const char* rom_path;           // NULL = start without a game
+    unsigned frames;                // Core frames to run
+    const char* options_path;       // Core options to read (never written), or NULL
+    const char* const* option_overrides; // "key=value" applied after the file
+    unsigned option_override_count;
+} libretro_instance_config_t;
+
+struct libretro_instance;
+
+/**
+ * Per-frame hook: before_frame gets the number of frames run so far (the
+ * index of the frame about to run), after_frame the count including it
+ * @return false to stop the instance (it then counts as failed)
+ */
+typedef bool (*libretro_instance_frame_hook_t)(struct libretro_instance* instance, unsigned frame);
+
+/**
+ * One instance and, once it finished, its results
+ */
+typedef struct libretro_instance {
+    libretro_instance_config_t config;
+    libretro_instance_frame_hook_t before_frame; // Optional (e.g. feed input)
+    libretro_instance_frame_hook_t after_frame;  // Optional (e.g. hash the frame)
+    void* userdata;
+    unsigned index;
+    int cpu;                        // CPU the thread was pinned to (-1 = not pinned)
+    void* core_image;               // Core image to reuse (libretro_core_open_image), NULL = load a private copy
+    libretro_frontend_t frontend;
+    pthread_t thread;
+    bool started;
+
+    // Results
+    bool ok;                        // Loaded and ran every frame, and no hook stopped it
+    unsigned frames_run;
+    double load_seconds;            // Core load, init and content load
+    double run_seconds;
+    double core_fps;                // Core's nominal frame rate
+} libretro_instance_t;
+
+//=============================================================================
+// Public API Functions
+//=============================================================================
+
+/**
+ * Number of online CPUs
+ */
+unsigned libretro_instance_cpu_count(void);
+
+/**
+ * Pin the calling thread to a CPU (an affinity tag on macOS)
+ * @param cpu CPU index
+ * @return false if the platform or the OS refused
+ */
+bool libretro_instance_pin_thread(int cpu);
+
+/**
+ * Run one instance start to finish on the calling thread (pinned first if
+ * instance->cpu >= 0). The frontend is deinitialized again before returning.
+ * @param instance Instance with config filled in
+ * @return true if it loaded and ran every frame
+ */
+bool libretro_instance_run(libretro_instance_t* instance);
+
+/**
+ * Run instances concurrently, one thread each, and wait for all of them
+ * @param instances Instances with config filled in
+ * @param count Number of instances
+ * @param pin Pin instance threads to CPUs round-robin
+ * @return true if every instance succeeded
+ */
+bool libretro_instance_run_all(libretro_instance_t* instances, unsigned count, bool pin);
+
+#endif // LIBRETRO_INSTANCE_H
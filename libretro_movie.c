@@ -0,0 +1,307 @@
+/*
+ * libretro_movie.c - Input Movies Implementation
+ *
+ * Copyright (c) 2024 mikedx
+ * GitHub: https://github.com/mikedx/libretro_raylib
+ *
+ * This file is part of libretro_raylib.
+ *
+ * libretro_raylib is free software: you can redistribute it and/or modify
+ * it under the terms of the MIT License.
+ */
+
+#include "libretro_movie.h"
+#include "libretro.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+
+#define MOVIE_MAGIC "LRMV"
+#define MOVIE_VERSION 1
+#define MOVIE_HEADER_SIZE 64
+#define MOVIE_CORE_NAME_SIZE 32
+#define MOVIE_FLAG_STATE 1u
+
+#define MOVIE_PORT_RESET 0xFF
+
+// Longest event: 5-byte varint (32-bit delta), port, mask
+#define MOVIE_MAX_EVENT 8
+
+//=============================================================================
+// Helpers
+//=============================================================================
+
+static void put_le32(uint8_t* p, uint32_t value) {
+    p[0] = (uint8_t)value;
+    p[1] = (uint8_t)(value >> 8);
+    p[2] = (uint8_t)(value >> 16);
+    p[3] = (uint8_t)(value >> 24);
+}
+
+static uint32_t get_le32(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/**
+ * Core's library name, so playback can warn about a different core
+ */
+static void movie_core_name(const libretro_frontend_t* frontend, char name[MOVIE_CORE_NAME_SIZE]) {
+    memset(name, 0, MOVIE_CORE_NAME_SIZE);
+    if (!frontend->core->retro_get_system_info) return;
+    struct retro_system_info info;
+    memset(&info, 0, sizeof(info));
+    frontend->core->retro_get_system_info(&info);
+    if (info.library_name) strncpy(name, info.library_name, MOVIE_CORE_NAME_SIZE - 1);
+}
+
+/**
+ * Append one event: frame delta since the previous event, port, mask
+ */
+static bool movie_write_event(libretro_movie_t* movie, unsigned port, uint16_t mask) {
+    if (movie->events_size + MOVIE_MAX_EVENT > movie->events_capacity) {
+        size_t capacity = movie->events_capacity ? movie->events_capacity * 2 : 4096;
+        uint8_t* events = (uint8_t*)realloc(movie->events, capacity);
+        if (!events) return false;
+        movie->events = events;
+        movie->events_capacity = capacity;
+    }
+    uint8_t* p = movie->events + movie->events_size;
+    uint32_t delta = movie->frame - movie->event_frame;
+    do {
+        *p++ = (uint8_t)((delta & 0x7F) | (delta >= 0x80 ? 0x80 : 0));
+        delta >>= 7;
+    } while (delta);
+    *p++ = (uint8_t)port;
+    if (port != MOVIE_PORT_RESET) {
+        *p++ = (uint8_t)mask;
+        *p++ = (uint8_t)(mask >> 8);
+    }
+    movie->events_size = (size_t)(p - movie->events);
+    movie->event_frame = movie->frame;
+    return true;
+}
+
+/**
+ * Read the frame delta that starts the next event
+ */
+static void movie_read_delta(libretro_movie_t* movie) {
+    uint32_t delta = 0;
+    for (unsigned shift = 0; shift < 35; shift += 7) {
+        if (movie->cursor >= movie->events_size) break;
+        uint8_t byte = movie->events[movie->cursor++];
+        delta |= (uint32_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            movie->event_frame += delta;
+            return;
+        }
+    }
+    movie->events_done = true;      // End of stream (or a truncated varint)
+}
+
+//=============================================================================
+// Public API Implementation
+//=============================================================================
+
+bool libretro_movie_record(libretro_movie_t* movie, libretro_frontend_t* frontend, const char* path) {
+    if (!movie || !frontend || !frontend->core || !path) return false;
+    memset(movie, 0, sizeof(*movie));
+    movie->frontend = frontend;
+    snprintf(movie->path, sizeof(movie->path), "%s", path);
+
+    struct retro_core_t* core = frontend->core;
+    size_t size = (core->retro_serialize_size && core->retro_serialize) ? core->retro_serialize_size() : 0;
+    if (size > 0) {
+        uint8_t* raw = (uint8_t*)malloc(size);
+        uLongf stored = compressBound((uLong)size);
+        movie->state = (uint8_t*)malloc(stored);
+        if (!raw || !movie->state) {
+            fprintf(stderr, "Movie: failed to allocate a %zu byte savestate\n", size);
+            free(raw);
+            libretro_movie_stop(movie);
+            return false;
+        }
+        if (core->retro_serialize(raw, size) && compress2(movie->state, &stored, raw, (uLong)size, 6) == Z_OK) {
+            movie->state_size = size;
+            movie->state_stored = stored;
+        } else {
+            fprintf(stderr, "Movie: retro_serialize failed\n");
+        }
+        free(raw);
+    }
+    if (movie->state_size == 0) {
+        fprintf(stderr, "Movie: core has no savestate, replay will only match from power-on\n");
+    }
+
+    // Every port starts released, so held buttons show up as first-frame events
+    movie->mode = LIBRETRO_MOVIE_RECORDING;
+    frontend->input_latch = movie->input;
+    frontend->movie = movie;
+    fprintf(stderr, "Movie: recording to %s (%zu byte state, %zu stored)\n",
+            movie->path, movie->state_size, movie->state_stored);
+    return true;
+}
+
+bool libretro_movie_play(libretro_movie_t* movie, libretro_frontend_t* frontend, const char* path) {
+    if (!movie || !frontend || !frontend->core || !path) return false;
+    memset(movie, 0, sizeof(*movie));
+    movie->frontend = frontend;
+    snprintf(movie->path, sizeof(movie->path), "%s", path);
+
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        fprintf(stderr, "Movie: failed to open %s\n", path);
+        return false;
+    }
+    uint8_t header[MOVIE_HEADER_SIZE];
+    bool ok = fread(header, 1, sizeof(header), file) == sizeof(header) &&
+              memcmp(header, MOVIE_MAGIC, 4) == 0 && get_le32(header + 4) == MOVIE_VERSION;
+    if (!ok) {
+        fprintf(stderr, "Movie: %s is not a version %d movie\n", path, MOVIE_VERSION);
+        fclose(file);
+        return false;
+    }
+    movie->frame_count = get_le32(header + 8);
+    uint32_t flags = get_le32(header + 12);
+    size_t state_size = (flags & MOVIE_FLAG_STATE) ? get_le32(header + 16) : 0;
+    size_t state_stored = (flags & MOVIE_FLAG_STATE) ? get_le32(header + 20) : 0;
+    movie->events_size = get_le32(header + 24);
+
+    char name[MOVIE_CORE_NAME_SIZE];
+    movie_core_name(frontend, name);
+    if (strncmp(name, (const char*)header + 32, MOVIE_CORE_NAME_SIZE) != 0) {
+        fprintf(stderr, "Movie: recorded with core '%.*s', playing on '%s'\n",
+                MOVIE_CORE_NAME_SIZE, (const char*)header + 32, name);
+    }
+
+    uint8_t* stored = (uint8_t*)malloc(state_stored ? state_stored : 1);
+    uint8_t* state = (uint8_t*)malloc(state_size ? state_size : 1);
+    movie->events = (uint8_t*)malloc(movie->events_size ? movie->events_size : 1);
+    ok = stored && state && movie->events &&
+         fread(stored, 1, state_stored, file) == state_stored &&
+         fread(movie->events, 1, movie->events_size, file) == movie->events_size;
+    fclose(file);
+    if (!ok) {
+        fprintf(stderr, "Movie: %s is truncated\n", path);
+    } else if (state_size > 0) {
+        // A state from another core or content either fails here or desyncs
+        uLongf length = (uLongf)state_size;
+        struct retro_core_t* core = frontend->core;
+        ok = uncompress(state, &length, stored, (uLong)state_stored) == Z_OK && length == state_size &&
+             core->retro_unserialize && core->retro_unserialize(state, state_size);
+        if (!ok) fprintf(stderr, "Movie: failed to restore the starting state\n");
+    }
+    free(stored);
+    free(state);
+    if (!ok) {
+        libretro_movie_stop(movie);
+        return false;
+    }
+
+    movie->mode = LIBRETRO_MOVIE_PLAYING;
+    movie_read_delta(movie);
+    frontend->input_latch = movie->input;
+    frontend->movie = movie;
+    fprintf(stderr, "Movie: playing %s (%u frames, %zu event bytes)\n",
+            path, movie->frame_count, movie->events_size);
+    return true;
+}
+
+void libretro_movie_begin_frame(libretro_movie_t* movie) {
+    if (!movie) return;
+    libretro_frontend_t* frontend = movie->frontend;
+
+    if (movie->mode == LIBRETRO_MOVIE_RECORDING) {
+        if (movie->reset_pending) {
+            movie->reset_pending = false;
+            movie_write_event(movie, MOVIE_PORT_RESET, 0);
+        }
+        for (unsigned port = 0; port < LIBRETRO_INPUT_MAX_PORTS; port++) {
+            uint16_t mask = __atomic_load_n(&frontend->input_state[port], __ATOMIC_RELAXED);
+            if (mask != movie->input[port] && movie_write_event(movie, port, mask)) {
+                movie->input[port] = mask;
+            }
+        }
+    } else if (movie->mode == LIBRETRO_MOVIE_PLAYING) {
+        while (!movie->events_done && movie->event_frame <= movie->frame) {
+            if (movie->cursor >= movie->events_size) {
+                movie->events_done = true;
+                break;
+            }
+            uint8_t port = movie->events[movie->cursor++];
+            if (port == MOVIE_PORT_RESET) {
+                if (frontend->core->retro_reset) frontend->core->retro_reset();
+                movie->resets++;
+            } else if (port < LIBRETRO_INPUT_MAX_PORTS && movie->cursor + 2 <= movie->events_size) {
+                movie->input[port] = (uint16_t)(movie->events[movie->cursor] | (movie->events[movie->cursor + 1] << 8));
+                movie->cursor += 2;
+            } else {
+                fprintf(stderr, "Movie: bad event at byte %zu, input stops here\n", movie->cursor - 1);
+                movie->events_done = true;
+                break;
+            }
+            movie_read_delta(movie);
+        }
+    }
+    movie->frame++;
+}
+
+bool libretro_movie_reset(libretro_movie_t* movie) {
+    if (!movie) return true;
+    if (movie->mode == LIBRETRO_MOVIE_PLAYING) return false;
+    if (movie->mode == LIBRETRO_MOVIE_RECORDING) {
+        movie->reset_pending = true;
+        movie->resets++;
+    }
+    return true;
+}
+
+bool libretro_movie_finished(const libretro_movie_t* movie) {
+    return movie && movie->mode == LIBRETRO_MOVIE_PLAYING && movie->frame >= movie->frame_count;
+}
+
+/**
+ * Write a finished recording
+ */
+static bool movie_write(const libretro_movie_t* movie) {
+    uint8_t header[MOVIE_HEADER_SIZE];
+    memset(header, 0, sizeof(header));
+    memcpy(header, MOVIE_MAGIC, 4);
+    put_le32(header + 4, MOVIE_VERSION);
+    put_le32(header + 8, movie->frame);
+    put_le32(header + 12, movie->state_size ? MOVIE_FLAG_STATE : 0);
+    put_le32(header + 16, (uint32_t)movie->state_size);
+    put_le32(header + 20, (uint32_t)movie->state_stored);
+    put_le32(header + 24, (uint32_t)movie->events_size);
+    movie_core_name(movie->frontend, (char*)header + 32);
+
+    FILE* file = fopen(movie->path, "wb");
+    if (!file) return false;
+    bool ok = fwrite(header, 1, sizeof(header), file) == sizeof(header) &&
+              fwrite(movie->state, 1, movie->state_stored, file) == movie->state_stored &&
+              fwrite(movie->events, 1, movie->events_size, file) == movie->events_size;
+    return (fclose(file) == 0) && ok;
+}
+
+bool libretro_movie_stop(libretro_movie_t* movie) {
+    if (!movie) return false;
+    bool ok = true;
+    libretro_frontend_t* frontend = movie->frontend;
+    if (movie->mode == LIBRETRO_MOVIE_RECORDING) {
+        ok = movie_write(movie);
+        if (ok) {
+            fprintf(stderr, "Movie: wrote %s (%u frames, %u resets, %zu event bytes)\n",
+                    movie->path, movie->frame, movie->resets, movie->events_size);
+        } else {
+            fprintf(stderr, "Movie: failed to write %s\n", movie->path);
+        }
+    }
+    if (frontend && frontend->movie == movie) {
+        frontend->movie = NULL;
+        frontend->input_latch = NULL;
+    }
+    free(movie->events);
+    free(movie->state);
+    memset(movie, 0, sizeof(*movie));
+    return ok;
+}
@@ -0,0 +1,131 @@
+/*
+ * libretro_movie.h - Input Movies
+ *
+ * Copyright (c) 2024 mikedx
+ * GitHub: https://github.com/mikedx/libretro_raylib
+ *
+ * This file is part of libretro_raylib.
+ *
+ * libretro_raylib is free software: you can redistribute it and/or modify
+ * it under the terms of the MIT License.
+ *
+ * Records the joypad input of a session and plays it back frame for frame.
+ * A movie file is (all integers little-endian):
+ *
+ *   Header (64 bytes): "LRMV", version, frame count, flags, savestate size,
+ *                      stored (zlib) savestate size, event bytes, reserved,
+ *                      core library name (32 bytes, NUL padded)
+ *   Savestate:         retro_serialize at the start, zlib compressed
+ *   Events:            (frame delta, port, mask) records, written only when a
+ *                      port's bitmask changes: frame delta as a LEB128 varint
+ *                      (frames since the previous event), port as one byte
+ *                      (0xFF = retro_reset, no mask follows), mask as 16 bits
+ *
+ * While a movie is attached the core reads joypads from a copy latched at
+ * the start of each frame (libretro_frontend_t.input_latch), so what it sees
+ * is exactly what is recorded or replayed even when input arrives from
+ * another thread or mid-frame. Keyboard input is not recorded. Playback
+ * needs the same core and content; cores that can't serialize still record,
+ * but replay only matches from power-on.
+ */
+
+#ifndef LIBRETRO_MOVIE_H
+#define LIBRETRO_MOVIE_H
+
+#include "libretro_frontend.h"
+#include <limits.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+//=============================================================================
+// Movie Structures
+//=============================================================================
+
+typedef enum {
+    LIBRETRO_MOVIE_NONE,
+    LIBRETRO_MOVIE_RECORDING,
+    LIBRETRO_MOVIE_PLAYING
+} libretro_movie_mode_t;
+
+/**
+ * Movie being recorded or played
+ */
+typedef struct libretro_movie {
+    libretro_frontend_t* frontend;
+    libretro_movie_mode_t mode;
+    char path[PATH_MAX];            // Written here when recording stops
+
+    uint32_t frame;                 // Frames run since the movie started
+    uint32_t frame_count;           // Playback: length of the movie
+    uint16_t input[LIBRETRO_INPUT_MAX_PORTS]; // Latched joypads for the current frame
+
+    // Event stream: growing when recording, read through when playing
+    uint8_t* events;
+    size_t events_size;
+    size_t events_capacity;
+    size_t cursor;                  // Playback: next unread byte
+    uint32_t event_frame;           // Frame of the last event written, or of the next one to apply
+    bool events_done;               // Playback: nothing left to apply
+
+    uint8_t* state;                 // Recording: starting savestate, compressed
+    size_t state_size;              // Uncompressed size
+    size_t state_stored;            // Compressed size
+
+    bool reset_pending;             // Recording: the core was reset since the last frame
+    unsigned resets;
+} libretro_movie_t;
+
+//=============================================================================
+// Public API Functions
+//=============================================================================
+
+/**
+ * Start recording: saves the core's state now and attaches to the frontend
+ * Call after content is loaded, before the first recorded frame
+ * @param movie Movie state
+ * @param frontend Frontend with content loaded
+ * @param path File written by libretro_movie_stop
+ * @return false on allocation failure
+ */
+bool libretro_movie_record(libretro_movie_t* movie, libretro_frontend_t* frontend, const char* path);
+
+/**
+ * Start playback: loads a movie, restores its starting state and attaches
+ * Call after the same content is loaded
+ * @param movie Movie state
+ * @param frontend Frontend with content loaded
+ * @param path Movie file
+ * @return false if the file is unreadable or the state didn't restore
+ */
+bool libretro_movie_play(libretro_movie_t* movie, libretro_frontend_t* frontend, const char* path);
+
+/**
+ * Latch this frame's input: replays or records the joypads and resets that
+ * apply to it (libretro_frontend_run_frame calls this before running the core)
+ * @param movie Movie state
+ */
+void libretro_movie_begin_frame(libretro_movie_t* movie);
+
+/**
+ * Note a reset: recorded when recording; ignored when playing, the movie's
+ * own resets are replayed instead (libretro_frontend_reset)
+ * @param movie Movie state
+ * @return true if the core should be reset now
+ */
+bool libretro_movie_reset(libretro_movie_t* movie);
+
+/**
+ * Whether playback has run every frame of the movie
+ * @param movie Movie state
+ */
+bool libretro_movie_finished(const libretro_movie_t* movie);
+
+/**
+ * Detach from the frontend, write the file when recording, and free buffers
+ * @param movie Movie state
+ * @return false if a recording couldn't be written
+ */
+bool libretro_movie_stop(libretro_movie_t* movie);
+
+#endif // LIBRETRO_MOVIE_H
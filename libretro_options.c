@@ -0,0 +1,505 @@
+/*
+ * libretro_options.c - Core Option Store Implementation
+ *
+ * Copyright (c) 2024 mikedx
+ * GitHub: https://github.com/mikedx/libretro_raylib
+ *
+ * This file is part of libretro_raylib.
+ *
+ * libretro_raylib is free software: you can redistribute it and/or modify
+ * it under the terms of the MIT License.
+ */
+
+#include "libretro_options.h"
+#include "libretro_file.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define OPTIONS_BLOCK_BYTES (16 * 1024)
+#define OPTIONS_MIN_TABLE 64
+
+//=============================================================================
+// Interning
+//=============================================================================
+
+static uint32_t hash_bytes(const char* s, size_t len) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        hash = (hash ^ (uint8_t)s[i]) * 16777619u;
+    }
+    return hash;
+}
+
+/**
+ * Carve space out of the arena (pointers stay valid until free)
+ */
+static void* arena_alloc(libretro_options_t* options, size_t size, size_t align) {
+    libretro_options_block_t* block = options->blocks;
+    if (block) {
+        size_t offset = (block->used + align - 1) & ~(align - 1);
+        if (offset + size <= block->size) {
+            block->used = offset + size;
+            return block->data + offset;
+        }
+    }
+
+    size_t block_size = size + align > OPTIONS_BLOCK_BYTES ? size + align : OPTIONS_BLOCK_BYTES;
+    block = (libretro_options_block_t*)malloc(sizeof(*block) + block_size);
+    if (!block) {
+        fprintf(stderr, "Failed to allocate option storage\n");
+        return NULL;
+    }
+    block->next = options->blocks;
+    block->size = block_size;
+    block->used = size;
+    options->blocks = block;
+    return block->data; // malloc alignment covers any align we ask for
+}
+
+/**
+ * Find an interned string, or the empty slot it would go in
+ */
+static const char** string_slot(const libretro_options_t* options, const char* s, size_t len, uint32_t hash) {
+    unsigned mask = options->string_table_size - 1;
+    for (unsigned i = hash & mask; ; i = (i + 1) & mask) {
+        const char** slot = &options->strings[i];
+        if (!*slot || (strncmp(*slot, s, len) == 0 && (*slot)[len] == '\0')) return slot;
+    }
+}
+
+static bool grow_strings(libretro_options_t* options) {
+    unsigned size = options->string_table_size ? options->string_table_size * 2 : OPTIONS_MIN_TABLE;
+    const char** table = (const char**)calloc(size, sizeof(*table));
+    if (!table) {
+        fprintf(stderr, "Failed to allocate option string table\n");
+        return false;
+    }
+    const char** old = options->strings;
+    unsigned old_size = options->string_table_size;
+    options->strings = table;
+    options->string_table_size = size;
+    for (unsigned i = 0; i < old_size; i++) {
+        if (!old[i]) continue;
+        size_t len = strlen(old[i]);
+        *string_slot(options, old[i], len, hash_bytes(old[i], len)) = old[i];
+    }
+    free(old);
+    return true;
+}
+
+/**
+ * Look up an interned string without adding it
+ */
+static const char* find_string(const libretro_options_t* options, const char* s) {
+    if (!s || !options->string_table_size) return NULL;
+    size_t len = strlen(s);
+    return *string_slot(options, s, len, hash_bytes(s, len));
+}
+
+/**
+ * Intern len bytes of s (need not be NUL-terminated)
+ */
+static const char* intern(libretro_options_t* options, const char* s, size_t len) {
+    if (options->string_count * 2 >= options->string_table_size && !grow_strings(options)) return NULL;
+    const char** slot = string_slot(options, s, len, hash_bytes(s, len));
+    if (*slot) return *slot;
+
+    char* copy = (char*)arena_alloc(options, len + 1, 1);
+    if (!copy) return NULL;
+    memcpy(copy, s, len);
+    copy[len] = '\0';
+    *slot = copy;
+    options->string_count++;
+    return copy;
+}
+
+//=============================================================================
+// Option Table
+//=============================================================================
+
+static libretro_option_t* find_option(const libretro_options_t* options, const char* key) {
+    if (!key || !options->table_size) return NULL;
+    uint32_t hash = hash_bytes(key, strlen(key));
+    unsigned mask = options->table_size - 1;
+    for (unsigned i = hash & mask; options->table[i]; i = (i + 1) & mask) {
+        libretro_option_t* option = &options->options[options->table[i] - 1];
+        if (option->hash == hash && strcmp(option->key, key) == 0) return option;
+    }
+    return NULL;
+}
+
+static bool grow_table(libretro_options_t* options) {
+    unsigned size = options->table_size ? options->table_size * 2 : OPTIONS_MIN_TABLE;
+    uint32_t* table = (uint32_t*)calloc(size, sizeof(*table));
+    if (!table) {
+        fprintf(stderr, "Failed to allocate option table\n");
+        return false;
+    }
+    for (unsigned n = 0; n < options->count; n++) {
+        unsigned i = options->options[n].hash & (size - 1);
+        while (table[i]) i = (i + 1) & (size - 1);
+        table[i] = n + 1;
+    }
+    free(options->table);
+    options->table = table;
+    options->table_size = size;
+    return true;
+}
+
+static libretro_option_t* add_option(libretro_options_t* options, const char* key) {
+    libretro_option_t* option = find_option(options, key);
+    if (option) return option;
+
+    if (options->count == options->capacity) {
+        unsigned capacity = options->capacity ? options->capacity * 2 : OPTIONS_MIN_TABLE / 2;
+        libretro_option_t* grown = (libretro_option_t*)realloc(options->options, capacity * sizeof(*grown));
+        if (!grown) {
+            fprintf(stderr, "Failed to allocate options\n");
+            return NULL;
+        }
+        options->options = grown;
+        options->capacity = capacity;
+    }
+    if ((options->count + 1) * 2 > options->table_size && !grow_table(options)) return NULL;
+
+    const char* interned = intern(options, key, strlen(key));
+    if (!interned) return NULL;
+
+    option = &options->options[options->count];
+    memset(option, 0, sizeof(*option));
+    option->key = interned;
+    option->hash = hash_bytes(key, strlen(key));
+    option->visible = true;
+
+    unsigned mask = options->table_size - 1;
+    unsigned i = option->hash & mask;
+    while (options->table[i]) i = (i + 1) & mask;
+    options->table[i] = ++options->count;
+    return option;
+}
+
+/**
+ * Find an interned value among an option's declared values
+ */
+static bool option_has_value(const libretro_option_t* option, const char* value) {
+    for (unsigned i = 0; i < option->value_count; i++) {
+        if (option->values[i] == value) return true;
+    }
+    return false;
+}
+
+/**
+ * Declare (or redeclare) an option
+ * @param values Value strings, already interned
+ */
+static bool declare_option(libretro_options_t* options, const char* key, const char* desc,
+                           const char** values, unsigned count, const char* default_value) {
+    if (!key || count == 0) return false;
+    libretro_option_t* option = add_option(options, key);
+    if (!option) return false;
+
+    bool declared = option->values != NULL;
+    option->desc = desc;
+    option->values = values;
+    option->value_count = count;
+    option->default_value = option_has_value(option, default_value) ? default_value : values[0];
+
+    // Keep an override (from the file, or an earlier declaration) if it is
+    // still one of the values
+    const char* value = option->value;
+    if (value && !option_has_value(option, value)) {
+        fprintf(stderr, "Option %s: \"%s\" is not a valid value, using \"%s\"\n",
+                key, value, option->default_value);
+        value = NULL;
+    }
+    if (!value) value = option->default_value;
+    if (value != option->value) {
+        __atomic_store_n(&option->value, value, __ATOMIC_RELEASE);
+        if (declared) __atomic_store_n(&options->updated, true, __ATOMIC_RELEASE);
+    }
+    return true;
+}
+
+/**
+ * Set a value; values from the file don't need saving back
+ */
+static bool set_value(libretro_options_t* options, const char* key, const char* value, bool from_file) {
+    if (!key || !value || !key[0]) return false;
+    libretro_option_t* option = add_option(options, key);
+    if (!option) return false;
+
+    const char* interned;
+    if (option->values) {
+        // Declared: the value must already be interned as one of its values
+        interned = find_string(options, value);
+        if (!interned || !option_has_value(option, interned)) return false;
+    } else {
+        interned = intern(options, value, strlen(value));
+        if (!interned) return false;
+    }
+
+    if (interned == option->value) return true;
+    __atomic_store_n(&option->value, interned, __ATOMIC_RELEASE);
+    if (!from_file) options->modified = true;
+    if (option->values) __atomic_store_n(&options->updated, true, __ATOMIC_RELEASE);
+    return true;
+}
+
+/**
+ * Report what a declaration call produced
+ */
+static void print_declared(const libretro_options_t* options) {
+    unsigned declared = 0;
+    unsigned overridden = 0;
+    for (unsigned i = 0; i < options->count; i++) {
+        const libretro_option_t* option = &options->options[i];
+        if (!option->values) continue;
+        declared++;
+        if (option->value != option->default_value) overridden++;
+    }
+    fprintf(stderr, "Options: %u declared, %u overridden\n", declared, overridden);
+}
+
+/**
+ * Intern a retro_core_option_value list
+ */
+static const char** intern_values(libretro_options_t* options, const struct retro_core_option_value* source,
+                                  unsigned* count) {
+    unsigned n = 0;
+    while (n < RETRO_NUM_CORE_OPTION_VALUES_MAX && source[n].value) n++;
+    *count = n;
+    if (n == 0) return NULL;
+
+    const char** values = (const char**)arena_alloc(options, n * sizeof(*values), sizeof(*values));
+    if (!values) return NULL;
+    for (unsigned i = 0; i < n; i++) {
+        values[i] = intern(options, source[i].value, strlen(source[i].value));
+        if (!values[i]) return NULL;
+    }
+    return values;
+}
+
+//=============================================================================
+// Public API
+//=============================================================================
+
+void libretro_options_init(libretro_options_t* options) {
+    if (!options) return;
+    memset(options, 0, sizeof(*options));
+}
+
+void libretro_options_free(libretro_options_t* options) {
+    if (!options) return;
+    libretro_options_block_t* block = options->blocks;
+    while (block) {
+        libretro_options_block_t* next = block->next;
+        free(block);
+        block = next;
+    }
+    free(options->options);
+    free(options->table);
+    free(options->strings);
+    memset(options, 0, sizeof(*options));
+}
+
+bool libretro_options_load(libretro_options_t* options, const char* path) {
+    if (!options || !path) return false;
+    snprintf(options->path, sizeof(options->path), "%s", path);
+
+    FILE* file = fopen(path, "r");
+    if (!file) {
+        options->file_exists = false;
+        if (errno == ENOENT) return true;
+        fprintf(stderr, "Failed to read options file: %s\n", path);
+        return false;
+    }
+    options->file_exists = true;
+
+    // key = "value", one per line; '#' starts a comment
+    char line[1024];
+    unsigned loaded = 0;
+    while (fgets(line, sizeof(line), file)) {
+        char* p = line;
+        while (*p == ' ' || *p == '\t') p++;
+        if (*p == '#' || *p == '\n' || *p == '\0') continue;
+
+        char* key = p;
+        while (*p && *p != '=' && *p != ' ' && *p != '\t') p++;
+        char* key_end = p;
+        while (*p == ' ' || *p == '\t') p++;
+        if (*p != '=') continue;
+        p++;
+        while (*p == ' ' || *p == '\t') p++;
+        *key_end = '\0';
+
+        char* value = p;
+        char* value_end;
+        if (*p == '"') {
+            value = ++p;
+            value_end = strchr(p, '"');
+            if (!value_end) continue;
+        } else {
+            value_end = p + strcspn(p, "\r\n");
+            while (value_end > value && (value_end[-1] == ' ' || value_end[-1] == '\t')) value_end--;
+        }
+        *value_end = '\0';
+
+        if (set_value(options, key, value, true)) loaded++;
+    }
+    fclose(file);
+
+    fprintf(stderr, "Options: %u loaded from %s\n", loaded, path);
+    return true;
+}
+
+bool libretro_options_save(libretro_options_t* options) {
+    if (!options || !options->path[0]) return true;
+    if (options->file_exists && !options->modified) return true;
+
+    bool any_declared = false;
+    for (unsigned i = 0; i < options->count; i++) {
+        if (options->options[i].values) any_declared = true;
+    }
+    if (!any_declared) return true;
+
+    if (!libretro_file_make_parent_dirs(options->path)) {
+        fprintf(stderr, "Failed to create directory for %s\n", options->path);
+        return false;
+    }
+
+    // Written atomically, so neither a crash nor another instance saving
+    // the same file can truncate the options
+    libretro_file_write_t writer;
+    FILE* file = libretro_file_begin_write(&writer, options->path) ? fdopen(writer.fd, "w") : NULL;
+    if (!file) {
+        if (writer.fd >= 0) {
+            close(writer.fd);
+            libretro_file_end_write(&writer, false);
+        }
+        fprintf(stderr, "Failed to write options file: %s\n", options->path);
+        return false;
+    }
+
+    // Undeclared overrides are kept: the core may only declare them with
+    // other content loaded
+    for (unsigned i = 0; i < options->count; i++) {
+        const libretro_option_t* option = &options->options[i];
+        if (option->value) fprintf(file, "%s = \"%s\"\n", option->key, option->value);
+    }
+
+    bool ok = fclose(file) == 0;
+    if (!libretro_file_end_write(&writer, ok)) {
+        fprintf(stderr, "Failed to write options file: %s\n", options->path);
+        return false;
+    }
+    options->file_exists = true;
+    options->modified = false;
+    return true;
+}
+
+bool libretro_options_set(libretro_options_t* options, const char* key, const char* value) {
+    if (!options) return false;
+    return set_value(options, key, value, false);
+}
+
+bool libretro_options_set_assignment(libretro_options_t* options, const char* assignment) {
+    if (!options || !assignment) return false;
+    const char* equals = strchr(assignment, '=');
+    if (!equals || equals == assignment) return false;
+
+    char key[256];
+    int len = snprintf(key, sizeof(key), "%.*s", (int)(equals - assignment), assignment);
+    if (len < 0 || (size_t)len >= sizeof(key)) return false;
+    return set_value(options, key, equals + 1, false);
+}
+
+const char* libretro_options_get(const libretro_options_t* options, const char* key) {
+    if (!options) return NULL;
+    libretro_option_t* option = find_option(options, key);
+    return option ? __atomic_load_n(&option->value, __ATOMIC_ACQUIRE) : NULL;
+}
+
+bool libretro_options_declare_variables(libretro_options_t* options, const struct retro_variable* variables) {
+    if (!options || !variables) return false;
+
+    for (const struct retro_variable* var = variables; var->key; var++) {
+        if (!var->value) continue;
+
+        // "Description; first|second|third"
+        const char* separator = strstr(var->value, "; ");
+        if (!separator) continue;
+        const char* desc = intern(options, var->value, (size_t)(separator - var->value));
+
+        const char* list = separator + 2;
+        unsigned count = 1;
+        for (const char* c = list; *c; c++) {
+            if (*c == '|') count++;
+        }
+        const char** values = (const char**)arena_alloc(options, count * sizeof(*values), sizeof(*values));
+        if (!desc || !values) return false;
+
+        unsigned n = 0;
+        for (const char* start = list; n < count; n++) {
+            const char* end = strchr(start, '|');
+            size_t len = end ? (size_t)(end - start) : strlen(start);
+            values[n] = intern(options, start, len);
+            if (!values[n]) return false;
+            start += len + 1;
+        }
+        declare_option(options, var->key, desc, values, count, values[0]);
+    }
+
+    if (!options->file_exists) options->modified = true;
+    print_declared(options);
+    return true;
+}
+
+bool libretro_options_declare_v1(libretro_options_t* options, const struct retro_core_option_definition* definitions) {
+    if (!options || !definitions) return false;
+
+    for (const struct retro_core_option_definition* def = definitions; def->key; def++) {
+        unsigned count = 0;
+        const char** values = intern_values(options, def->values, &count);
+        if (!values) continue;
+        const char* desc = def->desc ? intern(options, def->desc, strlen(def->desc)) : NULL;
+        const char* default_value = def->default_value ? find_string(options, def->default_value) : NULL;
+        declare_option(options, def->key, desc, values, count, default_value);
+    }
+
+    if (!options->file_exists) options->modified = true;
+    print_declared(options);
+    return true;
+}
+
+bool libretro_options_declare_v2(libretro_options_t* options, const struct retro_core_option_v2_definition* definitions) {
+    if (!options || !definitions) return false;
+
+    for (const struct retro_core_option_v2_definition* def = definitions; def->key; def++) {
+        unsigned count = 0;
+        const char** values = intern_values(options, def->values, &count);
+        if (!values) continue;
+        const char* desc = def->desc ? intern(options, def->desc, strlen(def->desc)) : NULL;
+        const char* default_value = def->default_value ? find_string(options, def->default_value) : NULL;
+        declare_option(options, def->key, desc, values, count, default_value);
+    }
+
+    if (!options->file_exists) options->modified = true;
+    print_declared(options);
+    return true;
+}
+
+bool libretro_options_set_visible(libretro_options_t* options, const char* key, bool visible) {
+    if (!options) return false;
+    libretro_option_t* option = find_option(options, key);
+    if (!option) return false;
+    option->visible = visible;
+    return true;
+}
+
+bool libretro_options_check_update(libretro_options_t* options) {
+    if (!options) return false;
+    return __atomic_exchange_n(&options->updated, false, __ATOMIC_ACQ_REL);
+}
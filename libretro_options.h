@@ -0,0 +1,187 @@
+/*
+ * libretro_options.h - Core Option Store
+ *
+ * Copyright (c) 2024 mikedx
+ * GitHub: https://github.com/mikedx/libretro_raylib
+ *
+ * This file is part of libretro_raylib.
+ *
+ * libretro_raylib is free software: you can redistribute it and/or modify
+ * it under the terms of the MIT License.
+ *
+ * Options declared by the core (SET_VARIABLES, SET_CORE_OPTIONS v1/v2) are
+ * parsed once into a hash table keyed by option name. Every string (keys
+ * and values) is interned in one arena, so:
+ *
+ * - GET_VARIABLE is a hash probe that hands back a stable pointer, with no
+ *   allocation or copying
+ * - Changing a value is a pointer compare against the interned value, and
+ *   GET_VARIABLE_UPDATE only reports true when a value actually changed
+ *
+ * Overrides are loaded from and saved to a RetroArch-style .opt file
+ * (key = "value" lines). Overrides for options the core hasn't declared yet
+ * are kept and applied when it declares them.
+ */
+
+#ifndef LIBRETRO_OPTIONS_H
+#define LIBRETRO_OPTIONS_H
+
+#include "libretro.h"
+#include <limits.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+//=============================================================================
+// Option Structures
+//=============================================================================
+
+// Version reported for RETRO_ENVIRONMENT_GET_CORE_OPTIONS_VERSION
+#define LIBRETRO_OPTIONS_VERSION 2
+
+/**
+ * One core option
+ */
+typedef struct {
+    const char* key;                // Interned
+    const char* desc;               // Interned (may be NULL)
+    const char** values;            // Interned, value_count entries; NULL until declared
+    unsigned value_count;
+    const char* default_value;
+    const char* value;              // Current value handed to GET_VARIABLE (atomic)
+    uint32_t hash;
+    bool visible;
+} libretro_option_t;
+
+/**
+ * Arena block the interned strings live in (never moves)
+ */
+typedef struct libretro_options_block {
+    struct libretro_options_block* next;
+    size_t used;
+    size_t size;
+    char data[];
+} libretro_options_block_t;
+
+/**
+ * Option store
+ */
+typedef struct libretro_options {
+    libretro_option_t* options;
+    unsigned count;
+    unsigned capacity;
+
+    // Open-addressed option index: option index + 1, 0 = empty
+    uint32_t* table;
+    unsigned table_size;            // Power of two, at least twice count
+
+    // Interned strings: open-addressed table of arena pointers
+    const char** strings;
+    unsigned string_count;
+    unsigned string_table_size;
+    libretro_options_block_t* blocks; // Also holds the value arrays
+
+    bool updated;                   // Reported by GET_VARIABLE_UPDATE (atomic)
+    bool modified;                  // Values differ from the file
+    bool file_exists;
+    char path[PATH_MAX];            // .opt file (empty = don't save)
+} libretro_options_t;
+
+//=============================================================================
+// Public API Functions
+//=============================================================================
+
+/**
+ * Initialize an empty store
+ * @param options Store
+ */
+void libretro_options_init(libretro_options_t* options);
+
+/**
+ * Free the store and every interned string
+ * @param options Store
+ */
+void libretro_options_free(libretro_options_t* options);
+
+/**
+ * Load overrides from an options file and remember it for saving
+ * A missing file is not an error; it will be created on save
+ * @param options Store
+ * @param path File path
+ * @return false if the file exists but can't be read
+ */
+bool libretro_options_load(libretro_options_t* options, const char* path);
+
+/**
+ * Write every declared option to the options file, if anything changed or
+ * the file doesn't exist yet
+ * @param options Store
+ * @return false on write error
+ */
+bool libretro_options_save(libretro_options_t* options);
+
+/**
+ * Set an option's value
+ * Declared options only accept one of their values; undeclared ones keep the
+ * value until the core declares them
+ * @param options Store
+ * @param key Option key
+ * @param value New value
+ * @return false if the value isn't valid for the option
+ */
+bool libretro_options_set(libretro_options_t* options, const char* key, const char* value);
+
+/**
+ * Set an option from a "key=value" string (--option)
+ * @param options Store
+ * @param assignment "key=value"
+ * @return false if malformed or the value isn't valid for the option
+ */
+bool libretro_options_set_assignment(libretro_options_t* options, const char* assignment);
+
+/**
+ * Look up an option's current value
+ * @param options Store
+ * @param key Option key
+ * @return Interned value (valid until libretro_options_free), or NULL
+ */
+const char* libretro_options_get(const libretro_options_t* options, const char* key);
+
+/**
+ * Declare options from RETRO_ENVIRONMENT_SET_VARIABLES
+ * ("Description; value1|value2", default is the first value)
+ * @param options Store
+ * @param variables Array terminated by a NULL key
+ */
+bool libretro_options_declare_variables(libretro_options_t* options, const struct retro_variable* variables);
+
+/**
+ * Declare options from RETRO_ENVIRONMENT_SET_CORE_OPTIONS (v1)
+ * @param options Store
+ * @param definitions Array terminated by a NULL key
+ */
+bool libretro_options_declare_v1(libretro_options_t* options, const struct retro_core_option_definition* definitions);
+
+/**
+ * Declare options from RETRO_ENVIRONMENT_SET_CORE_OPTIONS_V2
+ * @param options Store
+ * @param definitions Array terminated by a NULL key
+ */
+bool libretro_options_declare_v2(libretro_options_t* options, const struct retro_core_option_v2_definition* definitions);
+
+/**
+ * Show or hide an option (RETRO_ENVIRONMENT_SET_CORE_OPTIONS_DISPLAY)
+ * @param options Store
+ * @param key Option key
+ * @param visible Whether a menu should list the option
+ */
+bool libretro_options_set_visible(libretro_options_t* options, const char* key, bool visible);
+
+/**
+ * Check and clear the changed flag (RETRO_ENVIRONMENT_GET_VARIABLE_UPDATE)
+ * @param options Store
+ * @return true if a value changed since the last call
+ */
+bool libretro_options_check_update(libretro_options_t* options);
+
+#endif // LIBRETRO_OPTIONS_H
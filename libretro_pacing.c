@@ -0,0 +1,271 @@
+/*
+ * libretro_pacing.c - Frame Pacing Implementation
+ *
+ * Copyright (c) 2024 mikedx
+ * GitHub: https://github.com/mikedx/libretro_raylib
+ *
+ * This file is part of libretro_raylib.
+ *
+ * libretro_raylib is free software: you can redistribute it and/or modify
+ * it under the terms of the MIT License.
+ */
+
+#include "libretro_pacing.h"
+#include "libretro_perf.h"
+#include <math.h>
+#include <string.h>
+#include <time.h>
+
+// Restart the schedule instead of bursting after falling this far behind
+#define PACING_MAX_LAG_FRAMES 4
+
+// Spin window bounds; the window follows how late the OS wakes us up
+#define PACING_SPIN_MIN_NS 100000ull
+#define PACING_SPIN_MAX_NS 2000000ull
+#define PACING_SPIN_DEFAULT_NS 500000ull
+
+// Audio mode polls the ring this often, and gives up after this many frame
+// periods (no device draining it) so the game falls back to the timer
+#define PACING_AUDIO_POLL_NS 250000ull
+#define PACING_AUDIO_MAX_PERIODS 2
+
+// Vsync mode: recompute the speed from the refresh estimate this often
+#define PACING_REMATCH_INTERVAL 60
+
+static void pacing_store_speed(libretro_pacing_t* pacing, double speed) {
+    __atomic_store(&pacing->speed, &speed, __ATOMIC_RELAXED);
+}
+
+/**
+ * Display rate the speed is matched to: the measured one once there is one
+ */
+static double pacing_display_rate(const libretro_pacing_t* pacing) {
+    if (pacing->mode == LIBRETRO_PACING_VSYNC && pacing->measured_refresh > 0.0) {
+        return pacing->measured_refresh;
+    }
+    return pacing->refresh;
+}
+
+/**
+ * Pick the speed that puts a whole number of refreshes in each core frame
+ * (1 for 60 Hz on 60 Hz, 2 for 60 Hz on 120 Hz), if it's within max_skew
+ */
+static void pacing_match_speed(libretro_pacing_t* pacing) {
+    double speed = 1.0;
+    double rate = pacing_display_rate(pacing);
+    double core_fps;
+    __atomic_load(&pacing->core_fps, &core_fps, __ATOMIC_RELAXED);
+    if (pacing->mode != LIBRETRO_PACING_AUDIO && pacing->max_skew > 0.0 && rate > 0.0) {
+        double refreshes = floor(rate / core_fps + 0.5);
+        if (refreshes >= 1.0) {
+            double matched = rate / (refreshes * core_fps);
+            if (fabs(matched - 1.0) <= pacing->max_skew) speed = matched;
+        }
+    }
+    pacing_store_speed(pacing, speed);
+}
+
+static void pacing_nanosleep(uint64_t ns) {
+    struct timespec ts = { (time_t)(ns / 1000000000ull), (long)(ns % 1000000000ull) };
+    nanosleep(&ts, NULL);
+}
+
+void libretro_pacing_sleep_until(uint64_t deadline_ns, uint64_t spin_ns) {
+    uint64_t now = libretro_perf_now_ns();
+    if (deadline_ns <= now) return;
+    if (deadline_ns - now > spin_ns) {
+        pacing_nanosleep(deadline_ns - now - spin_ns);
+    }
+    while (libretro_perf_now_ns() < deadline_ns) {
+        // Spin out the last stretch; the scheduler can't wake us this precisely
+    }
+}
+
+/**
+ * Sleep until the deadline, widening or narrowing the spin window to the
+ * wake-up latency actually seen
+ */
+static void pacing_sleep(libretro_pacing_t* pacing, uint64_t deadline_ns) {
+    uint64_t now = libretro_perf_now_ns();
+    if (deadline_ns <= now) return;
+    if (deadline_ns - now > pacing->spin_ns) {
+        uint64_t wake = deadline_ns - pacing->spin_ns;
+        pacing_nanosleep(wake - now);
+        now = libretro_perf_now_ns();
+        uint64_t late = (now > wake) ? now - wake : 0;
+        // Keep twice the typical lateness in reserve (moving average, 1/8 weight)
+        uint64_t want = late * 2 + PACING_SPIN_MIN_NS;
+        pacing->spin_ns = (pacing->spin_ns * 7 + want) / 8;
+        if (pacing->spin_ns < PACING_SPIN_MIN_NS) pacing->spin_ns = PACING_SPIN_MIN_NS;
+        if (pacing->spin_ns > PACING_SPIN_MAX_NS) pacing->spin_ns = PACING_SPIN_MAX_NS;
+    }
+    while (libretro_perf_now_ns() < deadline_ns) {
+    }
+}
+
+//=============================================================================
+// Setup
+//=============================================================================
+
+void libretro_pacing_init(libretro_pacing_t* pacing, libretro_pacing_mode_t mode, double core_fps,
+                          double refresh, double max_skew) {
+    memset(pacing, 0, sizeof(*pacing));
+    pacing->mode = mode;
+    pacing->core_fps = (core_fps > 0.0) ? core_fps : 60.0;
+    pacing->refresh = (refresh > 0.0) ? refresh : 0.0;
+    pacing->max_skew = (max_skew > 0.0) ? max_skew : 0.0;
+    pacing->spin_ns = PACING_SPIN_DEFAULT_NS;
+    pacing->deadline_ns = libretro_perf_now_ns();
+    pacing->owed = 0.5; // Round rather than truncate, so 1 - epsilon per refresh still runs every refresh
+    pacing_match_speed(pacing);
+}
+
+void libretro_pacing_set_audio(libretro_pacing_t* pacing, const libretro_audio_ring_t* ring, size_t target_frames) {
+    pacing->audio_ring = ring;
+    pacing->audio_target = target_frames;
+}
+
+void libretro_pacing_set_core_fps(libretro_pacing_t* pacing, double core_fps) {
+    if (core_fps <= 0.0 || core_fps == pacing->core_fps) return;
+    __atomic_store(&pacing->core_fps, &core_fps, __ATOMIC_RELAXED);
+    // The refresh measurement belongs to the presenting thread, which
+    // rematches the speed itself in vsync mode
+    if (pacing->mode != LIBRETRO_PACING_VSYNC) pacing_match_speed(pacing);
+}
+
+bool libretro_pacing_parse_mode(const char* name, libretro_pacing_mode_t* mode) {
+    if (strcmp(name, "timer") == 0) {
+        *mode = LIBRETRO_PACING_TIMER;
+    } else if (strcmp(name, "vsync") == 0) {
+        *mode = LIBRETRO_PACING_VSYNC;
+    } else if (strcmp(name, "audio") == 0) {
+        *mode = LIBRETRO_PACING_AUDIO;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+const char* libretro_pacing_mode_name(libretro_pacing_mode_t mode) {
+    switch (mode) {
+        case LIBRETRO_PACING_VSYNC: return "vsync";
+        case LIBRETRO_PACING_AUDIO: return "audio";
+        default: return "timer";
+    }
+}
+
+double libretro_pacing_speed(const libretro_pacing_t* pacing) {
+    double speed;
+    __atomic_load(&pacing->speed, &speed, __ATOMIC_RELAXED);
+    return speed;
+}
+
+//=============================================================================
+// Scheduling
+//=============================================================================
+
+unsigned libretro_pacing_frames_due(libretro_pacing_t* pacing) {
+    if (pacing->mode != LIBRETRO_PACING_VSYNC) return 1;
+
+    // Each call is one refresh; until the refresh is known, assume one core
+    // frame per refresh (the estimate settles within a few hundred frames)
+    double rate = pacing_display_rate(pacing);
+    double fps = pacing->core_fps * libretro_pacing_speed(pacing);
+    pacing->owed += (rate > 0.0) ? fps / rate : 1.0;
+
+    unsigned due = (unsigned)pacing->owed;
+    if (due > PACING_MAX_LAG_FRAMES) {
+        due = PACING_MAX_LAG_FRAMES;
+        pacing->owed = 0.5;
+    } else {
+        pacing->owed -= due;
+    }
+    return due;
+}
+
+void libretro_pacing_wait(libretro_pacing_t* pacing, unsigned frames, double speedup) {
+    uint64_t now = libretro_perf_now_ns();
+    if (speedup <= 0.0 || frames == 0) {
+        pacing->deadline_ns = now;
+        return;
+    }
+
+    double fps = pacing->core_fps * libretro_pacing_speed(pacing) * speedup;
+    uint64_t period = (uint64_t)(1e9 * frames / fps);
+
+    // Audio mode: the device is the clock, except while fast-forwarding
+    // (audio is squeezed then) or when nothing drains the ring
+    if (pacing->mode == LIBRETRO_PACING_AUDIO && pacing->audio_ring && speedup == 1.0) {
+        uint64_t limit = now + period * PACING_AUDIO_MAX_PERIODS;
+        while (libretro_audio_ring_available(pacing->audio_ring) > pacing->audio_target && now < limit) {
+            pacing_nanosleep(PACING_AUDIO_POLL_NS);
+            now = libretro_perf_now_ns();
+        }
+        pacing->deadline_ns = now;
+        return;
+    }
+
+    pacing->deadline_ns += period;
+    if (now > pacing->deadline_ns + period * PACING_MAX_LAG_FRAMES) {
+        pacing->deadline_ns = now;
+    }
+    pacing_sleep(pacing, pacing->deadline_ns);
+}
+
+//=============================================================================
+// Measurement
+//=============================================================================
+
+void libretro_pacing_present(libretro_pacing_t* pacing) {
+    uint64_t now = libretro_perf_now_ns();
+    uint64_t last = pacing->last_present_ns;
+    pacing->last_present_ns = now;
+    if (last == 0) return;
+
+    uint64_t interval_us = (now - last) / 1000;
+    if (interval_us > UINT32_MAX) interval_us = UINT32_MAX;
+    if (interval_us == 0) interval_us = 1;
+    pacing->intervals_us[pacing->interval_count % LIBRETRO_PACING_HISTORY] = (uint32_t)interval_us;
+    pacing->interval_count++;
+
+    if (pacing->mode != LIBRETRO_PACING_VSYNC) return;
+
+    // Refresh estimate: a smoothed rate over presented intervals. A missed
+    // swap (longer than 1.5 refreshes) says nothing about the display and is
+    // skipped; shorter intervals are kept, so a driver that ignores vsync
+    // shows up as a high rate and the speed falls back to 1.
+    double rate = 1e6 / (double)interval_us;
+    double estimate = pacing_display_rate(pacing);
+    if (estimate > 0.0 && rate < estimate / 1.5) return;
+    pacing->measured_refresh = (pacing->measured_refresh > 0.0)
+                             ? pacing->measured_refresh * 0.98 + rate * 0.02
+                             : rate;
+    if (pacing->interval_count % PACING_REMATCH_INTERVAL == 0) {
+        pacing_match_speed(pacing);
+    }
+}
+
+bool libretro_pacing_get_stats(const libretro_pacing_t* pacing, libretro_pacing_stats_t* stats) {
+    memset(stats, 0, sizeof(*stats));
+    unsigned count = pacing->interval_count;
+    if (count > LIBRETRO_PACING_HISTORY) count = LIBRETRO_PACING_HISTORY;
+    if (count == 0) return false;
+
+    double sum = 0.0;
+    for (unsigned i = 0; i < count; i++) sum += pacing->intervals_us[i];
+    double mean = sum / count;
+
+    double deviation = 0.0;
+    double max_deviation = 0.0;
+    for (unsigned i = 0; i < count; i++) {
+        double d = fabs(pacing->intervals_us[i] - mean);
+        deviation += d;
+        if (d > max_deviation) max_deviation = d;
+    }
+
+    stats->interval_ms = mean / 1000.0;
+    stats->jitter_ms = deviation / count / 1000.0;
+    stats->max_jitter_ms = max_deviation / 1000.0;
+    stats->count = pacing->interval_count;
+    return true;
+}
@@ -0,0 +1,181 @@
+/*
+ * libretro_pacing.h - Frame Pacing
+ *
+ * Copyright (c) 2024 mikedx
+ * GitHub: https://github.com/mikedx/libretro_raylib
+ *
+ * This file is part of libretro_raylib.
+ *
+ * libretro_raylib is free software: you can redistribute it and/or modify
+ * it under the terms of the MIT License.
+ *
+ * Decides when the core runs, at its exact (fractional) frame rate:
+ *
+ * - Timer: deadlines on the monotonic clock, reached by sleeping until just
+ *   before and spinning the rest, so a 59.73 Hz core gets 16.742 ms frames
+ *   rather than whatever an integer frame cap rounds to
+ * - Vsync: the display's buffer swap is the clock; core frames are owed at
+ *   the core's rate and run as they come due, so a 50 Hz core on a 60 Hz
+ *   display skips a refresh in six instead of drifting
+ * - Audio: the audio device is the clock; a frame runs once the output ring
+ *   has drained to its target fill, so audio never under- or overruns
+ *
+ * When the display refresh is within max_skew of the core's rate, the game
+ * runs at the display's rate instead (speed = refresh / fps, e.g. 1.0045 for
+ * a 59.73 Hz core on 60 Hz), and audio is resampled by the same factor
+ * (libretro_frontend_t.speed), so frames line up with refreshes and nothing
+ * drifts. The display rate is measured from presented frames in vsync mode.
+ *
+ * Presented frame intervals are recorded for the overlay: their average and
+ * the mean/max deviation from it (jitter).
+ */
+
+#ifndef LIBRETRO_PACING_H
+#define LIBRETRO_PACING_H
+
+#include "libretro_audio_ring.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+//=============================================================================
+// Pacing Structures
+//=============================================================================
+
+#define LIBRETRO_PACING_DEFAULT_MAX_SKEW 0.01   // Up to 1% faster or slower
+#define LIBRETRO_PACING_HISTORY 128             // Presented intervals kept (power of two)
+
+typedef enum {
+    LIBRETRO_PACING_TIMER,
+    LIBRETRO_PACING_VSYNC,
+    LIBRETRO_PACING_AUDIO
+} libretro_pacing_mode_t;
+
+/**
+ * Jitter over the recorded intervals
+ */
+typedef struct {
+    double interval_ms;             // Average presented frame interval
+    double jitter_ms;               // Mean absolute deviation from the average
+    double max_jitter_ms;           // Largest deviation
+    unsigned count;                 // Intervals measured
+} libretro_pacing_stats_t;
+
+/**
+ * Pacing state
+ *
+ * Deadlines and intervals belong to the thread that calls wait/present; the
+ * speed is read by the emulation and audio paths on other threads (atomic).
+ */
+typedef struct libretro_pacing {
+    libretro_pacing_mode_t mode;
+    double core_fps;                // Core's nominal rate (written by the waiting thread, atomic)
+    double refresh;                 // Display refresh in Hz (0 = unknown)
+    double max_skew;                // Largest speed change to match the display
+    double speed;                   // Game speed: 1 = core rate (atomic)
+
+    // Timer mode
+    uint64_t deadline_ns;           // When the next frame is due
+    uint64_t spin_ns;               // Sleep ends this early; the rest is spun
+
+    // Vsync mode: core frames owed, in frames
+    double owed;
+
+    // Audio mode: run when the ring holds at most this many frames
+    const libretro_audio_ring_t* audio_ring;
+    size_t audio_target;
+
+    // Presented intervals (ring) and the display rate estimate from them
+    uint64_t last_present_ns;
+    uint32_t intervals_us[LIBRETRO_PACING_HISTORY];
+    unsigned interval_count;        // Total recorded (index = count % HISTORY)
+    double measured_refresh;        // Smoothed, vsync mode only
+} libretro_pacing_t;
+
+//=============================================================================
+// Public API Functions
+//=============================================================================
+
+/**
+ * Initialize pacing
+ * @param pacing Pacing state
+ * @param mode Which clock frames follow
+ * @param core_fps Core's frame rate (<= 0 = 60)
+ * @param refresh Display refresh in Hz (0 = unknown: no speed matching until measured)
+ * @param max_skew Largest speed change to match the display (0 = never change speed)
+ */
+void libretro_pacing_init(libretro_pacing_t* pacing, libretro_pacing_mode_t mode, double core_fps,
+                          double refresh, double max_skew);
+
+/**
+ * Use the audio ring as the clock (audio mode)
+ * @param pacing Pacing state
+ * @param ring Output ring the audio device drains
+ * @param target_frames Fill level to wait for (the rate control's midpoint)
+ */
+void libretro_pacing_set_audio(libretro_pacing_t* pacing, const libretro_audio_ring_t* ring, size_t target_frames);
+
+/**
+ * Parse a mode name ("timer", "vsync" or "audio")
+ * @return false if unknown
+ */
+bool libretro_pacing_parse_mode(const char* name, libretro_pacing_mode_t* mode);
+
+/**
+ * Mode name for messages and the overlay
+ */
+const char* libretro_pacing_mode_name(libretro_pacing_mode_t mode);
+
+/**
+ * Current game speed (safe from any thread)
+ */
+double libretro_pacing_speed(const libretro_pacing_t* pacing);
+
+/**
+ * Follow a core frame rate change (SET_SYSTEM_AV_INFO); call from the
+ * thread that calls wait
+ * @param pacing Pacing state
+ * @param core_fps New rate
+ */
+void libretro_pacing_set_core_fps(libretro_pacing_t* pacing, double core_fps);
+
+/**
+ * Core frames to run before the next present (vsync mode: 0, 1 or more as
+ * they come due; other modes: always 1)
+ * @param pacing Pacing state
+ */
+unsigned libretro_pacing_frames_due(libretro_pacing_t* pacing);
+
+/**
+ * Wait until the next frame should run: on the timer at the (speed matched)
+ * core rate, or in audio mode until the ring drained. A serial loop in vsync
+ * mode doesn't call this (presenting blocks instead); an emulation thread
+ * does, to run at the same speed the display gets.
+ * @param pacing Pacing state
+ * @param frames Core frames the last iteration ran
+ * @param speedup Extra speed on top (fast-forward; 0 = don't wait at all)
+ */
+void libretro_pacing_wait(libretro_pacing_t* pacing, unsigned frames, double speedup);
+
+/**
+ * Record that a frame was presented (for jitter, and the refresh estimate
+ * in vsync mode)
+ * @param pacing Pacing state
+ */
+void libretro_pacing_present(libretro_pacing_t* pacing);
+
+/**
+ * Jitter over the last LIBRETRO_PACING_HISTORY presented frames
+ * @return false if fewer than two frames were presented
+ */
+bool libretro_pacing_get_stats(const libretro_pacing_t* pacing, libretro_pacing_stats_t* stats);
+
+/**
+ * Sleep until a monotonic deadline with sub-millisecond precision: sleeps
+ * until spin_ns before it, then spins
+ * @param deadline_ns libretro_perf_now_ns() time
+ * @param spin_ns How early to stop sleeping
+ */
+void libretro_pacing_sleep_until(uint64_t deadline_ns, uint64_t spin_ns);
+
+#endif // LIBRETRO_PACING_H
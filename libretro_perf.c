@@ -0,0 +1,287 @@
+/*
+ * libretro_perf.c - Frame Timing Instrumentation Implementation
+ *
+ * Copyright (c) 2024 mikedx
+ * GitHub: https://github.com/mikedx/libretro_raylib
+ *
+ * This file is part of libretro_raylib.
+ *
+ * libretro_raylib is free software: you can redistribute it and/or modify
+ * it under the terms of the MIT License.
+ */
+
+#include "libretro_perf.h"
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Same ordering scheme as the audio ring (see libretro_audio_ring.c)
+#define PERF_LOAD_ACQUIRE(p) __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define PERF_LOAD_RELAXED(p) __atomic_load_n((p), __ATOMIC_RELAXED)
+#define PERF_STORE_RELEASE(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+
+uint64_t libretro_perf_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+//=============================================================================
+// Recorder
+//=============================================================================
+
+bool libretro_perf_init(libretro_perf_t* perf, const char* name, uint32_t stage_mask) {
+    if (!perf) return false;
+    memset(perf, 0, sizeof(*perf));
+    perf->ring = (libretro_perf_sample_t*)calloc(LIBRETRO_PERF_RING_FRAMES, sizeof(libretro_perf_sample_t));
+    if (!perf->ring) return false;
+    perf->ring_mask = LIBRETRO_PERF_RING_FRAMES - 1;
+    perf->name = name ? name : "main";
+    perf->stage_mask = stage_mask;
+    perf->frame_start = libretro_perf_now_ns();
+    return true;
+}
+
+void libretro_perf_free(libretro_perf_t* perf) {
+    if (!perf) return;
+    free(perf->ring);
+    memset(perf, 0, sizeof(*perf));
+}
+
+void libretro_perf_add(libretro_perf_t* perf, libretro_perf_stage_t stage, uint64_t ns) {
+    if (!perf || stage >= LIBRETRO_PERF_STAGE_COUNT) return;
+    perf->current[stage] += ns;
+}
+
+void libretro_perf_end_frame(libretro_perf_t* perf) {
+    if (!perf || !perf->ring) return;
+    uint64_t now = libretro_perf_now_ns();
+
+    size_t write_pos = PERF_LOAD_RELAXED(&perf->write_pos);
+    size_t read_pos = PERF_LOAD_ACQUIRE(&perf->read_pos);
+    if (write_pos - read_pos < LIBRETRO_PERF_RING_FRAMES) {
+        libretro_perf_sample_t* sample = &perf->ring[write_pos & perf->ring_mask];
+        sample->sequence = perf->sequence;
+        memcpy(sample->stage_ns, perf->current, sizeof(sample->stage_ns));
+        sample->frame_ns = now - perf->frame_start;
+        PERF_STORE_RELEASE(&perf->write_pos, write_pos + 1);
+    } else {
+        perf->dropped++;
+    }
+
+    perf->sequence++;
+    memset(perf->current, 0, sizeof(perf->current));
+    perf->frame_start = now;
+}
+
+//=============================================================================
+// Log
+//=============================================================================
+
+void libretro_perf_log_init(libretro_perf_log_t* log, size_t expected_frames) {
+    if (!log) return;
+    memset(log, 0, sizeof(*log));
+    log->expected_frames = expected_frames;
+}
+
+void libretro_perf_log_free(libretro_perf_log_t* log) {
+    if (!log) return;
+    for (int i = 0; i < log->source_count; i++) {
+        free(log->sources[i].samples);
+    }
+    memset(log, 0, sizeof(*log));
+}
+
+bool libretro_perf_log_attach(libretro_perf_log_t* log, libretro_perf_t* perf) {
+    if (!log || !perf || log->source_count >= LIBRETRO_PERF_MAX_SOURCES) return false;
+    libretro_perf_source_t* source = &log->sources[log->source_count++];
+    memset(source, 0, sizeof(*source));
+    source->perf = perf;
+    return true;
+}
+
+/**
+ * Grow a source's history so frames more samples fit
+ */
+static bool source_reserve(libretro_perf_source_t* source, size_t frames, size_t initial) {
+    if (frames <= source->capacity) return true;
+    size_t capacity = source->capacity ? source->capacity : (initial ? initial : 1024);
+    while (capacity < frames) capacity *= 2;
+    libretro_perf_sample_t* grown = (libretro_perf_sample_t*)realloc(source->samples,
+                                                                     capacity * sizeof(libretro_perf_sample_t));
+    if (!grown) return false;
+    source->samples = grown;
+    source->capacity = capacity;
+    return true;
+}
+
+size_t libretro_perf_log_drain(libretro_perf_log_t* log) {
+    if (!log) return 0;
+    size_t drained = 0;
+
+    for (int i = 0; i < log->source_count; i++) {
+        libretro_perf_source_t* source = &log->sources[i];
+        libretro_perf_t* perf = source->perf;
+
+        size_t read_pos = PERF_LOAD_RELAXED(&perf->read_pos);
+        size_t write_pos = PERF_LOAD_ACQUIRE(&perf->write_pos);
+        size_t available = write_pos - read_pos;
+        if (available == 0) continue;
+
+        // On allocation failure the samples are consumed but not kept, so the
+        // recorder never stalls
+        bool keep = source_reserve(source, source->count + available, log->expected_frames);
+        for (size_t n = 0; n < available; n++) {
+            if (keep) source->samples[source->count++] = perf->ring[(read_pos + n) & perf->ring_mask];
+        }
+        PERF_STORE_RELEASE(&perf->read_pos, write_pos);
+        drained += available;
+    }
+
+    return drained;
+}
+
+static int compare_u64(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+    return (x > y) - (x < y);
+}
+
+static uint64_t sample_value(const libretro_perf_sample_t* sample, int stage) {
+    return (stage < LIBRETRO_PERF_STAGE_COUNT) ? sample->stage_ns[stage] : sample->frame_ns;
+}
+
+bool libretro_perf_log_get_stats(const libretro_perf_log_t* log, int stage, size_t last_frames,
+                                 libretro_perf_stats_t* stats) {
+    if (!log || !stats || stage < 0 || stage > LIBRETRO_PERF_FRAME) return false;
+
+    // The first recorder that claims the stage is authoritative for it
+    const libretro_perf_source_t* source = NULL;
+    for (int i = 0; i < log->source_count; i++) {
+        if (log->sources[i].perf->stage_mask & LIBRETRO_PERF_STAGE_BIT(stage)) {
+            source = &log->sources[i];
+            break;
+        }
+    }
+    if (!source || source->count == 0) return false;
+
+    size_t count = source->count;
+    if (last_frames > 0 && last_frames < count) count = last_frames;
+    const libretro_perf_sample_t* first = source->samples + (source->count - count);
+
+    uint64_t* sorted = (uint64_t*)malloc(count * sizeof(uint64_t));
+    if (!sorted) return false;
+    uint64_t total = 0;
+    for (size_t i = 0; i < count; i++) {
+        sorted[i] = sample_value(&first[i], stage);
+        total += sorted[i];
+    }
+    qsort(sorted, count, sizeof(uint64_t), compare_u64);
+
+    // Nearest-rank percentiles
+    size_t last = count - 1;
+    stats->min = sorted[0];
+    stats->avg = total / count;
+    stats->p50 = sorted[last * 50 / 100];
+    stats->p95 = sorted[last * 95 / 100];
+    stats->p99 = sorted[last * 99 / 100];
+    stats->max = sorted[last];
+    stats->count = count;
+
+    free(sorted);
+    return true;
+}
+
+const char* libretro_perf_stage_name(int stage) {
+    switch (stage) {
+        case LIBRETRO_PERF_INPUT: return "input";
+        case LIBRETRO_PERF_RUN: return "run";
+        case LIBRETRO_PERF_VIDEO: return "video";
+        case LIBRETRO_PERF_AUDIO: return "audio";
+        case LIBRETRO_PERF_UPLOAD: return "upload";
+        case LIBRETRO_PERF_PRESENT: return "present";
+        case LIBRETRO_PERF_REWIND: return "rewind";
+        case LIBRETRO_PERF_FRAME: return "frame";
+    }
+    return "unknown";
+}
+
+void libretro_perf_log_print_report(const libretro_perf_log_t* log, FILE* out) {
+    if (!log || !out) return;
+
+    fprintf(out, "%-8s %10s %10s %10s %10s %10s %10s\n",
+            "stage", "min(us)", "avg(us)", "p50(us)", "p95(us)", "p99(us)", "max(us)");
+    for (int s = 0; s <= LIBRETRO_PERF_FRAME; s++) {
+        libretro_perf_stats_t stats;
+        if (!libretro_perf_log_get_stats(log, s, 0, &stats)) continue;
+        // Skip stages this run never entered (e.g. upload when headless)
+        if (s != LIBRETRO_PERF_FRAME && stats.max == 0) continue;
+        fprintf(out, "%-8s %10.1f %10.1f %10.1f %10.1f %10.1f %10.1f\n",
+                libretro_perf_stage_name(s),
+                stats.min / 1e3, stats.avg / 1e3, stats.p50 / 1e3,
+                stats.p95 / 1e3, stats.p99 / 1e3, stats.max / 1e3);
+    }
+
+    for (int i = 0; i < log->source_count; i++) {
+        uint64_t dropped = log->sources[i].perf->dropped;
+        if (dropped > 0) {
+            fprintf(out, "(%s: %llu samples dropped, ring full)\n",
+                    log->sources[i].perf->name, (unsigned long long)dropped);
+        }
+    }
+}
+
+bool libretro_perf_log_dump(const libretro_perf_log_t* log, const char* path) {
+    if (!log || !path) return false;
+
+    FILE* file = fopen(path, "w");
+    if (!file) {
+        fprintf(stderr, "Failed to open perf dump file: %s\n", path);
+        return false;
+    }
+
+    size_t length = strlen(path);
+    bool json = length >= 5 && strcmp(path + length - 5, ".json") == 0;
+
+    if (json) {
+        fprintf(file, "{\n  \"unit\": \"ns\",\n  \"sources\": [");
+        for (int i = 0; i < log->source_count; i++) {
+            const libretro_perf_source_t* source = &log->sources[i];
+            fprintf(file, "%s\n    {\"name\": \"%s\", \"dropped\": %llu, \"frames\": [",
+                    i ? "," : "", source->perf->name, (unsigned long long)source->perf->dropped);
+            for (size_t n = 0; n < source->count; n++) {
+                const libretro_perf_sample_t* sample = &source->samples[n];
+                fprintf(file, "%s\n      {\"frame\": %llu", n ? "," : "", (unsigned long long)sample->sequence);
+                for (int s = 0; s < LIBRETRO_PERF_STAGE_COUNT; s++) {
+                    if (!(source->perf->stage_mask & LIBRETRO_PERF_STAGE_BIT(s))) continue;
+                    fprintf(file, ", \"%s\": %llu", libretro_perf_stage_name(s),
+                            (unsigned long long)sample->stage_ns[s]);
+                }
+                fprintf(file, ", \"frame_time\": %llu}", (unsigned long long)sample->frame_ns);
+            }
+            fprintf(file, "\n    ]}");
+        }
+        fprintf(file, "\n  ]\n}\n");
+    } else {
+        fprintf(file, "source,frame");
+        for (int s = 0; s < LIBRETRO_PERF_STAGE_COUNT; s++) {
+            fprintf(file, ",%s_ns", libretro_perf_stage_name(s));
+        }
+        fprintf(file, ",frame_ns\n");
+        for (int i = 0; i < log->source_count; i++) {
+            const libretro_perf_source_t* source = &log->sources[i];
+            for (size_t n = 0; n < source->count; n++) {
+                const libretro_perf_sample_t* sample = &source->samples[n];
+                fprintf(file, "%s,%llu", source->perf->name, (unsigned long long)sample->sequence);
+                for (int s = 0; s < LIBRETRO_PERF_STAGE_COUNT; s++) {
+                    fprintf(file, ",%llu", (unsigned long long)sample->stage_ns[s]);
+                }
+                fprintf(file, ",%llu\n", (unsigned long long)sample->frame_ns);
+            }
+        }
+    }
+
+    bool ok = !ferror(file);
+    fclose(file);
+    if (ok) fprintf(stderr, "Perf samples written to %s\n", path);
+    return ok;
+}
@@ -0,0 +1,229 @@
+/*
+ * libretro_perf.h - Frame Timing Instrumentation
+ *
+ * Copyright (c) 2024 mikedx
+ * GitHub: https://github.com/mikedx/libretro_raylib
+ *
+ * This file is part of libretro_raylib.
+ *
+ * libretro_raylib is free software: you can redistribute it and/or modify
+ * it under the terms of the MIT License.
+ *
+ * Per-frame, per-stage timings with a monotonic nanosecond clock.
+ *
+ * A recorder (libretro_perf_t) belongs to one thread: stage time accumulates
+ * during a frame and is pushed as one sample into the recorder's lock-free
+ * SPSC ring when the frame ends. A log (libretro_perf_log_t), owned by the
+ * main thread, drains the rings of one or more recorders into a history used
+ * for the overlay, reports and CSV/JSON dumps. In threaded mode the emulation
+ * and render threads each have a recorder and neither ever blocks on the log.
+ */
+
+#ifndef LIBRETRO_PERF_H
+#define LIBRETRO_PERF_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+//=============================================================================
+// Perf Structures
+//=============================================================================
+
+/**
+ * Timed stages of a frame
+ * VIDEO and AUDIO are spent inside the core's callbacks, so they are also
+ * part of RUN
+ */
+typedef enum {
+    LIBRETRO_PERF_INPUT = 0,    // Input polling and mapping
+    LIBRETRO_PERF_RUN,          // retro_run (including callbacks)
+    LIBRETRO_PERF_VIDEO,        // Video callback: conversion/hashing
+    LIBRETRO_PERF_AUDIO,        // Audio callbacks: resampling, ring writes
+    LIBRETRO_PERF_UPLOAD,       // Texture upload
+    LIBRETRO_PERF_PRESENT,      // Draw and present (includes vsync wait)
+    LIBRETRO_PERF_REWIND,       // Rewind capture and restore (outside retro_run)
+    LIBRETRO_PERF_STAGE_COUNT
+} libretro_perf_stage_t;
+
+// Pseudo-stage for whole-frame durations (stats, stage masks)
+#define LIBRETRO_PERF_FRAME LIBRETRO_PERF_STAGE_COUNT
+#define LIBRETRO_PERF_STAGE_BIT(stage) (1u << (stage))
+#define LIBRETRO_PERF_ALL_STAGES ((1u << (LIBRETRO_PERF_STAGE_COUNT + 1)) - 1)
+
+// Samples a recorder can queue before the log drains it
+#define LIBRETRO_PERF_RING_FRAMES 1024
+
+// Maximum recorders attached to one log
+#define LIBRETRO_PERF_MAX_SOURCES 2
+
+#define LIBRETRO_PERF_CACHE_LINE 64
+
+/**
+ * One frame's timings (nanoseconds)
+ */
+typedef struct {
+    uint64_t sequence;                          // Frame number within its recorder
+    uint64_t stage_ns[LIBRETRO_PERF_STAGE_COUNT];
+    uint64_t frame_ns;                          // Time since the previous frame ended
+} libretro_perf_sample_t;
+
+/**
+ * Summary statistics for one stage (nanoseconds)
+ */
+typedef struct {
+    uint64_t min;
+    uint64_t avg;
+    uint64_t p50;
+    uint64_t p95;
+    uint64_t p99;
+    uint64_t max;
+    size_t count;
+} libretro_perf_stats_t;
+
+/**
+ * Per-thread timing recorder
+ */
+typedef struct {
+    const char* name;           // Source name in reports ("main", "emu")
+    uint32_t stage_mask;        // Stages this recorder is authoritative for
+    uint64_t current[LIBRETRO_PERF_STAGE_COUNT];    // Accumulated in the current frame
+    uint64_t frame_start;
+    uint64_t sequence;
+
+    // SPSC ring of finished samples: written by the recording thread only,
+    // drained by the log's thread only
+    libretro_perf_sample_t* ring;
+    size_t ring_mask;
+    char pad0[LIBRETRO_PERF_CACHE_LINE];
+    size_t write_pos;
+    char pad1[LIBRETRO_PERF_CACHE_LINE];
+    size_t read_pos;
+    char pad2[LIBRETRO_PERF_CACHE_LINE];
+    uint64_t dropped;           // Samples lost to a full ring (recording thread)
+} libretro_perf_t;
+
+/**
+ * Drained history of one recorder
+ */
+typedef struct {
+    libretro_perf_t* perf;
+    libretro_perf_sample_t* samples;
+    size_t count;
+    size_t capacity;
+} libretro_perf_source_t;
+
+/**
+ * Consumer-side log
+ */
+typedef struct {
+    libretro_perf_source_t sources[LIBRETRO_PERF_MAX_SOURCES];
+    int source_count;
+    size_t expected_frames;     // Initial history capacity per source
+} libretro_perf_log_t;
+
+//=============================================================================
+// Public API Functions
+//=============================================================================
+
+/**
+ * Monotonic clock
+ * @return Nanoseconds since an arbitrary epoch
+ */
+uint64_t libretro_perf_now_ns(void);
+
+/**
+ * Initialize a recorder
+ * @param perf Recorder
+ * @param name Source name for reports (not copied)
+ * @param stage_mask LIBRETRO_PERF_STAGE_BIT()s this recorder times,
+ *                   including LIBRETRO_PERF_FRAME if its frame time counts
+ * @return true on success
+ */
+bool libretro_perf_init(libretro_perf_t* perf, const char* name, uint32_t stage_mask);
+
+/**
+ * Free a recorder's ring
+ * @param perf Recorder
+ */
+void libretro_perf_free(libretro_perf_t* perf);
+
+/**
+ * Add time to a stage of the current frame
+ * @param perf Recorder (NULL is ignored, so call sites need no check)
+ * @param stage Stage
+ * @param ns Duration in nanoseconds
+ */
+void libretro_perf_add(libretro_perf_t* perf, libretro_perf_stage_t stage, uint64_t ns);
+
+/**
+ * Push the current frame's sample into the ring and start the next frame
+ * Never blocks; if the ring is full the sample is dropped and counted
+ * @param perf Recorder (NULL is ignored)
+ */
+void libretro_perf_end_frame(libretro_perf_t* perf);
+
+/**
+ * Initialize a log
+ * @param log Log
+ * @param expected_frames History to preallocate per source (grows as needed)
+ */
+void libretro_perf_log_init(libretro_perf_log_t* log, size_t expected_frames);
+
+/**
+ * Free a log's history (attached recorders are not freed)
+ * @param log Log
+ */
+void libretro_perf_log_free(libretro_perf_log_t* log);
+
+/**
+ * Attach a recorder whose samples the log should drain
+ * @param log Log
+ * @param perf Recorder
+ * @return false if the log already has LIBRETRO_PERF_MAX_SOURCES recorders
+ */
+bool libretro_perf_log_attach(libretro_perf_log_t* log, libretro_perf_t* perf);
+
+/**
+ * Move queued samples from every attached recorder into the history
+ * @param log Log
+ * @return Number of samples drained
+ */
+size_t libretro_perf_log_drain(libretro_perf_log_t* log);
+
+/**
+ * Compute statistics for a stage from the recorder that owns it
+ * @param log Log
+ * @param stage Stage, or LIBRETRO_PERF_FRAME
+ * @param last_frames Only use the most recent frames (0 = all history)
+ * @param stats Output statistics
+ * @return false if no attached recorder times this stage or nothing was recorded
+ */
+bool libretro_perf_log_get_stats(const libretro_perf_log_t* log, int stage, size_t last_frames,
+                                 libretro_perf_stats_t* stats);
+
+/**
+ * Stage name for reports
+ * @param stage Stage, or LIBRETRO_PERF_FRAME
+ * @return Lowercase name
+ */
+const char* libretro_perf_stage_name(int stage);
+
+/**
+ * Print a per-stage table (microseconds) over all history
+ * @param log Log
+ * @param out Output stream
+ */
+void libretro_perf_log_print_report(const libretro_perf_log_t* log, FILE* out);
+
+/**
+ * Write every recorded sample to a file
+ * Format follows the extension: .json writes JSON, anything else CSV
+ * @param log Log
+ * @param path Output path
+ * @return true on success
+ */
+bool libretro_perf_log_dump(const libretro_perf_log_t* log, const char* path);
+
+#endif // LIBRETRO_PERF_H
@@ -0,0 +1,206 @@
+/*
+ * libretro_pipeline.c - Threaded Emulation/Render Pipeline Implementation
+ *
+ * Copyright (c) 2024 mikedx
+ * GitHub: https://github.com/mikedx/libretro_raylib
+ *
+ * This file is part of libretro_raylib.
+ *
+ * libretro_raylib is free software: you can redistribute it and/or modify
+ * it under the terms of the MIT License.
+ */
+
+#include "libretro_pipeline.h"
+#include "libretro_video.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Marks the ready slot as holding a frame the render thread hasn't taken yet
+#define LIBRETRO_PIPELINE_FRESH 0x4u
+#define LIBRETRO_PIPELINE_INDEX_MASK 0x3u
+
+/**
+ * Emulation thread: run the core at its own frame rate
+ */
+static void* pipeline_thread(void* arg) {
+    libretro_pipeline_t* pipeline = (libretro_pipeline_t*)arg;
+    libretro_frontend_t* frontend = pipeline->frontend;
+    libretro_pacing_t own_pacing;
+    libretro_pacing_t* pacing = pipeline->pacing;
+    if (!pacing) {
+        libretro_pacing_init(&own_pacing, LIBRETRO_PACING_TIMER, frontend->fps, 0.0, 0.0);
+        pacing = &own_pacing;
+    }
+    libretro_frontend_bind_thread(frontend);
+
+    while (__atomic_load_n(&pipeline->running, __ATOMIC_ACQUIRE)) {
+        if (__atomic_exchange_n(&pipeline->reset_requested, false, __ATOMIC_ACQ_REL)) {
+            fprintf(stderr, "Resetting core...\n");
+            libretro_frontend_reset(frontend);
+        }
+
+        unsigned frames = libretro_frontend_run_display_frame(frontend);
+        libretro_perf_end_frame(frontend->perf);
+        pipeline->frames_run += frames;
+
+        // Pace to the core's fps; audio drift is absorbed by rate control.
+        // Fast-forward is unthrottled unless the core asked for a speed.
+        double speedup = 1.0;
+        if (__atomic_load_n(&frontend->fastforward, __ATOMIC_RELAXED)) {
+            speedup = (frontend->fastforward_ratio >= 1.0f) ? frontend->fastforward_ratio : 0.0;
+        }
+        libretro_pacing_set_core_fps(pacing, frontend->fps);
+        libretro_pacing_wait(pacing, frames, speedup);
+    }
+
+    return NULL;
+}
+
+bool libretro_pipeline_init(libretro_pipeline_t* pipeline, libretro_frontend_t* frontend) {
+    if (!pipeline || !frontend) return false;
+    memset(pipeline, 0, sizeof(*pipeline));
+    pipeline->frontend = frontend;
+    pipeline->write_index = 0;
+    pipeline->ready = 1;
+    pipeline->read_index = 2;
+    return true;
+}
+
+bool libretro_pipeline_start(libretro_pipeline_t* pipeline) {
+    if (!pipeline || !pipeline->frontend || pipeline->thread_started) return false;
+    libretro_frontend_t* frontend = pipeline->frontend;
+
+    // Slots for the largest frame the core may send, from the session arena,
+    // so geometry changes never reallocate on either thread
+    unsigned max_width = frontend->max_width > frontend->width ? frontend->max_width : frontend->width;
+    unsigned max_height = frontend->max_height > frontend->height ? frontend->max_height : frontend->height;
+    size_t pixels = (size_t)max_width * max_height;
+    if (pixels > 0 &&
+        libretro_arena_reserve(&frontend->arena, (LIBRETRO_PIPELINE_SLOTS + 1) * libretro_arena_aligned_size(pixels * 4))) {
+        for (int i = 0; i < LIBRETRO_PIPELINE_SLOTS; i++) {
+            libretro_pipeline_frame_t* frame = &pipeline->frames[i];
+            void* data = libretro_arena_grow(&frontend->arena, frame->data, &frame->capacity, pixels * 4);
+            if (data) frame->data = data;
+        }
+        size_t capacity = pipeline->convert_capacity * sizeof(uint32_t);
+        uint32_t* buffer = (uint32_t*)libretro_arena_grow(&frontend->arena, pipeline->convert_buffer,
+                                                          &capacity, pixels * sizeof(uint32_t));
+        if (buffer) {
+            pipeline->convert_buffer = buffer;
+            pipeline->convert_capacity = capacity / sizeof(uint32_t);
+        }
+    }
+
+    // Route video frames into the triple buffer before the first threaded retro_run
+    pipeline->frontend->pipeline = pipeline;
+    pipeline->running = true;
+    if (pthread_create(&pipeline->thread, NULL, pipeline_thread, pipeline) != 0) {
+        fprintf(stderr, "Failed to start emulation thread\n");
+        pipeline->running = false;
+        pipeline->frontend->pipeline = NULL;
+        return false;
+    }
+    pipeline->thread_started = true;
+    return true;
+}
+
+void libretro_pipeline_stop(libretro_pipeline_t* pipeline) {
+    if (!pipeline || !pipeline->thread_started) return;
+    __atomic_store_n(&pipeline->running, false, __ATOMIC_RELEASE);
+    pthread_join(pipeline->thread, NULL);
+    pipeline->thread_started = false;
+    pipeline->frontend->pipeline = NULL;
+}
+
+void libretro_pipeline_free(libretro_pipeline_t* pipeline) {
+    if (!pipeline) return;
+    libretro_pipeline_stop(pipeline);
+    // Slots and the conversion buffer belong to the frontend's session arena
+    memset(pipeline, 0, sizeof(*pipeline));
+}
+
+void libretro_pipeline_request_reset(libretro_pipeline_t* pipeline) {
+    if (!pipeline) return;
+    __atomic_store_n(&pipeline->reset_requested, true, __ATOMIC_RELEASE);
+}
+
+bool libretro_pipeline_submit(libretro_pipeline_t* pipeline, const void* data,
+                              unsigned width, unsigned height, size_t pitch, unsigned format,
+                              unsigned display_width, unsigned display_height) {
+    if (!pipeline || !data || width == 0 || height == 0) return false;
+
+    // The core's buffer is only valid until the next retro_run, so the rows
+    // are copied out; the render thread converts them later
+    size_t bytes_per_pixel = (format == RETRO_PIXEL_FORMAT_XRGB8888) ? 4 : 2;
+    size_t row_bytes = (size_t)width * bytes_per_pixel;
+    size_t needed = row_bytes * height;
+
+    libretro_pipeline_frame_t* frame = &pipeline->frames[pipeline->write_index];
+    if (needed > frame->capacity) {
+        void* buffer = libretro_arena_grow(&pipeline->frontend->arena, frame->data, &frame->capacity, needed);
+        if (!buffer) {
+            fprintf(stderr, "Failed to allocate %zu byte pipeline frame\n", needed);
+            return false;
+        }
+        frame->data = buffer;
+    }
+
+    if (pitch == row_bytes) {
+        memcpy(frame->data, data, needed);
+    } else {
+        for (unsigned y = 0; y < height; y++) {
+            memcpy((uint8_t*)frame->data + y * row_bytes, (const uint8_t*)data + y * pitch, row_bytes);
+        }
+    }
+    frame->width = width;
+    frame->height = height;
+    frame->pitch = row_bytes;
+    frame->format = format;
+    frame->display_width = display_width;
+    frame->display_height = display_height;
+    frame->sequence = ++pipeline->frames_submitted;
+
+    // Publish: swap our finished slot with the ready one
+    unsigned previous = __atomic_exchange_n(&pipeline->ready, pipeline->write_index | LIBRETRO_PIPELINE_FRESH,
+                                            __ATOMIC_ACQ_REL);
+    pipeline->write_index = previous & LIBRETRO_PIPELINE_INDEX_MASK;
+    return true;
+}
+
+const libretro_pipeline_frame_t* libretro_pipeline_acquire(libretro_pipeline_t* pipeline) {
+    if (!pipeline) return NULL;
+    if (!(__atomic_load_n(&pipeline->ready, __ATOMIC_ACQUIRE) & LIBRETRO_PIPELINE_FRESH)) {
+        return NULL;
+    }
+
+    // Hand back the slot we were reading and take the newest one
+    unsigned previous = __atomic_exchange_n(&pipeline->ready, pipeline->read_index, __ATOMIC_ACQ_REL);
+    pipeline->read_index = previous & LIBRETRO_PIPELINE_INDEX_MASK;
+    pipeline->frames_acquired++;
+    return &pipeline->frames[pipeline->read_index];
+}
+
+const uint32_t* libretro_pipeline_convert(libretro_pipeline_t* pipeline, const libretro_pipeline_frame_t* frame) {
+    if (!pipeline || !frame || !frame->data) return NULL;
+
+    size_t pixels = (size_t)frame->width * frame->height;
+    if (pixels == 0) return NULL;
+    if (pixels > pipeline->convert_capacity) {
+        size_t capacity = pipeline->convert_capacity * sizeof(uint32_t);
+        uint32_t* buffer = (uint32_t*)libretro_arena_grow(&pipeline->frontend->arena, pipeline->convert_buffer,
+                                                          &capacity, pixels * sizeof(uint32_t));
+        if (!buffer) {
+            fprintf(stderr, "Failed to allocate pipeline conversion buffer\n");
+            return NULL;
+        }
+        pipeline->convert_buffer = buffer;
+        pipeline->convert_capacity = capacity / sizeof(uint32_t);
+    }
+
+    if (!libretro_video_convert_frame(pipeline->convert_buffer, frame->data, frame->width, frame->height,
+                                      frame->pitch, frame->format)) {
+        return NULL;
+    }
+    return pipeline->convert_buffer;
+}
@@ -0,0 +1,148 @@
+/*
+ * libretro_pipeline.h - Threaded Emulation/Render Pipeline
+ *
+ * Copyright (c) 2024 mikedx
+ * GitHub: https://github.com/mikedx/libretro_raylib
+ *
+ * This file is part of libretro_raylib.
+ *
+ * libretro_raylib is free software: you can redistribute it and/or modify
+ * it under the terms of the MIT License.
+ *
+ * Optional pipelined mode: retro_run executes on an emulation thread paced to
+ * the core's fps (by libretro_pacing), and each frame's raw pixels are copied into a lock-free
+ * triple buffer. The render thread picks up the newest frame, converts it if
+ * needed, uploads and presents it, so vsync or a slow GPU upload never stalls
+ * the core. Frames the renderer is too slow to show are simply overwritten.
+ */
+
+#ifndef LIBRETRO_PIPELINE_H
+#define LIBRETRO_PIPELINE_H
+
+#include "libretro_frontend.h"
+#include "libretro_pacing.h"
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+//=============================================================================
+// Pipeline Structures
+//=============================================================================
+
+#define LIBRETRO_PIPELINE_SLOTS 3
+
+/**
+ * One raw frame as the core produced it (rows repacked to pitch = width * bpp)
+ */
+typedef struct {
+    void* data;                 // Raw pixels in the core's format
+    size_t capacity;            // Allocated size in bytes
+    unsigned width;             // Frame width from the video callback
+    unsigned height;            // Frame height from the video callback
+    size_t pitch;               // Bytes per row in data
+    unsigned format;            // RETRO_PIXEL_FORMAT_*
+    unsigned display_width;     // Display size from AV info at submit time
+    unsigned display_height;
+    uint64_t sequence;          // Emulated frame number
+} libretro_pipeline_frame_t;
+
+/**
+ * Pipeline state
+ * Slot ownership: write_index belongs to the emulation thread, read_index to
+ * the render thread, and ready is exchanged between them atomically
+ */
+typedef struct libretro_pipeline {
+    libretro_frontend_t* frontend;
+    libretro_pipeline_frame_t frames[LIBRETRO_PIPELINE_SLOTS];
+    unsigned write_index;       // Emulation thread only
+    unsigned read_index;        // Render thread only
+    unsigned ready;             // Shared: slot index | LIBRETRO_PIPELINE_FRESH
+
+    pthread_t thread;
+    bool thread_started;
+    bool running;               // Cleared to stop the emulation thread
+    bool reset_requested;       // Set by the render thread, handled between frames
+    libretro_pacing_t* pacing;  // Paces the emulation thread (NULL = timer at the core's fps); set before start
+
+    // Render-side conversion target for frames that can't be uploaded as-is
+    uint32_t* convert_buffer;
+    size_t convert_capacity;    // In pixels
+
+    // Statistics
+    uint64_t frames_run;        // retro_run calls on the emulation thread
+    uint64_t frames_submitted;  // Frames copied into the triple buffer
+    uint64_t frames_acquired;   // Frames picked up by the render thread
+} libretro_pipeline_t;
+
+//=============================================================================
+// Public API Functions
+//=============================================================================
+
+/**
+ * Initialize the pipeline (does not start the thread)
+ * @param pipeline Pipeline to initialize
+ * @param frontend Frontend with a loaded core and content
+ * @return true on success
+ */
+bool libretro_pipeline_init(libretro_pipeline_t* pipeline, libretro_frontend_t* frontend);
+
+/**
+ * Start running the core on the emulation thread
+ * From here on only the emulation thread may call into the core
+ * @param pipeline Pipeline
+ * @return true if the thread started
+ */
+bool libretro_pipeline_start(libretro_pipeline_t* pipeline);
+
+/**
+ * Stop and join the emulation thread
+ * @param pipeline Pipeline
+ */
+void libretro_pipeline_stop(libretro_pipeline_t* pipeline);
+
+/**
+ * Stop the pipeline and free its buffers
+ * @param pipeline Pipeline
+ */
+void libretro_pipeline_free(libretro_pipeline_t* pipeline);
+
+/**
+ * Ask the emulation thread to reset the core before its next frame
+ * @param pipeline Pipeline
+ */
+void libretro_pipeline_request_reset(libretro_pipeline_t* pipeline);
+
+/**
+ * Emulation thread: copy a frame from the video callback into the triple buffer
+ * @param pipeline Pipeline
+ * @param data Frame data from the core
+ * @param width Frame width
+ * @param height Frame height
+ * @param pitch Source pitch in bytes
+ * @param format RETRO_PIXEL_FORMAT_*
+ * @param display_width Display width from AV info
+ * @param display_height Display height from AV info
+ * @return true if the frame was published
+ */
+bool libretro_pipeline_submit(libretro_pipeline_t* pipeline, const void* data,
+                              unsigned width, unsigned height, size_t pitch, unsigned format,
+                              unsigned display_width, unsigned display_height);
+
+/**
+ * Render thread: take the newest published frame
+ * The frame stays valid until the next call
+ * @param pipeline Pipeline
+ * @return Newest frame, or NULL if nothing new was published since the last call
+ */
+const libretro_pipeline_frame_t* libretro_pipeline_acquire(libretro_pipeline_t* pipeline);
+
+/**
+ * Render thread: convert a frame to RGBA8888 at its own size
+ * @param pipeline Pipeline
+ * @param frame Frame from libretro_pipeline_acquire
+ * @return width * height pixels, or NULL on failure
+ */
+const uint32_t* libretro_pipeline_convert(libretro_pipeline_t* pipeline, const libretro_pipeline_frame_t* frame);
+
+#endif // LIBRETRO_PIPELINE_H
@@ -0,0 +1,119 @@
+/*
+ * libretro_resampler.c - Audio Resampler with Dynamic Rate Control Implementation
+ *
+ * Copyright (c) 2024 mikedx
+ * GitHub: https://github.com/mikedx/libretro_raylib
+ *
+ * This file is part of libretro_raylib.
+ *
+ * libretro_raylib is free software: you can redistribute it and/or modify
+ * it under the terms of the MIT License.
+ */
+
+#include "libretro_resampler.h"
+#include <string.h>
+#include <math.h>
+
+#if defined(__SSE2__) || defined(__x86_64__) || defined(_M_X64)
+#define LIBRETRO_RESAMPLER_HAVE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define LIBRETRO_RESAMPLER_HAVE_NEON 1
+#include <arm_neon.h>
+#endif
+
+void libretro_resampler_init(libretro_resampler_t* resampler, double input_rate, double output_rate) {
+    if (!resampler) return;
+    memset(resampler, 0, sizeof(*resampler));
+    resampler->input_rate = (input_rate > 0.0) ? input_rate : 44100.0;
+    resampler->output_rate = (output_rate > 0.0) ? output_rate : 48000.0;
+    resampler->max_deviation = LIBRETRO_RESAMPLER_DEFAULT_DEVIATION;
+}
+
+void libretro_resampler_set_input_rate(libretro_resampler_t* resampler, double input_rate) {
+    if (!resampler || input_rate <= 0.0) return;
+    resampler->input_rate = input_rate;
+}
+
+double libretro_resampler_drc_ratio(const libretro_resampler_t* resampler, size_t free_frames, size_t capacity) {
+    double ratio = resampler->output_rate / resampler->input_rate;
+    if (capacity == 0) return ratio;
+
+    // direction is +1 when the ring is empty (produce more), -1 when full
+    double half = (double)capacity / 2.0;
+    double direction = ((double)free_frames - half) / half;
+    if (direction > 1.0) direction = 1.0;
+    if (direction < -1.0) direction = -1.0;
+
+    return ratio * (1.0 + resampler->max_deviation * direction);
+}
+
+size_t libretro_resampler_max_output(size_t in_frames, double ratio) {
+    return (size_t)ceil((double)in_frames * ratio) + 2;
+}
+
+size_t libretro_resampler_process(libretro_resampler_t* resampler, const float* in, size_t in_frames,
+                                  float* out, double ratio) {
+    if (!resampler || !in || !out || ratio <= 0.0) return 0;
+
+    const double step = 1.0 / ratio; // Input frames advanced per output frame
+    double phase = resampler->phase;
+    float (*h)[2] = resampler->history;
+    size_t produced = 0;
+
+    for (size_t i = 0; i < in_frames; i++) {
+        // Shift the new frame into the four-tap window
+        memmove(h[0], h[1], 3 * sizeof(h[0]));
+        h[3][0] = in[i * 2];
+        h[3][1] = in[i * 2 + 1];
+
+        // Emit every output sample that falls between h[1] and h[2]
+        while (phase < 1.0) {
+            float t = (float)phase;
+            for (int c = 0; c < 2; c++) {
+                float p0 = h[0][c], p1 = h[1][c], p2 = h[2][c], p3 = h[3][c];
+                float a = -0.5f * p0 + 1.5f * p1 - 1.5f * p2 + 0.5f * p3;
+                float b = p0 - 2.5f * p1 + 2.0f * p2 - 0.5f * p3;
+                float d = 0.5f * (p2 - p0);
+                out[produced * 2 + c] = ((a * t + b) * t + d) * t + p1;
+            }
+            produced++;
+            phase += step;
+        }
+        phase -= 1.0;
+    }
+
+    resampler->phase = phase;
+    return produced;
+}
+
+void libretro_resampler_s16_to_float(float* dst, const int16_t* src, size_t samples) {
+    const float scale = 1.0f / 32768.0f;
+    size_t i = 0;
+
+#if defined(LIBRETRO_RESAMPLER_HAVE_SSE2)
+    const __m128 vscale = _mm_set1_ps(scale);
+    for (; i + 8 <= samples; i += 8) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(src + i));
+        // Sign-extend by placing each int16 in the high half and shifting back down
+        __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+        __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+        _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), vscale));
+        _mm_storeu_ps(dst + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), vscale));
+    }
+#elif defined(LIBRETRO_RESAMPLER_HAVE_NEON)
+    for (; i + 8 <= samples; i += 8) {
+        int16x8_t v = vld1q_s16(src + i);
+        float32x4_t lo = vcvtq_f32_s32(vmovl_s16(vget_low_s16(v)));
+        float32x4_t hi = vcvtq_f32_s32(vmovl_s16(vget_high_s16(v)));
+        vst1q_f32(dst + i, vmulq_n_f32(lo, scale));
+        vst1q_f32(dst + i + 4, vmulq_n_f32(hi, scale));
+    }
+#endif
+
+    for (; i < samples; i++) {
+        dst[i] = (float)src[i] * scale;
+    }
+}
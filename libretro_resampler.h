@@ -0,0 +1,100 @@
+/*
+ * libretro_resampler.h - Audio Resampler with Dynamic Rate Control
+ *
+ * Copyright (c) 2024 mikedx
+ * GitHub: https://github.com/mikedx/libretro_raylib
+ *
+ * This file is part of libretro_raylib.
+ *
+ * libretro_raylib is free software: you can redistribute it and/or modify
+ * it under the terms of the MIT License.
+ *
+ * Streaming cubic (Catmull-Rom) resampler that sits between the core's audio
+ * callbacks and the ring buffer. The output device runs at its own rate; the
+ * ratio is nudged by up to max_deviation based on ring fill level (RetroArch's
+ * dynamic rate control), so the ring hovers around half full instead of
+ * drifting into overruns or underruns.
+ */
+
+#ifndef LIBRETRO_RESAMPLER_H
+#define LIBRETRO_RESAMPLER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+//=============================================================================
+// Resampler Structure
+//=============================================================================
+
+// Default maximum ratio deviation for dynamic rate control (0.5%, inaudible)
+#define LIBRETRO_RESAMPLER_DEFAULT_DEVIATION 0.005
+
+/**
+ * Resampler state (stereo)
+ */
+typedef struct {
+    double input_rate;      // Core sample rate (Hz)
+    double output_rate;     // Device sample rate (Hz)
+    double max_deviation;   // Maximum DRC ratio adjustment (fraction)
+    double phase;           // Position between history[1] and history[2], [0, 1)
+    float history[4][2];    // Last four input frames (cubic taps)
+} libretro_resampler_t;
+
+//=============================================================================
+// Public API Functions
+//=============================================================================
+
+/**
+ * Initialize the resampler
+ * @param resampler Resampler to initialize
+ * @param input_rate Core sample rate in Hz
+ * @param output_rate Device sample rate in Hz
+ */
+void libretro_resampler_init(libretro_resampler_t* resampler, double input_rate, double output_rate);
+
+/**
+ * Change the input rate (core reported a new sample rate); keeps history
+ * @param resampler Resampler
+ * @param input_rate Core sample rate in Hz
+ */
+void libretro_resampler_set_input_rate(libretro_resampler_t* resampler, double input_rate);
+
+/**
+ * Compute the output/input ratio for the current ring fill level
+ * @param resampler Resampler
+ * @param free_frames Writable frames in the output ring
+ * @param capacity Ring capacity in frames
+ * @return Ratio to pass to libretro_resampler_process
+ */
+double libretro_resampler_drc_ratio(const libretro_resampler_t* resampler, size_t free_frames, size_t capacity);
+
+/**
+ * Maximum number of output frames process() can produce for an input count
+ * @param in_frames Input frames
+ * @param ratio Output/input ratio
+ * @return Upper bound on output frames
+ */
+size_t libretro_resampler_max_output(size_t in_frames, double ratio);
+
+/**
+ * Resample interleaved stereo float frames
+ * @param resampler Resampler
+ * @param in Input frames
+ * @param in_frames Number of input frames
+ * @param out Output frames (at least libretro_resampler_max_output() frames)
+ * @param ratio Output/input ratio (from libretro_resampler_drc_ratio)
+ * @return Number of output frames produced
+ */
+size_t libretro_resampler_process(libretro_resampler_t* resampler, const float* in, size_t in_frames,
+                                  float* out, double ratio);
+
+/**
+ * Convert int16 samples to float in [-1, 1) (SSE2/NEON when available)
+ * @param dst Output samples
+ * @param src Input samples
+ * @param samples Number of samples (frames * channels)
+ */
+void libretro_resampler_s16_to_float(float* dst, const int16_t* src, size_t samples);
+
+#endif // LIBRETRO_RESAMPLER_H
@@ -0,0 +1,383 @@
+/*
+ * libretro_rewind.c - Rewind Buffer Implementation
+ *
+ * Copyright (c) 2024 mikedx
+ * GitHub: https://github.com/mikedx/libretro_raylib
+ *
+ * This file is part of libretro_raylib.
+ *
+ * libretro_raylib is free software: you can redistribute it and/or modify
+ * it under the terms of the MIT License.
+ */
+
+#include "libretro_rewind.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define REWIND_ENTRY_MASK (LIBRETRO_REWIND_MAX_ENTRIES - 1)
+
+// Unchanged bytes inside a run of changed ones are copied as literals unless
+// there are at least this many; shorter runs cost more to encode than to copy
+#define REWIND_MIN_ZERO_RUN 16
+
+// Longest LEB128 encoding of a size_t
+#define REWIND_MAX_VARINT 10
+
+//=============================================================================
+// Delta Encoding
+//
+// A compressed delta is a sequence of (skip, count, count XOR bytes) records,
+// skip and count as LEB128 varints: skip unchanged bytes, then XOR the next
+// count bytes. An uncompressed delta is the plain XOR of the two states.
+//=============================================================================
+
+/**
+ * Worst-case encoded size: every record but the first covers at least
+ * REWIND_MIN_ZERO_RUN unchanged bytes
+ */
+static size_t delta_bound(size_t size) {
+    return size + (size / REWIND_MIN_ZERO_RUN + 2) * 2 * REWIND_MAX_VARINT;
+}
+
+/**
+ * Number of equal bytes in a and b starting at pos, at most limit (0 = no limit)
+ */
+static size_t match_length(const uint8_t* a, const uint8_t* b, size_t pos, size_t size, size_t limit) {
+    size_t start = pos;
+    size_t end = (limit && limit < size - pos) ? pos + limit : size;
+    while (pos + 8 <= end) {
+        uint64_t x, y;
+        memcpy(&x, a + pos, 8);
+        memcpy(&y, b + pos, 8);
+        if (x != y) break;
+        pos += 8;
+    }
+    while (pos < end && a[pos] == b[pos]) pos++;
+    return pos - start;
+}
+
+static size_t put_varint(uint8_t* out, size_t value) {
+    size_t n = 0;
+    while (value >= 0x80) {
+        out[n++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    out[n++] = (uint8_t)value;
+    return n;
+}
+
+static bool get_varint(const uint8_t* in, size_t length, size_t* pos, size_t* value) {
+    size_t result = 0;
+    for (unsigned shift = 0; *pos < length && shift < 7 * REWIND_MAX_VARINT; shift += 7) {
+        uint8_t byte = in[(*pos)++];
+        result |= (size_t)(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            *value = result;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Encode a XOR b into out (at least delta_bound(size) bytes)
+ * @return Encoded length
+ */
+static size_t delta_encode(const uint8_t* a, const uint8_t* b, size_t size, uint8_t* out) {
+    size_t pos = 0, n = 0;
+    while (pos < size) {
+        size_t skip = match_length(a, b, pos, size, 0);
+        pos += skip;
+
+        size_t start = pos;
+        while (pos < size) {
+            if (a[pos] != b[pos]) {
+                pos++;
+                continue;
+            }
+            size_t run = match_length(a, b, pos, size, REWIND_MIN_ZERO_RUN);
+            if (run == REWIND_MIN_ZERO_RUN || pos + run == size) break;
+            pos += run;
+        }
+
+        n += put_varint(out + n, skip);
+        n += put_varint(out + n, pos - start);
+        for (size_t i = start; i < pos; i++) {
+            out[n++] = a[i] ^ b[i];
+        }
+    }
+    return n;
+}
+
+static void xor_bytes(uint8_t* dst, const uint8_t* src, size_t size) {
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t x, y;
+        memcpy(&x, dst + i, 8);
+        memcpy(&y, src + i, 8);
+        x ^= y;
+        memcpy(dst + i, &x, 8);
+    }
+    for (; i < size; i++) dst[i] ^= src[i];
+}
+
+/**
+ * Apply a delta to state in place
+ * @return false if the delta is malformed
+ */
+static bool delta_apply(uint8_t* state, size_t size, const uint8_t* delta, size_t length, bool compressed) {
+    if (!compressed) {
+        if (length != size) return false;
+        xor_bytes(state, delta, size);
+        return true;
+    }
+
+    size_t in = 0, pos = 0;
+    while (in < length) {
+        size_t skip, count;
+        if (!get_varint(delta, length, &in, &skip) || !get_varint(delta, length, &in, &count)) return false;
+        if (skip > size - pos || count > size - pos - skip || count > length - in) return false;
+        pos += skip;
+        xor_bytes(state + pos, delta + in, count);
+        pos += count;
+        in += count;
+    }
+    return true;
+}
+
+//=============================================================================
+// Arena
+//=============================================================================
+
+static void rewind_drop_oldest(libretro_rewind_t* rewind) {
+    rewind->entry_tail++;
+}
+
+static void rewind_clear_history(libretro_rewind_t* rewind) {
+    rewind->entry_head = rewind->entry_tail = 0;
+    rewind->arena_head = 0;
+}
+
+/**
+ * Reserve length bytes for a new newest delta, dropping the oldest ones
+ * until it fits
+ * @return Arena pointer, or NULL if the delta is larger than the arena
+ */
+static uint8_t* rewind_reserve(libretro_rewind_t* rewind, size_t length) {
+    if (length == 0 || length > rewind->arena_size) return NULL;
+    if (rewind->entry_head - rewind->entry_tail == LIBRETRO_REWIND_MAX_ENTRIES) {
+        rewind_drop_oldest(rewind);
+    }
+
+    size_t pos = rewind->arena_head;
+    if (pos + length > rewind->arena_size) {
+        // Wrap: whatever lies past the write position is older than anything
+        // before it, so it goes first
+        while (rewind->entry_head != rewind->entry_tail &&
+               rewind->entries[rewind->entry_tail & REWIND_ENTRY_MASK].offset >= rewind->arena_head) {
+            rewind_drop_oldest(rewind);
+        }
+        pos = 0;
+    }
+    while (rewind->entry_head != rewind->entry_tail) {
+        const libretro_rewind_entry_t* oldest = &rewind->entries[rewind->entry_tail & REWIND_ENTRY_MASK];
+        if (oldest->offset >= pos + length || oldest->offset + oldest->length <= pos) break;
+        rewind_drop_oldest(rewind);
+    }
+
+    libretro_rewind_entry_t* entry = &rewind->entries[rewind->entry_head & REWIND_ENTRY_MASK];
+    entry->offset = pos;
+    entry->length = length;
+    rewind->entry_head++;
+    rewind->arena_head = pos + length;
+    return rewind->arena + pos;
+}
+
+/**
+ * (Re)allocate the state buffers for a state size; drops the history
+ */
+static bool rewind_resize_state(libretro_rewind_t* rewind, size_t size) {
+    free(rewind->current);
+    free(rewind->scratch);
+    free(rewind->delta);
+    rewind->current = (uint8_t*)malloc(size);
+    rewind->scratch = (uint8_t*)malloc(size);
+    rewind->delta = (uint8_t*)malloc(delta_bound(size));
+    rewind->state_size = size;
+    rewind->have_current = false;
+    rewind_clear_history(rewind);
+
+    if (!rewind->current || !rewind->scratch || !rewind->delta) {
+        fprintf(stderr, "Failed to allocate rewind buffers for a %zu byte state\n", size);
+        free(rewind->current);
+        free(rewind->scratch);
+        free(rewind->delta);
+        rewind->current = rewind->scratch = rewind->delta = NULL;
+        rewind->state_size = 0;
+        return false;
+    }
+    return true;
+}
+
+//=============================================================================
+// Public API
+//=============================================================================
+
+bool libretro_rewind_init(libretro_rewind_t* rewind, libretro_frontend_t* frontend,
+                          unsigned memory_mb, unsigned interval, bool compress) {
+    if (!rewind || !frontend) return false;
+    memset(rewind, 0, sizeof(*rewind));
+    rewind->frontend = frontend;
+
+    struct retro_core_t* core = frontend->core;
+    if (!core || !core->retro_serialize_size || !core->retro_serialize || !core->retro_unserialize) {
+        fprintf(stderr, "Rewind unavailable: core does not export savestate functions\n");
+        return false;
+    }
+    size_t size = core->retro_serialize_size();
+    if (size == 0) {
+        fprintf(stderr, "Rewind unavailable: core reports no savestate size\n");
+        return false;
+    }
+
+    rewind->arena_size = (size_t)(memory_mb ? memory_mb : LIBRETRO_REWIND_DEFAULT_MB) << 20;
+    rewind->arena = (uint8_t*)malloc(rewind->arena_size);
+    rewind->entries = (libretro_rewind_entry_t*)calloc(LIBRETRO_REWIND_MAX_ENTRIES, sizeof(libretro_rewind_entry_t));
+    if (!rewind->arena || !rewind->entries || !rewind_resize_state(rewind, size)) {
+        fprintf(stderr, "Rewind unavailable: failed to allocate %zu MB arena\n", rewind->arena_size >> 20);
+        libretro_rewind_free(rewind);
+        return false;
+    }
+    rewind->interval = interval ? interval : LIBRETRO_REWIND_DEFAULT_INTERVAL;
+    rewind->compress = compress;
+
+    frontend->rewind = rewind;
+    fprintf(stderr, "Rewind: %zu MB buffer, %zu byte state, every %u frame%s%s\n",
+            rewind->arena_size >> 20, size, rewind->interval, rewind->interval == 1 ? "" : "s",
+            compress ? ", compressed" : "");
+    return true;
+}
+
+void libretro_rewind_free(libretro_rewind_t* rewind) {
+    if (!rewind) return;
+    if (rewind->frontend && rewind->frontend->rewind == rewind) {
+        rewind->frontend->rewind = NULL;
+    }
+    free(rewind->arena);
+    free(rewind->entries);
+    free(rewind->current);
+    free(rewind->scratch);
+    free(rewind->delta);
+    memset(rewind, 0, sizeof(*rewind));
+}
+
+void libretro_rewind_set_rewinding(libretro_rewind_t* rewind, bool rewinding) {
+    if (!rewind) return;
+    __atomic_store_n(&rewind->rewinding, rewinding, __ATOMIC_RELAXED);
+}
+
+size_t libretro_rewind_available(const libretro_rewind_t* rewind) {
+    return rewind ? rewind->entry_head - rewind->entry_tail : 0;
+}
+
+void libretro_rewind_capture(libretro_rewind_t* rewind) {
+    if (!rewind || !rewind->arena) return;
+    if (++rewind->frame_counter < rewind->interval) return;
+    rewind->frame_counter = 0;
+
+    libretro_frontend_t* frontend = rewind->frontend;
+    struct retro_core_t* core = frontend->core;
+    uint64_t start = frontend->perf ? libretro_perf_now_ns() : 0;
+
+    // The state size can change (e.g. a cartridge mapper switching); deltas
+    // only work between equal sizes, so history starts over
+    size_t size = core->retro_serialize_size();
+    if (size != rewind->state_size && (size == 0 || !rewind_resize_state(rewind, size))) return;
+
+    frontend->av_enable |= LIBRETRO_AV_ENABLE_FAST_SAVESTATES;
+    bool saved = core->retro_serialize(rewind->scratch, size);
+    frontend->av_enable &= ~LIBRETRO_AV_ENABLE_FAST_SAVESTATES;
+    if (!saved) {
+        static bool warned = false;
+        if (!warned) fprintf(stderr, "Rewind: retro_serialize failed\n");
+        warned = true;
+        return;
+    }
+
+    if (rewind->have_current) {
+        // Store the delta that takes the new state back to the previous one
+        bool stored = false;
+        if (rewind->compress) {
+            size_t length = delta_encode(rewind->scratch, rewind->current, size, rewind->delta);
+            uint8_t* slot = rewind_reserve(rewind, length);
+            if (slot) {
+                memcpy(slot, rewind->delta, length);
+                rewind->stored_bytes += length;
+                stored = true;
+            }
+        } else {
+            uint8_t* slot = rewind_reserve(rewind, size);
+            if (slot) {
+                memcpy(slot, rewind->current, size);
+                xor_bytes(slot, rewind->scratch, size);
+                rewind->stored_bytes += size;
+                stored = true;
+            }
+        }
+        if (stored) {
+            rewind->captures++;
+            rewind->state_bytes += size;
+        } else {
+            // A delta bigger than the whole arena breaks the chain
+            rewind_clear_history(rewind);
+        }
+    }
+
+    uint8_t* previous = rewind->current;
+    rewind->current = rewind->scratch;
+    rewind->scratch = previous;
+    rewind->have_current = true;
+
+    if (frontend->perf) libretro_perf_add(frontend->perf, LIBRETRO_PERF_REWIND, libretro_perf_now_ns() - start);
+}
+
+bool libretro_rewind_run_frame(libretro_rewind_t* rewind) {
+    if (!rewind || !rewind->arena) return false;
+    if (!__atomic_load_n(&rewind->rewinding, __ATOMIC_RELAXED)) return false;
+
+    // Out of history: hold on the oldest state until the key is released
+    if (rewind->entry_head == rewind->entry_tail || !rewind->have_current) return true;
+
+    libretro_frontend_t* frontend = rewind->frontend;
+    struct retro_core_t* core = frontend->core;
+    uint64_t start = frontend->perf ? libretro_perf_now_ns() : 0;
+
+    rewind->entry_head--;
+    const libretro_rewind_entry_t* entry = &rewind->entries[rewind->entry_head & REWIND_ENTRY_MASK];
+    rewind->arena_head = entry->offset;
+    if (!delta_apply(rewind->current, rewind->state_size, rewind->arena + entry->offset, entry->length,
+                     rewind->compress)) {
+        fprintf(stderr, "Rewind: corrupt delta, history dropped\n");
+        rewind_clear_history(rewind);
+        rewind->have_current = false;
+        return true;
+    }
+
+    frontend->av_enable = LIBRETRO_AV_ENABLE_FAST_SAVESTATES;
+    bool restored = core->retro_unserialize(rewind->current, rewind->state_size);
+    if (frontend->perf) libretro_perf_add(frontend->perf, LIBRETRO_PERF_REWIND, libretro_perf_now_ns() - start);
+    if (!restored) {
+        fprintf(stderr, "Rewind: retro_unserialize failed\n");
+        frontend->av_enable = LIBRETRO_AV_ENABLE_VIDEO | LIBRETRO_AV_ENABLE_AUDIO;
+        return true;
+    }
+
+    // Run one frame from the restored state so there is a picture to show;
+    // its audio would play forwards, so it is muted
+    frontend->av_enable = LIBRETRO_AV_ENABLE_VIDEO;
+    libretro_frontend_run_core_frame(frontend);
+    frontend->av_enable = LIBRETRO_AV_ENABLE_VIDEO | LIBRETRO_AV_ENABLE_AUDIO;
+    rewind->steps++;
+    return true;
+}
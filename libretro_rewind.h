@@ -0,0 +1,138 @@
+/*
+ * libretro_rewind.h - Rewind Buffer
+ *
+ * Copyright (c) 2024 mikedx
+ * GitHub: https://github.com/mikedx/libretro_raylib
+ *
+ * This file is part of libretro_raylib.
+ *
+ * libretro_raylib is free software: you can redistribute it and/or modify
+ * it under the terms of the MIT License.
+ *
+ * Savestate history kept as backward deltas: each capture stores
+ * previous_state XOR new_state, which turns the newest full state back into
+ * the one before it. Consecutive states differ in few bytes, so deltas are
+ * mostly zero and are run-length encoded (zero runs skipped, changed bytes
+ * copied) unless compression is turned off.
+ *
+ * Deltas live in one fixed-size arena used as a ring; when it is full the
+ * oldest deltas are dropped, so memory never grows past the configured cap.
+ * Capture and restore run inside libretro_frontend_run_frame on whichever
+ * thread runs the core.
+ */
+
+#ifndef LIBRETRO_REWIND_H
+#define LIBRETRO_REWIND_H
+
+#include "libretro_frontend.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+//=============================================================================
+// Rewind Structures
+//=============================================================================
+
+#define LIBRETRO_REWIND_DEFAULT_MB 64
+#define LIBRETRO_REWIND_DEFAULT_INTERVAL 1
+
+// Delta index size: caps history at this many captures regardless of memory
+// (about 9 minutes at 60 fps with an interval of 1); must be a power of two
+#define LIBRETRO_REWIND_MAX_ENTRIES 32768
+
+/**
+ * One stored delta in the arena
+ */
+typedef struct {
+    size_t offset;
+    size_t length;
+} libretro_rewind_entry_t;
+
+/**
+ * Rewind state
+ */
+typedef struct libretro_rewind {
+    libretro_frontend_t* frontend;
+
+    // Delta arena, used as a byte ring
+    uint8_t* arena;
+    size_t arena_size;
+    size_t arena_head;              // Next write offset
+
+    // Delta index: monotonic positions, newest at entry_head - 1
+    libretro_rewind_entry_t* entries;
+    size_t entry_head;
+    size_t entry_tail;
+
+    // Full copy of the newest captured state, plus scratch for the next one
+    uint8_t* current;
+    uint8_t* scratch;
+    uint8_t* delta;                 // Encoded delta before it is copied into the arena
+    size_t state_size;
+    bool have_current;
+
+    unsigned interval;              // Capture every N frames
+    unsigned frame_counter;
+    bool compress;                  // Run-length encode deltas
+    bool rewinding;                 // Set by the UI thread (atomic)
+
+    // Statistics
+    uint64_t captures;
+    uint64_t steps;
+    uint64_t stored_bytes;          // Arena bytes written
+    uint64_t state_bytes;           // Full state bytes those captures replaced
+} libretro_rewind_t;
+
+//=============================================================================
+// Public API Functions
+//=============================================================================
+
+/**
+ * Set up rewind for a loaded core
+ * Call after content is loaded (state size depends on the content)
+ * @param rewind Rewind state
+ * @param frontend Frontend with content loaded
+ * @param memory_mb Arena size in megabytes (0 = LIBRETRO_REWIND_DEFAULT_MB)
+ * @param interval Capture every N frames (0 = LIBRETRO_REWIND_DEFAULT_INTERVAL)
+ * @param compress Run-length encode deltas (smaller, slightly slower)
+ * @return false if the core can't serialize or allocation failed
+ */
+bool libretro_rewind_init(libretro_rewind_t* rewind, libretro_frontend_t* frontend,
+                          unsigned memory_mb, unsigned interval, bool compress);
+
+/**
+ * Detach from the frontend and free all buffers
+ * @param rewind Rewind state
+ */
+void libretro_rewind_free(libretro_rewind_t* rewind);
+
+/**
+ * Start or stop rewinding (safe to call from another thread)
+ * @param rewind Rewind state
+ * @param rewinding true while the rewind key is held
+ */
+void libretro_rewind_set_rewinding(libretro_rewind_t* rewind, bool rewinding);
+
+/**
+ * Step back one capture if rewinding (libretro_frontend_run_frame calls this
+ * before running the core)
+ * Restores the previous state and runs one frame with audio off to show it
+ * @param rewind Rewind state
+ * @return true if the frame was handled (the core must not run normally)
+ */
+bool libretro_rewind_run_frame(libretro_rewind_t* rewind);
+
+/**
+ * Capture the current state if the interval has elapsed (called by
+ * libretro_frontend_run_frame after each normal frame)
+ * @param rewind Rewind state
+ */
+void libretro_rewind_capture(libretro_rewind_t* rewind);
+
+/**
+ * Number of captures that can currently be rewound
+ * @param rewind Rewind state
+ */
+size_t libretro_rewind_available(const libretro_rewind_t* rewind);
+
+#endif // LIBRETRO_REWIND_H
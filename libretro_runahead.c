@@ -0,0 +1,201 @@
+/*
+ * libretro_runahead.c - Run-Ahead Latency Reduction Implementation
+ *
+ * Copyright (c) 2024 mikedx
+ * GitHub: https://github.com/mikedx/libretro_raylib
+ *
+ * This file is part of libretro_raylib.
+ *
+ * libretro_raylib is free software: you can redistribute it and/or modify
+ * it under the terms of the MIT License.
+ */
+
+#include "libretro_runahead.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Make sure the state buffer can hold the core's current state size
+ */
+static bool runahead_reserve(libretro_runahead_t* runahead) {
+    struct retro_core_t* core = runahead->frontend->core;
+    size_t size = core->retro_serialize_size();
+    if (size == 0) return false;
+
+    runahead->state_size = size;
+    if (size <= runahead->state_capacity) return true;
+
+    void* state = realloc(runahead->state, size);
+    if (!state) {
+        fprintf(stderr, "Failed to allocate %zu byte run-ahead state\n", size);
+        return false;
+    }
+    runahead->state = state;
+    runahead->state_capacity = size;
+    return true;
+}
+
+/**
+ * Turn run-ahead off for good and go back to plain frames
+ */
+static void runahead_fail(libretro_runahead_t* runahead, const char* reason) {
+    fprintf(stderr, "Run-ahead disabled: %s\n", reason);
+    runahead->failed = true;
+    runahead->frontend->av_enable = LIBRETRO_AV_ENABLE_VIDEO | LIBRETRO_AV_ENABLE_AUDIO;
+}
+
+bool libretro_runahead_init(libretro_runahead_t* runahead, libretro_frontend_t* frontend, unsigned frames) {
+    if (!runahead || !frontend) return false;
+    memset(runahead, 0, sizeof(*runahead));
+    runahead->frontend = frontend;
+
+    if (frames == 0) return true;
+    if (frames > LIBRETRO_RUNAHEAD_MAX_FRAMES) frames = LIBRETRO_RUNAHEAD_MAX_FRAMES;
+
+    struct retro_core_t* core = frontend->core;
+    if (!core || !core->retro_serialize_size || !core->retro_serialize || !core->retro_unserialize) {
+        fprintf(stderr, "Run-ahead unavailable: core does not export savestate functions\n");
+        return false;
+    }
+    if (!runahead_reserve(runahead)) {
+        fprintf(stderr, "Run-ahead unavailable: core reports no savestate size\n");
+        return false;
+    }
+
+    runahead->frames = frames;
+    frontend->runahead = runahead;
+    fprintf(stderr, "Run-ahead: %u frame%s, %zu byte state\n", frames, frames == 1 ? "" : "s",
+            runahead->state_size);
+    return true;
+}
+
+/**
+ * Unload the second instance; the calling thread is bound to the main
+ * frontend again afterwards
+ */
+static void runahead_free_secondary(libretro_runahead_t* runahead) {
+    if (!runahead->secondary) return;
+    // The core's retro_deinit calls back into its own frontend
+    libretro_frontend_bind_thread(runahead->secondary);
+    libretro_frontend_deinit(runahead->secondary);
+    free(runahead->secondary);
+    runahead->secondary = NULL;
+    libretro_frontend_bind_thread(runahead->frontend);
+}
+
+bool libretro_runahead_use_second_instance(libretro_runahead_t* runahead, const char* core_path,
+                                           const char* rom_path) {
+    if (!runahead || !runahead->frontend || runahead->frames == 0 || !core_path) return false;
+    libretro_frontend_t* frontend = runahead->frontend;
+    if (frontend->hw.requested) {
+        fprintf(stderr, "Run-ahead: a second instance can't share a hardware rendered core's context\n");
+        return false;
+    }
+
+    libretro_frontend_t* secondary = (libretro_frontend_t*)calloc(1, sizeof(*secondary));
+    if (!secondary || !libretro_frontend_init(secondary)) {
+        free(secondary);
+        libretro_frontend_bind_thread(frontend);
+        fprintf(stderr, "Run-ahead: failed to set up a second instance\n");
+        return false;
+    }
+    runahead->secondary = secondary;
+    secondary->native_upload = false;   // Its frames reach the screen through the main frontend
+    secondary->core_private_copy = true;
+
+    // Same option values as the main core, never written back
+    for (unsigned i = 0; i < frontend->options.count; i++) {
+        const libretro_option_t* option = &frontend->options.options[i];
+        const char* value = __atomic_load_n(&option->value, __ATOMIC_ACQUIRE);
+        if (value) libretro_options_set(&secondary->options, option->key, value);
+    }
+
+    bool loaded = libretro_frontend_load_core(secondary, core_path) &&
+                  libretro_frontend_init_core(secondary) &&
+                  libretro_frontend_load_rom(secondary, rom_path);
+    libretro_frontend_bind_thread(frontend);
+    struct retro_core_t* core = loaded ? secondary->core : NULL;
+    if (!core || !core->retro_unserialize || !core->retro_serialize_size ||
+        core->retro_serialize_size() != runahead->state_size) {
+        fprintf(stderr, "Run-ahead: failed to load a second instance of the core\n");
+        runahead_free_secondary(runahead);
+        return false;
+    }
+    fprintf(stderr, "Run-ahead: speculative frames run in a second instance\n");
+    return true;
+}
+
+void libretro_runahead_free(libretro_runahead_t* runahead) {
+    if (!runahead) return;
+    runahead_free_secondary(runahead);
+    if (runahead->frontend && runahead->frontend->runahead == runahead) {
+        runahead->frontend->runahead = NULL;
+        runahead->frontend->av_enable = LIBRETRO_AV_ENABLE_VIDEO | LIBRETRO_AV_ENABLE_AUDIO;
+    }
+    free(runahead->state);
+    memset(runahead, 0, sizeof(*runahead));
+}
+
+void libretro_runahead_run_frame(libretro_runahead_t* runahead) {
+    libretro_frontend_t* frontend = runahead->frontend;
+    struct retro_core_t* core = frontend->core;
+
+    if (runahead->failed || runahead->frames == 0) {
+        libretro_frontend_run_core_frame(frontend);
+        return;
+    }
+
+    // 1. The real frame: its audio is the one heard, its video is replaced
+    frontend->av_enable = LIBRETRO_AV_ENABLE_AUDIO;
+    libretro_frontend_run_core_frame(frontend);
+
+    // 2. Save the real timeline (the state size can change after a frame)
+    frontend->av_enable = LIBRETRO_AV_ENABLE_FAST_SAVESTATES;
+    if (!runahead_reserve(runahead) || !core->retro_serialize(runahead->state, runahead->state_size)) {
+        runahead_fail(runahead, "retro_serialize failed");
+        return;
+    }
+
+    // A second instance picks the real timeline up from the state; its
+    // callbacks land in this frontend, since this thread stays bound to it
+    struct retro_core_t* real_core = core;
+    if (runahead->secondary) {
+        if (!runahead->secondary->core->retro_unserialize(runahead->state, runahead->state_size)) {
+            runahead_fail(runahead, "the second instance's retro_unserialize failed");
+            return;
+        }
+        frontend->core = runahead->secondary->core;
+        frontend->runahead_secondary = true;
+    }
+
+    // 3. Speculative frames reuse the input just polled, so the poll handler
+    //    is skipped; only the last one is shown
+    void (*poll_handler)(void*) = frontend->input_poll_handler;
+    frontend->input_poll_handler = NULL;
+    for (unsigned i = 0; i < runahead->frames; i++) {
+        bool last = (i + 1 == runahead->frames);
+        frontend->av_enable = LIBRETRO_AV_ENABLE_HARD_DISABLE_AUDIO |
+                              (last ? LIBRETRO_AV_ENABLE_VIDEO : LIBRETRO_AV_ENABLE_FAST_SAVESTATES);
+        libretro_frontend_run_core_frame(frontend);
+    }
+    frontend->input_poll_handler = poll_handler;
+    frontend->core = real_core;
+    frontend->runahead_secondary = false;
+
+    // 4. Back to the real timeline (the real core never left it with a
+    //    second instance)
+    if (runahead->secondary) {
+        frontend->av_enable = LIBRETRO_AV_ENABLE_VIDEO | LIBRETRO_AV_ENABLE_AUDIO;
+        runahead->frames_run++;
+        return;
+    }
+    frontend->av_enable = LIBRETRO_AV_ENABLE_FAST_SAVESTATES;
+    if (!core->retro_unserialize(runahead->state, runahead->state_size)) {
+        runahead_fail(runahead, "retro_unserialize failed");
+        return;
+    }
+
+    frontend->av_enable = LIBRETRO_AV_ENABLE_VIDEO | LIBRETRO_AV_ENABLE_AUDIO;
+    runahead->frames_run++;
+}
@@ -0,0 +1,104 @@
+/*
+ * libretro_runahead.h - Run-Ahead Latency Reduction
+ *
+ * Copyright (c) 2024 mikedx
+ * GitHub: https://github.com/mikedx/libretro_raylib
+ *
+ * This file is part of libretro_raylib.
+ *
+ * libretro_raylib is free software: you can redistribute it and/or modify
+ * it under the terms of the MIT License.
+ *
+ * Hides a core's internal input lag by running ahead of the real timeline
+ * each frame:
+ *
+ *   1. run the real frame: audio on, video off
+ *   2. save state
+ *   3. run N more frames with the same input, audio off, video on only for
+ *      the last one, so the frame shown is N frames in the future
+ *   4. restore the state saved in step 2
+ *
+ * With a second instance (libretro_runahead_use_second_instance), step 3
+ * runs in a private copy of the core that the state is loaded into instead,
+ * so the real core is never rolled back (step 4 goes away). This helps cores
+ * whose audio or timing glitches when they are restored, at the price of a
+ * second copy of the core and its content in memory. Its callbacks go to the
+ * main frontend while it runs, so its last frame is the one shown, and it
+ * reads the same input and options; the AV info and geometry it sets are
+ * ignored (the real core sets them when it gets there) and it renders into
+ * its own framebuffer.
+ *
+ * The state buffer is allocated once and only grows if the core's state
+ * size does, so a frame does no allocation.
+ */
+
+#ifndef LIBRETRO_RUNAHEAD_H
+#define LIBRETRO_RUNAHEAD_H
+
+#include "libretro_frontend.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+//=============================================================================
+// Run-Ahead Structure
+//=============================================================================
+
+// Most frames a core is run ahead; more costs N+1 retro_runs per frame
+#define LIBRETRO_RUNAHEAD_MAX_FRAMES 6
+
+/**
+ * Run-ahead state
+ */
+typedef struct libretro_runahead {
+    libretro_frontend_t* frontend;
+    unsigned frames;            // Frames to run ahead (0 = off)
+    void* state;                // Savestate after the real frame
+    size_t state_capacity;      // Allocated bytes
+    size_t state_size;          // Bytes used by the last save
+    uint64_t frames_run;        // Real frames run with run-ahead
+    bool failed;                // Core can't serialize; run-ahead disabled
+    libretro_frontend_t* secondary; // Second instance running the speculative frames (NULL = none)
+} libretro_runahead_t;
+
+//=============================================================================
+// Public API Functions
+//=============================================================================
+
+/**
+ * Set up run-ahead for a loaded core
+ * Call after content is loaded (state size depends on the content)
+ * @param runahead Run-ahead state
+ * @param frontend Frontend with content loaded
+ * @param frames Frames to run ahead (clamped to LIBRETRO_RUNAHEAD_MAX_FRAMES)
+ * @return false if the core can't serialize (run-ahead stays off)
+ */
+bool libretro_runahead_init(libretro_runahead_t* runahead, libretro_frontend_t* frontend, unsigned frames);
+
+/**
+ * Run the speculative frames in a second instance of the core
+ * Call after libretro_runahead_init, on a thread bound to the frontend.
+ * Loads a private copy of the core and the same content, with the
+ * frontend's current option values.
+ * @param runahead Run-ahead state (with frames set)
+ * @param core_path Core the frontend loaded
+ * @param rom_path Content the frontend loaded (NULL = no game)
+ * @return false if it couldn't be loaded (run-ahead stays single instance)
+ */
+bool libretro_runahead_use_second_instance(libretro_runahead_t* runahead, const char* core_path,
+                                           const char* rom_path);
+
+/**
+ * Detach from the frontend, unload any second instance and free the state
+ * buffer
+ * @param runahead Run-ahead state
+ */
+void libretro_runahead_free(libretro_runahead_t* runahead);
+
+/**
+ * Run one real frame with run-ahead (libretro_frontend_run_frame calls this
+ * while run-ahead is attached)
+ * @param runahead Run-ahead state
+ */
+void libretro_runahead_run_frame(libretro_runahead_t* runahead);
+
+#endif // LIBRETRO_RUNAHEAD_H
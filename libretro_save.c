@@ -0,0 +1,389 @@
+/*
+ * libretro_save.c - Savestate Slots and SRAM Persistence Implementation
+ *
+ * Copyright (c) 2024 mikedx
+ * GitHub: https://github.com/mikedx/libretro_raylib
+ *
+ * This file is part of libretro_raylib.
+ *
+ * libretro_raylib is free software: you can redistribute it and/or modify
+ * it under the terms of the MIT License.
+ */
+
+#include "libretro_save.h"
+#include "libretro.h"
+#include "libretro_file.h"
+#include "libretro_perf.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <zlib.h>
+
+// gzread/gzwrite take unsigned lengths, so large buffers go in chunks
+#define SAVE_IO_CHUNK (1u << 20)
+
+//=============================================================================
+// I/O Thread
+//=============================================================================
+
+/**
+ * Write a job's buffer to a temporary file and rename it into place
+ */
+static bool save_write_job(const libretro_save_job_t* job) {
+    libretro_file_write_t writer;
+    if (!libretro_file_begin_write(&writer, job->path)) return false;
+
+    bool ok;
+    if (job->compress) {
+        gzFile gz = gzdopen(writer.fd, "wb6");
+        if (!gz) close(writer.fd);
+        ok = gz != NULL;
+        for (size_t done = 0; ok && done < job->size;) {
+            unsigned chunk = (unsigned)((job->size - done < SAVE_IO_CHUNK) ? job->size - done : SAVE_IO_CHUNK);
+            ok = gzwrite(gz, job->data + done, chunk) == (int)chunk;
+            done += chunk;
+        }
+        if (gz && gzclose(gz) != Z_OK) ok = false;
+    } else {
+        FILE* file = fdopen(writer.fd, "wb");
+        if (!file) close(writer.fd);
+        ok = file && fwrite(job->data, 1, job->size, file) == job->size;
+        if (file && fclose(file) != 0) ok = false;
+    }
+    return libretro_file_end_write(&writer, ok);
+}
+
+/**
+ * Read a (possibly gzip compressed) file into a job's buffer, growing it
+ */
+static bool save_read_job(libretro_save_job_t* job) {
+    gzFile gz = gzopen(job->path, "rb");
+    if (!gz) return false;
+    job->size = 0;
+    bool ok = true;
+    for (;;) {
+        if (job->capacity - job->size < SAVE_IO_CHUNK) {
+            size_t capacity = job->capacity + SAVE_IO_CHUNK;
+            uint8_t* data = (uint8_t*)realloc(job->data, capacity);
+            if (!data) {
+                ok = false;
+                break;
+            }
+            job->data = data;
+            job->capacity = capacity;
+        }
+        int n = gzread(gz, job->data + job->size, SAVE_IO_CHUNK);
+        if (n < 0) ok = false;
+        if (n <= 0) break;
+        job->size += (size_t)n;
+    }
+    gzclose(gz);
+    return ok && job->size > 0;
+}
+
+static void* save_io_thread(void* arg) {
+    libretro_save_t* save = (libretro_save_t*)arg;
+    libretro_save_job_t* jobs[3] = { &save->sram_job, &save->state_job, &save->load_job };
+
+    pthread_mutex_lock(&save->mutex);
+    for (;;) {
+        libretro_save_job_t* job = NULL;
+        int state = LIBRETRO_SAVE_JOB_FREE;
+        for (int i = 0; i < 3 && !job; i++) {
+            state = __atomic_load_n(&jobs[i]->state, __ATOMIC_ACQUIRE);
+            if (state == LIBRETRO_SAVE_JOB_WRITE || state == LIBRETRO_SAVE_JOB_READ) job = jobs[i];
+        }
+        if (!job) {
+            if (save->quit) break;
+            pthread_cond_wait(&save->cond, &save->mutex);
+            continue;
+        }
+        pthread_mutex_unlock(&save->mutex);
+
+        // The emulation thread doesn't touch a queued job until it is handed back
+        int next;
+        if (state == LIBRETRO_SAVE_JOB_WRITE) {
+            job->failed = !save_write_job(job);
+            if (job->failed) {
+                fprintf(stderr, "Save: failed to write %s\n", job->path);
+            } else if (job == &save->state_job) {
+                fprintf(stderr, "Saved state to slot %u\n", job->slot);
+            }
+            next = LIBRETRO_SAVE_JOB_FREE;
+        } else {
+            job->failed = !save_read_job(job);
+            next = LIBRETRO_SAVE_JOB_READY;
+        }
+
+        pthread_mutex_lock(&save->mutex);
+        __atomic_store_n(&job->state, next, __ATOMIC_RELEASE);
+        pthread_cond_broadcast(&save->cond);
+    }
+    pthread_mutex_unlock(&save->mutex);
+    return NULL;
+}
+
+/**
+ * Hand a filled job to the I/O thread
+ */
+static void save_queue(libretro_save_t* save, libretro_save_job_t* job, int state) {
+    pthread_mutex_lock(&save->mutex);
+    __atomic_store_n(&job->state, state, __ATOMIC_RELEASE);
+    pthread_cond_broadcast(&save->cond);
+    pthread_mutex_unlock(&save->mutex);
+}
+
+static bool save_job_free(const libretro_save_job_t* job) {
+    return __atomic_load_n(&job->state, __ATOMIC_ACQUIRE) == LIBRETRO_SAVE_JOB_FREE;
+}
+
+//=============================================================================
+// Snapshots (emulation thread)
+//=============================================================================
+
+static void save_state_path(const libretro_save_t* save, unsigned slot, char* path, size_t size) {
+    if (slot == 0) {
+        snprintf(path, size, "%s.state", save->base_path);
+    } else {
+        snprintf(path, size, "%s.state%u", save->base_path, slot);
+    }
+}
+
+/**
+ * Queue SRAM for writing if it changed since it was last written
+ */
+static void save_check_sram(libretro_save_t* save) {
+    if (!save->sram_enabled || !save_job_free(&save->sram_job)) return;
+    struct retro_core_t* core = save->frontend->core;
+    const uint8_t* sram = (const uint8_t*)core->retro_get_memory_data(RETRO_MEMORY_SAVE_RAM);
+    if (!sram || core->retro_get_memory_size(RETRO_MEMORY_SAVE_RAM) != save->sram_size) return;
+
+    save->sram_checks++;
+    bool retry = save->sram_job.failed;
+    if (!retry && memcmp(sram, save->sram_saved, save->sram_size) == 0) return;
+
+    memcpy(save->sram_job.data, sram, save->sram_size);
+    memcpy(save->sram_saved, sram, save->sram_size);
+    save->sram_job.failed = false;
+    save->sram_writes++;
+    save_queue(save, &save->sram_job, LIBRETRO_SAVE_JOB_WRITE);
+}
+
+static void save_snapshot_state(libretro_save_t* save, unsigned slot) {
+    libretro_save_job_t* job = &save->state_job;
+    if (!save_job_free(job)) {
+        fprintf(stderr, "Save: still writing the previous state, slot %u not saved\n", slot);
+        return;
+    }
+    struct retro_core_t* core = save->frontend->core;
+    size_t size = (core->retro_serialize_size && core->retro_serialize) ? core->retro_serialize_size() : 0;
+    if (size == 0) {
+        fprintf(stderr, "Save: core reports no savestate size\n");
+        return;
+    }
+    // Only when the state grew (rare); normally the buffer from init is reused
+    if (size > job->capacity) {
+        uint8_t* data = (uint8_t*)realloc(job->data, size);
+        if (!data) return;
+        job->data = data;
+        job->capacity = size;
+    }
+    if (!core->retro_serialize(job->data, size)) {
+        fprintf(stderr, "Save: retro_serialize failed\n");
+        return;
+    }
+    job->size = size;
+    job->slot = slot;
+    save_state_path(save, slot, job->path, sizeof(job->path));
+    save->states_saved++;
+    save_queue(save, job, LIBRETRO_SAVE_JOB_WRITE);
+}
+
+static void save_apply_load(libretro_save_t* save) {
+    libretro_save_job_t* job = &save->load_job;
+    struct retro_core_t* core = save->frontend->core;
+    if (job->failed) {
+        fprintf(stderr, "Save: no state in slot %u (%s)\n", job->slot, job->path);
+    } else if (!core->retro_unserialize || !core->retro_unserialize(job->data, job->size)) {
+        fprintf(stderr, "Save: slot %u doesn't match this core or content\n", job->slot);
+    } else {
+        fprintf(stderr, "Loaded state from slot %u\n", job->slot);
+        save->states_loaded++;
+    }
+    __atomic_store_n(&job->state, LIBRETRO_SAVE_JOB_FREE, __ATOMIC_RELEASE);
+}
+
+void libretro_save_run_frame(libretro_save_t* save) {
+    if (!save || !save->thread_started) return;
+    uint64_t start = libretro_perf_now_ns();
+    bool worked = false;
+
+    if (__atomic_load_n(&save->load_job.state, __ATOMIC_ACQUIRE) == LIBRETRO_SAVE_JOB_READY) {
+        save_apply_load(save);
+        worked = true;
+    }
+
+    unsigned request = __atomic_exchange_n(&save->save_request, 0, __ATOMIC_RELAXED);
+    if (request) {
+        save_snapshot_state(save, request - 1);
+        worked = true;
+    }
+
+    request = __atomic_exchange_n(&save->load_request, 0, __ATOMIC_RELAXED);
+    if (request && !save->loads_enabled) {
+        fprintf(stderr, "Save: loading states is off while a movie is recorded or played\n");
+    } else if (request && save_job_free(&save->load_job)) {
+        libretro_save_job_t* job = &save->load_job;
+        job->slot = request - 1;
+        save_state_path(save, job->slot, job->path, sizeof(job->path));
+        save_queue(save, job, LIBRETRO_SAVE_JOB_READ);
+    }
+
+    if (save->sram_enabled && ++save->frame_counter >= save->flush_frames) {
+        save->frame_counter = 0;
+        save_check_sram(save);
+        worked = true;
+    }
+
+    if (worked) save->snapshot_ns += libretro_perf_now_ns() - start;
+}
+
+//=============================================================================
+// Public API Implementation
+//=============================================================================
+
+/**
+ * Read base.srm into the core's SRAM and keep a copy for the dirty check
+ */
+static bool save_init_sram(libretro_save_t* save) {
+    struct retro_core_t* core = save->frontend->core;
+    if (!core->retro_get_memory_data || !core->retro_get_memory_size) return true;
+    size_t size = core->retro_get_memory_size(RETRO_MEMORY_SAVE_RAM);
+    uint8_t* sram = (uint8_t*)core->retro_get_memory_data(RETRO_MEMORY_SAVE_RAM);
+    if (size == 0 || !sram) return true;
+
+    save->sram_saved = (uint8_t*)malloc(size);
+    save->sram_job.data = (uint8_t*)malloc(size);
+    if (!save->sram_saved || !save->sram_job.data) return false;
+    save->sram_size = size;
+    save->sram_job.capacity = size;
+    snprintf(save->sram_job.path, sizeof(save->sram_job.path), "%s.srm", save->base_path);
+
+    // A shorter file (another frontend, an older core) fills what it has
+    FILE* file = fopen(save->sram_job.path, "rb");
+    if (file) {
+        size_t read = fread(sram, 1, size, file);
+        fclose(file);
+        fprintf(stderr, "SRAM: loaded %zu of %zu bytes from %s\n", read, size, save->sram_job.path);
+    } else {
+        fprintf(stderr, "SRAM: %zu bytes, saved to %s\n", size, save->sram_job.path);
+    }
+    memcpy(save->sram_saved, sram, size);
+    save->sram_job.size = size;
+    save->sram_enabled = true;
+    return true;
+}
+
+bool libretro_save_init(libretro_save_t* save, libretro_frontend_t* frontend, const char* base_path,
+                        bool sram, unsigned flush_frames) {
+    if (!save || !frontend || !frontend->core || !base_path) return false;
+    memset(save, 0, sizeof(*save));
+    save->frontend = frontend;
+    snprintf(save->base_path, sizeof(save->base_path), "%s", base_path);
+    save->flush_frames = flush_frames ? flush_frames : LIBRETRO_SAVE_DEFAULT_FLUSH_FRAMES;
+    save->loads_enabled = true;
+    save->state_job.compress = true;   // SRAM stays raw, as other frontends store it
+
+    if (sram && !save_init_sram(save)) {
+        fprintf(stderr, "Save: failed to allocate SRAM buffers\n");
+        libretro_save_free(save);
+        return false;
+    }
+
+    // Allocated now so saving a state never allocates during a frame
+    struct retro_core_t* core = frontend->core;
+    bool states = core->retro_serialize_size && core->retro_serialize && core->retro_unserialize;
+    size_t state_size = states ? core->retro_serialize_size() : 0;
+    if (state_size > 0) {
+        save->state_job.data = (uint8_t*)malloc(state_size);
+        save->load_job.data = (uint8_t*)malloc(state_size);
+        if (!save->state_job.data || !save->load_job.data) {
+            fprintf(stderr, "Save: failed to allocate %zu byte state buffers\n", state_size);
+            libretro_save_free(save);
+            return false;
+        }
+        save->state_job.capacity = state_size;
+        save->load_job.capacity = state_size;
+    }
+
+    pthread_mutex_init(&save->mutex, NULL);
+    pthread_cond_init(&save->cond, NULL);
+    if (pthread_create(&save->thread, NULL, save_io_thread, save) != 0) {
+        fprintf(stderr, "Save: failed to start the I/O thread\n");
+        pthread_mutex_destroy(&save->mutex);
+        pthread_cond_destroy(&save->cond);
+        libretro_save_free(save);
+        return false;
+    }
+    save->thread_started = true;
+    frontend->save = save;
+    return true;
+}
+
+void libretro_save_free(libretro_save_t* save) {
+    if (!save) return;
+    if (save->frontend && save->frontend->save == save) {
+        save->frontend->save = NULL;
+    }
+
+    if (save->thread_started) {
+        // Wait out an SRAM write in flight so the final contents get queued
+        pthread_mutex_lock(&save->mutex);
+        while (!save_job_free(&save->sram_job)) {
+            pthread_cond_wait(&save->cond, &save->mutex);
+        }
+        pthread_mutex_unlock(&save->mutex);
+        save_check_sram(save);
+
+        pthread_mutex_lock(&save->mutex);
+        save->quit = true;
+        pthread_cond_broadcast(&save->cond);
+        pthread_mutex_unlock(&save->mutex);
+        pthread_join(save->thread, NULL);
+        pthread_mutex_destroy(&save->mutex);
+        pthread_cond_destroy(&save->cond);
+
+        if (save->states_saved || save->states_loaded || save->sram_writes) {
+            fprintf(stderr, "Saves: %llu states saved, %llu loaded, %llu SRAM writes in %llu checks, "
+                    "%.2f ms snapshotting\n",
+                    (unsigned long long)save->states_saved, (unsigned long long)save->states_loaded,
+                    (unsigned long long)save->sram_writes, (unsigned long long)save->sram_checks,
+                    save->snapshot_ns / 1e6);
+        }
+    }
+
+    free(save->sram_saved);
+    free(save->sram_job.data);
+    free(save->state_job.data);
+    free(save->load_job.data);
+    memset(save, 0, sizeof(*save));
+}
+
+void libretro_save_select_slot(libretro_save_t* save, int slot) {
+    if (!save) return;
+    slot %= LIBRETRO_SAVE_SLOTS;
+    if (slot < 0) slot += LIBRETRO_SAVE_SLOTS;
+    __atomic_store_n(&save->slot, (unsigned)slot, __ATOMIC_RELAXED);
+    fprintf(stderr, "State slot %d\n", slot);
+}
+
+void libretro_save_request_state(libretro_save_t* save) {
+    if (!save) return;
+    __atomic_store_n(&save->save_request, __atomic_load_n(&save->slot, __ATOMIC_RELAXED) + 1, __ATOMIC_RELAXED);
+}
+
+void libretro_save_request_load(libretro_save_t* save) {
+    if (!save) return;
+    __atomic_store_n(&save->load_request, __atomic_load_n(&save->slot, __ATOMIC_RELAXED) + 1, __ATOMIC_RELAXED);
+}
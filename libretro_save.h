@@ -0,0 +1,155 @@
+/*
+ * libretro_save.h - Savestate Slots and SRAM Persistence
+ *
+ * Copyright (c) 2024 mikedx
+ * GitHub: https://github.com/mikedx/libretro_raylib
+ *
+ * This file is part of libretro_raylib.
+ *
+ * libretro_raylib is free software: you can redistribute it and/or modify
+ * it under the terms of the MIT License.
+ *
+ * Keeps disk I/O off the thread that runs the core:
+ *
+ * - The emulation thread only snapshots: retro_serialize or an SRAM memcpy
+ *   into a buffer allocated up front (libretro_save_run_frame, called by
+ *   libretro_frontend_run_frame before each frame)
+ * - A background I/O thread compresses and writes snapshots, and reads and
+ *   decompresses states to load; the emulation thread unserializes a loaded
+ *   state at the start of the next frame
+ * - SRAM is compared with what was last written every flush interval and
+ *   only written when it changed
+ *
+ * Files are written next to a base path: base.srm (raw, as other frontends
+ * store it) and base.state, base.state1, ... (gzip). Writes go to a
+ * temporary file that is renamed over the old one, so a crash never leaves
+ * a torn save. When the I/O thread is still busy with the previous snapshot
+ * of the same kind, the new one is skipped (a state save is reported, SRAM
+ * is retried at the next interval) rather than waiting.
+ */
+
+#ifndef LIBRETRO_SAVE_H
+#define LIBRETRO_SAVE_H
+
+#include "libretro_frontend.h"
+#include <limits.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+//=============================================================================
+// Save Structures
+//=============================================================================
+
+#define LIBRETRO_SAVE_SLOTS 10
+#define LIBRETRO_SAVE_DEFAULT_FLUSH_FRAMES 300 // About 5 seconds at 60 fps
+
+typedef enum {
+    LIBRETRO_SAVE_JOB_FREE,         // Owned by the emulation thread
+    LIBRETRO_SAVE_JOB_WRITE,        // Queued for / being written by the I/O thread
+    LIBRETRO_SAVE_JOB_READ,         // Queued for / being read by the I/O thread
+    LIBRETRO_SAVE_JOB_READY         // Read finished, waiting to be unserialized
+} libretro_save_job_state_t;
+
+/**
+ * One snapshot buffer handed between the emulation and I/O threads
+ */
+typedef struct {
+    uint8_t* data;
+    size_t capacity;
+    size_t size;
+    char path[PATH_MAX];
+    bool compress;                  // gzip on write
+    unsigned slot;                  // For messages
+    int state;                      // libretro_save_job_state_t (atomic)
+    bool failed;                    // Last write or read failed (set before state)
+} libretro_save_job_t;
+
+/**
+ * Save manager for one loaded core
+ */
+typedef struct libretro_save {
+    libretro_frontend_t* frontend;
+    char base_path[PATH_MAX - 16];  // Directory and content name (room left for the extension)
+
+    // I/O thread
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;            // Jobs queued or finished
+    bool thread_started;
+    bool quit;
+
+    libretro_save_job_t sram_job;
+    libretro_save_job_t state_job;
+    libretro_save_job_t load_job;
+
+    // SRAM dirty check against the contents last written (or loaded)
+    uint8_t* sram_saved;
+    size_t sram_size;
+    bool sram_enabled;
+    unsigned flush_frames;          // Compare every N frames
+    unsigned frame_counter;
+
+    bool loads_enabled;             // Off while a movie is recorded or played
+
+    // Requests from the UI thread (atomic; slot + 1, 0 = none)
+    unsigned slot;                  // Current slot (atomic)
+    unsigned save_request;
+    unsigned load_request;
+
+    // Statistics
+    uint64_t states_saved;
+    uint64_t states_loaded;
+    uint64_t sram_checks;
+    uint64_t sram_writes;
+    uint64_t snapshot_ns;           // Emulation thread time spent snapshotting
+} libretro_save_t;
+
+//=============================================================================
+// Public API Functions
+//=============================================================================
+
+/**
+ * Set up saves for loaded content: reads base.srm into the core's SRAM and
+ * starts the I/O thread
+ * @param save Save manager
+ * @param frontend Frontend with content loaded
+ * @param base_path Directory and content name without extension
+ * @param sram Persist SRAM (load it now, flush it periodically and on exit)
+ * @param flush_frames SRAM check interval (0 = LIBRETRO_SAVE_DEFAULT_FLUSH_FRAMES)
+ * @return false if the I/O thread or buffers couldn't be set up
+ */
+bool libretro_save_init(libretro_save_t* save, libretro_frontend_t* frontend, const char* base_path,
+                        bool sram, unsigned flush_frames);
+
+/**
+ * Flush SRAM one last time, wait for pending writes, stop the I/O thread and
+ * detach. Call while the core is still loaded and not running a frame.
+ * @param save Save manager
+ */
+void libretro_save_free(libretro_save_t* save);
+
+/**
+ * Select the slot used by the next save or load (safe from any thread)
+ * @param save Save manager
+ * @param slot 0 to LIBRETRO_SAVE_SLOTS - 1 (wraps)
+ */
+void libretro_save_select_slot(libretro_save_t* save, int slot);
+
+/**
+ * Save or load the current slot at the start of the next frame (safe from
+ * any thread)
+ * @param save Save manager
+ */
+void libretro_save_request_state(libretro_save_t* save);
+void libretro_save_request_load(libretro_save_t* save);
+
+/**
+ * Handle requests, apply a loaded state and check SRAM
+ * (libretro_frontend_run_frame calls this before running the core)
+ * @param save Save manager
+ */
+void libretro_save_run_frame(libretro_save_t* save);
+
+#endif // LIBRETRO_SAVE_H
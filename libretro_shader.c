@@ -0,0 +1,318 @@
+/*
+ * libretro_shader.c - GPU Scaling and Shader Pass Chain Implementation
+ *
+ * Copyright (c) 2024 mikedx
+ * GitHub: https://github.com/mikedx/libretro_raylib
+ *
+ * This file is part of libretro_raylib.
+ *
+ * libretro_raylib is free software: you can redistribute it and/or modify
+ * it under the terms of the MIT License.
+ */
+
+#include "libretro_shader.h"
+#include "../raylib/src/rlgl.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+//=============================================================================
+// Built-in Shaders
+//=============================================================================
+
+// Shared GLSL 330 preamble matching raylib's default vertex shader outputs
+#define SHADER_HEADER \
+    "#version 330\n" \
+    "in vec2 fragTexCoord;\n" \
+    "in vec4 fragColor;\n" \
+    "uniform sampler2D texture0;\n" \
+    "uniform vec4 colDiffuse;\n" \
+    "uniform vec2 sourceSize;\n" \
+    "uniform vec2 originalSize;\n" \
+    "uniform vec2 outputSize;\n" \
+    "out vec4 finalColor;\n"
+
+/**
+ * Native XRGB8888 frames: the core's B, G, R, X bytes are uploaded as an
+ * RGBA8 texture, so swap red/blue and force alpha
+ */
+static const char swizzle_bgrx_fs[] =
+    SHADER_HEADER
+    "void main() {\n"
+    "    vec4 texel = texture(texture0, fragTexCoord);\n"
+    "    finalColor = vec4(texel.bgr, 1.0) * colDiffuse * fragColor;\n"
+    "}\n";
+
+/**
+ * Sharp bilinear: nearest-neighbour up to the largest integer scale, then
+ * bilinear for the remaining fraction, so pixels stay square and sharp at
+ * any window size without the uneven widths of plain nearest
+ */
+static const char sharp_bilinear_fs[] =
+    SHADER_HEADER
+    "void main() {\n"
+    "    vec2 size = vec2(textureSize(texture0, 0));\n"
+    "    vec2 texel = fragTexCoord * size;\n"
+    "    vec2 scale = max(floor(outputSize / sourceSize), vec2(1.0));\n"
+    "    vec2 range = 0.5 - 0.5 / scale;\n"
+    "    vec2 center = fract(texel) - 0.5;\n"
+    "    vec2 f = (center - clamp(center, -range, range)) * scale + 0.5;\n"
+    "    finalColor = texture(texture0, (floor(texel) + f) / size) * colDiffuse * fragColor;\n"
+    "}\n";
+
+/**
+ * CRT: darkens the edges of each frame row into scanlines and applies an
+ * RGB aperture grille across screen pixels, with a little gain to make up
+ * for the lost brightness
+ */
+static const char crt_fs[] =
+    SHADER_HEADER
+    "void main() {\n"
+    "    vec2 texel = fragTexCoord * vec2(textureSize(texture0, 0)) * originalSize / sourceSize;\n"
+    "    vec3 color = texture(texture0, fragTexCoord).rgb;\n"
+    "    float line = abs(fract(texel.y) - 0.5) * 2.0;\n"
+    "    float scan = mix(1.0, 0.55, line * line);\n"
+    "    vec3 mask = vec3(0.8);\n"
+    "    mask[int(mod(gl_FragCoord.x, 3.0))] = 1.2;\n"
+    "    finalColor = vec4(clamp(color * scan * mask * 1.15, 0.0, 1.0), 1.0) * colDiffuse * fragColor;\n"
+    "}\n";
+
+/**
+ * Built-in pass names
+ */
+static const struct {
+    const char* name;
+    const char* fs;                 // NULL = plain sampling
+    int filter;
+} builtin_passes[] = {
+    { "nearest",        NULL,              TEXTURE_FILTER_POINT },
+    { "bilinear",       NULL,              TEXTURE_FILTER_BILINEAR },
+    { "sharp-bilinear", sharp_bilinear_fs, TEXTURE_FILTER_BILINEAR },
+    { "crt",            crt_fs,            TEXTURE_FILTER_POINT },
+};
+
+//=============================================================================
+// Helpers
+//=============================================================================
+
+/**
+ * raylib falls back to its default shader when compiling or loading fails
+ */
+static bool shader_loaded(Shader shader) {
+    return shader.id != 0 && shader.id != rlGetShaderIdDefault();
+}
+
+/**
+ * (Re)create a render target if its size changed
+ */
+static bool target_ensure(RenderTexture2D* target, int width, int height) {
+    if (target->id != 0 && target->texture.width == width && target->texture.height == height) {
+        return true;
+    }
+    if (target->id != 0) {
+        UnloadRenderTexture(*target);
+        *target = (RenderTexture2D){0};
+    }
+    if (width <= 0 || height <= 0) return false;
+
+    *target = LoadRenderTexture(width, height);
+    if (target->id == 0) {
+        fprintf(stderr, "Shader: failed to create %dx%d render target\n", width, height);
+        return false;
+    }
+    SetTextureWrap(target->texture, TEXTURE_WRAP_CLAMP);
+    return true;
+}
+
+static void pass_set_uniforms(const libretro_shader_pass_t* pass, Rectangle input,
+                              float original_width, float original_height, int width, int height) {
+    float source_size[2] = { fabsf(input.width), fabsf(input.height) };
+    float original_size[2] = { original_width, original_height };
+    float output_size[2] = { (float)width, (float)height };
+    if (pass->loc_source_size >= 0) {
+        SetShaderValue(pass->shader, pass->loc_source_size, source_size, SHADER_UNIFORM_VEC2);
+    }
+    if (pass->loc_original_size >= 0) {
+        SetShaderValue(pass->shader, pass->loc_original_size, original_size, SHADER_UNIFORM_VEC2);
+    }
+    if (pass->loc_output_size >= 0) {
+        SetShaderValue(pass->shader, pass->loc_output_size, output_size, SHADER_UNIFORM_VEC2);
+    }
+}
+
+//=============================================================================
+// Public API Functions
+//=============================================================================
+
+bool libretro_shader_chain_init(libretro_shader_chain_t* chain) {
+    if (!chain) return false;
+    memset(chain, 0, sizeof(*chain));
+
+    chain->swizzle = LoadShaderFromMemory(NULL, swizzle_bgrx_fs);
+    if (!shader_loaded(chain->swizzle)) {
+        chain->swizzle = (Shader){0};
+        return false;
+    }
+    return true;
+}
+
+bool libretro_shader_chain_add(libretro_shader_chain_t* chain, const char* spec) {
+    if (!chain || !spec || !spec[0]) return false;
+
+    if (strcmp(spec, "integer") == 0) {
+        chain->integer_scale = true;
+        return true;
+    }
+    if (chain->count == LIBRETRO_SHADER_MAX_PASSES) {
+        fprintf(stderr, "Shader: at most %d passes\n", LIBRETRO_SHADER_MAX_PASSES);
+        return false;
+    }
+
+    libretro_shader_pass_t* pass = &chain->passes[chain->count];
+    memset(pass, 0, sizeof(*pass));
+    snprintf(pass->name, sizeof(pass->name), "%s", spec);
+    pass->filter = TEXTURE_FILTER_POINT;
+
+    bool builtin = false;
+    bool wants_shader = true;
+    for (size_t i = 0; i < sizeof(builtin_passes) / sizeof(builtin_passes[0]); i++) {
+        if (strcmp(spec, builtin_passes[i].name) != 0) continue;
+        pass->filter = builtin_passes[i].filter;
+        wants_shader = builtin_passes[i].fs != NULL;
+        if (wants_shader) {
+            pass->shader = LoadShaderFromMemory(NULL, builtin_passes[i].fs);
+        }
+        builtin = true;
+        break;
+    }
+
+    // Anything that isn't a built-in name is a fragment shader file
+    if (!builtin) {
+        if (!strchr(spec, '.') && !strchr(spec, '/')) {
+            fprintf(stderr, "Shader: unknown pass '%s' (nearest, bilinear, sharp-bilinear, crt, integer or a .fs file)\n",
+                    spec);
+            return false;
+        }
+        pass->shader = LoadShader(NULL, spec);
+    }
+
+    if (wants_shader && !shader_loaded(pass->shader)) {
+        fprintf(stderr, "Shader: '%s' failed to load\n", spec);
+        pass->shader = (Shader){0};
+        return false;
+    }
+
+    pass->loc_source_size = -1;
+    pass->loc_original_size = -1;
+    pass->loc_output_size = -1;
+    if (pass->shader.id != 0) {
+        pass->loc_source_size = GetShaderLocation(pass->shader, "sourceSize");
+        pass->loc_original_size = GetShaderLocation(pass->shader, "originalSize");
+        pass->loc_output_size = GetShaderLocation(pass->shader, "outputSize");
+    }
+    chain->count++;
+    fprintf(stderr, "Shader pass %u: %s\n", chain->count, spec);
+    return true;
+}
+
+Rectangle libretro_shader_chain_viewport(const libretro_shader_chain_t* chain, unsigned width, unsigned height,
+                                         int screen_width, int screen_height) {
+    if (width == 0 || height == 0) return (Rectangle){0, 0, 0, 0};
+
+    // Integer scaling only when the window holds at least one whole multiple
+    float scale = fminf((float)screen_width / width, (float)screen_height / height);
+    if (chain && chain->integer_scale && scale >= 1.0f) {
+        scale = floorf(scale);
+    }
+    int render_width = (int)(width * scale);
+    int render_height = (int)(height * scale);
+    return (Rectangle){
+        (float)((screen_width - render_width) / 2),
+        (float)((screen_height - render_height) / 2),
+        (float)render_width,
+        (float)render_height
+    };
+}
+
+void libretro_shader_chain_draw(libretro_shader_chain_t* chain, Texture2D texture, Rectangle source,
+                                bool swizzle, Rectangle dest) {
+    if (!chain || texture.id == 0) return;
+    int width = (int)dest.width;
+    int height = (int)dest.height;
+    if (width <= 0 || height <= 0) return;
+
+    float original_width = fabsf(source.width);
+    float original_height = fabsf(source.height);
+    Texture2D input = texture;
+    Rectangle input_rect = source;
+    bool needs_swizzle = swizzle && chain->swizzle.id != 0;
+
+    // No passes: one plain point-sampled draw, as before shaders existed
+    libretro_shader_pass_t fallback = {
+        .filter = TEXTURE_FILTER_POINT,
+        .loc_source_size = -1,
+        .loc_original_size = -1,
+        .loc_output_size = -1
+    };
+    libretro_shader_pass_t* passes = chain->count ? chain->passes : &fallback;
+    unsigned count = chain->count ? chain->count : 1;
+
+    // A shader pass can't also swizzle, so BGRX frames are fixed up first at
+    // frame size (render targets are stored bottom-up, hence the flip)
+    if (needs_swizzle && passes[0].shader.id != 0) {
+        if (!target_ensure(&chain->swizzle_target, (int)original_width, (int)original_height)) return;
+        SetTextureFilter(input, TEXTURE_FILTER_POINT);
+        BeginTextureMode(chain->swizzle_target);
+        BeginShaderMode(chain->swizzle);
+        DrawTexturePro(input, input_rect, (Rectangle){0, 0, original_width, original_height},
+                       (Vector2){0, 0}, 0.0f, WHITE);
+        EndShaderMode();
+        EndTextureMode();
+        input = chain->swizzle_target.texture;
+        input_rect = (Rectangle){0, 0, original_width, -original_height};
+        needs_swizzle = false;
+    }
+
+    for (unsigned i = 0; i < count; i++) {
+        libretro_shader_pass_t* pass = &passes[i];
+        bool last = (i + 1 == count);
+
+        Rectangle output_rect = dest;
+        if (!last) {
+            if (!target_ensure(&pass->target, width, height)) return;
+            output_rect = (Rectangle){0, 0, (float)width, (float)height};
+            BeginTextureMode(pass->target);
+            ClearBackground(BLACK);
+        }
+
+        Shader shader = pass->shader;
+        if (shader.id == 0 && needs_swizzle) shader = chain->swizzle;
+        if (pass->shader.id != 0) {
+            pass_set_uniforms(pass, input_rect, original_width, original_height, width, height);
+        }
+
+        SetTextureFilter(input, pass->filter);
+        if (shader.id != 0) BeginShaderMode(shader);
+        DrawTexturePro(input, input_rect, output_rect, (Vector2){0, 0}, 0.0f, WHITE);
+        if (shader.id != 0) EndShaderMode();
+
+        if (!last) {
+            EndTextureMode();
+            input = pass->target.texture;
+            input_rect = (Rectangle){0, 0, (float)width, -(float)height};
+        }
+        needs_swizzle = false;
+    }
+}
+
+void libretro_shader_chain_free(libretro_shader_chain_t* chain) {
+    if (!chain) return;
+    for (unsigned i = 0; i < chain->count; i++) {
+        libretro_shader_pass_t* pass = &chain->passes[i];
+        if (pass->shader.id != 0) UnloadShader(pass->shader);
+        if (pass->target.id != 0) UnloadRenderTexture(pass->target);
+    }
+    if (chain->swizzle.id != 0) UnloadShader(chain->swizzle);
+    if (chain->swizzle_target.id != 0) UnloadRenderTexture(chain->swizzle_target);
+    memset(chain, 0, sizeof(*chain));
+}
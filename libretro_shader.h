@@ -0,0 +1,126 @@
+/*
+ * libretro_shader.h - GPU Scaling and Shader Pass Chain
+ *
+ * Copyright (c) 2024 mikedx
+ * GitHub: https://github.com/mikedx/libretro_raylib
+ *
+ * This file is part of libretro_raylib.
+ *
+ * libretro_raylib is free software: you can redistribute it and/or modify
+ * it under the terms of the MIT License.
+ *
+ * Frames are uploaded at the core's own size and every bit of scaling and
+ * filtering happens here, on the GPU, through raylib's shader API.
+ *
+ * A chain is a list of passes given with --shader, in order:
+ *
+ * - nearest         Point sampling (the default with no passes)
+ * - bilinear        Bilinear sampling
+ * - sharp-bilinear  Integer prescale then bilinear: crisp pixels, no shimmer
+ * - crt             Scanlines and an aperture grille mask
+ * - integer         Not a pass: snaps the viewport to an integer scale
+ * - <file>.fs       Custom GLSL 330 fragment shader (raylib's default
+ *                   vertex shader, sampled with point filtering)
+ *
+ * The first pass reads the frame texture and every pass renders at viewport
+ * size; the last one draws straight to the screen. Besides raylib's own
+ * texture0/colDiffuse, passes get these uniforms if they declare them:
+ *
+ * - vec2 sourceSize    Visible size of the pass's input, in texels
+ * - vec2 originalSize  Visible size of the frame, in texels
+ * - vec2 outputSize    Size the pass renders at, in pixels
+ *
+ * Native XRGB8888 frames are uploaded as BGRX, so they get a swizzle:
+ * folded into plain sampling passes, or a cheap frame-sized pre-pass
+ * ahead of a shader pass.
+ */
+
+#ifndef LIBRETRO_SHADER_H
+#define LIBRETRO_SHADER_H
+
+#include "../raylib/src/raylib.h"
+#include <stdbool.h>
+
+//=============================================================================
+// Shader Chain Structures
+//=============================================================================
+
+#define LIBRETRO_SHADER_MAX_PASSES 8
+
+/**
+ * One pass of the chain
+ */
+typedef struct {
+    char name[64];                  // Built-in name or file name, for logging
+    Shader shader;                  // id 0 = plain sampling pass
+    int filter;                     // TEXTURE_FILTER_* used to sample the input
+    int loc_source_size;            // Uniform locations (-1 if not declared)
+    int loc_original_size;
+    int loc_output_size;
+    RenderTexture2D target;         // Viewport-sized output (all but the last pass)
+} libretro_shader_pass_t;
+
+/**
+ * Shader pass chain
+ */
+typedef struct {
+    libretro_shader_pass_t passes[LIBRETRO_SHADER_MAX_PASSES];
+    unsigned count;
+    bool integer_scale;             // Viewport is an integer multiple of the frame
+
+    Shader swizzle;                 // BGRX -> RGBA for native XRGB8888 frames
+    RenderTexture2D swizzle_target; // Frame-sized pre-pass ahead of shader passes
+} libretro_shader_chain_t;
+
+//=============================================================================
+// Public API Functions
+//=============================================================================
+
+/**
+ * Initialize an empty chain (draws with point sampling)
+ * Call once the window exists
+ * @param chain Chain
+ * @return false if the swizzle shader failed to compile (native XRGB8888
+ *         frames can't be drawn)
+ */
+bool libretro_shader_chain_init(libretro_shader_chain_t* chain);
+
+/**
+ * Append a pass
+ * @param chain Chain
+ * @param spec Built-in pass name or path to a fragment shader
+ * @return false if the pass is unknown, fails to load, or the chain is full
+ */
+bool libretro_shader_chain_add(libretro_shader_chain_t* chain, const char* spec);
+
+/**
+ * Where the frame goes on screen: as large as fits with the frame's aspect
+ * ratio kept, an integer multiple with the "integer" pass, centered
+ * @param chain Chain
+ * @param width Display width (AV info base size)
+ * @param height Display height
+ * @param screen_width Window width in pixels
+ * @param screen_height Window height in pixels
+ */
+Rectangle libretro_shader_chain_viewport(const libretro_shader_chain_t* chain, unsigned width, unsigned height,
+                                         int screen_width, int screen_height);
+
+/**
+ * Run the chain: draws the frame to the screen (call between BeginDrawing
+ * and EndDrawing)
+ * @param chain Chain
+ * @param texture Frame texture
+ * @param source Visible part of the texture (negative height flips it)
+ * @param swizzle Texture holds native BGRX pixels
+ * @param dest Viewport from libretro_shader_chain_viewport
+ */
+void libretro_shader_chain_draw(libretro_shader_chain_t* chain, Texture2D texture, Rectangle source,
+                                bool swizzle, Rectangle dest);
+
+/**
+ * Unload every shader and render target
+ * @param chain Chain
+ */
+void libretro_shader_chain_free(libretro_shader_chain_t* chain);
+
+#endif // LIBRETRO_SHADER_H
@@ -0,0 +1,596 @@
+/*
+ * libretro_vfs.c - Virtual File System Implementation
+ *
+ * Copyright (c) 2024 mikedx
+ * GitHub: https://github.com/mikedx/libretro_raylib
+ *
+ * This file is part of libretro_raylib.
+ *
+ * libretro_raylib is free software: you can redistribute it and/or modify
+ * it under the terms of the MIT License.
+ */
+
+#include "libretro_vfs.h"
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// Pending read-ahead requests; when full, new requests are dropped (they
+// are only hints)
+#define VFS_READAHEAD_QUEUE 64
+
+#define VFS_STAT_ADD(field, n) __atomic_add_fetch(&g_vfs.stats.field, (uint64_t)(n), __ATOMIC_RELAXED)
+
+struct retro_vfs_file_handle {
+    char* path;
+    int fd;                     // -1 once a read-only file is mapped
+    unsigned mode;              // RETRO_VFS_FILE_ACCESS_*
+    int64_t position;
+
+    // Mapped read-only files (and memory files, which aren't unmapped)
+    const uint8_t* map;
+    int64_t map_size;
+    bool memory;
+    int64_t readahead_from;     // Read position when read-ahead was last queued
+    int64_t readahead_end;      // Read-ahead has been queued up to here
+
+    // Buffered files
+    uint8_t* buffer;
+    int64_t buffer_offset;
+    size_t buffer_length;
+};
+
+struct retro_vfs_dir_handle {
+    DIR* dir;
+    struct dirent* entry;
+    char* path;
+    bool include_hidden;
+};
+
+typedef struct vfs_memory_file {
+    char* path;
+    const uint8_t* data;
+    size_t size;
+    struct vfs_memory_file* next;
+} vfs_memory_file_t;
+
+typedef struct {
+    struct retro_vfs_file_handle* file;     // NULL if the file was closed first
+    int64_t offset;
+    int64_t length;
+} vfs_readahead_t;
+
+static struct {
+    pthread_mutex_t lock;
+    pthread_cond_t wake;        // Work queued or stop requested
+    pthread_cond_t idle;        // The worker finished a request
+    pthread_t thread;
+    bool started;
+    bool stop;
+    vfs_readahead_t queue[VFS_READAHEAD_QUEUE];
+    size_t head, tail;          // Monotonic positions
+    struct retro_vfs_file_handle* busy;     // File the worker is touching
+    vfs_memory_file_t* memory;              // Buffers served as files
+    libretro_vfs_stats_t stats;
+} g_vfs = { .lock = PTHREAD_MUTEX_INITIALIZER, .wake = PTHREAD_COND_INITIALIZER, .idle = PTHREAD_COND_INITIALIZER };
+
+static char* vfs_strdup(const char* s) {
+    size_t length = strlen(s) + 1;
+    char* copy = (char*)malloc(length);
+    if (copy) memcpy(copy, s, length);
+    return copy;
+}
+
+/**
+ * Look up a memory file
+ * @return true with its buffer if path is one
+ */
+static bool vfs_find_memory_file(const char* path, const uint8_t** data, size_t* size) {
+    pthread_mutex_lock(&g_vfs.lock);
+    vfs_memory_file_t* file = g_vfs.memory;
+    while (file && strcmp(file->path, path) != 0) file = file->next;
+    if (file) {
+        *data = file->data;
+        *size = file->size;
+    }
+    pthread_mutex_unlock(&g_vfs.lock);
+    return file != NULL;
+}
+
+//=============================================================================
+// Read-Ahead Thread
+//=============================================================================
+
+/**
+ * Worker: fault in each requested range so the core's next read finds the
+ * pages resident instead of blocking on the disk inside retro_run
+ */
+static void* vfs_readahead_thread(void* arg) {
+    (void)arg;
+    long page = sysconf(_SC_PAGESIZE);
+    if (page <= 0) page = 4096;
+
+    pthread_mutex_lock(&g_vfs.lock);
+    while (!g_vfs.stop) {
+        if (g_vfs.head == g_vfs.tail) {
+            pthread_cond_wait(&g_vfs.wake, &g_vfs.lock);
+            continue;
+        }
+        vfs_readahead_t request = g_vfs.queue[g_vfs.tail++ % VFS_READAHEAD_QUEUE];
+        if (!request.file) continue;
+        g_vfs.busy = request.file;
+        pthread_mutex_unlock(&g_vfs.lock);
+
+        const volatile uint8_t* data = request.file->map + request.offset;
+        madvise((void*)(uintptr_t)data, (size_t)request.length, MADV_WILLNEED);
+        uint8_t sink = 0;
+        for (int64_t i = 0; i < request.length; i += page) {
+            sink ^= data[i];
+        }
+        (void)sink;
+        VFS_STAT_ADD(readahead_bytes, request.length);
+
+        pthread_mutex_lock(&g_vfs.lock);
+        g_vfs.busy = NULL;
+        pthread_cond_broadcast(&g_vfs.idle);
+    }
+    pthread_mutex_unlock(&g_vfs.lock);
+    return NULL;
+}
+
+/**
+ * Queue read-ahead past a mapped file's read position
+ * Sequential readers get a new request once they are halfway through the
+ * window; a seek restarts the window at the new position
+ */
+static void vfs_readahead(struct retro_vfs_file_handle* stream) {
+    int64_t position = stream->position;
+    int64_t start;
+    if (position < stream->readahead_from || position > stream->readahead_end) {
+        start = position;
+    } else if (stream->readahead_end - position >= LIBRETRO_VFS_READAHEAD_BYTES / 2) {
+        return;
+    } else {
+        start = stream->readahead_end;
+    }
+    int64_t end = position + LIBRETRO_VFS_READAHEAD_BYTES;
+    if (end > stream->map_size) end = stream->map_size;
+    if (start >= end) return;
+
+    pthread_mutex_lock(&g_vfs.lock);
+    if (!g_vfs.started && !g_vfs.stop) {
+        g_vfs.started = pthread_create(&g_vfs.thread, NULL, vfs_readahead_thread, NULL) == 0;
+    }
+    bool queued = false;
+    if (g_vfs.started && g_vfs.head - g_vfs.tail < VFS_READAHEAD_QUEUE) {
+        vfs_readahead_t* request = &g_vfs.queue[g_vfs.head++ % VFS_READAHEAD_QUEUE];
+        request->file = stream;
+        request->offset = start;
+        request->length = end - start;
+        pthread_cond_signal(&g_vfs.wake);
+        queued = true;
+    }
+    pthread_mutex_unlock(&g_vfs.lock);
+
+    if (queued) {
+        stream->readahead_from = position;
+        stream->readahead_end = end;
+    }
+}
+
+/**
+ * Make sure the worker no longer references a file that is being closed
+ */
+static void vfs_readahead_forget(struct retro_vfs_file_handle* stream) {
+    pthread_mutex_lock(&g_vfs.lock);
+    for (size_t i = g_vfs.tail; i != g_vfs.head; i++) {
+        vfs_readahead_t* request = &g_vfs.queue[i % VFS_READAHEAD_QUEUE];
+        if (request->file == stream) request->file = NULL;
+    }
+    while (g_vfs.busy == stream) {
+        pthread_cond_wait(&g_vfs.idle, &g_vfs.lock);
+    }
+    pthread_mutex_unlock(&g_vfs.lock);
+}
+
+//=============================================================================
+// Files
+//=============================================================================
+
+static const char* RETRO_CALLCONV vfs_get_path(struct retro_vfs_file_handle* stream) {
+    return stream ? stream->path : NULL;
+}
+
+static struct retro_vfs_file_handle* RETRO_CALLCONV vfs_open(const char* path, unsigned mode, unsigned hints) {
+    if (!path || !(mode & RETRO_VFS_FILE_ACCESS_READ_WRITE)) return NULL;
+
+    // Memory files are read-only and already resident
+    const uint8_t* data;
+    size_t size;
+    if (vfs_find_memory_file(path, &data, &size)) {
+        if ((mode & RETRO_VFS_FILE_ACCESS_READ_WRITE) != RETRO_VFS_FILE_ACCESS_READ) return NULL;
+        struct retro_vfs_file_handle* stream = (struct retro_vfs_file_handle*)calloc(1, sizeof(*stream));
+        char* copy = vfs_strdup(path);
+        if (!stream || !copy) {
+            free(stream);
+            free(copy);
+            return NULL;
+        }
+        stream->path = copy;
+        stream->fd = -1;
+        stream->mode = mode;
+        stream->map = data;
+        stream->map_size = (int64_t)size;
+        stream->memory = true;
+        VFS_STAT_ADD(files_opened, 1);
+        return stream;
+    }
+
+    int flags;
+    if ((mode & RETRO_VFS_FILE_ACCESS_READ_WRITE) == RETRO_VFS_FILE_ACCESS_READ) {
+        flags = O_RDONLY;
+    } else {
+        flags = ((mode & RETRO_VFS_FILE_ACCESS_READ) ? O_RDWR : O_WRONLY) | O_CREAT;
+        if (!(mode & RETRO_VFS_FILE_ACCESS_UPDATE_EXISTING)) flags |= O_TRUNC;
+    }
+
+    int fd = open(path, flags, 0666);
+    if (fd < 0) return NULL;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || S_ISDIR(st.st_mode)) {
+        close(fd);
+        return NULL;
+    }
+
+    struct retro_vfs_file_handle* stream = (struct retro_vfs_file_handle*)calloc(1, sizeof(*stream));
+    char* copy = vfs_strdup(path);
+    if (!stream || !copy) {
+        free(stream);
+        free(copy);
+        close(fd);
+        return NULL;
+    }
+    stream->path = copy;
+    stream->fd = fd;
+    stream->mode = mode;
+
+    // Read-only content is served straight from the page cache
+    if (flags == O_RDONLY && S_ISREG(st.st_mode) && st.st_size > 0) {
+        void* map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map != MAP_FAILED) {
+            close(fd);
+            stream->fd = -1;
+            stream->map = (const uint8_t*)map;
+            stream->map_size = (int64_t)st.st_size;
+            if (hints & RETRO_VFS_FILE_ACCESS_HINT_FREQUENT_ACCESS) {
+                madvise(map, (size_t)st.st_size, MADV_WILLNEED);
+            }
+            VFS_STAT_ADD(files_mapped, 1);
+        }
+    }
+
+    if (!stream->map && (mode & RETRO_VFS_FILE_ACCESS_READ)) {
+        stream->buffer = (uint8_t*)malloc(LIBRETRO_VFS_BUFFER_BYTES);
+        // Without a buffer reads go straight to pread
+    }
+
+    VFS_STAT_ADD(files_opened, 1);
+    return stream;
+}
+
+static int RETRO_CALLCONV vfs_close(struct retro_vfs_file_handle* stream) {
+    if (!stream) return -1;
+    int result = 0;
+    if (stream->map && !stream->memory) {
+        vfs_readahead_forget(stream);
+        munmap((void*)(uintptr_t)stream->map, (size_t)stream->map_size);
+    }
+    if (stream->fd >= 0 && close(stream->fd) != 0) result = -1;
+    free(stream->buffer);
+    free(stream->path);
+    free(stream);
+    return result;
+}
+
+static int64_t RETRO_CALLCONV vfs_size(struct retro_vfs_file_handle* stream) {
+    if (!stream) return -1;
+    if (stream->map) return stream->map_size;
+    struct stat st;
+    if (fstat(stream->fd, &st) != 0) return -1;
+    return (int64_t)st.st_size;
+}
+
+static int64_t RETRO_CALLCONV vfs_truncate(struct retro_vfs_file_handle* stream, int64_t length) {
+    if (!stream || stream->map || length < 0) return -1;
+    stream->buffer_length = 0;
+    return ftruncate(stream->fd, (off_t)length) == 0 ? 0 : -1;
+}
+
+static int64_t RETRO_CALLCONV vfs_tell(struct retro_vfs_file_handle* stream) {
+    return stream ? stream->position : -1;
+}
+
+static int64_t RETRO_CALLCONV vfs_seek(struct retro_vfs_file_handle* stream, int64_t offset, int seek_position) {
+    if (!stream) return -1;
+    int64_t base;
+    switch (seek_position) {
+        case RETRO_VFS_SEEK_POSITION_START: base = 0; break;
+        case RETRO_VFS_SEEK_POSITION_CURRENT: base = stream->position; break;
+        case RETRO_VFS_SEEK_POSITION_END: base = vfs_size(stream); break;
+        default: return -1;
+    }
+    if (base < 0 || base + offset < 0) return -1;
+    stream->position = base + offset;
+    return stream->position;
+}
+
+static int64_t RETRO_CALLCONV vfs_read(struct retro_vfs_file_handle* stream, void* s, uint64_t len) {
+    if (!stream || !s || !(stream->mode & RETRO_VFS_FILE_ACCESS_READ)) return -1;
+    uint8_t* out = (uint8_t*)s;
+
+    if (stream->map) {
+        if (stream->position >= stream->map_size) return 0;
+        uint64_t available = (uint64_t)(stream->map_size - stream->position);
+        if (len > available) len = available;
+        memcpy(out, stream->map + stream->position, (size_t)len);
+        stream->position += (int64_t)len;
+        VFS_STAT_ADD(bytes_read, len);
+        if (!stream->memory) vfs_readahead(stream);
+        return (int64_t)len;
+    }
+
+    uint64_t total = 0;
+    while (total < len) {
+        int64_t position = stream->position;
+        uint64_t wanted = len - total;
+
+        // Serve from the buffer when it covers the position
+        if (stream->buffer_length && position >= stream->buffer_offset &&
+            position < stream->buffer_offset + (int64_t)stream->buffer_length) {
+            size_t skip = (size_t)(position - stream->buffer_offset);
+            size_t n = stream->buffer_length - skip;
+            if (n > wanted) n = (size_t)wanted;
+            memcpy(out + total, stream->buffer + skip, n);
+            stream->position += (int64_t)n;
+            total += n;
+            continue;
+        }
+
+        // Large reads bypass the buffer; small ones refill it
+        ssize_t n;
+        if (!stream->buffer || wanted >= LIBRETRO_VFS_BUFFER_BYTES) {
+            n = pread(stream->fd, out + total, (size_t)wanted, (off_t)position);
+            if (n > 0) {
+                stream->position += n;
+                total += (uint64_t)n;
+            }
+        } else {
+            n = pread(stream->fd, stream->buffer, LIBRETRO_VFS_BUFFER_BYTES, (off_t)position);
+            VFS_STAT_ADD(buffer_refills, 1);
+            stream->buffer_offset = position;
+            stream->buffer_length = (n > 0) ? (size_t)n : 0;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) return total ? (int64_t)total : -1;
+        if (n == 0) break;
+    }
+
+    VFS_STAT_ADD(bytes_read, total);
+    return (int64_t)total;
+}
+
+static int64_t RETRO_CALLCONV vfs_write(struct retro_vfs_file_handle* stream, const void* s, uint64_t len) {
+    if (!stream || !s || !(stream->mode & RETRO_VFS_FILE_ACCESS_WRITE) || stream->fd < 0) return -1;
+    const uint8_t* in = (const uint8_t*)s;
+
+    // Buffered bytes the write overlaps would be stale
+    if (stream->buffer_length && stream->position < stream->buffer_offset + (int64_t)stream->buffer_length &&
+        stream->position + (int64_t)len > stream->buffer_offset) {
+        stream->buffer_length = 0;
+    }
+
+    uint64_t total = 0;
+    while (total < len) {
+        ssize_t n = pwrite(stream->fd, in + total, (size_t)(len - total), (off_t)stream->position);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return total ? (int64_t)total : -1;
+        stream->position += n;
+        total += (uint64_t)n;
+    }
+
+    VFS_STAT_ADD(bytes_written, total);
+    return (int64_t)total;
+}
+
+static int RETRO_CALLCONV vfs_flush(struct retro_vfs_file_handle* stream) {
+    // Writes go straight to the file; nothing is held back
+    return stream ? 0 : -1;
+}
+
+static int RETRO_CALLCONV vfs_remove(const char* path) {
+    return (path && remove(path) == 0) ? 0 : -1;
+}
+
+static int RETRO_CALLCONV vfs_rename(const char* old_path, const char* new_path) {
+    return (old_path && new_path && rename(old_path, new_path) == 0) ? 0 : -1;
+}
+
+//=============================================================================
+// Paths and Directories
+//=============================================================================
+
+static int RETRO_CALLCONV vfs_stat(const char* path, int32_t* size) {
+    const uint8_t* data;
+    size_t length;
+    if (path && vfs_find_memory_file(path, &data, &length)) {
+        if (size) *size = (length > INT32_MAX) ? INT32_MAX : (int32_t)length;
+        return RETRO_VFS_STAT_IS_VALID;
+    }
+
+    struct stat st;
+    if (!path || stat(path, &st) != 0) return 0;
+    if (size) *size = (st.st_size > INT32_MAX) ? INT32_MAX : (int32_t)st.st_size;
+
+    int flags = RETRO_VFS_STAT_IS_VALID;
+    if (S_ISDIR(st.st_mode)) flags |= RETRO_VFS_STAT_IS_DIRECTORY;
+    if (S_ISCHR(st.st_mode)) flags |= RETRO_VFS_STAT_IS_CHARACTER_SPECIAL;
+    return flags;
+}
+
+static int RETRO_CALLCONV vfs_mkdir(const char* dir) {
+    if (!dir) return -1;
+    if (mkdir(dir, 0755) == 0) return 0;
+    return (errno == EEXIST) ? -2 : -1;
+}
+
+static struct retro_vfs_dir_handle* RETRO_CALLCONV vfs_opendir(const char* dir, bool include_hidden) {
+    if (!dir) return NULL;
+    struct retro_vfs_dir_handle* handle = (struct retro_vfs_dir_handle*)calloc(1, sizeof(*handle));
+    if (!handle) return NULL;
+    handle->dir = opendir(dir);
+    handle->path = vfs_strdup(dir);
+    if (!handle->dir || !handle->path) {
+        if (handle->dir) closedir(handle->dir);
+        free(handle->path);
+        free(handle);
+        return NULL;
+    }
+    handle->include_hidden = include_hidden;
+    return handle;
+}
+
+static bool RETRO_CALLCONV vfs_readdir(struct retro_vfs_dir_handle* dirstream) {
+    if (!dirstream) return false;
+    do {
+        dirstream->entry = readdir(dirstream->dir);
+    } while (dirstream->entry && !dirstream->include_hidden && dirstream->entry->d_name[0] == '.');
+    return dirstream->entry != NULL;
+}
+
+static const char* RETRO_CALLCONV vfs_dirent_get_name(struct retro_vfs_dir_handle* dirstream) {
+    return (dirstream && dirstream->entry) ? dirstream->entry->d_name : NULL;
+}
+
+static bool RETRO_CALLCONV vfs_dirent_is_dir(struct retro_vfs_dir_handle* dirstream) {
+    if (!dirstream || !dirstream->entry) return false;
+    char path[PATH_MAX];
+    int length = snprintf(path, sizeof(path), "%s/%s", dirstream->path, dirstream->entry->d_name);
+    if (length < 0 || (size_t)length >= sizeof(path)) return false;
+    struct stat st;
+    return stat(path, &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+static int RETRO_CALLCONV vfs_closedir(struct retro_vfs_dir_handle* dirstream) {
+    if (!dirstream) return -1;
+    int result = closedir(dirstream->dir) == 0 ? 0 : -1;
+    free(dirstream->path);
+    free(dirstream);
+    return result;
+}
+
+//=============================================================================
+// Public API
+//=============================================================================
+
+static struct retro_vfs_interface g_vfs_interface = {
+    vfs_get_path,
+    vfs_open,
+    vfs_close,
+    vfs_size,
+    vfs_tell,
+    vfs_seek,
+    vfs_read,
+    vfs_write,
+    vfs_flush,
+    vfs_remove,
+    vfs_rename,
+    vfs_truncate,
+    vfs_stat,
+    vfs_mkdir,
+    vfs_opendir,
+    vfs_readdir,
+    vfs_dirent_get_name,
+    vfs_dirent_is_dir,
+    vfs_closedir,
+};
+
+struct retro_vfs_interface* libretro_vfs_get_interface(uint32_t required_version) {
+    return (required_version <= LIBRETRO_VFS_VERSION) ? &g_vfs_interface : NULL;
+}
+
+bool libretro_vfs_add_memory_file(const char* path, const void* data, size_t size) {
+    if (!path || (!data && size)) return false;
+    vfs_memory_file_t* file = (vfs_memory_file_t*)calloc(1, sizeof(*file));
+    char* copy = vfs_strdup(path);
+    if (!file || !copy) {
+        free(file);
+        free(copy);
+        return false;
+    }
+    file->path = copy;
+    file->data = (const uint8_t*)data;
+    file->size = size;
+
+    pthread_mutex_lock(&g_vfs.lock);
+    file->next = g_vfs.memory;
+    g_vfs.memory = file;
+    pthread_mutex_unlock(&g_vfs.lock);
+    return true;
+}
+
+void libretro_vfs_remove_memory_file(const char* path) {
+    if (!path) return;
+    pthread_mutex_lock(&g_vfs.lock);
+    vfs_memory_file_t** link = &g_vfs.memory;
+    while (*link && strcmp((*link)->path, path) != 0) link = &(*link)->next;
+    vfs_memory_file_t* file = *link;
+    if (file) *link = file->next;
+    pthread_mutex_unlock(&g_vfs.lock);
+    if (file) {
+        free(file->path);
+        free(file);
+    }
+}
+
+void libretro_vfs_shutdown(void) {
+    pthread_mutex_lock(&g_vfs.lock);
+    bool started = g_vfs.started;
+    g_vfs.stop = true;
+    pthread_cond_broadcast(&g_vfs.wake);
+    pthread_mutex_unlock(&g_vfs.lock);
+    if (started) pthread_join(g_vfs.thread, NULL);
+
+    pthread_mutex_lock(&g_vfs.lock);
+    g_vfs.started = false;
+    g_vfs.stop = false;
+    g_vfs.head = g_vfs.tail = 0;
+    pthread_mutex_unlock(&g_vfs.lock);
+    
+    libretro_vfs_stats_t stats;
+    libretro_vfs_get_stats(&stats);
+    if (stats.files_opened > 0) {
+        fprintf(stderr, "VFS: %llu files (%llu mapped), %.1f MB read, %.1f MB written, "
+                "%llu buffer refills, %.1f MB read ahead\n",
+                (unsigned long long)stats.files_opened, (unsigned long long)stats.files_mapped,
+                stats.bytes_read / 1048576.0, stats.bytes_written / 1048576.0,
+                (unsigned long long)stats.buffer_refills, stats.readahead_bytes / 1048576.0);
+    }
+}
+
+void libretro_vfs_get_stats(libretro_vfs_stats_t* stats) {
+    if (!stats) return;
+    stats->files_opened = __atomic_load_n(&g_vfs.stats.files_opened, __ATOMIC_RELAXED);
+    stats->files_mapped = __atomic_load_n(&g_vfs.stats.files_mapped, __ATOMIC_RELAXED);
+    stats->bytes_read = __atomic_load_n(&g_vfs.stats.bytes_read, __ATOMIC_RELAXED);
+    stats->bytes_written = __atomic_load_n(&g_vfs.stats.bytes_written, __ATOMIC_RELAXED);
+    stats->buffer_refills = __atomic_load_n(&g_vfs.stats.buffer_refills, __ATOMIC_RELAXED);
+    stats->readahead_bytes = __atomic_load_n(&g_vfs.stats.readahead_bytes, __ATOMIC_RELAXED);
+}
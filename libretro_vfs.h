@@ -0,0 +1,90 @@
+/*
+ * libretro_vfs.h - Virtual File System (VFS API v3)
+ *
+ * Copyright (c) 2024 mikedx
+ * GitHub: https://github.com/mikedx/libretro_raylib
+ *
+ * This file is part of libretro_raylib.
+ *
+ * libretro_raylib is free software: you can redistribute it and/or modify
+ * it under the terms of the MIT License.
+ *
+ * File access for cores that ask for it (RETRO_ENVIRONMENT_GET_VFS_INTERFACE),
+ * so disc-based cores don't stall retro_run on synchronous disk reads:
+ *
+ * - Read-only files are mmap'd, so reads are copies from the page cache
+ * - A read-ahead thread faults in the pages just past each file's read
+ *   position, so the next read normally finds them resident
+ * - Everything else (files opened for writing, files that can't be
+ *   mapped) goes through a large per-file read buffer
+ * - Content the frontend holds in memory (an archive member for a
+ *   need_fullpath core) can be published under a virtual path and is read
+ *   straight from the buffer
+ */
+
+#ifndef LIBRETRO_VFS_H
+#define LIBRETRO_VFS_H
+
+#include "libretro.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// Highest VFS API version implemented
+#define LIBRETRO_VFS_VERSION 3
+
+// Read buffer for files that aren't mapped
+#define LIBRETRO_VFS_BUFFER_BYTES (256 * 1024)
+
+// How far past the read position the read-ahead thread keeps a mapped file
+// resident
+#define LIBRETRO_VFS_READAHEAD_BYTES (4 * 1024 * 1024)
+
+/**
+ * VFS usage counters
+ */
+typedef struct {
+    uint64_t files_opened;
+    uint64_t files_mapped;
+    uint64_t bytes_read;
+    uint64_t bytes_written;
+    uint64_t buffer_refills;        // preads issued for buffered reads
+    uint64_t readahead_bytes;       // Bytes faulted in by the read-ahead thread
+} libretro_vfs_stats_t;
+
+/**
+ * Get the VFS interface for a core
+ * @param required_version Version the core asked for
+ * @return Interface, or NULL if the version isn't supported
+ */
+struct retro_vfs_interface* libretro_vfs_get_interface(uint32_t required_version);
+
+/**
+ * Serve a buffer as a read-only file
+ * Opening path read-only (and stat) finds the buffer instead of the disk.
+ * The buffer must stay valid until it is removed, after the core has closed
+ * the file.
+ * @param path Virtual path
+ * @param data Contents
+ * @param size Size in bytes
+ * @return false if out of memory
+ */
+bool libretro_vfs_add_memory_file(const char* path, const void* data, size_t size);
+
+/**
+ * Stop serving a buffer added with libretro_vfs_add_memory_file
+ * @param path Virtual path
+ */
+void libretro_vfs_remove_memory_file(const char* path);
+
+/**
+ * Stop the read-ahead thread (after the core is unloaded) and print usage
+ */
+void libretro_vfs_shutdown(void);
+
+/**
+ * Read the usage counters
+ * @param stats Output counters
+ */
+void libretro_vfs_get_stats(libretro_vfs_stats_t* stats);
+
+#endif // LIBRETRO_VFS_H
@@ -12,34 +12,194 @@
 
 #include "libretro_video.h"
 #include "libretro_frontend.h"
+#include "libretro_convert.h"
+#include "libretro_pipeline.h"
+#include "libretro_capture.h"
+#include "libretro_runahead.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdint.h>
 
-// Global frontend instance for callbacks
-static libretro_frontend_t* g_frontend = NULL;
+//=============================================================================
+// Frame Change Tracking
+//=============================================================================
 
-void libretro_video_set_frontend(libretro_frontend_t* frontend) {
-    g_frontend = frontend;
+/**
+ * Hash one row of pixels
+ * Four independent multiply/xor lanes over 8-byte words keep the multiplier
+ * pipeline busy, so hashing runs at close to memory read speed
+ */
+static uint64_t hash_row(const uint8_t* row, size_t bytes) {
+    const uint64_t prime = 0x9E3779B97F4A7C15ull;
+    uint64_t h0 = 0x243F6A8885A308D3ull, h1 = 0x13198A2E03707344ull;
+    uint64_t h2 = 0xA4093822299F31D0ull, h3 = 0x082EFA98EC4E6C89ull;
+    size_t i = 0;
+    
+    for (; i + 32 <= bytes; i += 32) {
+        uint64_t w[4];
+        memcpy(w, row + i, sizeof(w));
+        h0 = (h0 ^ w[0]) * prime;
+        h1 = (h1 ^ w[1]) * prime;
+        h2 = (h2 ^ w[2]) * prime;
+        h3 = (h3 ^ w[3]) * prime;
+    }
+    for (; i < bytes; i++) {
+        h0 = (h0 ^ row[i]) * prime;
+    }
+    
+    uint64_t h = h0 ^ (h1 >> 1) ^ (h2 << 1) ^ (h3 >> 3) ^ (uint64_t)bytes;
+    return h ^ (h >> 29);
+}
+
+/**
+ * Prepare the per-row hash table for a frame layout
+ * Stored hashes are only comparable if geometry, format and upload path are
+ * unchanged (and the destination still holds the previous frame)
+ * @param hashes_valid Output: true if stored hashes are valid for this layout
+ * @return true on success, false if the hash table could not be allocated
+ */
+static bool row_hashes_prepare(libretro_frontend_t* frontend, unsigned width, unsigned height, bool native, bool* hashes_valid) {
+    uint64_t layout = ((uint64_t)width << 36) | ((uint64_t)height << 12) |
+                      ((uint64_t)frontend->pixel_format << 1) | (native ? 1u : 0u);
+    
+    if (height > frontend->row_hash_capacity) {
+        size_t capacity = frontend->row_hash_capacity * sizeof(uint64_t);
+        uint64_t* hashes = (uint64_t*)libretro_arena_grow(&frontend->arena, frontend->row_hashes, &capacity,
+                                                          height * sizeof(uint64_t));
+        if (!hashes) {
+            frontend->row_hash_layout = 0;
+            return false;
+        }
+        frontend->row_hashes = hashes;
+        frontend->row_hash_capacity = capacity / sizeof(uint64_t);
+        frontend->row_hash_layout = 0;
+    }
+    
+    *hashes_valid = (frontend->row_hash_layout == layout);
+    frontend->row_hash_layout = layout;
+    return true;
 }
 
-static int frame_count = 0;
+/**
+ * Check a source row against its stored hash and update it
+ * @return true if the row changed (or hashes were invalid)
+ */
+static bool row_changed(libretro_frontend_t* frontend, unsigned y, const uint8_t* row, size_t bytes, bool hashes_valid) {
+    uint64_t h = hash_row(row, bytes);
+    bool changed = !hashes_valid || frontend->row_hashes[y] != h;
+    frontend->row_hashes[y] = h;
+    return changed;
+}
 
 /**
- * Video refresh callback implementation
+ * Record changed rows; ranges accumulate until the renderer uploads the frame
  */
-void retro_video_refresh_callback(const void* data, unsigned width, unsigned height, size_t pitch) {
-    if (!g_frontend || !data) {
-        fprintf(stderr, "ERROR: video_callback called with NULL frontend or data!\n");
+static void mark_rows_dirty(libretro_frontend_t* frontend, unsigned begin, unsigned end) {
+    if (begin >= end) return;
+    if (frontend->frame_dirty) {
+        if (begin < frontend->dirty_row_begin) frontend->dirty_row_begin = begin;
+        if (end > frontend->dirty_row_end) frontend->dirty_row_end = end;
+    } else {
+        frontend->dirty_row_begin = begin;
+        frontend->dirty_row_end = end;
+        frontend->frame_dirty = true;
+    }
+}
+
+//=============================================================================
+// Frame Conversion
+//=============================================================================
+
+bool libretro_video_convert_frame(uint32_t* dst, const void* src, unsigned width, unsigned height,
+                                  size_t pitch, unsigned format) {
+    libretro_convert_row_t convert_row = libretro_convert_get_row(format);
+    if (!convert_row || !dst || !src) return false;
+    
+    // Row by row at frame size (SIMD when available); scaling is the GPU's job
+    for (unsigned y = 0; y < height; y++) {
+        convert_row(dst + (size_t)y * width, (const uint8_t*)src + y * pitch, width);
+    }
+    return true;
+}
+
+//=============================================================================
+// Software Framebuffer
+//=============================================================================
+
+// Row alignment for the software framebuffer: a cache line, which also keeps
+// pitch a multiple of 4 as the native upload path requires (the arena hands
+// out buffers at the same alignment)
+#define SW_FRAMEBUFFER_ALIGNMENT 64
+
+/**
+ * Software framebuffer implementation
+ */
+bool libretro_video_get_software_framebuffer(libretro_frontend_t* frontend, struct retro_framebuffer* framebuffer) {
+    if (!frontend || !framebuffer) return false;
+    
+    // Only worth it when the frame can be uploaded from where the core drew it;
+    // 0RGB1555 is converted anyway, so let the core keep its own buffer
+    if (!frontend->native_upload) return false;
+    if (frontend->pixel_format != RETRO_PIXEL_FORMAT_XRGB8888 &&
+        frontend->pixel_format != RETRO_PIXEL_FORMAT_RGB565) {
+        return false;
+    }
+    if (framebuffer->width == 0 || framebuffer->height == 0) return false;
+    
+    size_t bytes_per_pixel = (frontend->pixel_format == RETRO_PIXEL_FORMAT_XRGB8888) ? 4 : 2;
+    size_t pitch = (framebuffer->width * bytes_per_pixel + SW_FRAMEBUFFER_ALIGNMENT - 1) &
+                   ~(size_t)(SW_FRAMEBUFFER_ALIGNMENT - 1);
+    size_t needed_size = pitch * framebuffer->height;
+    
+    // Grow only (normally never: the session reserves it at max geometry);
+    // the pointer is valid for the current retro_run, so keeping a larger
+    // buffer across geometry changes is fine
+    void* buffer = libretro_arena_grow(&frontend->arena, frontend->sw_framebuffer,
+                                       &frontend->sw_framebuffer_capacity, needed_size);
+    if (!buffer) {
+        fprintf(stderr, "Failed to allocate %zu byte software framebuffer\n", needed_size);
+        return false;
+    }
+    frontend->sw_framebuffer = buffer;
+    
+    framebuffer->data = frontend->sw_framebuffer;
+    framebuffer->pitch = pitch;
+    framebuffer->format = (enum retro_pixel_format)frontend->pixel_format;
+    framebuffer->memory_flags = RETRO_MEMORY_TYPE_CACHED;
+    return true;
+}
+
+/**
+ * Handle one frame from the core (body of the video refresh callback)
+ */
+static void video_refresh(libretro_frontend_t* frontend, const void* data, unsigned width, unsigned height, size_t pitch) {
+    // Hidden run-ahead or skipped fast-forward frame: not shown, and cores
+    // that ignore GET_AUDIO_VIDEO_ENABLE still call us
+    if (!(libretro_frontend_av_enable(frontend) & LIBRETRO_AV_ENABLE_VIDEO)) return;
+    
+    // Captured raw, as the core sent it; duplicates are repeats
+    if (frontend->capture && data != RETRO_HW_FRAME_BUFFER_VALID && width > 0 && height > 0) {
+        libretro_capture_video(frontend->capture, data, width, height, pitch, frontend->pixel_format);
+    }
+    
+    // NULL data is a duplicate frame (GET_CAN_DUPE): the previous frame is
+    // still in the framebuffer/texture, so there is nothing to convert or upload
+    if (!data) return;
+    
+    // Hardware rendered frame: it is already in the FBO, drawn from there
+    if (data == RETRO_HW_FRAME_BUFFER_VALID) {
+        libretro_hw_frame(&frontend->hw, width, height);
+        frontend->frame_width = width;
+        frontend->frame_height = height;
         return;
     }
     
     // Safety check: ensure framebuffer_size is consistent with framebuffer pointer
     // If framebuffer is set but framebuffer_size is 0, something is wrong
-    if (g_frontend->framebuffer && g_frontend->framebuffer_size == 0) {
+    if (frontend->framebuffer && frontend->framebuffer_size == 0) {
         fprintf(stderr, "WARNING: framebuffer pointer set but size is 0, resetting\n");
-        g_frontend->framebuffer = NULL;
+        frontend->framebuffer = NULL;
     }
     
     if (width == 0 || height == 0) {
@@ -47,16 +207,13 @@ void retro_video_refresh_callback(const void* data, unsigned width, unsigned hei
         return;
     }
     
-    static int call_count = 0;
-    static bool warned_black = false;
-    static bool logged_format_info = false;
-    call_count++;
+    frontend->video_calls++;
     
     // Log format/size info on first frame
-    if (!logged_format_info) {
+    if (!frontend->video_logged_format) {
         const char* format_name = "UNKNOWN";
         size_t bytes_per_pixel = 0;
-        switch (g_frontend->pixel_format) {
+        switch (frontend->pixel_format) {
             case RETRO_PIXEL_FORMAT_XRGB8888: format_name = "XRGB8888"; bytes_per_pixel = 4; break;
             case RETRO_PIXEL_FORMAT_RGB565: format_name = "RGB565"; bytes_per_pixel = 2; break;
             case RETRO_PIXEL_FORMAT_0RGB1555: format_name = "0RGB1555"; bytes_per_pixel = 2; break;
@@ -66,12 +223,12 @@ void retro_video_refresh_callback(const void* data, unsigned width, unsigned hei
         fprintf(stderr, "Video callback: %ux%u, format=%s, pitch=%zu (expected=%zu, diff=%zu, pixels_per_row=%zu, AV_width=%u)\n",
                 width, height, format_name, pitch, expected_pitch,
                 (pitch > expected_pitch) ? (pitch - expected_pitch) : (expected_pitch - pitch),
-                pixels_per_row, g_frontend->width);
-        logged_format_info = true;
+                pixels_per_row, frontend->width);
+        frontend->video_logged_format = true;
     }
     
     // Debug: Check if data is all zeros (black screen) - only warn once
-    if (!warned_black && call_count >= 10) {
+    if (!frontend->video_warned_black && frontend->video_calls >= 10) {
         const uint16_t* pixels = (const uint16_t*)data;
         int non_zero_count = 0;
         int sample_size = (width * height < 100) ? width * height : 100;
@@ -82,170 +239,160 @@ void retro_video_refresh_callback(const void* data, unsigned width, unsigned hei
             }
         }
         if (non_zero_count == 0) {
-            fprintf(stderr, "WARNING: Video callback receiving all-zero (black) data after %d frames\n", call_count);
-            warned_black = true;
+            fprintf(stderr, "WARNING: Video callback receiving all-zero (black) data after %u frames\n", frontend->video_calls);
+            frontend->video_warned_black = true;
         }
     }
     
-    frame_count++;
-    
     // Proper libretro way (matching RetroArch):
     // - Callback width/height = frame cache dimensions (actual frame buffer size)
     // - AV info base_width/base_height = display/canvas dimensions (what to render)
     // - Store frame cache dimensions separately from display dimensions
     
     // Store frame cache dimensions (from callback)
-    g_frontend->frame_width = width;
-    g_frontend->frame_height = height;
+    frontend->frame_width = width;
+    frontend->frame_height = height;
     
     // Use AV info dimensions for display (base_width/base_height)
     // If AV info not set yet, use frame dimensions as fallback
-    unsigned display_width = (g_frontend->width > 0) ? g_frontend->width : width;
-    unsigned display_height = (g_frontend->height > 0) ? g_frontend->height : height;
+    unsigned display_width = (frontend->width > 0) ? frontend->width : width;
+    unsigned display_height = (frontend->height > 0) ? frontend->height : height;
     
-    // Allocate framebuffer based on display dimensions (what we'll render)
-    // Only reallocate if dimensions actually changed
-    size_t needed_size = display_width * display_height * 4;
-    if (needed_size == 0) {
-        fprintf(stderr, "ERROR: Invalid framebuffer size: %ux%u\n", display_width, display_height);
+    // Threaded mode: copy the raw frame out for the render thread, which does
+    // the conversion and upload off the emulation thread
+    if (frontend->pipeline) {
+        frontend->width = display_width;
+        frontend->height = display_height;
+        libretro_pipeline_submit(frontend->pipeline, data, width, height, pitch,
+                                 frontend->pixel_format, display_width, display_height);
         return;
     }
     
-    // Only reallocate if size changed or framebuffer is NULL
-    // Safety: Only free if framebuffer_size > 0 (indicates it was allocated)
-    if (needed_size != g_frontend->framebuffer_size || !g_frontend->framebuffer) {
-        // Only free if we actually allocated it (framebuffer_size > 0)
-        // Double-check that framebuffer is not NULL before freeing
-        if (g_frontend->framebuffer != NULL && g_frontend->framebuffer_size > 0) {
-            // Additional safety: verify the pointer looks valid (not obviously garbage)
-            // This is a heuristic check - valid pointers are typically aligned
-            uintptr_t ptr_val = (uintptr_t)g_frontend->framebuffer;
-            if ((ptr_val % sizeof(void*)) == 0 && ptr_val > 0x1000) {
-                free(g_frontend->framebuffer);
-            } else {
-                fprintf(stderr, "WARNING: Invalid framebuffer pointer detected (0x%lx), not freeing\n", (unsigned long)ptr_val);
+    // Native upload: XRGB8888 and RGB565 map directly onto GPU texture formats
+    // (BGRA via a shader swizzle, R5G6B5 as-is), so the core's buffer is handed
+    // to the renderer unconverted, at its own size; the GPU scales it to the
+    // display size. The texture is pitch/bpp pixels wide, so padded rows need
+    // no repacking either.
+    // The pointer stays valid until the next retro_run, which is also what
+    // RetroArch's frame cache relies on when it redraws the last frame.
+    // Single-instance run-ahead restores a savestate right after the shown
+    // frame, which can rewrite the buffer, so it takes the converted path; a
+    // second instance isn't touched again until its next speculative frames.
+    size_t native_bpp = (frontend->pixel_format == RETRO_PIXEL_FORMAT_XRGB8888) ? 4 : 2;
+    bool native_format = frontend->pixel_format == RETRO_PIXEL_FORMAT_XRGB8888 ||
+                         frontend->pixel_format == RETRO_PIXEL_FORMAT_RGB565;
+    if (frontend->native_upload && native_format &&
+        (!frontend->runahead || frontend->runahead->secondary) &&
+        pitch >= width * native_bpp && (pitch % 4) == 0) {
+        frontend->native_frame = data;
+        frontend->native_pitch = pitch;
+        frontend->frame_is_native = true;
+        frontend->width = display_width;
+        frontend->height = display_height;
+        
+        bool hashes_valid = false;
+        if (!frontend->video_row_hash || !row_hashes_prepare(frontend, width, height, true, &hashes_valid)) {
+            mark_rows_dirty(frontend, 0, height);
+            return;
+        }
+        
+        // Upload only the span of rows that changed, or nothing at all
+        unsigned begin = height, end = 0;
+        for (unsigned y = 0; y < height; y++) {
+            if (row_changed(frontend, y, (const uint8_t*)data + y * pitch, width * native_bpp, hashes_valid)) {
+                if (y < begin) begin = y;
+                end = y + 1;
             }
         }
-        g_frontend->framebuffer = NULL;
-        g_frontend->framebuffer_size = needed_size;
-        g_frontend->framebuffer = calloc(1, g_frontend->framebuffer_size);
-        if (!g_frontend->framebuffer) {
+        mark_rows_dirty(frontend, begin, end);
+        return;
+    }
+    frontend->frame_is_native = false;
+    frontend->native_frame = NULL;
+    
+    // Frames are converted 1:1 at frame size and scaled to the display size
+    // on the GPU. The framebuffer is reserved at max geometry for the
+    // session, so a geometry change just uses less (or more) of it; it only
+    // grows if the core exceeds its own max geometry.
+    size_t needed_size = (size_t)width * height * 4;
+    if (needed_size == 0) {
+        fprintf(stderr, "ERROR: Invalid framebuffer size: %ux%u\n", width, height);
+        return;
+    }
+    if (needed_size > frontend->framebuffer_size || !frontend->framebuffer) {
+        void* buffer = libretro_arena_grow(&frontend->arena, frontend->framebuffer,
+                                           &frontend->framebuffer_size, needed_size);
+        if (!buffer) {
             fprintf(stderr, "Failed to allocate framebuffer in callback\n");
-            g_frontend->framebuffer_size = 0;
             return;
         }
+        frontend->framebuffer = buffer;
+        frontend->row_hash_layout = 0; // Previous rows are gone
     }
     
     // Update display dimensions
-    g_frontend->width = display_width;
-    g_frontend->height = display_height;
+    frontend->width = display_width;
+    frontend->height = display_height;
     
-    if (!g_frontend->framebuffer) return;
+    if (!frontend->framebuffer) return;
     
     // Safety check
-    if (display_width * display_height * 4 > g_frontend->framebuffer_size) {
+    if (needed_size > frontend->framebuffer_size) {
         fprintf(stderr, "Framebuffer size mismatch: %ux%u needs %zu bytes, have %zu\n",
-                display_width, display_height, (size_t)(display_width * display_height * 4), g_frontend->framebuffer_size);
+                width, height, needed_size, frontend->framebuffer_size);
         return;
     }
     
-    uint32_t* dst = (uint32_t*)g_frontend->framebuffer;
-    
-    // Handle different pixel formats
-    switch (g_frontend->pixel_format) {
-        case RETRO_PIXEL_FORMAT_XRGB8888: {
-            // XRGB8888 handling - proper libretro way
-            // Read exactly 'width' pixels per row from callback (frame cache dimensions)
-            // Use 'pitch' to advance to next row (may be larger than width*4 due to alignment)
-            // Scale to display_width if different (display/canvas dimensions from AV info)
-            
-            // If frame width matches display width, direct copy
-            if (width == display_width && height == display_height) {
-                for (unsigned y = 0; y < height; y++) {
-                    const uint8_t* src_line = (const uint8_t*)data + y * pitch;
-                    uint32_t* dst_line = dst + y * display_width;
-                    
-                    const uint32_t* src_pixels = (const uint32_t*)src_line;
-                    for (unsigned x = 0; x < width; x++) {
-                        uint32_t pixel = src_pixels[x];
-                        uint8_t r = (pixel >> 16) & 0xFF;
-                        uint8_t g = (pixel >> 8) & 0xFF;
-                        uint8_t b = pixel & 0xFF;
-                        dst_line[x] = (0xFF << 24) | (b << 16) | (g << 8) | r;
-                    }
-                }
-            } else {
-                // Scale from frame dimensions to display dimensions
-                for (unsigned y = 0; y < display_height; y++) {
-                    unsigned src_y = (y * height) / display_height;
-                    const uint8_t* src_line = (const uint8_t*)data + src_y * pitch;
-                    uint32_t* dst_line = dst + y * display_width;
-                    
-                    const uint32_t* src_pixels = (const uint32_t*)src_line;
-                    for (unsigned x = 0; x < display_width; x++) {
-                        unsigned src_x = (x * width) / display_width;
-                        uint32_t pixel = src_pixels[src_x];
-                        uint8_t r = (pixel >> 16) & 0xFF;
-                        uint8_t g = (pixel >> 8) & 0xFF;
-                        uint8_t b = pixel & 0xFF;
-                        dst_line[x] = (0xFF << 24) | (b << 16) | (g << 8) | r;
-                    }
-                }
-            }
-            break;
-        }
-        case RETRO_PIXEL_FORMAT_RGB565: {
-            size_t expected_pitch = width * 2;
-            
-            for (unsigned y = 0; y < height; y++) {
-                const uint8_t* src_bytes = (const uint8_t*)data + y * pitch;
-                uint32_t* dst_line = dst + y * width;
-                
-                if (pitch == expected_pitch) {
-                    // Fast path
-                    const uint16_t* src_line = (const uint16_t*)src_bytes;
-                    for (unsigned x = 0; x < width; x++) {
-                        uint16_t pixel = src_line[x];
-                        
-                        uint8_t r = ((pixel >> 11) & 0x1F) << 3;
-                        uint8_t g = ((pixel >> 5) & 0x3F) << 2;
-                        uint8_t b = (pixel & 0x1F) << 3;
-                        
-                        dst_line[x] = (0xFF << 24) | (b << 16) | (g << 8) | r;
-                    }
-                } else {
-                    // Slow path: handle variable pitch
-                    for (unsigned x = 0; x < width; x++) {
-                        const uint16_t* pixel_ptr = (const uint16_t*)(src_bytes + x * 2);
-                        uint16_t pixel = *pixel_ptr;
-                        
-                        uint8_t r = ((pixel >> 11) & 0x1F) << 3;
-                        uint8_t g = ((pixel >> 5) & 0x3F) << 2;
-                        uint8_t b = (pixel & 0x1F) << 3;
-                        
-                        dst_line[x] = (0xFF << 24) | (b << 16) | (g << 8) | r;
-                    }
-                }
-            }
-            break;
-        }
-        case RETRO_PIXEL_FORMAT_0RGB1555: {
-            for (unsigned y = 0; y < height; y++) {
-                const uint16_t* src_line = (const uint16_t*)((const char*)data + y * pitch);
-                uint32_t* dst_line = dst + y * width;
-                for (unsigned x = 0; x < width; x++) {
-                    uint16_t pixel = src_line[x];
-                    uint8_t r = ((pixel >> 10) & 0x1F) << 3;
-                    uint8_t g = ((pixel >> 5) & 0x1F) << 3;
-                    uint8_t b = (pixel & 0x1F) << 3;
-                    dst_line[x] = (0xFF << 24) | (b << 16) | (g << 8) | r;
-                }
-            }
-            break;
-        }
-        default:
-            fprintf(stderr, "Unsupported pixel format: %u\n", g_frontend->pixel_format);
-            break;
+    uint32_t* dst = (uint32_t*)frontend->framebuffer;
+    
+    if (!libretro_convert_get_row(frontend->pixel_format)) {
+        fprintf(stderr, "Unsupported pixel format: %u\n", frontend->pixel_format);
+        return;
+    }
+    
+    // Optional row hashing: rows whose source bytes are unchanged keep their
+    // previous conversion in the framebuffer and are neither converted nor uploaded
+    size_t bytes_per_pixel = (frontend->pixel_format == RETRO_PIXEL_FORMAT_XRGB8888) ? 4 : 2;
+    bool use_hash = false;
+    bool hashes_valid = false;
+    if (frontend->video_row_hash) {
+        use_hash = row_hashes_prepare(frontend, width, height, false, &hashes_valid);
+    }
+    
+    if (!use_hash) {
+        libretro_video_convert_frame(dst, data, width, height, pitch, frontend->pixel_format);
+        mark_rows_dirty(frontend, 0, height);
+        return;
+    }
+    
+    // Convert (and upload) only the rows that changed
+    libretro_convert_row_t convert_row = libretro_convert_get_row(frontend->pixel_format);
+    unsigned begin = height, end = 0;
+    for (unsigned y = 0; y < height; y++) {
+        const uint8_t* src_line = (const uint8_t*)data + y * pitch;
+        if (!row_changed(frontend, y, src_line, width * bytes_per_pixel, hashes_valid)) continue;
+        convert_row(dst + (size_t)y * width, src_line, width);
+        if (y < begin) begin = y;
+        end = y + 1;
     }
+    mark_rows_dirty(frontend, begin, end);
 }
 
+/**
+ * Video refresh callback implementation
+ */
+void retro_video_refresh_callback(const void* data, unsigned width, unsigned height, size_t pitch) {
+    libretro_frontend_t* frontend = libretro_frontend_current();
+    if (!frontend) {
+        fprintf(stderr, "ERROR: video_callback called with NULL frontend!\n");
+        return;
+    }
+    
+    if (!frontend->perf) {
+        video_refresh(frontend, data, width, height, pitch);
+        return;
+    }
+    uint64_t start = libretro_perf_now_ns();
+    video_refresh(frontend, data, width, height, pitch);
+    libretro_perf_add(frontend->perf, LIBRETRO_PERF_VIDEO, libretro_perf_now_ns() - start);
+}
@@ -26,10 +26,29 @@
 void retro_video_refresh_callback(const void* data, unsigned width, unsigned height, size_t pitch);
 
 /**
- * Set the frontend instance for callbacks
- * @param frontend Frontend instance (can be NULL)
+ * Get a frontend-owned framebuffer for the core to render into
+ * (RETRO_ENVIRONMENT_GET_CURRENT_SOFTWARE_FRAMEBUFFER)
+ * @param frontend Frontend the request came to
+ * @param framebuffer In: width/height requested by the core.
+ *                    Out: data, pitch, format and memory flags.
+ * @return true if a buffer was provided, false if the core should use its own
  */
-void libretro_video_set_frontend(libretro_frontend_t* frontend);
+bool libretro_video_get_software_framebuffer(libretro_frontend_t* frontend, struct retro_framebuffer* framebuffer);
+
+/**
+ * Convert a frame to RGBA8888 at its own size
+ * Rows are converted with the SIMD row converters; scaling to the display
+ * size is left to the GPU
+ * @param dst Output, width * height pixels
+ * @param src Frame data in the core's format
+ * @param width Frame width
+ * @param height Frame height
+ * @param pitch Source pitch in bytes
+ * @param format RETRO_PIXEL_FORMAT_*
+ * @return false if the format is unsupported
+ */
+bool libretro_video_convert_frame(uint32_t* dst, const void* src, unsigned width, unsigned height,
+                                  size_t pitch, unsigned format);
 
 #endif // LIBRETRO_VIDEO_H
 
@@ -17,11 +17,28 @@
  */
 
 #include "libretro_frontend.h"
+#include "libretro_audio.h"
+#include "libretro_pipeline.h"
+#include "libretro_pacing.h"
+#include "libretro_runahead.h"
+#include "libretro_rewind.h"
+#include "libretro_movie.h"
+#include "libretro_save.h"
+#include "libretro_capture.h"
+#include "libretro_content.h"
+#include "libretro_core_cache.h"
+#include "libretro_shader.h"
+#include "libretro_instance.h"
+#include "libretro_batch.h"
 #include "../raylib/src/raylib.h"
+#include "../raylib/src/rlgl.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#include <limits.h>
+#include <pthread.h>
+#include <sys/resource.h>
 
 //=============================================================================
 // Input Mapping
@@ -94,41 +111,943 @@ static unsigned map_raylib_to_retrok(int raylib_key) {
     }
 }
 
+// raylib key codes are below 512
+#define INPUT_MAX_KEYS 512
+// Keys held at once that are tracked for release
+#define INPUT_MAX_DOWN 32
+
 /**
- * Updates keyboard state for all keys
- * @param frontend Pointer to the libretro frontend instance
+ * Event-driven keyboard mapping
+ * Presses come from raylib's key queue (GetKeyPressed); only keys currently
+ * held are checked for release, so a frame costs O(keys down), not O(512)
  */
-static void update_keyboard_input(libretro_frontend_t* frontend) {
-    // Update all keyboard keys
-    for (int key = 0; key < 512; key++) { // Raylib has keys 0-511
-        unsigned retrok = map_raylib_to_retrok(key);
-        if (retrok != 0) { // Skip RETROK_UNKNOWN
-            libretro_frontend_set_keyboard_key(frontend, retrok, IsKeyDown(key));
-        }
+typedef struct {
+    uint16_t retrok[INPUT_MAX_KEYS];            // raylib key -> RETROK_* (0 = unmapped)
+    uint16_t joypad[INPUT_MAX_KEYS];            // raylib key -> port 0 joypad button bits
+    int down[INPUT_MAX_DOWN];                   // Keys currently held
+    int down_count;
+    uint32_t pressed[INPUT_MAX_KEYS / 32];      // Keys pressed since the last update (hotkeys)
+    bool polled;                                // The core polled input this refresh (serial mode)
+} input_mapper_t;
+
+static input_mapper_t g_input;
+
+/**
+ * Builds the raylib -> libretro lookup tables
+ */
+static void input_mapper_init(void) {
+    memset(&g_input, 0, sizeof(g_input));
+    for (int key = 0; key < INPUT_MAX_KEYS; key++) {
+        g_input.retrok[key] = (uint16_t)map_raylib_to_retrok(key);
+    }
+    
+    // Port 0, Joypad
+    static const struct { int key; unsigned button; } bindings[] = {
+        { KEY_UP, RETRO_DEVICE_ID_JOYPAD_UP }, { KEY_W, RETRO_DEVICE_ID_JOYPAD_UP },
+        { KEY_DOWN, RETRO_DEVICE_ID_JOYPAD_DOWN }, { KEY_S, RETRO_DEVICE_ID_JOYPAD_DOWN },
+        { KEY_LEFT, RETRO_DEVICE_ID_JOYPAD_LEFT }, { KEY_A, RETRO_DEVICE_ID_JOYPAD_LEFT },
+        { KEY_RIGHT, RETRO_DEVICE_ID_JOYPAD_RIGHT }, { KEY_D, RETRO_DEVICE_ID_JOYPAD_RIGHT },
+        { KEY_X, RETRO_DEVICE_ID_JOYPAD_A },
+        { KEY_Z, RETRO_DEVICE_ID_JOYPAD_B },
+        { KEY_C, RETRO_DEVICE_ID_JOYPAD_X },
+        { KEY_V, RETRO_DEVICE_ID_JOYPAD_Y },
+        { KEY_Q, RETRO_DEVICE_ID_JOYPAD_L },
+        { KEY_E, RETRO_DEVICE_ID_JOYPAD_R },
+        { KEY_TAB, RETRO_DEVICE_ID_JOYPAD_SELECT },
+        { KEY_ENTER, RETRO_DEVICE_ID_JOYPAD_START },
+    };
+    for (size_t i = 0; i < sizeof(bindings) / sizeof(bindings[0]); i++) {
+        g_input.joypad[bindings[i].key] |= (uint16_t)(1u << bindings[i].button);
     }
 }
 
 /**
- * Maps raylib keyboard input to libretro joypad buttons
+ * Checks whether a key went down since the last input update
+ * Used for hotkeys instead of IsKeyPressed, which depends on how often
+ * raylib's input events are polled
+ * @param key Raylib key code
+ */
+static bool input_key_pressed(int key) {
+    if (key < 0 || key >= INPUT_MAX_KEYS) return false;
+    return (g_input.pressed[key / 32] >> (key % 32)) & 1;
+}
+
+/**
+ * Starts a new frame for hotkey edge detection
+ */
+static void input_begin_frame(void) {
+    memset(g_input.pressed, 0, sizeof(g_input.pressed));
+    g_input.polled = false;
+}
+
+/**
+ * Applies key presses/releases since the last call to the frontend's
+ * keyboard bitset and port 0 joypad mask
  * @param frontend Pointer to the libretro frontend instance
  */
 static void update_input(libretro_frontend_t* frontend) {
-    // Update keyboard state (needed for VICE cores)
-    update_keyboard_input(frontend);
+    // Releases: only held keys can be released
+    for (int i = 0; i < g_input.down_count; ) {
+        int key = g_input.down[i];
+        if (IsKeyDown(key)) {
+            i++;
+            continue;
+        }
+        if (g_input.retrok[key]) libretro_frontend_set_keyboard_key(frontend, g_input.retrok[key], false);
+        g_input.down[i] = g_input.down[--g_input.down_count];
+    }
     
-    // Port 0, Joypad
-    libretro_frontend_set_input(frontend, 0, RETRO_DEVICE_ID_JOYPAD_UP, IsKeyDown(KEY_UP) || IsKeyDown(KEY_W));
-    libretro_frontend_set_input(frontend, 0, RETRO_DEVICE_ID_JOYPAD_DOWN, IsKeyDown(KEY_DOWN) || IsKeyDown(KEY_S));
-    libretro_frontend_set_input(frontend, 0, RETRO_DEVICE_ID_JOYPAD_LEFT, IsKeyDown(KEY_LEFT) || IsKeyDown(KEY_A));
-    libretro_frontend_set_input(frontend, 0, RETRO_DEVICE_ID_JOYPAD_RIGHT, IsKeyDown(KEY_RIGHT) || IsKeyDown(KEY_D));
-    libretro_frontend_set_input(frontend, 0, RETRO_DEVICE_ID_JOYPAD_A, IsKeyDown(KEY_X));
-    libretro_frontend_set_input(frontend, 0, RETRO_DEVICE_ID_JOYPAD_B, IsKeyDown(KEY_Z));
-    libretro_frontend_set_input(frontend, 0, RETRO_DEVICE_ID_JOYPAD_X, IsKeyDown(KEY_C));
-    libretro_frontend_set_input(frontend, 0, RETRO_DEVICE_ID_JOYPAD_Y, IsKeyDown(KEY_V));
-    libretro_frontend_set_input(frontend, 0, RETRO_DEVICE_ID_JOYPAD_L, IsKeyDown(KEY_Q));
-    libretro_frontend_set_input(frontend, 0, RETRO_DEVICE_ID_JOYPAD_R, IsKeyDown(KEY_E));
-    libretro_frontend_set_input(frontend, 0, RETRO_DEVICE_ID_JOYPAD_SELECT, IsKeyDown(KEY_TAB));
-    libretro_frontend_set_input(frontend, 0, RETRO_DEVICE_ID_JOYPAD_START, IsKeyDown(KEY_ENTER));
+    // Presses, in the order they happened
+    int key;
+    while ((key = GetKeyPressed()) != 0) {
+        if (key < 0 || key >= INPUT_MAX_KEYS) continue;
+        g_input.pressed[key / 32] |= 1u << (key % 32);
+        
+        bool tracked = false;
+        for (int i = 0; i < g_input.down_count; i++) {
+            if (g_input.down[i] == key) tracked = true;
+        }
+        if (tracked || g_input.down_count >= INPUT_MAX_DOWN) continue;
+        
+        g_input.down[g_input.down_count++] = key;
+        if (g_input.retrok[key]) libretro_frontend_set_keyboard_key(frontend, g_input.retrok[key], true);
+    }
+    
+    // Joypad: several keys may map to one button, so rebuild from held keys
+    uint16_t joypad = 0;
+    for (int i = 0; i < g_input.down_count; i++) {
+        joypad |= g_input.joypad[g_input.down[i]];
+    }
+    libretro_frontend_set_joypad_mask(frontend, 0, joypad);
+}
+
+/**
+ * Late input poll (serial mode), called from retro_input_poll_callback
+ * inside retro_run so input is sampled as late as possible
+ * PollInputEvents resets raylib's key queue, so events queued since the
+ * last poll (in EndDrawing) are applied first
+ * @param userdata Frontend
+ */
+static void poll_input_late(void* userdata) {
+    libretro_frontend_t* frontend = (libretro_frontend_t*)userdata;
+    update_input(frontend);
+    PollInputEvents();
+    update_input(frontend);
+    g_input.polled = true;
+}
+
+//=============================================================================
+// Audio Stream
+//=============================================================================
+
+// Frames per device period requested from the audio stream
+#define AUDIO_STREAM_BUFFER_FRAMES 1024
+
+// raylib audio callbacks take no user pointer, so the stream callback reads
+// the frontend it was started for from here
+static libretro_frontend_t* g_audio_frontend = NULL;
+
+/**
+ * Audio stream callback - runs on the audio device thread and drains the
+ * frontend's lock-free ring buffer (silence on underrun)
+ * @param buffer Output interleaved stereo float samples
+ * @param frames Number of frames requested
+ */
+static void audio_stream_callback(void* buffer, unsigned int frames) {
+    if (!g_audio_frontend) {
+        memset(buffer, 0, (size_t)frames * 2 * sizeof(float));
+        return;
+    }
+    libretro_frontend_get_audio_samples(g_audio_frontend, (float*)buffer, frames);
+}
+
+/**
+ * Attaches the audio callback to a stream and starts playback
+ * @param frontend Frontend whose ring buffer feeds the stream
+ * @param stream Loaded audio stream (32-bit float stereo)
+ */
+static void start_audio_stream(libretro_frontend_t* frontend, AudioStream stream) {
+    g_audio_frontend = frontend;
+    SetAudioStreamCallback(stream, audio_stream_callback);
+    PlayAudioStream(stream);
+}
+
+//=============================================================================
+// Command-Line Options
+//=============================================================================
+
+#define HEADLESS_DEFAULT_FRAMES 1000
+#define APP_MAX_OPTION_OVERRIDES 32
+
+/**
+ * Options parsed from the command line
+ */
+typedef struct {
+    const char* core_path;
+    const char* rom_path;
+    bool native_upload;     // Upload XRGB8888/RGB565 frames without CPU conversion
+    bool row_hash;          // Skip converting/uploading unchanged rows
+    unsigned audio_rate;    // Output device rate (0 = default)
+    unsigned audio_latency; // Audio buffer in milliseconds (0 = default)
+    bool threaded;          // Run the core on its own thread (libretro_pipeline)
+    bool headless;          // No window or audio device; run as fast as possible
+    unsigned frames;        // Frames to run in headless mode
+    bool frames_set;        // --frames given (otherwise playback runs the whole movie)
+    unsigned instances;     // Headless instances to run side by side (0 = one, the normal way)
+    bool pin_instances;     // Pin instance threads to CPUs
+    const char* batch;      // Batch manifest to run instead of a core (libretro_batch)
+    const char* batch_report; // Write batch results here
+    unsigned workers;       // Batch worker threads (0 = the manifest's, or one per CPU)
+    bool perf_overlay;      // Draw per-stage timings over the game
+    const char* perf_dump;  // Write per-frame timings here on exit (.csv/.json)
+    unsigned frame_delay;   // Milliseconds to wait after present before running the core
+    libretro_pacing_mode_t pacing; // Clock frames follow: timer, vsync or audio
+    double max_skew;        // Largest speed change to match the display (fraction)
+    unsigned run_ahead;     // Frames to run ahead of the real timeline (0 = off)
+    bool run_ahead_second_instance; // Run the hidden frames in a second copy of the core
+    bool rewind;            // Keep a savestate history; hold Backspace to rewind
+    unsigned rewind_mb;     // Rewind buffer size (0 = default)
+    unsigned rewind_interval; // Capture every N frames (0 = default)
+    bool rewind_compress;   // Run-length encode rewind deltas
+    const char* movie_record; // Record joypad input to this movie file
+    const char* movie_play; // Replay this movie, headless and unthrottled
+    const char* save_dir;   // SRAM and savestate directory (NULL = next to the content)
+    bool sram;              // Load and flush SRAM
+    unsigned sram_flush;    // Seconds between SRAM checks (0 = default)
+    const char* capture;    // Record video and audio here (libretro_capture)
+    const char* capture_codec; // ffmpeg encoder for non-.y4m captures (NULL = default)
+    bool fast_forward;      // Start in fast-forward (toggle with F)
+    unsigned ff_skip;       // Frames run per presented frame while fast-forwarding (0 = default)
+    bool ff_mute;           // Mute fast-forward audio instead of speeding it up
+    const char* content_cache; // Decompressed content cache directory (NULL = default)
+    unsigned content_cache_mb; // Cache size cap (0 = don't cache)
+    const char* options_file; // Core options file (NULL = per-core default)
+    const char* option_overrides[APP_MAX_OPTION_OVERRIDES]; // "key=value" from --option
+    unsigned option_override_count;
+    const char* shaders[LIBRETRO_SHADER_MAX_PASSES + 1]; // --shader passes, in order (+1 for "integer")
+    unsigned shader_count;
+} app_options_t;
+
+/**
+ * Default core options file: <config>/libretro_raylib/<core file name>.opt,
+ * where <config> is $XDG_CONFIG_HOME or ~/.config
+ * @return false if there is no config directory
+ */
+static bool default_options_path(const char* core_path, char* path, size_t size) {
+    const char* xdg = getenv("XDG_CONFIG_HOME");
+    const char* home = getenv("HOME");
+    char base[PATH_MAX];
+    const char* slash = strrchr(core_path, '/');
+    snprintf(base, sizeof(base), "%s", slash ? slash + 1 : core_path);
+    char* dot = strrchr(base, '.');
+    if (dot && dot != base) *dot = '\0';
+    
+    int len;
+    if (xdg && xdg[0]) {
+        len = snprintf(path, size, "%s/libretro_raylib/%s.opt", xdg, base);
+    } else if (home && home[0]) {
+        len = snprintf(path, size, "%s/.config/libretro_raylib/%s.opt", home, base);
+    } else {
+        return false;
+    }
+    return len > 0 && (size_t)len < size;
+}
+
+/**
+ * Base path for SRAM and savestates: <dir>/<content name>, where <dir> is
+ * --save-dir or the content's directory; without content, the core's name
+ * in the current directory
+ * @return false if the path doesn't fit
+ */
+static bool save_base_path(const app_options_t* options, char* path, size_t size) {
+    const char* source = options->rom_path ? options->rom_path : options->core_path;
+    const char* slash = strrchr(source, '/');
+    char name[PATH_MAX];
+    snprintf(name, sizeof(name), "%s", slash ? slash + 1 : source);
+    char* dot = strrchr(name, '.');
+    if (dot && dot != name) *dot = '\0';
+    
+    int len;
+    if (options->save_dir) {
+        len = snprintf(path, size, "%s/%s", options->save_dir, name);
+    } else if (options->rom_path && slash) {
+        len = snprintf(path, size, "%.*s/%s", (int)(slash - source), source, name);
+    } else {
+        len = snprintf(path, size, "%s", name);
+    }
+    return len > 0 && (size_t)len < size;
+}
+
+/**
+ * Prints command-line usage
+ * @param argv0 Program name
+ */
+static void print_usage(const char* argv0) {
+    printf("Usage: %s [options] <path_to_libretro_core.dylib> [rom_file]\n", argv0);
+    printf("       %s [options] --batch <manifest.json>\n", argv0);
+    printf("\nOptions:\n");
+    printf("  --no-native-upload   Always convert frames to RGBA8888 on the CPU\n");
+    printf("  --row-hash           Hash frame rows and skip unchanged ones\n");
+    printf("  --audio-rate HZ      Output sample rate (default %d)\n", LIBRETRO_AUDIO_DEFAULT_OUTPUT_RATE);
+    printf("  --audio-latency MS   Audio buffer size in milliseconds (default %d)\n", LIBRETRO_AUDIO_DEFAULT_LATENCY_MS);
+    printf("  --threaded           Run the core on an emulation thread, decoupled from rendering\n");
+    printf("  --headless           Run without a window or audio device and print timings\n");
+    printf("  --frames N           Frames to run in headless mode (default %d)\n", HEADLESS_DEFAULT_FRAMES);
+    printf("  --instances N        Run N headless instances of the core in this process, one thread each\n");
+    printf("  --no-pin             Don't pin instance or batch worker threads to CPUs\n");
+    printf("  --batch MANIFEST     Run the jobs in a JSON manifest in parallel and check their hashes\n");
+    printf("  --batch-report FILE  Write batch results, hashes included, as JSON\n");
+    printf("  --workers N          Batch worker threads (default: the manifest's, or one per CPU)\n");
+    printf("  --perf-overlay       Show min/avg/p99 time per frame stage\n");
+    printf("  --perf-dump FILE     Write per-frame stage timings on exit (.csv or .json)\n");
+    printf("  --frame-delay MS     Wait MS after vsync before running the core (lower input latency)\n");
+    printf("  --pacing MODE        Frame clock: timer (default), vsync or audio\n");
+    printf("  --max-skew PERCENT   Run up to PERCENT faster or slower to match the display (default %.0f)\n",
+           LIBRETRO_PACING_DEFAULT_MAX_SKEW * 100.0);
+    printf("  --run-ahead N        Run N frames ahead to hide the core's own input lag (max %d)\n",
+           LIBRETRO_RUNAHEAD_MAX_FRAMES);
+    printf("  --run-ahead-instance Run the hidden run-ahead frames in a second copy of the core\n");
+    printf("  --rewind             Keep a rewind buffer; hold Backspace to rewind\n");
+    printf("  --rewind-mb N        Rewind buffer size in megabytes (default %d)\n", LIBRETRO_REWIND_DEFAULT_MB);
+    printf("  --rewind-interval N  Capture a rewind state every N frames (default %d)\n",
+           LIBRETRO_REWIND_DEFAULT_INTERVAL);
+    printf("  --rewind-raw         Store rewind deltas uncompressed (faster, more memory)\n");
+    printf("  --record FILE        Record joypad input (plus a starting savestate) to a movie file\n");
+    printf("  --play FILE          Replay a movie headless and unthrottled, and print timings\n");
+    printf("  --save-dir DIR       Directory for SRAM and savestates (default: next to the content)\n");
+    printf("  --no-sram            Don't load or save the core's SRAM\n");
+    printf("  --sram-flush SEC     Write changed SRAM every SEC seconds (default %d)\n",
+           LIBRETRO_SAVE_DEFAULT_FLUSH_FRAMES / 60);
+    printf("  --capture FILE       Record video (.y4m, or through ffmpeg for other extensions) and a .wav\n");
+    printf("  --capture-codec NAME ffmpeg video encoder for --capture (default h264_videotoolbox on macOS)\n");
+    printf("  --fast-forward       Start fast-forwarding (F toggles)\n");
+    printf("  --ff-skip N          Present one frame in N while fast-forwarding (default %d)\n",
+           LIBRETRO_FASTFORWARD_DEFAULT_SKIP);
+    printf("  --ff-audio MODE      Fast-forward audio: mute (default) or stretch\n");
+    printf("  --options FILE       Core options file (default ~/.config/libretro_raylib/<core>.opt)\n");
+    printf("  --option KEY=VALUE   Set a core option (saved to the options file)\n");
+    printf("  --content-cache DIR  Keep decompressed zip/gz content in DIR\n");
+    printf("  --content-cache-mb N Decompressed content cache cap in megabytes (default %d, 0 = off)\n",
+           LIBRETRO_CONTENT_CACHE_DEFAULT_MB);
+    printf("  --shader NAME|FILE   Add a scaling pass: nearest, bilinear, sharp-bilinear, crt,\n");
+    printf("                       integer or a GLSL fragment shader file (repeatable, in order)\n");
+    printf("\nExample:\n");
+    printf("  %s mgba_libretro.dylib mike_test.gba\n", argv0);
+    printf("  %s mgba_libretro.dylib\n", argv0);
+    printf("\nNote: The first argument must be a libretro core (.dylib file), not the executable itself.\n");
+}
+
+/**
+ * Parses command-line arguments
+ * @param argc Argument count
+ * @param argv Argument vector
+ * @param options Output options
+ * @return true on success, false if usage should be printed
+ */
+static bool parse_options(int argc, char* argv[], app_options_t* options) {
+    memset(options, 0, sizeof(*options));
+    options->native_upload = true;
+    options->frames = HEADLESS_DEFAULT_FRAMES;
+    options->pin_instances = true;
+    options->rewind_compress = true;
+    options->ff_mute = true;
+    options->sram = true;
+    options->content_cache_mb = LIBRETRO_CONTENT_CACHE_DEFAULT_MB;
+    options->pacing = LIBRETRO_PACING_TIMER;
+    options->max_skew = LIBRETRO_PACING_DEFAULT_MAX_SKEW;
+    
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        if (strcmp(arg, "--no-native-upload") == 0) {
+            options->native_upload = false;
+        } else if (strcmp(arg, "--row-hash") == 0) {
+            options->row_hash = true;
+        } else if (strcmp(arg, "--audio-rate") == 0 && i + 1 < argc) {
+            options->audio_rate = (unsigned)atoi(argv[++i]);
+        } else if (strcmp(arg, "--audio-latency") == 0 && i + 1 < argc) {
+            options->audio_latency = (unsigned)atoi(argv[++i]);
+        } else if (strcmp(arg, "--threaded") == 0) {
+            options->threaded = true;
+        } else if (strcmp(arg, "--headless") == 0) {
+            options->headless = true;
+        } else if (strcmp(arg, "--frames") == 0 && i + 1 < argc) {
+            options->frames = (unsigned)atoi(argv[++i]);
+            options->frames_set = true;
+        } else if (strcmp(arg, "--instances") == 0 && i + 1 < argc) {
+            options->instances = (unsigned)atoi(argv[++i]);
+            options->headless = true;
+        } else if (strcmp(arg, "--no-pin") == 0) {
+            options->pin_instances = false;
+        } else if (strcmp(arg, "--batch") == 0 && i + 1 < argc) {
+            options->batch = argv[++i];
+        } else if (strcmp(arg, "--batch-report") == 0 && i + 1 < argc) {
+            options->batch_report = argv[++i];
+        } else if (strcmp(arg, "--workers") == 0 && i + 1 < argc) {
+            options->workers = (unsigned)atoi(argv[++i]);
+        } else if (strcmp(arg, "--perf-overlay") == 0) {
+            options->perf_overlay = true;
+        } else if (strcmp(arg, "--perf-dump") == 0 && i + 1 < argc) {
+            options->perf_dump = argv[++i];
+        } else if (strcmp(arg, "--frame-delay") == 0 && i + 1 < argc) {
+            options->frame_delay = (unsigned)atoi(argv[++i]);
+        } else if (strcmp(arg, "--run-ahead") == 0 && i + 1 < argc) {
+            options->run_ahead = (unsigned)atoi(argv[++i]);
+        } else if (strcmp(arg, "--run-ahead-instance") == 0) {
+            options->run_ahead_second_instance = true;
+        } else if (strcmp(arg, "--rewind") == 0) {
+            options->rewind = true;
+        } else if (strcmp(arg, "--rewind-mb") == 0 && i + 1 < argc) {
+            options->rewind = true;
+            options->rewind_mb = (unsigned)atoi(argv[++i]);
+        } else if (strcmp(arg, "--rewind-interval") == 0 && i + 1 < argc) {
+            options->rewind = true;
+            options->rewind_interval = (unsigned)atoi(argv[++i]);
+        } else if (strcmp(arg, "--rewind-raw") == 0) {
+            options->rewind = true;
+            options->rewind_compress = false;
+        } else if (strcmp(arg, "--record") == 0 && i + 1 < argc) {
+            options->movie_record = argv[++i];
+        } else if (strcmp(arg, "--play") == 0 && i + 1 < argc) {
+            options->movie_play = argv[++i];
+            options->headless = true;
+        } else if (strcmp(arg, "--save-dir") == 0 && i + 1 < argc) {
+            options->save_dir = argv[++i];
+        } else if (strcmp(arg, "--no-sram") == 0) {
+            options->sram = false;
+        } else if (strcmp(arg, "--sram-flush") == 0 && i + 1 < argc) {
+            options->sram_flush = (unsigned)atoi(argv[++i]);
+        } else if (strcmp(arg, "--capture") == 0 && i + 1 < argc) {
+            options->capture = argv[++i];
+        } else if (strcmp(arg, "--capture-codec") == 0 && i + 1 < argc) {
+            options->capture_codec = argv[++i];
+        } else if (strcmp(arg, "--pacing") == 0 && i + 1 < argc) {
+            const char* mode = argv[++i];
+            if (!libretro_pacing_parse_mode(mode, &options->pacing)) {
+                fprintf(stderr, "Unknown pacing mode: %s\n", mode);
+                return false;
+            }
+        } else if (strcmp(arg, "--max-skew") == 0 && i + 1 < argc) {
+            options->max_skew = atof(argv[++i]) / 100.0;
+        } else if (strcmp(arg, "--fast-forward") == 0) {
+            options->fast_forward = true;
+        } else if (strcmp(arg, "--ff-skip") == 0 && i + 1 < argc) {
+            options->ff_skip = (unsigned)atoi(argv[++i]);
+        } else if (strcmp(arg, "--ff-audio") == 0 && i + 1 < argc) {
+            const char* mode = argv[++i];
+            if (strcmp(mode, "mute") != 0 && strcmp(mode, "stretch") != 0) {
+                fprintf(stderr, "Unknown fast-forward audio mode: %s\n", mode);
+                return false;
+            }
+            options->ff_mute = strcmp(mode, "mute") == 0;
+        } else if (strcmp(arg, "--options") == 0 && i + 1 < argc) {
+            options->options_file = argv[++i];
+        } else if (strcmp(arg, "--option") == 0 && i + 1 < argc) {
+            const char* option = argv[++i];
+            if (!strchr(option, '=') || options->option_override_count == APP_MAX_OPTION_OVERRIDES) {
+                fprintf(stderr, "Invalid or too many --option values: %s\n", option);
+                return false;
+            }
+            options->option_overrides[options->option_override_count++] = option;
+        } else if (strcmp(arg, "--content-cache") == 0 && i + 1 < argc) {
+            options->content_cache = argv[++i];
+        } else if (strcmp(arg, "--content-cache-mb") == 0 && i + 1 < argc) {
+            options->content_cache_mb = (unsigned)atoi(argv[++i]);
+        } else if (strcmp(arg, "--shader") == 0 && i + 1 < argc) {
+            if (options->shader_count == LIBRETRO_SHADER_MAX_PASSES + 1) {
+                fprintf(stderr, "Too many --shader passes\n");
+                return false;
+            }
+            options->shaders[options->shader_count++] = argv[++i];
+        } else if (strncmp(arg, "--", 2) == 0) {
+            fprintf(stderr, "Unknown option: %s\n", arg);
+            return false;
+        } else if (!options->core_path) {
+            options->core_path = arg;
+        } else if (!options->rom_path) {
+            options->rom_path = arg;
+        } else {
+            fprintf(stderr, "Unexpected argument: %s\n", arg);
+            return false;
+        }
+    }
+    
+    // A batch names its cores in the manifest
+    return options->core_path != NULL || options->batch != NULL;
+}
+
+//=============================================================================
+// Frame Texture
+//=============================================================================
+
+/**
+ * GPU texture the current frame is uploaded to
+ */
+typedef struct {
+    Texture2D texture;
+    int width;          // Texture width (pitch / bpp for native frames)
+    int height;
+    int format;         // PIXELFORMAT_*
+    bool needs_full_upload; // Freshly created, contents undefined
+} frame_texture_t;
+
+/**
+ * (Re)creates the frame texture if its size or format changed
+ * @param ft Frame texture
+ * @param width Texture width in pixels
+ * @param height Texture height in pixels
+ * @param format PIXELFORMAT_* of the data that will be uploaded
+ * @return true if a usable texture exists
+ */
+static bool frame_texture_ensure(frame_texture_t* ft, int width, int height, int format) {
+    if (ft->texture.id != 0 && ft->width == width && ft->height == height && ft->format == format) {
+        return true;
+    }
+    
+    if (ft->texture.id != 0) {
+        UnloadTexture(ft->texture);
+        ft->texture = (Texture2D){0};
+    }
+    
+    if (width <= 0 || height <= 0) return false;
+    
+    // Allocate storage only; the frame is uploaded with UpdateTexture
+    Image img = {
+        .data = NULL,
+        .width = width,
+        .height = height,
+        .format = format,
+        .mipmaps = 1
+    };
+    ft->texture = LoadTextureFromImage(img);
+    ft->width = width;
+    ft->height = height;
+    ft->format = format;
+    ft->needs_full_upload = true;
+    
+    if (ft->texture.id == 0) {
+        fprintf(stderr, "Failed to create %dx%d texture (format %d)\n", width, height, format);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Uploads the changed rows of a frame to the texture
+ * @param ft Frame texture
+ * @param pixels Frame data, one texture row every row_bytes
+ * @param row_bytes Bytes between consecutive rows of pixels
+ * @param first_row First changed row
+ * @param end_row One past the last changed row
+ */
+static void frame_texture_upload(frame_texture_t* ft, const void* pixels, size_t row_bytes,
+                                 unsigned first_row, unsigned end_row) {
+    if (end_row > (unsigned)ft->height) end_row = (unsigned)ft->height;
+    
+    if (ft->needs_full_upload || (first_row == 0 && end_row == (unsigned)ft->height)) {
+        UpdateTexture(ft->texture, pixels);
+        ft->needs_full_upload = false;
+        return;
+    }
+    
+    if (first_row >= end_row) return;
+    UpdateTextureRec(ft->texture,
+                     (Rectangle){0, (float)first_row, (float)ft->width, (float)(end_row - first_row)},
+                     (const uint8_t*)pixels + first_row * row_bytes);
+}
+
+/**
+ * A frame ready for upload, from either the serial or the threaded path
+ */
+typedef struct {
+    const void* pixels;         // NULL until a frame has arrived
+    size_t row_bytes;           // Bytes between rows of pixels
+    int texture_width;          // pitch / bpp for native frames
+    int texture_height;
+    int texture_format;         // PIXELFORMAT_*
+    Rectangle source;           // Visible part of the texture
+    bool swizzle;               // Native XRGB8888 frame, drawn with the swizzle shader
+    bool dirty;                 // Rows [first_row, end_row) need uploading
+    unsigned first_row;
+    unsigned end_row;
+    unsigned display_width;     // Display size from AV info (aspect and window size)
+    unsigned display_height;
+} frame_view_t;
+
+/**
+ * Describes a frame in the core's native XRGB8888/RGB565 format
+ */
+static void frame_view_native(frame_view_t* view, const void* pixels, size_t pitch,
+                              unsigned width, unsigned height, unsigned format) {
+    bool is_xrgb = format == RETRO_PIXEL_FORMAT_XRGB8888;
+    int bpp = is_xrgb ? 4 : 2;
+    view->pixels = pixels;
+    view->row_bytes = pitch;
+    view->texture_width = (int)(pitch / bpp);
+    view->texture_height = (int)height;
+    view->texture_format = is_xrgb ? PIXELFORMAT_UNCOMPRESSED_R8G8B8A8 : PIXELFORMAT_UNCOMPRESSED_R5G6B5;
+    view->source = (Rectangle){0, 0, (float)width, (float)height};
+    view->swizzle = is_xrgb;
+}
+
+/**
+ * Describes a frame converted to RGBA8888 at its own size
+ */
+static void frame_view_converted(frame_view_t* view, const void* pixels, unsigned width, unsigned height) {
+    view->pixels = pixels;
+    view->row_bytes = (size_t)width * 4;
+    view->texture_width = (int)width;
+    view->texture_height = (int)height;
+    view->texture_format = PIXELFORMAT_UNCOMPRESSED_R8G8B8A8;
+    view->source = (Rectangle){0, 0, (float)width, (float)height};
+    view->swizzle = false;
+}
+
+/**
+ * Serial mode: takes the frame the video callback just produced
+ * @param frontend Frontend (core runs on this thread)
+ * @param view Output frame view
+ */
+static void frame_view_from_frontend(libretro_frontend_t* frontend, frame_view_t* view) {
+    memset(view, 0, sizeof(*view));
+    libretro_frontend_get_video_size(frontend, &view->display_width, &view->display_height);
+    
+    // Duplicate and unchanged frames are not uploaded at all; with row
+    // hashing only the changed span of rows is sent
+    view->dirty = libretro_frontend_frame_dirty(frontend, &view->first_row, &view->end_row);
+    
+    size_t native_pitch = 0;
+    const void* native_frame = libretro_frontend_get_native_frame(frontend, &native_pitch);
+    if (native_frame) {
+        frame_view_native(view, native_frame, native_pitch, frontend->frame_width, frontend->frame_height,
+                          frontend->pixel_format);
+    } else if (frontend->framebuffer) {
+        frame_view_converted(view, frontend->framebuffer, frontend->frame_width, frontend->frame_height);
+    }
+    libretro_frontend_clear_frame_dirty(frontend);
+}
+
+/**
+ * Threaded mode: takes the newest frame from the pipeline, converting it
+ * here on the render thread if it can't be uploaded as-is
+ * @param pipeline Running pipeline
+ * @param native_upload Whether native uploads are enabled
+ * @param view Frame view, left untouched if no new frame arrived
+ */
+static void frame_view_from_pipeline(libretro_pipeline_t* pipeline, bool native_upload, frame_view_t* view) {
+    const libretro_pipeline_frame_t* frame = libretro_pipeline_acquire(pipeline);
+    if (!frame) return;
+    
+    bool native_format = frame->format == RETRO_PIXEL_FORMAT_XRGB8888 ||
+                         frame->format == RETRO_PIXEL_FORMAT_RGB565;
+    if (native_upload && native_format && (frame->pitch % 4) == 0) {
+        frame_view_native(view, frame->data, frame->pitch, frame->width, frame->height, frame->format);
+    } else {
+        const uint32_t* pixels = libretro_pipeline_convert(pipeline, frame);
+        if (!pixels) return;
+        frame_view_converted(view, pixels, frame->width, frame->height);
+    }
+    view->display_width = frame->display_width;
+    view->display_height = frame->display_height;
+    view->dirty = true;
+    view->first_row = 0;
+    view->end_row = (unsigned)view->texture_height;
+}
+
+/**
+ * Puts back the GL state raylib relies on after a hardware rendered core ran
+ * (rlgl caches some of it, so the blend mode is toggled to force a reset)
+ */
+static void hw_restore_raylib_state(void) {
+    rlDisableFramebuffer();
+    rlViewport(0, 0, GetRenderWidth(), GetRenderHeight());
+    rlDisableDepthTest();
+    rlDisableScissorTest();
+    rlEnableBackfaceCulling();
+    rlEnableColorBlend();
+    rlSetBlendMode(RL_BLEND_ADDITIVE);
+    rlSetBlendMode(RL_BLEND_ALPHA);
+    rlActiveTextureSlot(0);
+}
+
+//=============================================================================
+// Perf Overlay
+//=============================================================================
+
+// Frames the overlay statistics cover (about two seconds at 60 fps)
+#define PERF_OVERLAY_FRAMES 120
+#define PERF_OVERLAY_FONT 10
+
+/**
+ * Adds the time since start to a stage and returns the current time, so
+ * consecutive stages can be timed with one clock read each
+ * @param perf Recorder, or NULL when timing is off
+ * @param stage Stage that just finished
+ * @param start Time the stage began
+ * @return Current time (0 when timing is off)
+ */
+static uint64_t perf_lap(libretro_perf_t* perf, libretro_perf_stage_t stage, uint64_t start) {
+    if (!perf) return 0;
+    uint64_t now = libretro_perf_now_ns();
+    libretro_perf_add(perf, stage, now - start);
+    return now;
+}
+
+/**
+ * Draws min/avg/p99 per stage over the last PERF_OVERLAY_FRAMES frames
+ * @param log Drained perf log
+ */
+static void draw_perf_overlay(const libretro_perf_log_t* log, const libretro_pacing_t* pacing) {
+    const int x = 10, line = PERF_OVERLAY_FONT + 2;
+    int y = 34;
+    char text[96];
+    
+    DrawRectangle(x - 4, y - 4, 250, line * (LIBRETRO_PERF_FRAME + 4) + 6, Fade(BLACK, 0.6f));
+    DrawText("stage       min    avg    p99  (ms)", x, y, PERF_OVERLAY_FONT, LIGHTGRAY);
+    y += line;
+    
+    for (int s = 0; s <= LIBRETRO_PERF_FRAME; s++) {
+        libretro_perf_stats_t stats;
+        if (!libretro_perf_log_get_stats(log, s, PERF_OVERLAY_FRAMES, &stats)) continue;
+        snprintf(text, sizeof(text), "%-8s %6.2f %6.2f %6.2f", libretro_perf_stage_name(s),
+                 stats.min / 1e6, stats.avg / 1e6, stats.p99 / 1e6);
+        DrawText(text, x, y, PERF_OVERLAY_FONT, (s == LIBRETRO_PERF_FRAME) ? YELLOW : RAYWHITE);
+        y += line;
+    }
+    
+    // Pacing: how the core is clocked and how evenly frames reach the screen
+    libretro_pacing_stats_t pace;
+    double display = (pacing->measured_refresh > 0.0) ? pacing->measured_refresh : pacing->refresh;
+    snprintf(text, sizeof(text), "pace %-5s x%.4f  display %.2f Hz", libretro_pacing_mode_name(pacing->mode),
+             libretro_pacing_speed(pacing), display);
+    DrawText(text, x, y, PERF_OVERLAY_FONT, LIGHTGRAY);
+    y += line;
+    if (libretro_pacing_get_stats(pacing, &pace)) {
+        snprintf(text, sizeof(text), "present  %6.2f jitter %5.2f max %5.2f", pace.interval_ms,
+                 pace.jitter_ms, pace.max_jitter_ms);
+        DrawText(text, x, y, PERF_OVERLAY_FONT, LIGHTGRAY);
+    }
+}
+
+/**
+ * Prints the pacing mode and how evenly frames were presented at the end
+ * @param pacing Pacing state
+ */
+static void print_pacing_stats(const libretro_pacing_t* pacing) {
+    libretro_pacing_stats_t stats;
+    if (!libretro_pacing_get_stats(pacing, &stats)) return;
+    fprintf(stderr, "Pacing: %s at x%.4f speed, %u frames presented, last %.3f ms apart, "
+            "jitter %.3f ms avg / %.3f ms max\n",
+            libretro_pacing_mode_name(pacing->mode), libretro_pacing_speed(pacing), stats.count + 1,
+            stats.interval_ms, stats.jitter_ms, stats.max_jitter_ms);
+}
+
+/**
+ * Prints how much the rewind buffer stored and saved
+ * @param rewind Rewind state (ignored if rewind is off)
+ */
+static void print_rewind_stats(const libretro_rewind_t* rewind) {
+    if (!rewind->frontend || rewind->captures == 0) return;
+    fprintf(stderr, "Rewind: %llu captures, %.1f bytes per delta (%.2f%% of state), %zu available, %llu steps\n",
+            (unsigned long long)rewind->captures,
+            (double)rewind->stored_bytes / rewind->captures,
+            100.0 * rewind->stored_bytes / rewind->state_bytes,
+            libretro_rewind_available(rewind), (unsigned long long)rewind->steps);
+}
+
+//=============================================================================
+// Headless Mode
+//=============================================================================
+
+// Frames drained from the audio ring per read (stands in for the audio device)
+#define HEADLESS_AUDIO_CHUNK 1024
+
+/**
+ * Runs the core as fast as possible without a window or audio device
+ * Video is still converted (only the presented frames when fast-forwarding)
+ * and audio still resampled into the ring, which is drained every frame as
+ * the audio thread would; timings go to stdout
+ * @param frontend Frontend with content loaded
+ * @param frames Number of core frames to run
+ * @return Exit code
+ */
+static int run_headless(libretro_frontend_t* frontend, unsigned frames, const char* perf_dump) {
+    libretro_perf_t perf;
+    libretro_perf_log_t perf_log;
+    float* audio = (float*)malloc(HEADLESS_AUDIO_CHUNK * 2 * sizeof(float));
+    if (!audio || !libretro_perf_init(&perf, "main", LIBRETRO_PERF_ALL_STAGES)) {
+        fprintf(stderr, "Failed to allocate headless buffers\n");
+        free(audio);
+        return 1;
+    }
+    libretro_perf_log_init(&perf_log, frames);
+    libretro_perf_log_attach(&perf_log, &perf);
+    frontend->perf = &perf;
+    
+    uint64_t start = libretro_perf_now_ns();
+    perf.frame_start = start;
+    unsigned ran = 0;
+    while (ran < frames) {
+        ran += libretro_frontend_run_display_frame(frontend);
+        libretro_frontend_clear_frame_dirty(frontend);
+        
+        uint64_t drain_start = libretro_perf_now_ns();
+        while (libretro_audio_ring_read(&frontend->audio_ring, audio, HEADLESS_AUDIO_CHUNK) == HEADLESS_AUDIO_CHUNK) {
+        }
+        libretro_perf_add(&perf, LIBRETRO_PERF_AUDIO, libretro_perf_now_ns() - drain_start);
+        
+        libretro_perf_end_frame(&perf);
+        libretro_perf_log_drain(&perf_log);
+    }
+    double elapsed = (double)(libretro_perf_now_ns() - start) / 1e9;
+    
+    double fps = (elapsed > 0.0) ? ran / elapsed : 0.0;
+    double core_fps = (frontend->fps > 0.0) ? frontend->fps : 60.0;
+    printf("Headless: %u frames in %.3f s: %.1f fps (%.1fx realtime at %.2f fps)\n",
+           ran, elapsed, fps, fps / core_fps, core_fps);
+    printf("Video: %ux%u, format %u; audio: %u Hz -> %u Hz\n",
+           frontend->width, frontend->height, frontend->pixel_format,
+           frontend->audio_sample_rate, frontend->audio_output_rate);
+    libretro_perf_log_print_report(&perf_log, stdout);
+    
+    bool dumped = !perf_dump || libretro_perf_log_dump(&perf_log, perf_dump);
+    
+    frontend->perf = NULL;
+    libretro_perf_log_free(&perf_log);
+    libretro_perf_free(&perf);
+    free(audio);
+    return dumped ? 0 : 1;
+}
+
+/**
+ * Runs several headless instances of the core side by side in this process
+ * (libretro_instance), then prints each one's throughput
+ * @param options Command-line options
+ * @param options_path Core options file (may be empty)
+ * @return Exit code
+ */
+static int run_instances(const app_options_t* options, const char* options_path) {
+    unsigned count = options->instances;
+    libretro_instance_t* instances = (libretro_instance_t*)calloc(count, sizeof(libretro_instance_t));
+    if (!instances) {
+        fprintf(stderr, "Failed to allocate %u instances\n", count);
+        return 1;
+    }
+    for (unsigned i = 0; i < count; i++) {
+        libretro_instance_config_t* config = &instances[i].config;
+        config->core_path = options->core_path;
+        config->rom_path = options->rom_path;
+        config->frames = options->frames;
+        config->options_path = options_path[0] ? options_path : NULL;
+        config->option_overrides = options->option_overrides;
+        config->option_override_count = options->option_override_count;
+    }
+    
+    libretro_content_set_cache(options->content_cache, options->content_cache_mb);
+    uint64_t start = libretro_perf_now_ns();
+    bool ok = libretro_instance_run_all(instances, count, options->pin_instances);
+    double elapsed = (double)(libretro_perf_now_ns() - start) / 1e9;
+    
+    unsigned long long total_frames = 0;
+    for (unsigned i = 0; i < count; i++) {
+        const libretro_instance_t* instance = &instances[i];
+        if (!instance->ok) {
+            printf("Instance %u: failed\n", i);
+            continue;
+        }
+        double fps = instance->run_seconds > 0.0 ? instance->frames_run / instance->run_seconds : 0.0;
+        double core_fps = instance->core_fps > 0.0 ? instance->core_fps : 60.0;
+        printf("Instance %u (cpu %d): loaded in %.3f s, %u frames in %.3f s: %.1f fps (%.1fx realtime)\n",
+               i, instance->cpu, instance->load_seconds, instance->frames_run, instance->run_seconds,
+               fps, fps / core_fps);
+        total_frames += instance->frames_run;
+    }
+    
+    // ru_maxrss is in kilobytes on Linux and bytes on macOS
+    struct rusage usage;
+    double rss_mb = 0.0;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+#ifdef __APPLE__
+        rss_mb = usage.ru_maxrss / 1048576.0;
+#else
+        rss_mb = usage.ru_maxrss / 1024.0;
+#endif
+    }
+    printf("Instances: %u in %.3f s, %.1f frames/s combined, peak RSS %.1f MB (%.1f MB per instance)\n",
+           count, elapsed, elapsed > 0.0 ? total_frames / elapsed : 0.0, rss_mb, rss_mb / count);
+    
+    free(instances);
+    return ok ? 0 : 1;
+}
+
+//=============================================================================
+// Startup
+//=============================================================================
+
+// Window size guessed before the core has reported one, when the metadata
+// cache has nothing (libretro_core_init's defaults)
+#define STARTUP_GUESS_WIDTH 240
+#define STARTUP_GUESS_HEIGHT 160
+
+/**
+ * Core startup: open, initialize and load content, on its own thread in
+ * windowed mode so the window and audio device come up alongside
+ */
+typedef struct {
+    libretro_frontend_t* frontend;
+    const char* core_path;
+    const char* rom_path;
+    bool ok;
+    uint64_t core_ns;       // dlopen, symbols, retro_set_environment, retro_init
+    uint64_t content_ns;    // retro_load_game, including decompression
+} core_startup_t;
+
+static void core_startup_run(core_startup_t* startup) {
+    libretro_frontend_t* frontend = startup->frontend;
+    uint64_t start = libretro_perf_now_ns();
+    
+    if (!libretro_frontend_load_core(frontend, startup->core_path)) {
+        fprintf(stderr, "Failed to load core\n");
+        return;
+    }
+    if (!libretro_frontend_init_core(frontend)) {
+        fprintf(stderr, "Failed to initialize core\n");
+        return;
+    }
+    uint64_t initialized = libretro_perf_now_ns();
+    startup->core_ns = initialized - start;
+    
+    // Load ROM if provided, or initialize in no-game mode
+    if (startup->rom_path) {
+        if (!libretro_frontend_load_rom(frontend, startup->rom_path)) {
+            fprintf(stderr, "Failed to load ROM\n");
+            return;
+        }
+        // Don't reset immediately - let VICE boot naturally
+        // RetroArch doesn't reset after loading, cores handle their own initialization
+        fprintf(stderr, "ROM loaded, letting core boot naturally...\n");
+    } else if (!libretro_frontend_load_rom(frontend, NULL)) {
+        fprintf(stderr, "Failed to start without a game\n");
+        return;
+    }
+    startup->content_ns = libretro_perf_now_ns() - initialized;
+    startup->ok = true;
+}
+
+static void* core_startup_thread(void* arg) {
+    core_startup_run((core_startup_t*)arg);
+    return NULL;
+}
+
+/**
+ * Closes what was opened alongside the core, for exits before the main loop
+ */
+static void close_devices(AudioStream audio_stream, bool audio_stream_created, libretro_shader_chain_t* shader_chain) {
+    if (audio_stream_created) {
+        UnloadAudioStream(audio_stream);
+    }
+    CloseAudioDevice();
+    libretro_shader_chain_free(shader_chain);
+    CloseWindow();
 }
 
 //=============================================================================
@@ -142,17 +1061,31 @@ static void update_input(libretro_frontend_t* frontend) {
  * @return Exit code (0 on success, 1 on error)
  */
 int main(int argc, char* argv[]) {
-    if (argc < 2) {
-        printf("Usage: %s <path_to_libretro_core.dylib> [rom_file]\n", argv[0]);
-        printf("\nExample:\n");
-        printf("  %s mgba_libretro.dylib mike_test.gba\n", argv[0]);
-        printf("  %s mgba_libretro.dylib\n", argv[0]);
-        printf("\nNote: The first argument must be a libretro core (.dylib file), not the executable itself.\n");
+    uint64_t launch_ns = libretro_perf_now_ns();
+    app_options_t options;
+    if (!parse_options(argc, argv, &options)) {
+        print_usage(argv[0]);
         return 1;
     }
     
-    const char* core_path = argv[1];
-    const char* rom_path = (argc >= 3) ? argv[2] : NULL;
+    if (options.batch) {
+        return libretro_batch_run(options.batch, options.batch_report, options.workers, options.frames,
+                                  options.pin_instances) ? 0 : 1;
+    }
+    
+    const char* core_path = options.core_path;
+    const char* rom_path = options.rom_path;
+    
+    char options_path[PATH_MAX];
+    if (options.options_file) {
+        snprintf(options_path, sizeof(options_path), "%s", options.options_file);
+    } else if (!default_options_path(core_path, options_path, sizeof(options_path))) {
+        options_path[0] = '\0';
+    }
+    
+    if (options.instances > 0) {
+        return run_instances(&options, options_path);
+    }
     
     // Initialize frontend
     libretro_frontend_t frontend;
@@ -160,261 +1093,527 @@ int main(int argc, char* argv[]) {
         fprintf(stderr, "Failed to initialize frontend\n");
         return 1;
     }
+    // Headless has no GPU to upload to, so frames always take the conversion path
+    frontend.native_upload = options.native_upload && !options.headless;
+    frontend.video_row_hash = options.row_hash;
+    if (options.ff_skip) frontend.fastforward_skip = options.ff_skip;
+    frontend.fastforward_mute = options.ff_mute;
+    if (options.audio_rate || options.audio_latency) {
+        libretro_frontend_set_audio_output(&frontend, options.audio_rate, options.audio_latency);
+    }
     
-    // Load core
-    if (!libretro_frontend_load_core(&frontend, core_path)) {
-        fprintf(stderr, "Failed to load core\n");
-        libretro_frontend_deinit(&frontend);
-        return 1;
+    // Hardware rendering needs the window's GL context
+    frontend.hw.available = !options.headless;
+    
+    // Core options are read before the core is loaded: cores may declare
+    // and query them from retro_set_environment/retro_init
+    if (options_path[0]) {
+        libretro_options_load(&frontend.options, options_path);
+    }
+    for (unsigned i = 0; i < options.option_override_count; i++) {
+        libretro_options_set_assignment(&frontend.options, options.option_overrides[i]);
     }
     
-    // Initialize core
-    if (!libretro_frontend_init_core(&frontend)) {
-        fprintf(stderr, "Failed to initialize core\n");
-        libretro_frontend_deinit(&frontend);
-        return 1;
+    // The core is opened, initialized and given its content on a startup
+    // thread while this thread brings up the window, audio device and
+    // shaders (raylib wants those on the main thread); the last run's
+    // metadata sizes the window before the core has said anything
+    libretro_core_meta_t cached_meta;
+    bool meta_cached = libretro_core_cache_load(core_path, &cached_meta);
+    if (rom_path) {
+        libretro_content_set_cache(options.content_cache, options.content_cache_mb);
+    }
+    core_startup_t startup = { &frontend, core_path, rom_path, false, 0, 0 };
+    pthread_t startup_thread;
+    bool startup_threaded = false;
+    if (!options.headless) {
+        pthread_attr_t attr;
+        pthread_attr_init(&attr);
+        pthread_attr_setstacksize(&attr, LIBRETRO_INSTANCE_STACK_SIZE);
+        startup_threaded = pthread_create(&startup_thread, &attr, core_startup_thread, &startup) == 0;
+        pthread_attr_destroy(&attr);
+    }
+    if (!startup_threaded) {
+        core_startup_run(&startup);
     }
     
-    // Audio stream will be created after ROM loads (when we know the sample rate)
+    unsigned width = STARTUP_GUESS_WIDTH, height = STARTUP_GUESS_HEIGHT;
+    if (meta_cached && cached_meta.have_av) {
+        width = cached_meta.base_width;
+        height = cached_meta.base_height;
+    }
+    int window_width = width * 3;  // Scale up for visibility
+    int window_height = height * 3;
     AudioStream audio_stream = {0};
     bool audio_stream_created = false;
+    libretro_shader_chain_t shader_chain;
+    bool shaders_ready = false;
+    uint64_t devices_ns = 0;
     
-    // Load ROM if provided, or initialize in no-game mode
-    if (rom_path) {
-        if (!libretro_frontend_load_rom(&frontend, rom_path)) {
-            fprintf(stderr, "Failed to load ROM\n");
-            libretro_frontend_deinit(&frontend);
-            return 1;
+    if (!options.headless) {
+        uint64_t devices_start = libretro_perf_now_ns();
+        
+        // Disable raylib debug output
+        SetTraceLogLevel(LOG_NONE);
+        
+        input_mapper_init();
+        
+        // Vsync pacing runs frames off the buffer swap, so ask for one that waits
+        if (options.pacing == LIBRETRO_PACING_VSYNC) {
+            SetConfigFlags(FLAG_VSYNC_HINT);
         }
-        // Don't reset immediately - let VICE boot naturally
-        // RetroArch doesn't reset after loading, cores handle their own initialization
-        fprintf(stderr, "ROM loaded, letting core boot naturally...\n");
-    } else {
-        // Try to initialize in no-game mode
-        // Use libretro_frontend_load_rom with NULL to start without a game
-        if (!libretro_frontend_load_rom(&frontend, NULL)) {
-            fprintf(stderr, "Failed to start without a game\n");
+        InitWindow(window_width, window_height, "Libretro Player");
+        
+        // Initialize audio device (must be done before creating streams)
+        InitAudioDevice();
+        
+        // The stream pulls from the ring buffer on the audio thread, so its own
+        // buffer only needs to cover one device period
+        SetAudioStreamBufferSizeDefault(AUDIO_STREAM_BUFFER_FRAMES);
+        
+        // The core's audio is resampled to the output rate, so the stream always
+        // runs at a standard device rate regardless of what the core reports;
+        // it starts playing once the content is loaded
+        audio_stream = LoadAudioStream(frontend.audio_output_rate, 32, 2); // 32-bit float, stereo
+        audio_stream_created = IsAudioStreamReady(audio_stream);
+        
+        // All scaling and filtering happens on the GPU, through the shader chain
+        shaders_ready = libretro_shader_chain_init(&shader_chain);
+        for (unsigned i = 0; i < options.shader_count; i++) {
+            if (!libretro_shader_chain_add(&shader_chain, options.shaders[i])) {
+                fprintf(stderr, "Warning: skipping shader pass '%s'\n", options.shaders[i]);
+            }
+        }
+        devices_ns = libretro_perf_now_ns() - devices_start;
+    }
+    
+    if (startup_threaded) {
+        pthread_join(startup_thread, NULL);
+    }
+    if (!startup.ok) {
+        if (!options.headless) close_devices(audio_stream, audio_stream_created, &shader_chain);
+        libretro_frontend_deinit(&frontend);
+        return 1;
+    }
+    
+    // Remember what the core reported for the next launch
+    libretro_core_meta_t meta;
+    libretro_core_cache_collect(&frontend, &meta);
+    if ((!meta_cached || libretro_core_cache_changed(&meta, &cached_meta)) &&
+        !libretro_core_cache_store(core_path, &meta)) {
+        fprintf(stderr, "Warning: couldn't write the core metadata cache\n");
+    }
+    
+    // Run-ahead needs the loaded content's savestate size
+    libretro_runahead_t runahead;
+    if (!libretro_runahead_init(&runahead, &frontend, options.run_ahead)) {
+        fprintf(stderr, "Warning: running without run-ahead\n");
+    } else if (options.run_ahead_second_instance && runahead.frames > 0 &&
+               !libretro_runahead_use_second_instance(&runahead, core_path, rom_path)) {
+        fprintf(stderr, "Warning: running run-ahead on a single instance\n");
+    }
+    // Stepping back would leave a movie's timeline behind it
+    bool movie_active = options.movie_record || options.movie_play;
+    if (options.rewind && movie_active) {
+        fprintf(stderr, "Warning: rewind is off while a movie is recorded or played\n");
+        options.rewind = false;
+    }
+    libretro_rewind_t rewind = {0};
+    if (options.rewind && !libretro_rewind_init(&rewind, &frontend, options.rewind_mb,
+                                                options.rewind_interval, options.rewind_compress)) {
+        fprintf(stderr, "Warning: running without rewind\n");
+    }
+    
+    // Movies start from the state right after loading
+    libretro_movie_t movie = {0};
+    if (options.movie_play) {
+        if (!libretro_movie_play(&movie, &frontend, options.movie_play)) {
+            if (!options.headless) close_devices(audio_stream, audio_stream_created, &shader_chain);
+            libretro_runahead_free(&runahead);
             libretro_frontend_deinit(&frontend);
             return 1;
         }
+        if (!options.frames_set) options.frames = movie.frame_count;
+    } else if (options.movie_record && !libretro_movie_record(&movie, &frontend, options.movie_record)) {
+        fprintf(stderr, "Warning: not recording a movie\n");
     }
     
-    // Get video dimensions
-    unsigned width, height;
-    libretro_frontend_get_video_size(&frontend, &width, &height);
+    if (options.fast_forward) {
+        libretro_frontend_set_fastforward(&frontend, true);
+    }
     
-    // Initialize raylib window
-    int window_width = width * 3;  // Scale up for visibility
-    int window_height = height * 3;
+    // Capture tees frames and audio from the core's thread, so it is
+    // attached before the emulation thread starts
+    libretro_capture_t capture = {0};
+    if (options.capture && !libretro_capture_start(&capture, &frontend, options.capture, options.capture_codec)) {
+        fprintf(stderr, "Warning: not capturing\n");
+    }
+    
+    if (options.headless) {
+        fprintf(stderr, "Startup: core %.1f ms, content %.1f ms\n",
+                startup.core_ns / 1e6, startup.content_ns / 1e6);
+        int result = run_headless(&frontend, options.frames, options.perf_dump);
+        if (!libretro_capture_stop(&capture)) result = 1;
+        if (!libretro_movie_stop(&movie)) result = 1;
+        print_rewind_stats(&rewind);
+        libretro_rewind_free(&rewind);
+        libretro_runahead_free(&runahead);
+        libretro_frontend_print_memory(&frontend);
+        libretro_frontend_deinit(&frontend);
+        return result;
+    }
     
-    // Disable raylib debug output
-    SetTraceLogLevel(LOG_NONE);
+    // SRAM and savestate slots; disk I/O runs on the save thread, so this is
+    // set up before the emulation thread starts calling into it
+    libretro_save_t save = {0};
+    char save_path[sizeof(save.base_path)];
+    if (!save_base_path(&options, save_path, sizeof(save_path)) ||
+        !libretro_save_init(&save, &frontend, save_path, options.sram,
+                            (unsigned)(options.sram_flush * (frontend.fps > 0.0 ? frontend.fps : 60.0)))) {
+        fprintf(stderr, "Warning: running without saves\n");
+    }
+    save.loads_enabled = !movie_active;
+    int save_slot = 0;
     
-    InitWindow(window_width, window_height, "Libretro Player");
+    // Resize if the core's geometry isn't what the window was opened with
+    libretro_frontend_get_video_size(&frontend, &width, &height);
+    if ((int)width * 3 != window_width || (int)height * 3 != window_height) {
+        window_width = width * 3;
+        window_height = height * 3;
+        SetWindowSize(window_width, window_height);
+    }
     
-    // Set FPS based on core's reported FPS (updated after ROM load)
-    // Use the FPS from the frontend which was set by update_av_info
-    unsigned target_fps = (unsigned)(frontend.fps > 0 ? frontend.fps + 0.5 : 60.0);
+    // Hardware rendered cores asked for a context while loading; it exists
+    // now, so create their FBO. GL is bound to this thread, so they always
+    // run in serial mode.
+    bool hw_render = frontend.hw.requested;
+    if (hw_render) {
+        if (!libretro_hw_context_reset(&frontend.hw, frontend.max_width, frontend.max_height)) {
+            fprintf(stderr, "Failed to set up hardware rendering\n");
+            close_devices(audio_stream, audio_stream_created, &shader_chain);
+            libretro_capture_stop(&capture);
+            libretro_save_free(&save);
+            libretro_movie_stop(&movie);
+            libretro_rewind_free(&rewind);
+            libretro_runahead_free(&runahead);
+            libretro_frontend_deinit(&frontend);
+            return 1;
+        }
+        hw_restore_raylib_state();
+        if (options.threaded) {
+            fprintf(stderr, "Warning: hardware rendered cores run in serial mode\n");
+            options.threaded = false;
+        }
+    }
+    
+    // Frame pacing at the core's exact rate (set by update_av_info); raylib's
+    // own frame cap only takes whole frame rates, so it stays off in serial
+    // mode. In threaded mode the emulation thread paces the core and the
+    // render loop presents at the display's rate.
+    double core_fps = (frontend.fps > 0.0) ? frontend.fps : 60.0;
+    int refresh = GetMonitorRefreshRate(GetCurrentMonitor());
+    libretro_pacing_t pacing;
+    libretro_pacing_init(&pacing, options.pacing, core_fps, refresh > 0 ? refresh : 0, options.max_skew);
+    unsigned target_fps = (unsigned)(core_fps + 0.5);
     if (target_fps < 1) target_fps = 60;
     if (target_fps > 120) target_fps = 120; // Cap at reasonable maximum
-    SetTargetFPS(target_fps);
-    
-    // Initialize audio device (must be done before creating streams)
-    InitAudioDevice();
-    
-    // Set larger default buffer size for audio streams to prevent scratchiness
-    // This gives more headroom and reduces underruns
-    SetAudioStreamBufferSizeDefault(4096);
-    
-    // Wait a moment for audio device to be ready
-    // Then create audio stream now that we know the sample rate
-    // Some cores report non-standard rates (like 65536 Hz), so we'll use a standard rate
-    // and let the audio system handle it, or clamp to a reasonable value
-    // Handle 0 Hz sample rate (use default)
-    if (!audio_stream_created) {
-        unsigned sample_rate = frontend.audio_sample_rate;
-        if (sample_rate == 0) {
-            fprintf(stderr, "Warning: Sample rate is 0, using default 44100 Hz\n");
-            sample_rate = 44100;
-            frontend.audio_sample_rate = 44100;
+    if (options.threaded && options.pacing != LIBRETRO_PACING_VSYNC) {
+        SetTargetFPS(refresh > 0 ? refresh : (int)target_fps);
+    } else {
+        SetTargetFPS(0);
+    }
+    
+    if (audio_stream_created) {
+        start_audio_stream(&frontend, audio_stream);
+        fprintf(stderr, "Audio initialized: core %u Hz -> output %u Hz, stereo, %u ms buffer\n",
+                frontend.audio_sample_rate, frontend.audio_output_rate, frontend.audio_latency_ms);
+    } else {
+        fprintf(stderr, "Failed to create audio stream at %u Hz\n", frontend.audio_output_rate);
+    }
+    
+    // Audio pacing runs a frame whenever the device has drained the ring to
+    // the fill level rate control aims for
+    if (pacing.mode == LIBRETRO_PACING_AUDIO) {
+        if (audio_stream_created) {
+            libretro_pacing_set_audio(&pacing, &frontend.audio_ring, frontend.audio_ring.capacity / 2);
+        } else {
+            fprintf(stderr, "Warning: no audio stream, pacing frames on the timer\n");
+            pacing.mode = LIBRETRO_PACING_TIMER;
         }
-        
-        // Clamp to reasonable values if the core reports something unusual
-        if (sample_rate < 8000) sample_rate = 8000;
-        if (sample_rate > 192000) sample_rate = 192000;
-        
-        // Try using the actual sample rate first - modern audio systems should handle it
-        // If it's a power-of-2 rate like 65536 or 32768, try it directly
-        // If that fails, fall back to 48000 Hz
-        unsigned original_rate = sample_rate;
-        bool try_original = (sample_rate == 65536 || sample_rate == 32768 || 
-                            (sample_rate >= 44100 && sample_rate <= 96000));
-        
-        if (!try_original && (sample_rate == 65536 || sample_rate == 32768)) {
-            sample_rate = 48000;
+    }
+    libretro_frontend_set_speed(&frontend, libretro_pacing_speed(&pacing));
+    fprintf(stderr, "Pacing: %s, core %.3f fps, display %d Hz, speed x%.4f\n",
+            libretro_pacing_mode_name(pacing.mode), core_fps, refresh, libretro_pacing_speed(&pacing));
+    
+    // Texture is (re)created on demand once frames arrive, matching the
+    // frame's size and whether it is native or converted
+    frame_texture_t frame_texture = {0};
+    
+    // The shaders were built during startup; without the swizzle pass
+    // native frames can't be drawn
+    if (!shaders_ready && frontend.native_upload) {
+        fprintf(stderr, "Warning: swizzle shader unavailable, disabling native upload\n");
+        frontend.native_upload = false;
+    }
+    
+    // Frame timing: one recorder per thread that does frame work, drained
+    // into a log here on the main thread each frame
+    bool perf_enabled = options.perf_overlay || options.perf_dump;
+    libretro_perf_t main_perf = {0};
+    libretro_perf_t emu_perf = {0};
+    libretro_perf_log_t perf_log;
+    libretro_perf_log_init(&perf_log, 0);
+    if (perf_enabled && options.threaded) {
+        if (libretro_perf_init(&emu_perf, "emu", LIBRETRO_PERF_STAGE_BIT(LIBRETRO_PERF_RUN) |
+                                                 LIBRETRO_PERF_STAGE_BIT(LIBRETRO_PERF_VIDEO) |
+                                                 LIBRETRO_PERF_STAGE_BIT(LIBRETRO_PERF_AUDIO) |
+                                                 LIBRETRO_PERF_STAGE_BIT(LIBRETRO_PERF_REWIND))) {
+            frontend.perf = &emu_perf;
         }
-        
-        // Try creating the audio stream with the actual sample rate first
-        // Use 32-bit sample size since we're providing float samples
-        audio_stream = LoadAudioStream(
-            sample_rate,  // Sample rate (try actual rate first)
-            32,           // Sample size (bits) - 32 for float samples
-            2             // Channels (stereo)
-        );
-        
-        if (IsAudioStreamReady(audio_stream)) {
-            PlayAudioStream(audio_stream);
-            audio_stream_created = true;
-            fprintf(stderr, "Audio initialized: %u Hz, stereo\n", sample_rate);
-        } else {
-            fprintf(stderr, "Failed to create audio stream at %u Hz\n", sample_rate);
-            // If original rate failed and it was unusual, try 48000 Hz fallback
-            if (original_rate == 65536 || original_rate == 32768) {
-                audio_stream = LoadAudioStream(48000, 32, 2);
-                if (IsAudioStreamReady(audio_stream)) {
-                    PlayAudioStream(audio_stream);
-                    audio_stream_created = true;
-                }
-            }
+    }
+    
+    // Threaded mode: from here on the core only runs on the emulation thread
+    libretro_pipeline_t pipeline;
+    bool threaded = false;
+    if (options.threaded) {
+        threaded = libretro_pipeline_init(&pipeline, &frontend);
+        pipeline.pacing = &pacing;
+        threaded = threaded && libretro_pipeline_start(&pipeline);
+        if (!threaded) {
+            fprintf(stderr, "Warning: falling back to serial mode\n");
+            SetTargetFPS(0);
         }
     }
     
-    // Create texture for rendering
-    // Texture will be recreated if dimensions change
-    Texture2D texture = {0};
-    unsigned current_texture_width = 0;
-    unsigned current_texture_height = 0;
-    
-    // Initial texture creation
-    if (frontend.framebuffer && width > 0 && height > 0) {
-        Image img = {
-            .data = frontend.framebuffer,
-            .width = (int)width,
-            .height = (int)height,
-            .format = PIXELFORMAT_UNCOMPRESSED_R8G8B8A8,
-            .mipmaps = 1
-        };
-        
-        texture = LoadTextureFromImage(img);
-        current_texture_width = width;
-        current_texture_height = height;
-        
-        // Ensure texture is properly initialized
-        if (texture.id == 0) {
-            fprintf(stderr, "Failed to create texture\n");
-            CloseWindow();
-            libretro_frontend_deinit(&frontend);
-            return 1;
+    libretro_perf_t* render_perf = NULL;
+    if (perf_enabled) {
+        uint32_t mask = LIBRETRO_PERF_ALL_STAGES;
+        if (threaded) {
+            mask = LIBRETRO_PERF_STAGE_BIT(LIBRETRO_PERF_INPUT) | LIBRETRO_PERF_STAGE_BIT(LIBRETRO_PERF_UPLOAD) |
+                   LIBRETRO_PERF_STAGE_BIT(LIBRETRO_PERF_PRESENT) | LIBRETRO_PERF_STAGE_BIT(LIBRETRO_PERF_FRAME);
+        }
+        if (libretro_perf_init(&main_perf, threaded ? "render" : "main", mask)) {
+            render_perf = &main_perf;
+            libretro_perf_log_attach(&perf_log, &main_perf);
+        }
+        if (threaded && frontend.perf) {
+            libretro_perf_log_attach(&perf_log, &emu_perf);
+        } else if (!threaded) {
+            frontend.perf = render_perf;
         }
     }
     
+    // Serial mode polls input from inside retro_run, when the core asks for it
+    if (!threaded) {
+        frontend.input_poll_handler = poll_input_late;
+        frontend.input_poll_userdata = &frontend;
+    }
     
-    // Audio buffer for streaming
-    float audio_buffer[4096 * 2]; // Stereo buffer
+    // Frame delay: run the core later in the frame so its input is fresher;
+    // it must leave enough of the frame for the core and the upload
+    double frame_delay = options.frame_delay / 1000.0;
+    if (frame_delay > 0.0 && threaded) {
+        fprintf(stderr, "Warning: --frame-delay has no effect in threaded mode\n");
+        frame_delay = 0.0;
+    } else if (frame_delay > 0.75 / target_fps) {
+        frame_delay = 0.75 / target_fps;
+        fprintf(stderr, "Frame delay clamped to %.1f ms\n", frame_delay * 1000.0);
+    }
+    
+    frame_view_t view = {0};
+    bool first_frame_shown = false;
     
     // Main loop
     while (!WindowShouldClose()) {
-        // Update input
-        update_input(&frontend);
-        
-        // Reset core if R key is pressed (for debugging/recovery)
-        if (IsKeyPressed(KEY_R)) {
-            fprintf(stderr, "Resetting core...\n");
-            libretro_frontend_reset(&frontend);
+        input_begin_frame();
+        if (frame_delay > 0.0) {
+            WaitTime(frame_delay);
         }
         
-        // Run one frame of the core
-        libretro_frontend_run_frame(&frontend);
+        // Rewind while Backspace is held; the core's thread does the stepping
+        if (frontend.rewind) {
+            libretro_rewind_set_rewinding(&rewind, IsKeyDown(KEY_BACKSPACE));
+        }
         
-        // Update audio stream - feed audio aggressively to prevent underruns
-        // This is critical for smooth audio playback
-        if (audio_stream_created) {
-            // Feed audio whenever the stream needs it - check multiple times per frame
-            // to ensure buffer stays full
-            while (IsAudioStreamProcessed(audio_stream)) {
-                // Buffer needs refill - read as much as we can to fill it up
-                size_t frames_read = libretro_frontend_get_audio_samples(&frontend, audio_buffer, 4096);
-                if (frames_read > 0) {
-                    UpdateAudioStream(audio_stream, audio_buffer, (int)frames_read);
-                } else {
-                    // No audio available, break to avoid busy loop
-                    break;
-                }
+        // Serial mode runs the core here (one frame, or in vsync pacing as many
+        // as came due this refresh), sampling input when the core polls;
+        // threaded mode updates input for the emulation thread
+        // (a press that lands mid-frame is seen on its next poll) and picks up
+        // whatever it published most recently (render-side conversion counts
+        // as upload time)
+        // Audio is pulled by the audio thread (audio_stream_callback), so there
+        // is nothing to feed here
+        uint64_t mark = render_perf ? libretro_perf_now_ns() : 0;
+        unsigned frames_run = 0;
+        if (threaded) {
+            update_input(&frontend);
+            mark = perf_lap(render_perf, LIBRETRO_PERF_INPUT, mark);
+            frame_view_from_pipeline(&pipeline, frontend.native_upload, &view);
+        } else {
+            for (unsigned due = libretro_pacing_frames_due(&pacing); due > 0; due--) {
+                frames_run += libretro_frontend_run_display_frame(&frontend); // Times INPUT/RUN/VIDEO/AUDIO itself
+            }
+            // No core frame polled this refresh (none came due, or rewind is
+            // holding at its oldest state): EndDrawing would drop the queued
+            // presses, so hotkeys and held keys are taken here instead
+            if (!g_input.polled) {
+                update_input(&frontend);
             }
+            if (hw_render) {
+                hw_restore_raylib_state();
+                libretro_hw_ensure_size(&frontend.hw, frontend.max_width, frontend.max_height);
+            }
+            frame_view_from_frontend(&frontend, &view);
+            if (render_perf) mark = libretro_perf_now_ns();
         }
         
+        // F toggles fast-forward; serial mode paces it below (the emulation
+        // thread paces itself in threaded mode)
+        if (input_key_pressed(KEY_F) &&
+            !libretro_frontend_set_fastforward(&frontend, !frontend.fastforward)) {
+            fprintf(stderr, "Fast-forward is controlled by the core\n");
+        }
         
-        // Check if dimensions changed and recreate texture if needed
-        unsigned new_width, new_height;
-        libretro_frontend_get_video_size(&frontend, &new_width, &new_height);
+        // F2/F4 save and load the current state slot, F6/F7 pick the slot
+        if (input_key_pressed(KEY_F6) || input_key_pressed(KEY_F7)) {
+            save_slot += input_key_pressed(KEY_F7) ? 1 : -1;
+            save_slot = (save_slot + LIBRETRO_SAVE_SLOTS) % LIBRETRO_SAVE_SLOTS;
+            libretro_save_select_slot(&save, save_slot);
+        }
+        if (input_key_pressed(KEY_F2)) libretro_save_request_state(&save);
+        if (input_key_pressed(KEY_F4)) libretro_save_request_load(&save);
         
-        if (new_width != current_texture_width || new_height != current_texture_height) {
-            // Dimensions changed, recreate texture
-            if (texture.id != 0) {
-                UnloadTexture(texture);
+        // Reset core if R key is pressed (for debugging/recovery)
+        if (input_key_pressed(KEY_R)) {
+            if (threaded) {
+                libretro_pipeline_request_reset(&pipeline);
+            } else {
+                fprintf(stderr, "Resetting core...\n");
+                libretro_frontend_reset(&frontend);
             }
+        }
+        
+        // Check if display dimensions changed and resize the window
+        unsigned new_width = view.display_width, new_height = view.display_height;
+        if ((new_width != width || new_height != height) && new_width > 0 && new_height > 0) {
+            width = new_width;
+            height = new_height;
             
-            if (frontend.framebuffer && new_width > 0 && new_height > 0) {
-                Image img = {
-                    .data = frontend.framebuffer,
-                    .width = (int)new_width,
-                    .height = (int)new_height,
-                    .format = PIXELFORMAT_UNCOMPRESSED_R8G8B8A8,
-                    .mipmaps = 1
-                };
-                
-                texture = LoadTextureFromImage(img);
-                current_texture_width = new_width;
-                current_texture_height = new_height;
-                width = new_width;
-                height = new_height;
-                
-                // Recalculate window scaling
-                int window_width = width * 3;
-                int window_height = height * 3;
-                SetWindowSize(window_width, window_height);
-            }
+            // Recalculate window scaling
+            window_width = width * 3;
+            window_height = height * 3;
+            SetWindowSize(window_width, window_height);
         }
         
-        // Update texture with new frame data
-        if (texture.id != 0 && frontend.framebuffer) {
-            UpdateTexture(texture, frontend.framebuffer);
+        // Upload the new frame: straight from the core's buffer when it is in a
+        // GPU-friendly format, otherwise from the converted RGBA8888 framebuffer
+        if (view.pixels &&
+            frame_texture_ensure(&frame_texture, view.texture_width, view.texture_height, view.texture_format) &&
+            (view.dirty || frame_texture.needs_full_upload)) {
+            frame_texture_upload(&frame_texture, view.pixels, view.row_bytes, view.first_row, view.end_row);
         }
+        view.dirty = false;
+        mark = perf_lap(render_perf, LIBRETRO_PERF_UPLOAD, mark);
         
         // Render
         BeginDrawing();
         ClearBackground(BLACK);
         
-        // Calculate centered position maintaining aspect ratio
-        float scale = fminf((float)window_width / width, (float)window_height / height);
-        int render_width = (int)(width * scale);
-        int render_height = (int)(height * scale);
-        int render_x = (window_width - render_width) / 2;
-        int render_y = (window_height - render_height) / 2;
+        // Centered, aspect ratio kept; the frame is scaled to it on the GPU
+        Rectangle viewport = libretro_shader_chain_viewport(&shader_chain, width, height,
+                                                            window_width, window_height);
         
-        DrawTexturePro(
-            texture,
-            (Rectangle){0, 0, (float)width, (float)height},
-            (Rectangle){(float)render_x, (float)render_y, (float)render_width, (float)render_height},
-            (Vector2){0, 0},
-            0.0f,
-            WHITE
-        );
+        if (hw_render && frontend.hw.frame_valid) {
+            // Drawn straight from the FBO's color texture, no readback; GL
+            // images are stored bottom-up, which a negative height flips
+            Texture2D fbo_texture = {
+                .id = frontend.hw.color_texture,
+                .width = (int)frontend.hw.width,
+                .height = (int)frontend.hw.height,
+                .mipmaps = 1,
+                .format = PIXELFORMAT_UNCOMPRESSED_R8G8B8A8
+            };
+            float source_height = (float)frontend.hw.frame_height;
+            libretro_shader_chain_draw(&shader_chain, fbo_texture,
+                (Rectangle){0, 0, (float)frontend.hw.frame_width,
+                            frontend.hw.callback.bottom_left_origin ? -source_height : source_height},
+                false, viewport);
+        } else if (frame_texture.texture.id != 0) {
+            libretro_shader_chain_draw(&shader_chain, frame_texture.texture, view.source, view.swizzle, viewport);
+        }
         
         // Draw FPS
         DrawFPS(10, 10);
+        if (options.perf_overlay && render_perf) {
+            draw_perf_overlay(&perf_log, &pacing);
+        }
         
         EndDrawing();
+        perf_lap(render_perf, LIBRETRO_PERF_PRESENT, mark);
+        if (!first_frame_shown && (frame_texture.texture.id != 0 || (hw_render && frontend.hw.frame_valid))) {
+            first_frame_shown = true;
+            fprintf(stderr, "Startup: first frame %.1f ms after launch (core %.1f ms, content %.1f ms, "
+                    "window/audio/shaders %.1f ms alongside; core metadata %s)\n",
+                    (libretro_perf_now_ns() - launch_ns) / 1e6, startup.core_ns / 1e6,
+                    startup.content_ns / 1e6, devices_ns / 1e6, meta_cached ? "cached" : "not cached");
+        }
+        libretro_pacing_present(&pacing);
+        libretro_frontend_set_speed(&frontend, libretro_pacing_speed(&pacing));
+        libretro_perf_end_frame(render_perf);
+        libretro_perf_log_drain(&perf_log);
+        
+        // Serial mode waits for the next frame here, unless vsync already
+        // did; fast-forward is unthrottled unless the core asked for a speed
+        if (!threaded && pacing.mode != LIBRETRO_PACING_VSYNC) {
+            double speedup = 1.0;
+            if (frontend.fastforward) {
+                speedup = (frontend.fastforward_ratio >= 1.0f) ? frontend.fastforward_ratio : 0.0;
+            }
+            libretro_pacing_set_core_fps(&pacing, frontend.fps);
+            libretro_pacing_wait(&pacing, frames_run, speedup);
+        }
     }
+    print_pacing_stats(&pacing);
+    
+    if (threaded) {
+        libretro_pipeline_stop(&pipeline);
+        fprintf(stderr, "Pipeline: %llu frames emulated, %llu presented\n",
+                (unsigned long long)pipeline.frames_run, (unsigned long long)pipeline.frames_acquired);
+        libretro_pipeline_free(&pipeline);
+    }
+    libretro_capture_stop(&capture);
+    
+    if (perf_enabled) {
+        libretro_perf_log_drain(&perf_log);
+        libretro_perf_log_print_report(&perf_log, stderr);
+        if (options.perf_dump) {
+            libretro_perf_log_dump(&perf_log, options.perf_dump);
+        }
+        frontend.perf = NULL;
+    }
+    libretro_perf_log_free(&perf_log);
+    libretro_perf_free(&main_perf);
+    libretro_perf_free(&emu_perf);
     
     // Cleanup
     if (audio_stream_created) {
         StopAudioStream(audio_stream);
         UnloadAudioStream(audio_stream);
+        g_audio_frontend = NULL;
     }
     CloseAudioDevice();
-    UnloadTexture(texture);
+    if (frame_texture.texture.id != 0) {
+        UnloadTexture(frame_texture.texture);
+    }
+    libretro_shader_chain_free(&shader_chain);
+    libretro_hw_context_destroy(&frontend.hw);
     CloseWindow();
+    libretro_save_free(&save);
+    libretro_movie_stop(&movie);
+    print_rewind_stats(&rewind);
+    libretro_rewind_free(&rewind);
+    libretro_runahead_free(&runahead);
+    libretro_frontend_print_memory(&frontend);
     libretro_frontend_deinit(&frontend);
     
     return 0;